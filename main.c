@@ -15,21 +15,137 @@ Requirements  : Windows OS, C Compiler, CSV file stores the students's data in M
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <winsock2.h> // Must come before windows.h
+#include <ws2tcpip.h>
 #include <windows.h>
 #include <conio.h>
 #include <ctype.h>
+#include <stdarg.h>
+#include <math.h>
+#include <io.h>
+
+#ifdef _MSC_VER
+#pragma comment(lib, "ws2_32.lib") // Winsock, MinGW links it with -lws2_32
+#endif
 
 
 
 // Defining Constants
 #define MAX_LINE_LENGTH 1024
 #define DATABASE_FILE "students.csv" // CSV file to store student data
+#define DATABASE_TEMP_FILE "students.csv.tmp" // Temporary file the database is written to before it replaces DATABASE_FILE
+#define DATABASE_DIRECTORY "."       // Directory of DATABASE_FILE, watched for edits made outside the program
+#define DATABASE_LOCK_FILE "students.csv.lock" // Locked by a program while it saves DATABASE_FILE, so saves of several programs never overlap
+#define CONFLICT_FILE "edit_conflicts.txt"     // Edits that lost to a save of another program running on the same database
+#define SAVE_COALESCE_MS 500         // Quiet time the background saver waits for more edits before saving
+#define SAVE_MAX_DELAY_MS 3000       // Longest time an edit waits to be saved during a burst of edits
+#define RECORD_STORE_FILE "students.dat" // Fixed-width binary record store, used instead of the CSV file when it exists
+#define RECORD_STORE_MAGIC "SRMSREC1"    // First bytes of RECORD_STORE_FILE
+#define RECORD_HEADER_SIZE 16            // Magic, record size and number of mark columns
+#define RECORD_SIZE 128                  // Bytes per student slot in RECORD_STORE_FILE
+#define ROLL_INDEX_SIZE 128              // Slots of the roll number hash index, a power of two above 2 * MAX_STUDENTS
+#define STORE_PAGE_ROWS 8                // Students per copy-on-write page of a store snapshot
+#define MAX_TRANSACTION_OPS (2 * MAX_STUDENTS) // Operations in one transaction, enough to promote every student of a shard
+#define CSV_CHUNK_ROWS 1024               // Rows formatted by one thread per chunk when saving a CSV file
+#define MAX_CSV_WRITERS 16               // Maximum number of threads formatting CSV chunks at the same time
+#define SHARD_MANIFEST_FILE "shards.txt"  // Manifest of the sharded layout, the database is sharded when it exists
+#define SHARD_FILE_PREFIX "students_"     // Shard files are named students_<Branch>_<Semester>.csv
+#define MAX_SHARDS 32                     // Maximum number of branch/semester shards
 #define MAX_NAME_LENGTH 50           // Maximum length for student names
 #define MAX_ROLLNO_LENGTH 20         // Maximum length for roll numbers
 #define MAX_LENGTH 30                // Maximum length for branch name
 #define MAX_STUDENTS 40              // Maximum number of students allowed
 #define NUM_SUBJECTS 4               // Number of theory subjects
 #define NUM_SUBJECTS_PRAC 7          // Number of practical subjects
+#define MAX_GRADES 12                // Maximum number of grades in the grading scale
+#define MAX_SUBJECT_MARKS 100        // Upper bound for the theory + practical marks of one subject
+#define GRADING_CONFIG_FILE "grading_config.txt" // Optional file overriding credits and grade boundaries
+#define SUBJECT_REPORT_PREFIX "subject_wise_result_" // File name prefix of the all-subjects export
+#define REPORT_BUFFER_SIZE (64 * 1024)   // Buffer size of each report writer
+#define QUERY_MAX_CODE 128               // Maximum number of instructions in a compiled query
+#define QUERY_MAX_STRINGS 16             // Maximum number of text values in a compiled query
+#define QUERY_MAX_STACK 16               // Maximum nesting depth of a query
+#define QUERY_RESULT_FILE "query_result.txt" // File the matched students of a query are saved to
+#define STREAM_BLOCK_SIZE (1024 * 1024)  // Bytes read from an archive file per read call
+#define STREAM_BATCH_ROWS 4096           // Students parsed per batch while streaming an archive file
+#define ARCHIVE_REPORT_FILE "archive_subject_wise_result.txt" // Subject-wise report of an archive file
+#define ARCHIVE_LIST_FILE "archive_query_result.txt"          // Filtered listing of an archive file
+#define ARCHIVE_EXPORT_FILE "archive_export.csv"              // Filtered export of an archive file
+#define ARCHIVE_CORRELATION_FILE "archive_correlation.txt"    // Correlation and covariance matrices of an archive file
+#define CORRELATION_BUFFER_ROWS 65536                         // Rows of columnar marks collected before they are processed in parallel
+#define CORRELATION_BLOCK_ROWS 1024                           // Rows per block of the correlation kernel, the block's columns stay in cache
+#define MAX_CORRELATION_WORKERS 16                            // Maximum number of threads accumulating one buffer
+#define ARCHIVE_GROUP_FILE "archive_group_summary.txt"        // Group-by summary of an archive file
+#define GROUP_BUFFER_ROWS 65536                               // Students collected before they are aggregated in parallel
+#define GROUP_KEY_LENGTH 64                                   // Maximum length of a group key, e.g. "CSE/5/23"
+#define MAX_GROUP_WORKERS 16                                  // Maximum number of threads aggregating groups
+#define CAMPUS_MANIFEST_FILE "campus_databases.txt"           // Default list of database files for the campus-wide report
+#define CAMPUS_REPORT_FILE "campus_report.txt"                // Campus-wide report written by campusReport()
+#define MAX_DATABASES 64                                      // Maximum number of databases in one campus-wide report
+#define SKETCH_FILE_SUFFIX ".sketch"                          // Quantile sketch saved next to a database file, e.g. students.csv.sketch
+#define SKETCH_MAGIC "SRMSQSK1"                               // First bytes of a sketch file
+#define RECONCILE_REPORT_FILE "reconcile_report.txt"          // Differences found by reconcileDatabases()
+#define RECONCILE_MERGED_FILE "reconciled.csv"                // Default name of the merged database written by reconcileDatabases()
+#define HISTORY_FILE "history.dat"                            // Marks sheets of the earlier semesters of every student
+#define HISTORY_MAGIC "SRMSHIS1"                              // First bytes of HISTORY_FILE
+#define MAX_SEMESTERS 12                                      // Most semesters kept in the history of one student
+#define TRANSCRIPT_FILE "transcript.txt"                      // Transcript saved by viewTranscript()
+#define ARROW_EXPORT_FILE "students.arrow"                    // Database exported as an Apache Arrow IPC file
+#define ARROW_QUERY_FILE "query_result.arrow"                 // Matched students of a query exported to Arrow
+#define ARROW_SUBJECT_FILE "subject_wise_result.arrow"        // Subject-wise result exported to Arrow
+#define ARCHIVE_ARROW_FILE "archive_export.arrow"             // Filtered export of an archive file to Arrow
+#define ARROW_MAGIC "ARROW1"                                  // First and last bytes of an Arrow IPC file
+#define ARROW_MAX_COLUMNS (NUM_MARK_COLUMNS + 4)              // Columns of the widest Arrow export, the full student table
+#define ARROW_MAX_DICTIONARY 1024                             // Most distinct branches in one Arrow export
+#define ARROW_BATCH_ROWS 65536                                // Students per record batch of an Arrow export from memory
+#define FLAT_MAX_FIELDS 8                                     // Most fields of a flatbuffer table written by the Arrow exporter
+#define XLSX_EXPORT_FILE "students.xlsx"                      // Database exported as an Excel workbook
+#define XLSX_QUERY_FILE "query_result.xlsx"                   // Matched students of a query exported to Excel
+#define XLSX_CARDS_FILE "result_cards.xlsx"                   // Result cards of every student exported to Excel
+#define XLSX_SUBJECT_FILE "subject_wise_result.xlsx"          // Subject-wise result exported to Excel
+#define XLSX_MY_RESULT_FILE "my_result.xlsx"                  // Result card downloaded by a student
+#define ARCHIVE_XLSX_FILE "archive_export.xlsx"               // Filtered export of an archive file to Excel
+#define XLSX_SHEET_ROWS 1048576                               // Most rows Excel reads from one worksheet
+#define XLSX_MAX_SHEETS 16                                    // Most worksheets of an exported workbook
+#define ZIP_MAX_ENTRIES (XLSX_MAX_SHEETS + 5)                 // Files of a workbook : the worksheets and 5 fixed parts
+#define DEFLATE_WINDOW 32768                                  // Distance deflate matches can reach back
+#define DEFLATE_HASH_SIZE 32768                               // Hash chains of the deflate compressor, a power of 2
+#define DEFLATE_MAX_CHAIN 16                                  // Earlier positions tried for each match
+#define DEFLATE_MAX_MATCH 258                                 // Longest deflate match
+#define DEFLATE_OUTPUT_SIZE 65536                             // Compressed bytes buffered before they are written
+#define SAVE_MERGE_RETRIES 8                                  // Merges saveToCSV() tries while other programs keep saving first
+#define REPLICATION_PORT "47048"                              // Suggested TCP port a primary serves its followers on
+#define REPLICATION_MAGIC "SRMSREP1"                          // First bytes a follower sends when it connects
+#define REPLICATION_HELLO_SIZE 28                             // Magic, epoch, last applied log position, record size and mark columns
+#define REPLICATION_FRAME_HEADER 21                           // Frame type, log position, time and record count
+#define REPLICATION_LOG_SIZE 65536                            // Committed changes a primary keeps for followers catching up, a power of 2
+#define REPLICATION_BATCH 256                                 // Most changes sent to a follower in one write
+#define REPLICATION_HEARTBEAT_MS 1000                         // Longest silence of a primary towards an idle follower
+#define REPLICATION_MAX_SNAPSHOT 1000000                      // Most students a follower accepts in one snapshot, bounds its allocation
+#define REPLICATION_RETRY_MS 2000                             // Wait of a follower before it reconnects to its primary
+#define REPLICATION_BUFFER_SIZE 65536                         // Bytes of replication frames sent or received at once
+#define MAX_FOLLOWERS 8                                       // Followers one primary serves at the same time
+#define TRACE_FILE "session_trace.txt"                        // Every session appends its operations to this file while it exists
+#define REPLAY_REPORT_FILE "replay_report.txt"                // Throughput and latency of the last replay
+#define REPLAY_MAX_INSTANCES 64                               // Most copies of a trace replayed at the same time
+#define MARK_ERROR_FILE "mark_errors.txt"                     // Students of the loaded database whose marks are out of range
+#define REJECTED_ROWS_FILE "rejected_rows.csv"                // Rows edited outside the program that were not merged, kept to be corrected
+#define STORE_PAGE_COUNT ((MAX_STUDENTS + STORE_PAGE_ROWS - 1) / STORE_PAGE_ROWS) // Pages of a full store snapshot
+
+// Number of mark columns (theory columns first, then practical columns)
+#define NUM_MARK_COLUMNS (NUM_SUBJECTS + NUM_SUBJECTS_PRAC)
+
+// Bit masks of mark columns, bit c standing for mark column c, as reported by validateMarkRows()
+#define THEORY_MARK_COLUMNS ((1u << NUM_SUBJECTS) - 1)
+#define ALL_MARK_COLUMNS ((1u << NUM_MARK_COLUMNS) - 1)
+#define PRACTICAL_MARK_COLUMNS (ALL_MARK_COLUMNS & ~THEORY_MARK_COLUMNS)
+
+// Longest encoding of one semester sheet in a history block : the semester and every mark column, 5 varint bytes each at most
+#define HISTORY_SHEET_BYTES ((NUM_MARK_COLUMNS + 1) * 5)
+
+// Longest CSV line of a student : text fields, the semester and the marks (11 characters each at most) with their commas
+#define MAX_CSV_ROW_LENGTH (MAX_ROLLNO_LENGTH + MAX_NAME_LENGTH + MAX_LENGTH + (NUM_MARK_COLUMNS + 1) * 12 + 4)
 
 // Calculates the total number of subjects in the subjectMarks array 
 #define TOTAL_SUBJECTS (sizeof(subjectMarks) / sizeof(SubjectMaxMarks))
@@ -82,30 +198,137 @@ typedef struct
 
 
 
+// Copy-on-write page of a store snapshot, shared by every snapshot in which its students are unchanged
+typedef struct
+{
+    volatile LONG refCount;         // Number of snapshots using the page
+    Student rows[STORE_PAGE_ROWS];  // Students of the page
+
+} StorePage;
+
+
+
+// Committed version of the students, read by other threads without locks
+typedef struct
+{
+    volatile LONG refCount;             // Readers holding the snapshot, plus one while it is the current version
+    long version;                       // Store version, incremented by every commit
+    int count;                          // Number of students
+    StorePage *pages[STORE_PAGE_COUNT]; // Pages holding the students, NULL after the last used page
+
+} StoreSnapshot;
+
+
+
+// Rows read by a CSV writer : the students of a snapshot, or rows of an array (all of them or those listed in indexes)
+typedef struct
+{
+    const StoreSnapshot *snapshot; // Snapshot to read, NULL to read rows
+    const Student *rows;           // Student array to read when snapshot is NULL
+    const int *indexes;            // Indexes in rows of the students to write, NULL for all rows
+    const char *branch;            // Only students of this branch/semester are written, or all students if NULL
+    int semester;
+
+} CSVSource;
+
+
+
+// One chunk of rows formatted by a CSV writer thread
+typedef struct
+{
+    const CSVSource *source;
+    int first;       // First row of the chunk
+    int last;        // Row after the last row of the chunk
+    char *buffer;    // Formatted lines, MAX_CSV_ROW_LENGTH bytes per row of the chunk
+    size_t length;   // Bytes formatted in buffer
+
+} CSVChunk;
+
+
+
+/* TransactionOpType - Enum for the operations that can be staged in a transaction */
+typedef enum
+{
+    TXN_ADD,    // Add a new student
+    TXN_UPDATE, // Replace a student's details and marks
+    TXN_DELETE  // Delete a student, only the roll number is used
+} TransactionOpType;
+
+
+
+// One staged operation of a transaction
+typedef struct
+{
+    TransactionOpType type;
+    Student student;
+
+} TransactionOp;
+
+
+
+// Adds, updates and deletes that are committed together or not at all
+typedef struct
+{
+    TransactionOp ops[MAX_TRANSACTION_OPS];
+    int count;
+
+} Transaction;
+
+
+
 // Structure to store maximum marks for each subject
 typedef struct
 {
     const char *subject;
     int maxTheory;
     int maxPractical;
+    int credits;
 
 } SubjectMaxMarks;
 
 
 
 // Array to map subjects to their max theory and practical marks
-// A structure and an array for mapping subjects to their max marks
+// A structure and an array for mapping subjects to their max marks and credits
 SubjectMaxMarks subjectMarks[] = {
 
-    {"Software Engineering", 30, 0},
-    {"Android Application Development", 30, 30},
-    {"Java Programming", 30, 30},
-    {"Computer Hardware and Servicing", 30, 30},
-    {"Minor Project Work", 0, 50},
-    {"Industrial Exposure", 0, 25},
-    {"Industrial Training", 0, 30},
-    {"General Proficiency", 0, 25},
+    {"Software Engineering", 30, 0, 3},
+    {"Android Application Development", 30, 30, 4},
+    {"Java Programming", 30, 30, 4},
+    {"Computer Hardware and Servicing", 30, 30, 4},
+    {"Minor Project Work", 0, 50, 2},
+    {"Industrial Exposure", 0, 25, 1},
+    {"Industrial Training", 0, 30, 2},
+    {"General Proficiency", 0, 25, 1},
+};
+
+
+
+// Structure to store one grade of the grading scale
+typedef struct
+{
+    char grade[4];  // Grade letter shown on the result card
+    int minPercent; // Minimum percentage of the subject's maximum marks for this grade
+    int gradePoint; // Grade point used for SGPA, 0 means the subject is failed
+
+} GradeBoundary;
+
+
+
+// Grading scale, ordered from the highest to the lowest grade
+GradeBoundary gradeScale[MAX_GRADES] = {
+
+    {"O", 90, 10},
+    {"A+", 80, 9},
+    {"A", 70, 8},
+    {"B+", 60, 7},
+    {"B", 50, 6},
+    {"C", 45, 5},
+    {"P", 40, 4},
+    {"F", 0, 0},
 };
+int gradeCount = 8; // Number of grades in gradeScale
+
 
 
 
@@ -113,21 +336,419 @@ SubjectMaxMarks subjectMarks[] = {
 Student students[MAX_STUDENTS]; // Array to store student records
 int studentCount = 0;           // Count of the students in the system
 
+// Store snapshots : students[] is only read and written by the main thread, other threads read the current snapshot
+StoreSnapshot *volatile currentSnapshot = NULL; // Latest committed version, replaced atomically by commits
+volatile LONG snapshotReaders = 0;              // Threads between loading currentSnapshot and taking a reference on it
+long storeVersion = 0;                          // Version of the latest commit
+
+// Background saver state, protected by storeLock
+CRITICAL_SECTION storeLock;     // Held while the saver state is changed
+CONDITION_VARIABLE saverWake;   // Signalled when an edit is made or the program exits
+HANDLE saverThread = NULL;      // Background saver thread, NULL if saving is synchronous
+long editGeneration = 0;        // Incremented for every edit
+long savedGeneration = 0;       // Edit generation contained in the database file
+int saverStopping = 0;          // Set when the program exits
+int savingDatabaseFile = 0;     // Set while the saver writes a file, the file may then be half replaced
+
+// FileSignature - Size and last write time of a file, compared to notice that it was replaced or edited
+typedef struct
+{
+    long long size;       // Size in bytes, -1 if the file does not exist
+    long long writeTime;  // Last write time (FILETIME units)
+
+} FileSignature;
+
+// External edit watching : DATABASE_FILE edited outside the program (e.g. in MS Excel) is merged into students[]
+HANDLE fileWatcher = NULL;                  // Thread waiting for change notifications of DATABASE_DIRECTORY
+HANDLE fileWatcherStop = NULL;              // Event telling the watcher thread to exit
+int fileWatcherStarted = 0;                 // Set once watching has started, even if no thread could be started
+volatile LONG externalEditPending = 0;      // Set by the watcher thread, cleared by reloadExternalEdits()
+StoreSnapshot *savedFileSnapshot = NULL;    // Students as last written to or read from DATABASE_FILE, protected by storeLock
+FileSignature savedFileSignature = {-1, 0}; // Signature of DATABASE_FILE when it held savedFileSnapshot, protected by storeLock
+
+// RecordStamp - Version stamp of a student changed by this program and not saved to DATABASE_FILE yet
+typedef struct
+{
+    char rollNo[MAX_ROLLNO_LENGTH]; // Student added, updated or deleted
+    long version;                   // editGeneration of the save that will contain the change
+} RecordStamp;
+
+// Concurrent editing : students changed since the last save, checked against the rows other programs saved meanwhile
+RecordStamp *recordStamps = NULL;   // One stamp per changed student and commit, protected by storeLock
+int recordStampCount = 0;
+int recordStampCapacity = 0;
+volatile LONG saveNeedsMerge = 0;   // Set by the saver when it stopped before merging a save of another program
+
+// Roll number index : open addressing hash table holding (index in students[] + 1), 0 marks an empty slot
+int rollIndex[ROLL_INDEX_SIZE];
+
+// Fails to compile unless ROLL_INDEX_SIZE is a power of two above 2 * MAX_STUDENTS, as the index probing requires
+typedef char RollIndexSizeCheck[((ROLL_INDEX_SIZE & (ROLL_INDEX_SIZE - 1)) == 0 && ROLL_INDEX_SIZE > 2 * MAX_STUDENTS) ? 1 : -1];
+
+// Background loading state
+HANDLE databaseLoaded = NULL;         // Manual-reset event set by the loader thread once the database is loaded
+HANDLE loaderThread = NULL;           // Loader thread, NULL when the database is loaded or was loaded synchronously
+int databaseReady = 0;                // Set by waitForDatabase() once the main thread may use the data
+int databaseLoadFailed = 0;           // Set by the loader if the first snapshot could not be published
+int loadingInBackground = 0;          // Loader messages are kept in loadReport instead of being printed
+char loadReport[MAX_LINE_LENGTH];     // Messages of the loader, printed by waitForDatabase()
+
+// Record store state
+HANDLE recordStore = NULL;            // Open RECORD_STORE_FILE, NULL when the CSV file is the database
+int studentSlots[MAX_STUDENTS];       // Slot of each student in RECORD_STORE_FILE, kept in the same order as students[]
+int freeSlots[MAX_STUDENTS];          // Deleted slots that can be reused
+int freeSlotCount = 0;
+int recordSlotCount = 0;              // Number of slots in RECORD_STORE_FILE, live or deleted
+int csvExportPending = 0;             // Set when the record store has changes not yet exported to DATABASE_FILE
+
+// Shard - One branch/semester partition of a sharded database, as listed in SHARD_MANIFEST_FILE
+typedef struct
+{
+    char branch[MAX_LENGTH];               // Branch of every student in the shard
+    int semester;                          // Semester of every student in the shard
+    char fileName[MAX_LINE_LENGTH];        // CSV file of the shard
+    int studentCount;                      // Number of students in the shard file
+    char firstRoll[MAX_ROLLNO_LENGTH];     // Smallest roll number in the shard (strcmp order), used to route logins
+    char lastRoll[MAX_ROLLNO_LENGTH];      // Largest roll number in the shard
+    int loaded;                            // 1 once the shard's students are in students[]
+    unsigned long lastUsed;                // shardClock when the shard was last loaded or asked for, to unload the oldest first
+    long editGeneration;                   // Incremented by every commit touching the shard
+    long savedGeneration;                  // Edit generation contained in the shard file
+
+} Shard;
+
+// Sharded storage state, the shard table is changed by the main thread under storeLock
+Shard shards[MAX_SHARDS];
+int shardCount = 0;
+int shardedStorage = 0;               // 1 when the database is SHARD_MANIFEST_FILE and its shard files
+unsigned long shardClock = 0;         // Counts the shard loads and requests, orders Shard.lastUsed
+
+/* ReplicationFrame - Enum for the frames a primary and its followers exchange */
+typedef enum
+{
+    FRAME_ADD = 'A',       // Student added, one record follows
+    FRAME_UPDATE = 'U',    // Student updated, one record follows
+    FRAME_DELETE = 'D',    // Student deleted, one record follows (only its roll number is used)
+    FRAME_SNAPSHOT = 'S',  // Every student at a log position, count records follow and the time holds the primary's epoch
+    FRAME_HEARTBEAT = 'H', // Log position of the primary, sent when there is nothing to stream
+    FRAME_ACK = 'K'        // Sent by a follower : last applied log position and its commit time
+} ReplicationFrame;
+
+// ReplicationEntry - Committed change kept in the replication log for the followers
+typedef struct
+{
+    long long commitTime;              // Wall clock time of the commit in milliseconds, see wallClockMs()
+    unsigned char record[RECORD_SIZE]; // Student as encoded by encodeRecord()
+    char type;                         // FRAME_ADD, FRAME_UPDATE or FRAME_DELETE
+
+} ReplicationEntry;
+
+// Follower - Connection of a read-only follower to this program
+typedef struct
+{
+    SOCKET socket;
+    HANDLE thread;        // Thread streaming the log to the follower, NULL if the slot is free
+    char address[64];     // Address the follower connected from
+    long long ackedLsn;   // Last log position the follower applied
+    long long ackLag;     // Milliseconds from the commit of ackedLsn to its acknowledgement
+    int active;           // Cleared by the thread when the follower disconnects
+    int ackFailed;        // Set by the acknowledgement reader when the follower disconnected or sent a bad frame
+    int closing;          // Set by the streaming thread to stop its acknowledgement reader
+
+} Follower;
+
+// Replication primary state : every committed change gets the next log position and stays in a ring buffer
+// the followers stream from. The log and the followers are protected by replicationLock
+ReplicationEntry *replicationLog = NULL;     // Change at position p is at p % REPLICATION_LOG_SIZE, NULL unless serving followers
+long long replicationLsn = 0;                // Log position of the last committed change
+long long replicationEpoch = 0;              // Start time of the primary, a follower of another epoch needs a new snapshot
+CRITICAL_SECTION replicationLock;
+CONDITION_VARIABLE replicationWake;          // Signalled when a change is logged or replication stops
+SOCKET replicationListener = INVALID_SOCKET; // Socket the followers connect to
+HANDLE followerAcceptThread = NULL;
+Follower followers[MAX_FOLLOWERS];
+volatile LONG replicationStopping = 0;       // Set to disconnect the followers
+
+// Session recording : while TRACE_FILE exists, every session appends its operations to it
+FILE *traceFile = NULL;     // TRACE_FILE opened for appending, NULL while not recording
+int traceChecked = 0;       // Set once the program looked for TRACE_FILE
+int traceSuspended = 0;     // Set while a trace is replayed, so the replayed edits are not recorded again
+char traceSession[32];      // Identifies the lines of this session in TRACE_FILE
+
+// Theory and practical column of each subject of subjectMarks[], -1 if the subject has no such part
+int subjectTheoryColumn[TOTAL_SUBJECTS];
+int subjectPracticalColumn[TOTAL_SUBJECTS];
+
+
+
+/* RankTieMode - Enum for defining how tied students are ranked */
+typedef enum
+{
+    RANK_COMPETITION, // Tied students share a rank and the following ranks are skipped (1, 2, 2, 4)
+    RANK_DENSE        // Tied students share a rank and no rank is skipped (1, 2, 2, 3)
+} RankTieMode;
+
+
+
+// StudentRank - Structure to store the computed ranks of a student
+typedef struct
+{
+    int total;                       // Total marks across all theory and practical subjects
+    int overallRank;                 // Rank among all students
+    int groupRank;                   // Rank within the student's branch and semester
+    int groupSize;                   // Number of students in the student's branch and semester
+    int subjectRank[TOTAL_SUBJECTS]; // Rank for each subject of subjectMarks[] (theory + practical)
+} StudentRank;
+
+
+
+// Rank cache, kept in the same order as students[] and rebuilt whenever a record changes
+StudentRank studentRanks[MAX_STUDENTS];
+int ranksValid = 0;                        // Set to 0 whenever students[] is modified
+RankTieMode rankTieMode = RANK_COMPETITION; // Tie handling used for all ranks
+
+
+
+// StudentGrades - Structure to store the computed grades and SGPA of a student
+typedef struct
+{
+    int gradeIndex[TOTAL_SUBJECTS]; // Index in gradeScale for each subject of subjectMarks[]
+    double sgpa;                    // Credit weighted average of the grade points
+    int passed;                     // 1 if every subject has a non-zero grade point
+} StudentGrades;
+
+
+
+/* QueryOpcode - Enum for the instructions of a compiled query */
+typedef enum
+{
+    QOP_MARK,     // Compare a mark column
+    QOP_TOTAL,    // Compare the total marks
+    QOP_SEMESTER, // Compare the semester
+    QOP_SGPA,     // Compare the SGPA
+    QOP_BRANCH,   // Compare the branch with a text value
+    QOP_NAME,     // Compare the name with a text value
+    QOP_ROLL,     // Compare the roll number with a text value
+    QOP_AND,      // Combine the two topmost results with AND
+    QOP_OR,       // Combine the two topmost results with OR
+    QOP_NOT       // Negate the topmost result
+} QueryOpcode;
+
+
+
+/* QueryCompare - Enum for the comparison operators of a query */
+typedef enum
+{
+    QCMP_EQ,      // =
+    QCMP_NE,      // !=
+    QCMP_LT,      // <
+    QCMP_LE,      // <=
+    QCMP_GT,      // >
+    QCMP_GE,      // >=
+    QCMP_CONTAINS // ~ (text contains, case-insensitive)
+} QueryCompare;
+
+
+
+/* XlsxLayout - Enum for the layouts of an Excel export */
+typedef enum
+{
+    XLSX_STUDENT_LIST,  // One row per student with every mark column
+    XLSX_RESULT_CARDS,  // A block of rows per student with every subject's marks and grade
+    XLSX_SUBJECT_RESULT // One row per student with the marks and grade of one subject
+} XlsxLayout;
+
+
+
+/* TraceOp - Enum for the operations a session trace records, in the order of traceOpNames[] */
+typedef enum
+{
+    TRACE_MENU,    // Menu choice, e.g. "admin 4" (not replayed)
+    TRACE_LOGIN,   // Login, "admin" or the roll number of a student
+    TRACE_RESULT,  // Result of a student viewed, roll number
+    TRACE_SEARCH,  // Student searched, roll number
+    TRACE_LIST,    // All students listed
+    TRACE_SUBJECT, // Subject-wise result, index in subjectMarks[]
+    TRACE_MERIT,   // Merit list, the merit menu choice
+    TRACE_QUERY,   // Query, its text
+    TRACE_ADD,     // Student added, CSV row
+    TRACE_UPDATE,  // Student updated, CSV row
+    TRACE_DELETE,  // Student deleted, roll number
+    TRACE_OP_COUNT
+} TraceOp;
+
+
+
+// QueryInstruction - One instruction of a compiled query
+typedef struct
+{
+    unsigned char opcode;  // QueryOpcode
+    unsigned char compare; // QueryCompare
+    short column;          // Mark column for QOP_MARK, index in strings[] for text fields
+    int operand;           // Numeric value multiplied by 100, so percentages of the maximum marks stay exact
+} QueryInstruction;
+
+
+
+// CompiledQuery - A query parsed once into postfix instructions
+typedef struct
+{
+    QueryInstruction code[QUERY_MAX_CODE];
+    int length;                                       // Number of instructions
+    char strings[QUERY_MAX_STRINGS][MAX_NAME_LENGTH]; // Text values used by the instructions
+    int stringCount;
+    int maxDepth;                                     // Number of result vectors needed to run the query
+    char error[MAX_LINE_LENGTH];                      // Parse error message
+} CompiledQuery;
+
+
+
+// Database - Context of one independently loaded database (e.g. one branch and semester)
+//
+// Everything needed to read and query the database lives in the context, so several databases can be loaded
+// and queried at the same time on different threads. The schema and grading scale are shared and only read.
+typedef struct
+{
+    char fileName[MAX_LINE_LENGTH];  // CSV file of the database
+    const SubjectMaxMarks *schema;   // Subjects and maximum marks, subjectMarks[] for every database
+    int schemaCount;                 // Number of entries in schema
+    Student *students;               // Students, in file order
+    StudentGrades *grades;           // Grades, in the same order as students
+    int count;                       // Number of students
+    int capacity;                    // Allocated entries of students and grades
+    int *rollIndex;                  // Roll number index over students, see insertRollIndex()
+    int rollIndexSize;               // Slots of rollIndex, a power of two above 2 * count
+    int longLines;                   // Lines longer than MAX_LINE_LENGTH, skipped while loading
+
+} Database;
+
+
+
+// ReconcilePolicy - How the marks of a student found in both files are resolved in a merged database
+typedef enum
+{
+    RECONCILE_FIRST,   // Keep the first file's row
+    RECONCILE_SECOND,  // Keep the second file's row
+    RECONCILE_HIGHER,  // Keep the higher marks of each column, details from the first file
+    RECONCILE_AVERAGE  // Average the marks of each column (rounded up), details from the first file
+} ReconcilePolicy;
+
+
+
+// ReconcileSide - One side of a reconciliation : a database file loaded and ordered by roll number
+typedef struct
+{
+    Database db;
+    const Student **order; // Students of db in roll number order
+    int result;            // Result of loadDatabase(), -2 also if the order could not be allocated
+    int sorted;            // 1 if the file was already in roll number order and was not sorted
+    int duplicates;        // Number of roll numbers appearing more than once
+
+} ReconcileSide;
+
+
+
+// ReconcileCounts - Counts of a reconciliation
+typedef struct
+{
+    long long same;                                 // Students with the same row in both files
+    long long changed;                              // Students found in both files with different rows
+    long long added;                                // Students found only in the second file
+    long long removed;                              // Students found only in the first file
+    long long written;                              // Students written to the merged database
+    long long columnChanges[3 + NUM_MARK_COLUMNS];  // Changed students per column : name, branch, semester, then every mark column
+
+} ReconcileCounts;
+
+
+
+// Number of distributions in a quantile sketch : every mark column, then the theory + practical total of every subject
+#define SKETCH_KEYS ((int)(NUM_MARK_COLUMNS + TOTAL_SUBJECTS))
+
+
+
+// MarkSketch - Mergeable quantile sketch of the marks of any number of students
+//
+// Marks are small bounded integers, so the sketch keeps one counter per possible mark of every column : percentiles
+// are exact, memory is constant, adding a student is one increment per column and two sketches merge by adding counters.
+typedef struct
+{
+    long long count;                                           // Students added
+    long long histogram[SKETCH_KEYS][MAX_SUBJECT_MARKS + 1];   // Students per marks, out of range marks are clamped
+
+} MarkSketch;
+
+
+
+// SemesterSheet - Marks of a student in one semester
+typedef struct
+{
+    int semester;
+    int marks[NUM_MARK_COLUMNS]; // Every mark column, theory columns first
+
+} SemesterSheet;
+
+
+
+// StudentHistory - Earlier semesters of one student. The sheets stay in a cold block until they are first needed
+typedef struct
+{
+    char rollNo[MAX_ROLLNO_LENGTH];
+    int sheetCount;         // Semesters in the history, oldest first
+    unsigned char *block;   // Cold block : the sheets delta and varint encoded by encodeSemesterSheets()
+    int blockLength;
+    SemesterSheet *sheets;  // Decoded sheets (MAX_SEMESTERS slots), NULL until the history is first read
+
+} StudentHistory;
+
+
+
+// Semester history, read from HISTORY_FILE on first use and only used by the main thread
+StudentHistory *history = NULL; // Histories ordered by roll number
+int historyCount = 0;
+int historyCapacity = 0;
+int historyLoaded = 0;          // Set once HISTORY_FILE has been read
+
+
+
+// Grade cache, kept in the same order as students[]
+StudentGrades studentGrades[MAX_STUDENTS];
+
+// Grade lookup table built from gradeScale : gradeLookup[subject][marks] is the index of the grade in gradeScale
+unsigned char gradeLookup[TOTAL_SUBJECTS][MAX_SUBJECT_MARKS + 1];
+
 
 
 // Function Prototypes
 // Admin functions
 void displayAdminMenu();          // Displays admin menu
 void addStudent();                // Add a new student record
+int readNewStudent(Student *newStudent); // Prompts for a new student's details and marks, returns 0 if cancelled
+int editStudentCopy(Student *tempStudent); // Lets the admin edit a copy of a student, returns 1 if it should be saved
 void viewAllStudents();           // Displays all student records
 void searchStudent();             // Searches and displays a student by roll number
 void updateStudent();             // Update details of a specific student
 void deleteStudent();             // Deletes a student record
 void viewSubjectWiseResults();    // Displays all student's marks for a specific subject
+void exportAllSubjectReports();   // Writes every subject's report to its own file
+void viewMeritList();             // Displays merit lists and subject toppers
+void viewGrading();               // Displays the grading scheme and the SGPA of all students
+void queryStudents();             // Lists students matching a query typed by the admin
+void archiveMode();               // Reports over an archive file streamed in bounded memory
+void archivePercentiles(const char *archiveFile); // Percentiles of an archive file from its quantile sketch
+void archiveCorrelation(const char *archiveFile); // Correlation and covariance matrices of the mark columns of an archive file
+void archiveGroupBy(const char *archiveFile);     // Count, sum, average, min, max and pass rate per group of an archive file
 
 // Removes leading and trailing whitespace from the given string
 void trim(char *str);
 
+// Report renderers, rows is the student array to read and indexes selects the students to include (NULL for all rows)
+void printStudentList(FILE *fp, const Student *rows, const int *indexes, int count);                     // Roll No, Name and Branch/Sem table
+void printStudentListRows(FILE *fp, const Student *rows, const int *indexes, int count);                 // Rows of the above table only
+int writeSubjectReport(FILE *fp, int subjectIndex, const Student *rows, const int *indexes, int count); // Subject-wise marks table
+void writeSubjectReportHeader(FILE *fp, int subjectIndex);                                               // Title and column headers
+void writeSubjectReportRows(FILE *fp, int subjectIndex, const Student *rows, const int *indexes, int count); // Rows of the report only
+
 
 
 
@@ -140,16 +761,211 @@ void downloadMyResult();                          // Saves a student's result to
 
 // Utility functions
 void saveToCSV();          // Saves all records to CSV
+int writeDatabaseFile(const StoreSnapshot *snapshot); // Atomically replaces DATABASE_FILE, returns 0 on success
+int writeStudentFile(const char *fileName, const char *tempFileName, const StoreSnapshot *snapshot, const char *branch, int semester); // Same for any file and partition
+void startBackgroundSaver();  // Starts the background saver thread
+void requestSave();           // Asks the background saver to save the database
+void stopBackgroundSaver();   // Saves pending edits and stops the background saver
+int saveDirtyShards(const Shard *table, int count, const StoreSnapshot *snapshot); // Writes changed shards and the manifest
+
+
+
+// External edit functions
+void fileSignature(const char *fileName, FileSignature *signature); // Reads the size and last write time of a file
+int sameFileSignature(const FileSignature *a, const FileSignature *b); // Returns 1 if both describe the same file version
+void rememberDatabaseFile(StoreSnapshot *snapshot);                 // Records the snapshot DATABASE_FILE now holds
+void startFileWatcher();                                            // Starts watching DATABASE_FILE for external edits
+void stopFileWatcher();                                             // Stops the watcher thread
+void reloadExternalEdits();                                         // Merges the rows changed outside the program into students[]
+HANDLE lockDatabaseFile();                                          // Waits for and takes the lock of DATABASE_LOCK_FILE
+void unlockDatabaseFile(HANDLE lock);                               // Releases the lock
+int saveDatabaseFile(StoreSnapshot *snapshot);                      // Saves under the lock unless another program saved first, returns 0, 1 or -1
+void stampRecords(const Transaction *txn);                          // Stamps the students a commit changed
+void dropRecordStamps(long version);                                // Forgets the stamps a save contains
+
+
+
+// Roll number index functions
+void buildRollIndex();                         // Rebuilds the roll number index from students[]
+int findStudentByRoll(const char *rollNo);     // Index of a student in students[], -1 if not found
+int locateStudent(const char *rollNo);         // Like findStudentByRoll(), loading the shards that may hold the roll number first
+
+
+
+// Database context functions
+void initDatabase(Database *db, const char *fileName);                // Prepares an empty database context for a CSV file
+int loadDatabase(Database *db);                                       // Loads, indexes and grades the database, returns 0 on success
+int findDatabaseStudent(const Database *db, const char *rollNo);      // Index of a student in db->students, -1 if not found
+void freeDatabase(Database *db);                                      // Frees everything owned by the context
+void campusReport();                                                  // Loads many databases in parallel and aggregates them
+void reconcileDatabases();                                            // Compares two database files by roll number and merges them
+
+
+
+// Sharded storage functions
+int loadShardManifest();                                  // Opens the sharded layout if it exists, returns 0 if it does not
+int loadShard(int shard);                                 // Appends a shard's students to students[], returns 0 on success
+void loadAllShards();                                     // Loads every shard not loaded yet, no-op without sharding
+int loadShardsForRoll(const char *rollNo);                // Loads the shards whose roll range may hold a roll number
+int loadShardsForQuery(const CompiledQuery *query);       // Loads the shards a query can match, returns their number
+int convertToShards();                                    // Splits the loaded database into one shard per branch/semester
+int loadShardsForTransaction(const Transaction *txn, unsigned char *loadedShards); // Loads the shards a transaction touches, returns 0 on success
+void dropTransactionShards(const unsigned char *loadedShards, int shardsBefore); // Unloads the shards a rolled back transaction loaded or created
+void markShardsChanged(const Transaction *txn);           // Updates the manifest entries of the shards a commit changed
+
+
+
+// Semester history functions
+int loadHistory();                                          // Reads HISTORY_FILE on first use, returns 0 on success
+int saveHistory();                                          // Atomically replaces HISTORY_FILE, returns 0 on success
+void freeHistory();                                         // Drops the history held in memory
+int archiveSemesterSheet(const Student *s);                 // Adds a student's current marks to their history, returns 0 on success
+int printTranscript(FILE *fp, const char *rollNo, const Student *current); // Prints every semester of a student, returns their number
+void viewTranscript(const Student *current, const char *rollNo); // Prints and saves a student's transcript
+int promoteStudents(const int *indexes, int count);         // Archives and promotes students, returns the number promoted
+void semesterHistory();                                     // Promotion and transcript menu
+
+
+
+// Arrow export functions
+int exportArrowStudents(const char *fileName, const Student *rows, const int *indexes, int count); // Students with every mark column, returns 0 on success
+int exportArrowSubject(const char *fileName, int subjectIndex, const Student *rows, const int *indexes, int count); // Subject-wise result, returns 0 on success
+void archiveArrowExport(const char *archiveFile);                                                  // Filtered archive file, streamed batch by batch
+
+
+
+// Excel export functions
+int exportXlsx(const char *fileName, XlsxLayout layout, int subjectIndex, const Student *rows, const StudentGrades *grades,
+               const int *indexes, int count); // Student list, result cards or subject-wise result, returns 0 on success
+void archiveXlsxExport(const char *archiveFile); // Filtered archive file, streamed into the workbook row by row
+
+
+
+// Session recording and replay functions
+void traceOperation(TraceOp op, const char *format, ...); // Appends an operation to TRACE_FILE, no-op unless recording
+void traceEdit(const TransactionOp *op);                  // Appends a committed add, update or delete to TRACE_FILE
+void sessionRecording();                                  // Record and replay menu
+
+
+
+// Replication functions
+void replicateChange(TransactionOpType type, const Student *s);     // Logs a committed change for the followers, no-op unless serving them
+int startReplicationPrimary(const char *address, const char *port); // Serves the committed changes to followers, returns 0 on success
+void stopReplicationPrimary();                                      // Disconnects the followers and stops logging changes
+void followPrimary();                                               // Keeps a read-only copy of another program's database and serves lookups from it
+void replicationMenu();                                             // Primary and follower menu
+
+
+
+// Bulk marks entry
+void bulkMarksEntry();                // Applies one subject's marks for many students in one transaction
+
+
+
+// Transaction and snapshot functions
+void beginTransaction(Transaction *txn);                              // Starts an empty transaction
+int stageOperation(Transaction *txn, TransactionOpType type, const Student *s); // Stages an operation, returns -1 if the transaction is full
+int stagedStudent(const Transaction *txn, const char *rollNo, Student *s); // Student as the transaction would leave it, returns 0 if absent
+int commitTransaction(Transaction *txn);                              // Applies all staged operations as a new store version, returns 0 on success
+int publishSnapshot();                                                // Publishes students[] as the current snapshot, returns 0 on success
+StoreSnapshot *acquireSnapshot();                                     // Takes a reference on the current snapshot, lock-free
+void releaseSnapshot(StoreSnapshot *snapshot);                        // Drops a reference taken by acquireSnapshot()
+const Student *snapshotRow(const StoreSnapshot *snapshot, int index); // Student of a snapshot by index
+void batchEdit();                                                     // Stages several edits and commits them together
+
+
+
+// Record store functions
+int loadFromRecordStore();            // Loads the database from RECORD_STORE_FILE, returns 0 if it does not exist
+int convertToRecordStore();           // Creates RECORD_STORE_FILE from the loaded students
+void closeRecordStore();              // Exports pending changes to DATABASE_FILE and closes the record store
+void saveStudentRecord(int index);    // Persists an added or updated student
+void deleteStudentRecord(int slot);   // Persists the deletion of the student stored in a slot
+void viewRecordStore();               // Record store and CSV export menu
 void loadFromCSV();        // Loads record form CSV
+int parseStudentLine(char *line, Student *s); // Parses one CSV line into a student, returns 1 on success
+int skipLongLine(const char *line, FILE *fp); // Drops the rest of a line longer than the buffer, returns 1 if it did
+void writeCSVHeader(FILE *fp);                // Writes the CSV header line
+int formatCSVRow(char *out, const Student *s); // Formats one student as a CSV line, returns its length
+int writeCSVRows(FILE *fp, const CSVSource *source, int count); // Writes many students, formatted in parallel chunks
 void clearInputBuffer();   // Clears input buffer
 void welcome_animation();  // Displays the welcome animation
 
 
 
+// Ranking functions
+int studentTotalMarks(const Student *s);                      // Sum of all theory and practical marks
+void mapSubjectColumns();                                     // Maps subjects to their theory and practical columns
+int subjectTotalMarks(const Student *s, int subjectIndex);    // Theory + practical marks of one subject
+void computeRanks();                                          // Rebuilds the rank cache for all students
+void invalidateRanks();                                       // Marks the rank cache as stale
+const StudentRank *getStudentRank(const Student *s);          // Returns the ranks of a student
+void printTopStudents(int n, const char *branch, int semester, int subjectIndex); // Prints a top-N merit list
+
+
+
+// Grading functions
+void loadGradingConfig();                       // Loads credits and grade boundaries from GRADING_CONFIG_FILE
+void buildGradeLookup();                        // Rebuilds gradeLookup from gradeScale and subjectMarks
+void computeGrades(int first, int last);        // Computes grades and SGPA of students[first..last-1]
+void gradeStudent(const Student *s, StudentGrades *grades); // Computes the grades of a student outside the students array
+
+
+
+// Mark column functions
+int markColumnValue(const Student *s, int column);  // Marks of a student in one mark column
+int markColumnMax(int column);                      // Maximum marks of a mark column from subjectMarks[]
+void setMarkColumnValue(Student *s, int column, int marks); // Sets the marks of a student in one mark column
+void markColumnValues(const Student *s, int *marks);           // Copies every mark column into marks[NUM_MARK_COLUMNS]
+void setMarkColumnValues(Student *s, const int *marks);        // Sets every mark column from marks[NUM_MARK_COLUMNS]
+unsigned int changedMarkColumns(const Student *a, const Student *b); // Bit mask of the mark columns that differ
+void markColumnName(int column, char *name);        // CSV header of a mark column, e.g. "Theory_Java Programming"
+
+
+
+// Mark validation functions
+int validateMarkRows(const Student *rows, int count, unsigned int *invalid); // Checks a batch of students against subjectMarks[], returns the number of bad rows
+void printMarkErrors(FILE *fp, const Student *rows, int count, const unsigned int *invalid); // One line per student with marks out of range
+int saveRejectedRows(const Student *rows, int count, const unsigned int *invalid); // Appends the rows with marks out of range to REJECTED_ROWS_FILE
+void readMarkColumns(Student *s, unsigned int columns); // Prompts for the marks of the chosen mark columns
+
+
+
+// Streaming functions
+typedef void (*StreamBatchHandler)(const Student *batch, const StudentGrades *grades, int count, void *context);
+long long streamStudentFile(const char *fileName, StreamBatchHandler handler, void *context); // Scans a CSV file in bounded memory
+
+
+
+// Quantile sketch functions
+void clearMarkSketch(MarkSketch *sketch);                                          // Empties a sketch
+void addToMarkSketch(MarkSketch *sketch, const Student *rows, const int *indexes, int count); // Adds students (those listed in indexes, or all rows if NULL)
+void mergeMarkSketch(MarkSketch *into, const MarkSketch *from);                    // Adds the students of one sketch to another
+int markSketchPercentile(const MarkSketch *sketch, int key, double percent);       // Marks at a percentile of one distribution
+void markSketchKeyName(int key, char *name);                                       // Name of a distribution of the sketch
+int saveMarkSketch(const char *fileName, const FileSignature *signature, const MarkSketch *sketch); // Saves the sketch of a database file next to it
+int loadMarkSketch(const char *fileName, MarkSketch *sketch);                      // Loads the saved sketch of a file if the file is unchanged
+void printMarkSketch(FILE *fp, const MarkSketch *sketch);                          // Median, quartiles and top 10% threshold table
+
+
+
+// Query functions
+int compileQuery(const char *text, CompiledQuery *query); // Parses a query into instructions, returns 0 on success
+int runQuery(const CompiledQuery *query, const Student *rows, const StudentGrades *grades, int n, int *matches); // Runs a compiled query, returns the number of matches
+
+
+
 UserRole login(); // Handles login for admin or student
 
 
 
+// Background loading functions
+void startDatabaseLoad();                  // Starts loading the database on a background thread
+void waitForDatabase();                    // Blocks until the database is loaded, then starts the background saver
+void reportLoad(const char *format, ...);  // Prints a loading message, or keeps it until waitForDatabase() while loading in the background
+
+
+
 
 /* Main Function
 
@@ -162,7 +978,8 @@ UserRole login(); // Handles login for admin or student
 int main()
 {
     welcome_animation(); // Display the welcome message
-    loadFromCSV();       // Load existing data from CSV file
+    loadGradingConfig(); // Load credits and grade boundaries
+    startDatabaseLoad(); // Load the database in the background while the user logs in
 
     int loggedInStudentIndex = -1; // Stores index of logged-in student
 
@@ -184,6 +1001,9 @@ int main()
                 clearInputBuffer();
                 continue;
             }
+            waitForDatabase();     // Every option needs the data
+            reloadExternalEdits(); // Merge edits made to the database file outside the program, e.g. in MS Excel
+            traceOperation(TRACE_MENU, "admin %d", choice);
 
             switch (choice)
             {
@@ -193,6 +1013,7 @@ int main()
                 break;
 
             case 2:
+                loadAllShards(); // Needs every student, no-op unless the database is sharded
                 viewAllStudents();
                 break;
 
@@ -205,16 +1026,74 @@ int main()
                 break;
 
             case 5:
+                loadAllShards(); // Needs every student, no-op unless the database is sharded
                 deleteStudent();
                 break;
 
             case 6:
+                loadAllShards(); // Needs every student, no-op unless the database is sharded
                 viewSubjectWiseResults();
                 break;
 
             case 7:
+                loadAllShards(); // Needs every student, no-op unless the database is sharded
+                viewMeritList();
+                break;
+
+            case 8:
+                loadAllShards(); // Needs every student, no-op unless the database is sharded
+                viewGrading();
+                break;
+
+            case 9:
+                queryStudents();
+                break;
+
+            case 10:
+                archiveMode();
+                break;
+
+            case 11:
+                viewRecordStore();
+                break;
+
+            case 12:
+                bulkMarksEntry();
+                break;
+
+            case 13:
+                batchEdit();
+                break;
+
+            case 14:
+                campusReport();
+                break;
+
+            case 15:
+                reconcileDatabases();
+                break;
+
+            case 16:
+                loadAllShards(); // Needs every student, no-op unless the database is sharded
+                semesterHistory();
+                break;
+
+            case 17:
+                replicationMenu();
+                break;
+
+            case 18:
+                sessionRecording();
+                break;
+
+            case 19:
                 printf("Exiting The Program. Goodbye!\n");
 
+                reloadExternalEdits(); // The final save must not overwrite an external edit
+                stopReplicationPrimary();
+                stopFileWatcher();
+                stopBackgroundSaver(); // Save pending edits before exiting
+                closeRecordStore();
                 exit(0);
                 break;
 
@@ -241,6 +1120,7 @@ int main()
                 clearInputBuffer();
                 continue;
             }
+            traceOperation(TRACE_MENU, "student %d", choice);
 
             switch (choice)
             {
@@ -254,13 +1134,22 @@ int main()
                 break;
 
             case 3:
-                printf("Exiting The Program. Goodbye!\n");
-                exit(0);
+                exportXlsx(XLSX_MY_RESULT_FILE, XLSX_RESULT_CARDS, 0, students, studentGrades, &loggedInStudentIndex, 1);
                 break;
 
-            default:
-                printf("Invalid Choice! Please Select a Valid Option.\n");
-            }
+            case 4:
+                viewTranscript(&students[loggedInStudentIndex], students[loggedInStudentIndex].rollNo);
+                break;
+
+            case 5:
+                printf("Exiting The Program. Goodbye!\n");
+                stopBackgroundSaver();
+                exit(0);
+                break;
+
+            default:
+                printf("Invalid Choice! Please Select a Valid Option.\n");
+            }
         }
     }
     else
@@ -295,19 +1184,105 @@ void welcome_animation()
 saveToCSV - Saves all student records to a CSV file.
 
 This function iterates over the list of students and writes their details including roll number, name, branch, semester, theory marks nad practical marks to the save CSV file specified in DATABASE_FILE.
+If another program saved the file first, its rows are merged before the file is saved again.
 */
 void saveToCSV()
 {
+    for (int attempt = 0; attempt < SAVE_MERGE_RETRIES; attempt++)
+    {
+        StoreSnapshot *snapshot = acquireSnapshot();
+        int result = saveDatabaseFile(snapshot);
+        releaseSnapshot(snapshot);
+
+        if (result == 0)
+        {
+            if (recordStore == NULL && !shardedStorage)
+            {
+                EnterCriticalSection(&storeLock);
+                dropRecordStamps(editGeneration + 1); // Every commit so far is in the snapshot
+                LeaveCriticalSection(&storeLock);
+            }
+            printf("Database Saved Successfully!\n");
+        }
+        if (result != 1)
+        {
+            return;
+        }
+
+        InterlockedExchange(&externalEditPending, 1);
+        reloadExternalEdits();
+    }
+    printf("Error : %s Keeps Being Saved by Other Programs. Changes Not Saved Yet.\n", DATABASE_FILE);
+}
+
+
+
+
+/*
+writeDatabaseFile - Writes the students of a snapshot to the database file without ever leaving it half written.
+
+Returns:
+- 0 on success, -1 if the file could not be written (the old database is kept).
+*/
+int writeDatabaseFile(const StoreSnapshot *snapshot)
+{
+    return writeStudentFile(DATABASE_FILE, DATABASE_TEMP_FILE, snapshot, NULL, 0);
+}
+
+
+
+
+/*
+writeStudentFile - Writes students of a snapshot to a CSV file without ever leaving it half written.
+
+The records are written to tempFileName, flushed to disk with _commit() and then moved over fileName,
+so a crash during the save leaves either the old or the new file, never a truncated one.
+
+Parameters:
+- branch, semester: Only the students of this branch/semester partition are written (a shard), or all students if branch is NULL.
 
-    FILE *fp = fopen(DATABASE_FILE, "w");
+Returns:
+- 0 on success, -1 if the file could not be written (the old file is kept).
+*/
+int writeStudentFile(const char *fileName, const char *tempFileName, const StoreSnapshot *snapshot, const char *branch, int semester)
+{
+    FILE *fp = fopen(tempFileName, "w");
 
     if (fp == NULL)
     {
-        printf("Error : Could Not Open Database File For Writing.\n");
-        return;
+        printf("Error : Could Not Open %s For Writing.\n", fileName);
+        return -1;
     }
 
     // Write header for CSV file
+    writeCSVHeader(fp);
+
+    // Write each student's data
+    CSVSource source = {snapshot, NULL, NULL, branch, semester};
+    int failed = (writeCSVRows(fp, &source, snapshot->count) != 0);
+
+    // Make sure the data is on disk before the old file is replaced
+    failed = (fflush(fp) != 0) || (_commit(_fileno(fp)) != 0) || failed;
+    failed = (fclose(fp) != 0) || failed;
+
+    if (failed || !MoveFileExA(tempFileName, fileName, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    {
+        printf("Error : Could Not Save %s (Error %lu).\n", fileName, (unsigned long)GetLastError());
+        DeleteFileA(tempFileName);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+
+
+/*
+writeCSVHeader - Writes the header line of the CSV file.
+*/
+void writeCSVHeader(FILE *fp)
+{
     fprintf(fp, "RollNo,Name,Branch,Semester");
     for (int i = 0; i < NUM_SUBJECTS; i++)
     {
@@ -318,32 +1293,243 @@ void saveToCSV()
         fprintf(fp, ",Practical_%s", practicalSubjects[i]);
     }
     fprintf(fp, "\n");
+}
 
-    // Write each student's data
-    for (int i = 0; i < studentCount; i++)
+
+
+
+// Two ASCII digits for every number from 0 to 99, used to format two digits per table lookup
+static const char digitPairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+
+
+/*
+formatInt - Writes an integer in decimal without a terminating null character, two digits per step.
+
+Returns:
+- The number of characters written (at most 11).
+*/
+static int formatInt(char *out, int value)
+{
+    char digits[12];
+    int pos = sizeof(digits);
+    unsigned int v = (value < 0) ? 0u - (unsigned int)value : (unsigned int)value;
+    int length = 0;
+
+    while (v >= 100)
+    {
+        unsigned int pair = (v % 100) * 2;
+        v /= 100;
+        digits[--pos] = digitPairs[pair + 1];
+        digits[--pos] = digitPairs[pair];
+    }
+    if (v >= 10)
+    {
+        digits[--pos] = digitPairs[v * 2 + 1];
+        digits[--pos] = digitPairs[v * 2];
+    }
+    else
     {
-        fprintf(fp, "%s,%s,%s,%d",
-                students[i].rollNo,
-                students[i].name,
-                students[i].branch,
-                students[i].semester);
+        digits[--pos] = (char)('0' + v);
+    }
 
-        // Theory Marks
-        for (int j = 0; j < NUM_SUBJECTS; j++)
+    if (value < 0)
+    {
+        out[length++] = '-';
+    }
+    memcpy(out + length, digits + pos, sizeof(digits) - pos);
+    return length + (int)sizeof(digits) - pos;
+}
+
+
+
+/*
+formatCSVRow - Formats one student as a line of the CSV file, in the same format as the header written by writeCSVHeader().
+
+No format string is parsed and no stream is locked, so rows can be formatted quickly and from several threads at once.
+
+Returns:
+- The length of the line, newline included (at most MAX_CSV_ROW_LENGTH - 1). No null character is written.
+*/
+int formatCSVRow(char *out, const Student *s)
+{
+    int length = 0;
+    size_t n;
+
+    n = strnlen(s->rollNo, MAX_ROLLNO_LENGTH);
+    memcpy(out + length, s->rollNo, n);
+    length += (int)n;
+    out[length++] = ',';
+
+    n = strnlen(s->name, MAX_NAME_LENGTH);
+    memcpy(out + length, s->name, n);
+    length += (int)n;
+    out[length++] = ',';
+
+    n = strnlen(s->branch, MAX_LENGTH);
+    memcpy(out + length, s->branch, n);
+    length += (int)n;
+    out[length++] = ',';
+
+    length += formatInt(out + length, s->semester);
+
+    // Theory Marks
+    for (int j = 0; j < NUM_SUBJECTS; j++)
+    {
+        out[length++] = ',';
+        length += formatInt(out + length, s->obtainedMarks[j]);
+    }
+
+    // Practical Marks
+    for (int j = 0; j < NUM_SUBJECTS_PRAC; j++)
+    {
+        out[length++] = ',';
+        length += formatInt(out + length, s->obtainedPracticalMarks[j]);
+    }
+    out[length++] = '\n';
+    return length;
+}
+
+
+
+
+/*
+csvSourceRow - Returns the k-th student of the rows a CSV writer reads.
+*/
+static const Student *csvSourceRow(const CSVSource *source, int k)
+{
+    if (source->snapshot != NULL)
+    {
+        return snapshotRow(source->snapshot, k);
+    }
+    return &source->rows[source->indexes != NULL ? source->indexes[k] : k];
+}
+
+
+
+
+/*
+formatCSVChunkThread - Thread function formatting the rows of one chunk into the chunk's own buffer.
+*/
+DWORD WINAPI formatCSVChunkThread(LPVOID param)
+{
+    CSVChunk *chunk = (CSVChunk *)param;
+    const CSVSource *source = chunk->source;
+    size_t length = 0;
+
+    for (int k = chunk->first; k < chunk->last; k++)
+    {
+        const Student *s = csvSourceRow(source, k);
+
+        if (source->branch == NULL || (s->semester == source->semester && strcmp(s->branch, source->branch) == 0))
+        {
+            length += formatCSVRow(chunk->buffer + length, s);
+        }
+    }
+    chunk->length = length;
+    return 0;
+}
+
+
+
+
+/*
+writeCSVRows - Writes students as CSV lines, formatting chunks of CSV_CHUNK_ROWS rows in parallel.
+
+Each thread formats its chunk into its own buffer with formatCSVRow(). The chunks are then written in order,
+one write per chunk, so the lines stay in order and saving large files is limited by the disk rather than the CPU.
+A small file is formatted on the current thread only.
+
+Returns:
+- 0 on success, -1 if a write failed or there is not enough memory.
+*/
+int writeCSVRows(FILE *fp, const CSVSource *source, int count)
+{
+    CSVChunk chunks[MAX_CSV_WRITERS];
+    HANDLE threads[MAX_CSV_WRITERS];
+    SYSTEM_INFO info;
+    int writers, w, result = 0;
+
+    int chunkCount = (count + CSV_CHUNK_ROWS - 1) / CSV_CHUNK_ROWS;
+    GetSystemInfo(&info);
+    writers = (int)info.dwNumberOfProcessors;
+    if (writers > MAX_CSV_WRITERS)
+    {
+        writers = MAX_CSV_WRITERS;
+    }
+    if (writers > chunkCount)
+    {
+        writers = chunkCount;
+    }
+
+    for (w = 0; w < writers; w++)
+    {
+        chunks[w].source = source;
+        chunks[w].buffer = malloc((size_t)(count < CSV_CHUNK_ROWS ? count : CSV_CHUNK_ROWS) * MAX_CSV_ROW_LENGTH);
+        if (chunks[w].buffer == NULL)
         {
-            fprintf(fp, ",%d", students[i].obtainedMarks[j]);
+            writers = w; // Continue with the buffers that could be allocated
+            break;
         }
+    }
+    if (writers == 0 && count > 0)
+    {
+        return -1;
+    }
 
-        // Practical Marks
-        for (int j = 0; j < NUM_SUBJECTS_PRAC; j++)
+    // Format up to one chunk per writer, then write the chunks in file order, until all rows are written
+    for (int first = 0; first < count && result == 0; first += writers * CSV_CHUNK_ROWS)
+    {
+        int threadCount = 0;
+        int used = 0;
+
+        for (w = 0; w < writers && first + w * CSV_CHUNK_ROWS < count; w++)
+        {
+            chunks[w].first = first + w * CSV_CHUNK_ROWS;
+            chunks[w].last = (chunks[w].first + CSV_CHUNK_ROWS < count) ? chunks[w].first + CSV_CHUNK_ROWS : count;
+            used++;
+
+            // The first chunk is formatted by the current thread, as is any chunk whose thread could not be started
+            threads[w] = (w > 0) ? CreateThread(NULL, 0, formatCSVChunkThread, &chunks[w], 0, NULL) : NULL;
+            if (threads[w] == NULL)
+            {
+                formatCSVChunkThread(&chunks[w]);
+            }
+            else
+            {
+                threadCount++;
+            }
+        }
+
+        for (w = 0; w < used; w++)
         {
-            fprintf(fp, ",%d", students[i].obtainedPracticalMarks[j]);
+            if (threads[w] != NULL)
+            {
+                WaitForSingleObject(threads[w], INFINITE);
+                CloseHandle(threads[w]);
+            }
+            if (result == 0 && fwrite(chunks[w].buffer, 1, chunks[w].length, fp) != chunks[w].length)
+            {
+                result = -1;
+            }
         }
-        fprintf(fp, "\n");
     }
 
-    fclose(fp);
-    printf("Database Saved Successfully!\n");
+    for (w = 0; w < writers; w++)
+    {
+        free(chunks[w].buffer);
+    }
+    return result;
 }
 
 
@@ -351,61 +1537,195 @@ void saveToCSV()
 /*
 loadFromCSV - Loads student records form a CSV file.
 
-This function reads data from the CSV file specified in DATABASE_FILE, and populates the students array with each student's details including theory and practical marks.
+This function reads data from the CSV file specified in DATABASE_FILE with loadDatabase(), the one CSV parser of the program,
+and copies the students and their grades into the students array, up to MAX_STUDENTS.
+Students with marks out of range are listed in MARK_ERROR_FILE.
 
 If the file does not exist, a message is displayed to inform the user.
 */
 void loadFromCSV()
 {
-    FILE *fp = fopen(DATABASE_FILE, "r");
-    if (fp == NULL)
+    Database db;
+
+    fileSignature(DATABASE_FILE, &savedFileSignature); // Taken first, so an edit made while the file is read is noticed later
+    mapSubjectColumns();
+    initDatabase(&db, DATABASE_FILE);
+    studentCount = 0;
+
+    int result = loadDatabase(&db);
+    if (result == -1)
     {
-        printf("No Existing Database Found. Starting Fresh.\n");
+        reportLoad("No Existing Database Found. Starting Fresh.\n");
+        return;
+    }
+    if (result == -2)
+    {
+        reportLoad("Error : Not Enough Memory to Load %s.\n", DATABASE_FILE);
+        freeDatabase(&db);
         return;
     }
-    char line[1024];
-    int lineCount = 0;
-    studentCount = 0;
 
-    fgets(line, 1024, fp);  // Skip the header line
+    int rowCount = db.count;
+    int longLines = db.longLines;
 
-    while (fgets(line, 1024, fp) && studentCount < MAX_STUDENTS)
+    studentCount = (rowCount < MAX_STUDENTS) ? rowCount : MAX_STUDENTS;
+    memcpy(students, db.students, studentCount * sizeof(Student));
+    memcpy(studentGrades, db.grades, studentCount * sizeof(StudentGrades));
+    for (int i = 0; i < studentCount; i++)
     {
-        Student s;
-        char *token = strtok(line, ",");
-        if (token == NULL)
-            continue;
-        // Parse student details
-        strncpy(s.rollNo, token, MAX_ROLLNO_LENGTH - 1);
+        studentSlots[i] = -1;
+    }
+    freeDatabase(&db);
 
-        token = strtok(NULL, ",");
-        strncpy(s.name, token, MAX_NAME_LENGTH - 1);
+    buildRollIndex();
+    invalidateRanks();
+    reportLoad("Database Loaded Successfully! Total Students: %d\n", studentCount);
+    if (rowCount > MAX_STUDENTS)
+    {
+        reportLoad("Warning : %s Holds More Than %d Students, Only the First %d Were Loaded.\n", DATABASE_FILE, MAX_STUDENTS, MAX_STUDENTS);
+    }
+    if (longLines > 0)
+    {
+        reportLoad("Warning : %d Lines of %s Are Longer Than %d Characters and Were Skipped.\n", longLines, DATABASE_FILE, MAX_LINE_LENGTH - 1);
+    }
 
-        token = strtok(NULL, ",");
-        strncpy(s.branch, token, MAX_LENGTH - 1);
+    // Marks edited by hand may be out of range, they are listed once for the whole file
+    unsigned int invalid[MAX_STUDENTS];
+    int bad = validateMarkRows(students, studentCount, invalid);
 
-        token = strtok(NULL, ",");
-        s.semester = atoi(token);
-        //  Parse theory marks
-        for (int i = 0; i < NUM_SUBJECTS; i++)
-        {
-            token = strtok(NULL, ",");
-            s.obtainedMarks[i] = atoi(token);
-        }
-        // Parse practical marks
-        for (int i = 0; i < NUM_SUBJECTS_PRAC; i++)
+    if (bad > 0)
+    {
+        FILE *errors = fopen(MARK_ERROR_FILE, "w");
+
+        if (errors != NULL)
         {
-            token = strtok(NULL, ",");
-            s.obtainedPracticalMarks[i] = atoi(token);
+            fprintf(errors, "Students of %s With Marks Out of Range (Valid Marks Are 0 to the Maximum Marks)\n\n", DATABASE_FILE);
+            printMarkErrors(errors, students, studentCount, invalid);
+            fclose(errors);
         }
-        students[studentCount++] = s;
+        reportLoad("Warning : %d Students Have Marks Out of Range. They Are Listed in %s.\n", bad, MARK_ERROR_FILE);
     }
-    fclose(fp);
-    printf("Database Loaded Successfully! Total Students: %d\n", studentCount);
 }
 
 
 
+/*
+nextCSVField - Returns the next comma separated field of a line and moves the cursor past it.
+
+Unlike strtok() it keeps no hidden state, so lines can be parsed on several threads at once. Returns NULL after the last field.
+*/
+char *nextCSVField(char **cursor)
+{
+    char *field = *cursor;
+
+    if (field == NULL)
+    {
+        return NULL;
+    }
+
+    char *comma = strchr(field, ',');
+    if (comma != NULL)
+    {
+        *comma = '\0';
+        *cursor = comma + 1;
+    }
+    else
+    {
+        *cursor = NULL;
+    }
+    return field;
+}
+
+
+
+
+/*
+skipLongLine - Drops the rest of a line that fgets() could not read whole.
+
+A line longer than the buffer is returned by fgets() in pieces, and each piece would be parsed as a row of its own.
+When the buffer holds no newline and the file is not at its end, the rest of the line is read and thrown away.
+
+Returns:
+- 1 if the line was longer than the buffer and must be skipped, 0 otherwise.
+*/
+int skipLongLine(const char *line, FILE *fp)
+{
+    int c;
+
+    if (strchr(line, '\n') != NULL || feof(fp))
+    {
+        return 0;
+    }
+    while ((c = fgetc(fp)) != EOF && c != '\n')
+    {
+    }
+    return 1;
+}
+
+
+
+
+/*
+parseStudentLine - Parses one line of the CSV file into a Student.
+
+The line is modified while it is parsed. The trailing newline, if any, is ignored.
+
+Returns:
+- 1 if the line holds a complete student record, 0 otherwise.
+*/
+int parseStudentLine(char *line, Student *s)
+{
+    char *cursor = line;
+    char *token;
+
+    line[strcspn(line, "\r\n")] = '\0';
+
+    // Parse student details
+    token = nextCSVField(&cursor);
+    if (token == NULL || token[0] == '\0')
+        return 0;
+    strncpy(s->rollNo, token, MAX_ROLLNO_LENGTH - 1);
+    s->rollNo[MAX_ROLLNO_LENGTH - 1] = '\0';
+
+    token = nextCSVField(&cursor);
+    if (token == NULL)
+        return 0;
+    strncpy(s->name, token, MAX_NAME_LENGTH - 1);
+    s->name[MAX_NAME_LENGTH - 1] = '\0';
+
+    token = nextCSVField(&cursor);
+    if (token == NULL)
+        return 0;
+    strncpy(s->branch, token, MAX_LENGTH - 1);
+    s->branch[MAX_LENGTH - 1] = '\0';
+
+    token = nextCSVField(&cursor);
+    if (token == NULL)
+        return 0;
+    s->semester = atoi(token);
+
+    //  Parse theory marks
+    for (int i = 0; i < NUM_SUBJECTS; i++)
+    {
+        token = nextCSVField(&cursor);
+        if (token == NULL)
+            return 0;
+        s->obtainedMarks[i] = atoi(token);
+    }
+    // Parse practical marks
+    for (int i = 0; i < NUM_SUBJECTS_PRAC; i++)
+    {
+        token = nextCSVField(&cursor);
+        if (token == NULL)
+            return 0;
+        s->obtainedPracticalMarks[i] = atoi(token);
+    }
+    return 1;
+}
+
+
+
+
 /*
 displayAdminMenu - Displays the admin menu options.
 
@@ -420,7 +1740,19 @@ void displayAdminMenu()
     printf("4. Update Student\n");
     printf("5. Delete Student\n");
     printf("6. View Subject Wise Result\n");
-    printf("7. Exit\n\n");
+    printf("7. Merit List and Ranks\n");
+    printf("8. Grades and SGPA\n");
+    printf("9. Query Students\n");
+    printf("10. Archive (Streaming) Mode\n");
+    printf("11. Record Store and CSV Export\n");
+    printf("12. Bulk Marks Entry (One Subject)\n");
+    printf("13. Batch Edit (Transaction)\n");
+    printf("14. Campus-Wide Report (Many Databases)\n");
+    printf("15. Compare and Reconcile Two Databases\n");
+    printf("16. Semester History (Promote, Transcripts)\n");
+    printf("17. Replication (Serve or Follow a Read-Only Copy)\n");
+    printf("18. Record and Replay Sessions (Load Test)\n");
+    printf("19. Exit\n\n");
 }
 
 
@@ -435,7 +1767,9 @@ void displayStudentMenu()
     printf("\n===== Student Menu =====\n\n");
     printf("1. View My Result\n");
     printf("2. Download My Result\n");
-    printf("3. Exit\n");
+    printf("3. Download My Result as Excel ('%s')\n", XLSX_MY_RESULT_FILE);
+    printf("4. View My Transcript (All Semesters)\n");
+    printf("5. Exit\n");
 }
 
 
@@ -448,6 +1782,7 @@ This function prompts the admin to input a student's details,  including their r
 It checks for duplicate roll numbers to prevent adding the same student twice.
 
 If maximum student capacity is reached, the function will return an error message.
+The student is committed as a one-operation transaction.
 
 */
 void addStudent()
@@ -459,23 +1794,50 @@ void addStudent()
     }
 
     Student s;
+    Transaction txn;
 
-    // Prompt for roll number and check if it's unique
-    printf("\n===== Add New Student =====\n\n");
-    printf("Enter Student Roll No    : ");
-    scanf("%s", s.rollNo);
-
-    // Check for duplicate Roll Number
-    int i;
+    if (!readNewStudent(&s))
+    {
+        return;
+    }
 
-    for (i = 0; i < studentCount; i++)
+    beginTransaction(&txn);
+    stageOperation(&txn, TXN_ADD, &s);
+    if (commitTransaction(&txn) == 0)
     {
+        printf("Student Added Successfully!\n\n");
+    }
+}
 
-        if (strcmp(students[i].rollNo, s.rollNo) == 0)
-        {
-            printf("A Student With Roll Number %s Already Exists. Operation Cancelled.\n", s.rollNo);
-            return;
-        }
+
+
+
+/*
+readNewStudent - Prompts for the details and marks of a new student.
+
+It is shared by addStudent() and the batch edit, which stages the student instead of adding it at once.
+The maximum marks shown and checked come from subjectMarks[]. All marks are entered first, then the ones out of range are
+listed together and asked for again.
+
+Returns:
+- 1 if newStudent was filled in, 0 if the roll number already exists.
+*/
+int readNewStudent(Student *newStudent)
+{
+    Student s;
+
+    memset(&s, 0, sizeof(Student)); // Marks never entered (end of input) stay valid
+
+    // Prompt for roll number and check if it's unique
+    printf("\n===== Add New Student =====\n\n");
+    printf("Enter Student Roll No    : ");
+    scanf("%s", s.rollNo);
+
+    // Check for duplicate Roll Number
+    if (locateStudent(s.rollNo) != -1)
+    {
+        printf("A Student With Roll Number %s Already Exists. Operation Cancelled.\n", s.rollNo);
+        return 0;
     }
 
     // Get student name, branch and semester
@@ -505,36 +1867,8 @@ void addStudent()
     printf("Subject                              Maximum Marks      Marks Obtained\n");
     printf("-----------------------------------------------------------------------\n\n");
 
-    // Collect theory marks and validate each input
-    for (i = 0; i < NUM_SUBJECTS; i++)
-    {
-        int marks;
-        int validInput = 0;
-        do
-        {
-            printf("%-40s 30", subjects[i]); // Print subject name and max marks
-            printf("%-20s", " ");
-            if (scanf("%d", &marks) != 1)
-            {
-                printf("Invalid Input! Please Enter a Number.\n");
-                clearInputBuffer();
-            }
-            else
-            {
-                if (marks < 1 || marks > 30)
-                {
-                    printf("Marks Should be between 0 and 30. Please Re-Enter.\n");
-                }
-                else
-                {
-                    validInput = 1;
-                }
-            }
-
-        } while (!validInput); // Repeat until valid input
-
-        s.obtainedMarks[i] = marks; // Store valid marks
-    }
+    // Collect theory marks, their range is checked with the practical marks below
+    readMarkColumns(&s, THEORY_MARK_COLUMNS);
     printf("-----------------------------------------------------------------------\n\n");
 
     printf("Marks for Theoretical Examination has been added!\n\n"); // Pop up message
@@ -546,207 +1880,61 @@ void addStudent()
     printf("Subject                              Maximum Marks      Marks Obtained\n");
     printf("-----------------------------------------------------------------------\n\n");
 
-    // Practical marks collection and validation
-    int marks;
-    int validInput = 0;
-    do
-    {
-        printf("Android Application Development%-10s 30", " ");
-        printf("%-20s", " ");
-
-        if (scanf("%d", &marks) != 1)
-        {
-            printf("Invalid Input! Please Enter a Number.\n");
-            clearInputBuffer();
-        }
-        else
-        {
-
-            if (marks < 1 || marks > 30)
-            {
-                printf("Marks should be between 0 and 30. Please Re-Enter.\n");
-            }
-            else
-            {
-                validInput = 1;
-            }
-        }
-    } while (!validInput);
-
-    s.obtainedPracticalMarks[0] = marks; // Store valid marks
-
-    validInput = 0;
-    do
-    {
-        printf("Java Programming%-25s 30", " ");
-        printf("%-20s", " ");
-
-        if (scanf("%d", &marks) != 1)
-        {
-            printf("Invalid Input! Please Enter a Number.\n");
-            clearInputBuffer();
-        }
-        else
-        {
-            if (marks < 1 || marks > 30)
-            {
-                printf("Marks should be between 0 and 30. Please Re-Enter.\n");
-            }
-            else
-            {
-                validInput = 1;
-            }
-        }
-
-    } while (!validInput); // Repeat until valid input
+    readMarkColumns(&s, PRACTICAL_MARK_COLUMNS);
 
-    s.obtainedPracticalMarks[1] = marks; // Store valid marks
-
-    validInput = 0;
-    do
+    // Check all marks against subjectMarks[] at once and ask again only for those out of range
+    unsigned int invalid;
+    while (validateMarkRows(&s, 1, &invalid) > 0)
     {
-        printf("Computer Hardware and Services%-11s 30", " ");
-        printf("%-20s", " ");
-
-        if (scanf("%d", &marks) != 1)
-        {
-            printf("Invalid Input! Please Enter a Number.\n");
-            clearInputBuffer();
-        }
-        else
-        {
-            if (marks < 1 || marks > 30)
-            {
-                printf("Marks should be between 0 and 30. Please Re-Enter.\n");
-            }
-            else
-            {
-                validInput = 1;
-            }
-        }
-
-    } while (!validInput); // Repeat until valid input
-
-    s.obtainedPracticalMarks[2] = marks; // Store valid marks
+        printf("\nMarks Out of Range (Valid Marks Are 0 to the Maximum Marks) :\n");
+        printMarkErrors(stdout, &s, 1, &invalid);
+        printf("Please Re-Enter Them.\n\n");
+        readMarkColumns(&s, invalid);
+    }
 
-    validInput = 0;
-    do
-    {
-        printf("Minor Project Work%-23s 50", " ");
-        printf("%-20s", " ");
+    printf("-----------------------------------------------------------------------\n\n");
 
-        if (scanf("%d", &marks) != 1)
-        {
-            printf("Invalid Input! Please Enter a Number.\n");
-            clearInputBuffer();
-        }
-        else
-        {
-            if (marks < 1 || marks > 50)
-            {
-                printf("Marks should be between 0 and 50. Please Re-Enter.\n");
-            }
-            else
-            {
-                validInput = 1;
-            }
-        }
+    printf("Marks for Practical Examination has been added!\n\n"); // Pop up message
 
-    } while (!validInput); // Repeat until valid input
+    *newStudent = s;
+    return 1;
+}
 
-    s.obtainedPracticalMarks[3] = marks; // Store valid marks
 
-    validInput = 0;
-    do
-    {
-        printf("Industrial Exposure%-22s 25", " ");
-        printf("%-20s", " ");
 
-        if (scanf("%d", &marks) != 1)
-        {
-            printf("Invalid Input! Please Enter a Number.\n");
-            clearInputBuffer();
-        }
-        else
-        {
-            if (marks < 1 || marks > 25)
-            {
-                printf("Marks should be between 0 and 25. Please Re-Enter.\n");
-            }
-            else
-            {
-                validInput = 1;
-            }
-        }
 
-    } while (!validInput); // Repeat until valid input
+/*
+printStudentList - Prints the roll number, name, branch and semester of a list of students.
 
-    s.obtainedPracticalMarks[4] = marks; // Store valid marks
+Parameters:
+- fp: File (or stdout) to print the list to.
+- rows: Student array to read, usually the students array.
+- indexes: Indexes in rows of the students to list, or NULL for all rows.
+- count: Number of entries in indexes (or number of rows when indexes is NULL).
+*/
+void printStudentList(FILE *fp, const Student *rows, const int *indexes, int count)
+{
+    fprintf(fp, "Roll No\t\t\t\tName\t\t\t\tBranch/Sem\n");
+    fprintf(fp, "------------------------------------------------------------------------------\n");
+    printStudentListRows(fp, rows, indexes, count);
+    fprintf(fp, "------------------------------------------------------------------------------\n\n");
+}
 
-    validInput = 0;
-    do
-    {
-        printf("Industrial Training%-22s 30", " ");
-        printf("%-20s", " ");
 
-        if (scanf("%d", &marks) != 1)
-        {
-            printf("Invalid Input! Please Enter a Number.\n");
-            clearInputBuffer();
-        }
-        else
-        {
-            if (marks < 1 || marks > 30)
-            {
-                printf("Marks should be between 0 and 30. Please Re-Enter.\n");
-            }
-            else
-            {
-                validInput = 1;
-            }
-        }
 
-    } while (!validInput); // Repeat until valid input
 
-    s.obtainedPracticalMarks[5] = marks; // Store valid marks
+/*
+printStudentListRows - Prints the rows of the student list without its header and footer.
 
-    validInput = 0;
-    do
+It is used directly when a list is printed in several parts, e.g. while streaming an archive file.
+*/
+void printStudentListRows(FILE *fp, const Student *rows, const int *indexes, int count)
+{
+    for (int k = 0; k < count; k++)
     {
-        printf("General Proficiency%-22s 25", " ");
-        printf("%-20s", " ");
-
-        if (scanf("%d", &marks) != 1)
-        {
-            printf("Invalid Input! Please Enter a Number.\n");
-            clearInputBuffer();
-        }
-        else
-        {
-            if (marks < 1 || marks > 25)
-            {
-                printf("Marks should be between 0 and 25. Please Re-Enter.\n");
-            }
-            else
-            {
-                validInput = 1;
-            }
-        }
-
-    } while (!validInput); // Repeat until valid input
-
-    s.obtainedPracticalMarks[6] = marks; // Store valid marks
-
-    printf("-----------------------------------------------------------------------\n\n");
-
-    printf("Marks for Practical Examination has been added!\n\n"); // Pop up message
-
-
-    // Save the new student to the system and update the CSV file 
-    students[studentCount++] = s; // Add student to global array
-    printf("Student Added Successfully!\n\n");
-
-    saveToCSV();
+        const Student *s = &rows[indexes != NULL ? indexes[k] : k];
+        fprintf(fp, "%-32s%-33s%s/%d\n", s->rollNo, s->name, s->branch, s->semester);
+    }
 }
 
 
@@ -768,21 +1956,15 @@ void viewAllStudents()
         printf("No Student Record available.\n\n");
         return; // Exit the function since there are no students to display
     }
+    traceOperation(TRACE_LIST, "");
 
     while (1) // Keep displaying until the admin chooses to exit
     {
 
         printf("\n=== View All Students ===\n\n");
-        printf("Roll No\t\t\t\tName\t\t\t\tBranch/Sem\n");
-        printf("------------------------------------------------------------------------------\n");
 
         // Display all students
-        int i;
-        for (i = 0; i < studentCount; i++)
-        {
-            printf("%-32s%-33s%s/%d\n", students[i].rollNo, students[i].name, students[i].branch, students[i].semester);
-        }
-        printf("------------------------------------------------------------------------------\n\n");
+        printStudentList(stdout, students, NULL, studentCount);
 
         // Ask if the admin wants to view a student's result
         char choice;
@@ -799,18 +1981,12 @@ void viewAllStudents()
             scanf("%s", rollNo);
 
             // Search for the student
-            int found = 0;
-            for (i = 0; i < studentCount; i++)
+            int found = locateStudent(rollNo);
+            if (found != -1)
             {
-                if (strcmp(students[i].rollNo, rollNo) == 0)
-                {
-                    displayStudentWithResults(&students[i]); // Display the student's results
-                    found = 1;
-                    break;
-                }
+                displayStudentWithResults(&students[found]); // Display the student's results
             }
-
-            if (!found)
+            else
             {
                 printf("No Student found with Roll No %s.\n\n", rollNo);
             }
@@ -845,6 +2021,8 @@ It is typically used when a student views their own result or when an admin view
 */
 void displayStudentWithResults(const Student *s)
 {
+    traceOperation(TRACE_RESULT, "%s", s->rollNo);
+
     printf("\n=== Student Results ===\n\n");
     printf("Roll No    : %-20s\n", s->rollNo);
     printf("Name       : %-20s\n", s->name);
@@ -875,6 +2053,34 @@ void displayStudentWithResults(const Student *s)
         printf("%-40s %d\n", practicalSubjects[i], s->obtainedPracticalMarks[i]);
     }
     printf("----------------------------------------------------\n\n");
+
+    // Display grades and ranks
+
+    const StudentRank *rank = getStudentRank(s);
+
+    if (rank != NULL)
+    {
+        const StudentGrades *grades = &studentGrades[s - students];
+
+        printf("\n===Subject Result===\n\n");
+        printf("Subject                              Marks     Credits   Grade   Rank\n");
+        printf("-----------------------------------------------------------------------\n");
+
+        for (i = 0; i < TOTAL_SUBJECTS; i++)
+        {
+            char marks[16];
+            sprintf(marks, "%d/%d", subjectTotalMarks(s, i), subjectMarks[i].maxTheory + subjectMarks[i].maxPractical);
+            printf("%-36s %-9s %-9d %-7s %d\n", subjectMarks[i].subject, marks, subjectMarks[i].credits,
+                   gradeScale[grades->gradeIndex[i]].grade, rank->subjectRank[i]);
+        }
+        printf("-----------------------------------------------------------------------\n\n");
+
+        printf("Total Marks     : %d\n", rank->total);
+        printf("SGPA            : %.2f\n", grades->sgpa);
+        printf("Result          : %s\n", grades->passed ? "PASS" : "FAIL");
+        printf("Overall Rank    : %d of %d\n", rank->overallRank, studentCount);
+        printf("Branch/Sem Rank : %d of %d (%s/%d)\n\n", rank->groupRank, rank->groupSize, s->branch, s->semester);
+    }
 }
 
 
@@ -924,6 +2130,33 @@ void downloadMyResult(const Student *s)
     }
     fprintf(fp, "------------------------------------------------------\n\n");
 
+    // Write grades and ranks
+
+    const StudentRank *rank = getStudentRank(s);
+
+    if (rank != NULL)
+    {
+        const StudentGrades *grades = &studentGrades[s - students];
+
+        fprintf(fp, "===Subject Result===\n\n");
+        fprintf(fp, "Subject                              Marks     Credits   Grade   Rank\n");
+        fprintf(fp, "-----------------------------------------------------------------------\n");
+        for (int i = 0; i < TOTAL_SUBJECTS; i++)
+        {
+            char marks[16];
+            sprintf(marks, "%d/%d", subjectTotalMarks(s, i), subjectMarks[i].maxTheory + subjectMarks[i].maxPractical);
+            fprintf(fp, "%-36s %-9s %-9d %-7s %d\n", subjectMarks[i].subject, marks, subjectMarks[i].credits,
+                    gradeScale[grades->gradeIndex[i]].grade, rank->subjectRank[i]);
+        }
+        fprintf(fp, "-----------------------------------------------------------------------\n\n");
+
+        fprintf(fp, "Total Marks     : %d\n", rank->total);
+        fprintf(fp, "SGPA            : %.2f\n", grades->sgpa);
+        fprintf(fp, "Result          : %s\n", grades->passed ? "PASS" : "FAIL");
+        fprintf(fp, "Overall Rank    : %d of %d\n", rank->overallRank, studentCount);
+        fprintf(fp, "Branch/Sem Rank : %d of %d (%s/%d)\n\n", rank->groupRank, rank->groupSize, s->branch, s->semester);
+    }
+
     fclose(fp);
     printf("Student results have been saved to 'student_results.txt'.\n\n");
 }
@@ -1018,12 +2251,16 @@ void viewSubjectWiseResults()
     printf("5. Minor Project Work\n");
     printf("6. Industrial Exposure\n");
     printf("7. Industrial Training\n");
-    printf("8. General Proficiency\n\n");
+    printf("8. General Proficiency\n");
+    printf("9. All Subjects (Export Each Subject to its Own File)\n\n");
     printf("Enter your choice: ");
     scanf("%d", &choice);
 
     switch (choice)
     {
+    case 9:
+        exportAllSubjectReports();
+        return;
     case 1:
         subject = "Software Engineering";
         break;
@@ -1063,6 +2300,7 @@ void viewSubjectWiseResults()
         printf("Error : Subject max marks not found.\n");
         return;
     }
+    traceOperation(TRACE_SUBJECT, "%d", (int)(subjectMax - subjectMarks));
 
     FILE *file = fopen("students.csv", "r");
     if (file == NULL)
@@ -1242,6 +2480,24 @@ void viewSubjectWiseResults()
 
         printf("Subject-Wise Student Results have been saved to 'subject_wise_results.txt'.\n");
     }
+
+    printf("\nDo you want to export this result as an Arrow IPC file? (y / n) : ");
+    clearInputBuffer();
+    scanf("%c", &printChoice);
+
+    if (printChoice == 'y' || printChoice == 'Y')
+    {
+        exportArrowSubject(ARROW_SUBJECT_FILE, (int)(subjectMax - subjectMarks), students, NULL, studentCount);
+    }
+
+    printf("\nDo you want to export this result as an Excel workbook? (y / n) : ");
+    clearInputBuffer();
+    scanf("%c", &printChoice);
+
+    if (printChoice == 'y' || printChoice == 'Y')
+    {
+        exportXlsx(XLSX_SUBJECT_FILE, XLSX_SUBJECT_RESULT, (int)(subjectMax - subjectMarks), students, studentGrades, NULL, studentCount);
+    }
 }
 
 
@@ -1262,18 +2518,15 @@ void searchStudent()
     printf("\n--- Search Student ---\n\n");
     printf("Enter Roll Number to Search : ");
     scanf("%s", rollNo);
+    traceOperation(TRACE_SEARCH, "%s", rollNo);
 
     // Search for the students 
-    int i;
-    for (i = 0; i < studentCount; i++)
+    int i = locateStudent(rollNo);
+    if (i != -1)
     {
-        if (strcmp(students[i].rollNo, rollNo) == 0)
-        {
-            printf("\nStudent Found\n\n");
-            displayStudentWithResults(&students[i]); // Display found student's details
-            found = 1;
-            break;
-        }
+        printf("\nStudent Found\n\n");
+        displayStudentWithResults(&students[i]); // Display found student's details
+        found = 1;
     }
 
     // If student not found, show a message
@@ -1303,15 +2556,7 @@ void updateStudent()
     clearInputBuffer();
 
     // Find the student by roll number
-    int found = -1;
-    for (int i = 0; i < studentCount; i++)
-    {
-        if (strcmp(students[i].rollNo, updateRollNo) == 0)
-        {
-            found = i;
-            break;
-        }
-    }
+    int found = locateStudent(updateRollNo);
 
     // If student not found, show a message and exit
 
@@ -1325,45 +2570,112 @@ void updateStudent()
     Student tempStudent;
     memcpy(&tempStudent, &students[found], sizeof(Student)); // Using memcpy for safe copy
 
-    int choice;
-
-    do
+    if (editStudentCopy(&tempStudent))
     {
-        // Display current student details and  prompt for update choice
-        printf("\n=== Current Student Details ===\n");
-        printf("Name     : %s\n", tempStudent.name);
-        printf("Roll No. : %s\n", tempStudent.rollNo);
-        printf("Branch   : %s\n", tempStudent.branch);
-        printf("Semester : %d\n", tempStudent.semester);
-
-        printf("\nWhat would you like to update?\n");
-        printf("1. Name\n");
-        printf("2. Theoretical Marks\n");
-        printf("3. Practical Marks\n");
-        printf("4. Save and Exit\n");
-        printf("5. Exit without Saving\n");
-        printf("\n\nEnter Your Choice : ");
+        // Save changes as a one-operation transaction
+        Transaction txn;
 
-        if (scanf("%d", &choice) != 1)
+        beginTransaction(&txn);
+        stageOperation(&txn, TXN_UPDATE, &tempStudent);
+        if (commitTransaction(&txn) == 0)
         {
-            clearInputBuffer();
-            choice = 0; // Invalid input
-            continue;
+            printf("\nChanges Saved Successfully.\n");
         }
-        clearInputBuffer();
+    }
+}
 
-        switch (choice)
-        {
-        case 1:
-            printf("\nCurrent Name: %s\n", tempStudent.name);
+
+
+
+/*
+keepValidMarks - Checks the marks just entered in some mark columns of a student and restores those out of range.
+
+All the entered marks are checked at once against subjectMarks[]; the ones out of range are listed in one report and
+set back to their value in before, the others are kept.
+
+Returns:
+- The number of mark columns that were restored, 0 if every entered mark is valid.
+*/
+static int keepValidMarks(Student *edited, const Student *before, unsigned int columns)
+{
+    unsigned int invalid;
+    int restored = 0;
+
+    validateMarkRows(edited, 1, &invalid);
+    invalid &= columns;
+    if (invalid == 0)
+    {
+        return 0;
+    }
+
+    printf("\nMarks Out of Range (Valid Marks Are 0 to the Maximum Marks), Previous Marks Kept :\n");
+    printMarkErrors(stdout, edited, 1, &invalid);
+    for (int column = 0; column < NUM_MARK_COLUMNS; column++)
+    {
+        if (invalid & (1u << column))
+        {
+            setMarkColumnValue(edited, column, markColumnValue(before, column));
+            restored++;
+        }
+    }
+    printf("Other Marks Updated.\n");
+    return restored;
+}
+
+
+
+
+/*
+editStudentCopy - Lets the admin edit the name and marks of a copy of a student.
+
+The copy is only changed in memory. It is used by updateStudent() and by the batch edit, which stages the copy instead of saving it.
+Entered marks out of range of subjectMarks[] are reported together and the previous marks are kept.
+
+Returns:
+- 1 if the admin chose to save the changes, 0 if they were discarded.
+*/
+int editStudentCopy(Student *tempStudent)
+{
+    Student before; // The student before the marks being entered, to restore those out of range
+    int choice;
+
+    do
+    {
+        // Display current student details and  prompt for update choice
+        printf("\n=== Current Student Details ===\n");
+        printf("Name     : %s\n", tempStudent->name);
+        printf("Roll No. : %s\n", tempStudent->rollNo);
+        printf("Branch   : %s\n", tempStudent->branch);
+        printf("Semester : %d\n", tempStudent->semester);
+
+        printf("\nWhat would you like to update?\n");
+        printf("1. Name\n");
+        printf("2. Theoretical Marks\n");
+        printf("3. Practical Marks\n");
+        printf("4. Save and Exit\n");
+        printf("5. Exit without Saving\n");
+        printf("\n\nEnter Your Choice : ");
+
+        if (scanf("%d", &choice) != 1)
+        {
+            clearInputBuffer();
+            choice = 0; // Invalid input
+            continue;
+        }
+        clearInputBuffer();
+
+        switch (choice)
+        {
+        case 1:
+            printf("\nCurrent Name: %s\n", tempStudent->name);
             printf("Enter New Name (or press Enter to keep current): ");
             char newName[MAX_NAME_LENGTH];
             fgets(newName, MAX_NAME_LENGTH, stdin);
             newName[strcspn(newName, "\n")] = 0;
             if (strlen(newName) > 0)
             {
-                strncpy(tempStudent.name, newName, MAX_NAME_LENGTH - 1);
-                tempStudent.name[MAX_NAME_LENGTH - 1] = '\0';
+                strncpy(tempStudent->name, newName, MAX_NAME_LENGTH - 1);
+                tempStudent->name[MAX_NAME_LENGTH - 1] = '\0';
                 printf("Name Updated Successfully!\n");
             }
             else
@@ -1373,45 +2685,49 @@ void updateStudent()
             break;
 
         case 2:
+            before = *tempStudent;
             printf("\nUpdating Theoretical Marks:\n");
             for (int i = 0; i < NUM_SUBJECTS; i++)
             {
-                printf("Current Marks for %s: %d\n", subjects[i], tempStudent.obtainedMarks[i]);
+                printf("Current Marks for %s: %d\n", subjects[i], tempStudent->obtainedMarks[i]);
                 printf("Enter New Marks: ");
-                if (scanf("%d", &tempStudent.obtainedMarks[i]) != 1)
+                if (scanf("%d", &tempStudent->obtainedMarks[i]) != 1)
                 {
                     printf("Invalid input! Keeping previous marks.\n");
                     clearInputBuffer();
                 }
             }
-            printf("Theoretical Marks Updated Successfully!\n");
+            if (keepValidMarks(tempStudent, &before, THEORY_MARK_COLUMNS) == 0)
+            {
+                printf("Theoretical Marks Updated Successfully!\n");
+            }
             break;
 
         case 3:
+            before = *tempStudent;
             printf("\nUpdating Practical Marks:\n");
             for (int i = 0; i < NUM_SUBJECTS_PRAC; i++)
             {
-                printf("Current Practical Marks for %s: %d\n", practicalSubjects[i], tempStudent.obtainedPracticalMarks[i]);
+                printf("Current Practical Marks for %s: %d\n", practicalSubjects[i], tempStudent->obtainedPracticalMarks[i]);
                 printf("Enter New Practical Marks: ");
-                if (scanf("%d", &tempStudent.obtainedPracticalMarks[i]) != 1)
+                if (scanf("%d", &tempStudent->obtainedPracticalMarks[i]) != 1)
                 {
                     printf("Invalid input! Keeping previous marks.\n");
                     clearInputBuffer();
                 }
             }
-            printf("Practical Marks Updated Successfully!\n");
+            if (keepValidMarks(tempStudent, &before, PRACTICAL_MARK_COLUMNS) == 0)
+            {
+                printf("Practical Marks Updated Successfully!\n");
+            }
             break;
 
         case 4:
-            // Save changes
-            memcpy(&students[found], &tempStudent, sizeof(Student));
-            saveToCSV();
-            printf("\nChanges Saved Successfully.\n");
-            return;
+            return 1;
 
         case 5:
             printf("\nExiting Without Saving Changes.\n");
-            return;
+            return 0;
 
         default:
             printf("\nInvalid Choice! Please select a valid option.\n");
@@ -1437,16 +2753,10 @@ void deleteStudent()
 {
 
     printf("\n=== View All Students ===\n\n");
-    printf("Roll No\t\t\t\tName\t\t\t\tBranch/Sem\n");
-    printf("------------------------------------------------------------------------------\n");
 
     // Display all students
     int i;
-    for (i = 0; i < studentCount; i++)
-    {
-        printf("%-32s%-33s%s/%d\n", students[i].rollNo, students[i].name, students[i].branch, students[i].semester);
-    }
-    printf("------------------------------------------------------------------------------\n\n");
+    printStudentList(stdout, students, NULL, studentCount);
 
     char deleteRollNo[MAX_ROLLNO_LENGTH];
     printf("\n--- Delete Student ---\n\n");
@@ -1454,15 +2764,7 @@ void deleteStudent()
     scanf("%s", deleteRollNo);
 
     // Search for the student
-    int found = -1;
-    for (i = 0; i < studentCount; i++)
-    {
-        if (strcmp(students[i].rollNo, deleteRollNo) == 0)
-        {
-            found = i;
-            break;
-        }
-    }
+    int found = locateStudent(deleteRollNo);
 
     if (found == -1)
     {
@@ -1500,23 +2802,20 @@ void deleteStudent()
 
     if (confirm == 'y' || confirm == 'Y')
     {
-        // Shift all students after the found student to the left by one
-        for (i = found; i < studentCount - 1; i++)
+        // Delete the student as a one-operation transaction
+        Transaction txn;
+
+        beginTransaction(&txn);
+        stageOperation(&txn, TXN_DELETE, &students[found]);
+        if (commitTransaction(&txn) == 0)
         {
-            students[i] = students[i + 1];
+            printf("Student with Roll Number %s has been deleted successfully.\n\n", deleteRollNo);
         }
-
-        // Decrement the student count
-        studentCount--;
-
-        printf("Student with Roll Number %s has been deleted successfully.\n\n", deleteRollNo);
     }
     else
     {
         printf("Deletion cancelled. No changes made.\n\n");
     }
-
-    saveToCSV();
 }
 
 
@@ -1619,6 +2918,7 @@ UserRole login(int *studentIndex)
         if (strcmp(username, "a") == 0 && strcmp(password, "1") == 0)
         {
             printf("Admin Login Successful!\n");
+            traceOperation(TRACE_LOGIN, "admin");
             return ADMIN;
         }
         else
@@ -1636,15 +2936,14 @@ UserRole login(int *studentIndex)
         clearInputBuffer();
 
         // Check if student exists
-        int i;
-        for (i = 0; i < studentCount; i++)
+        waitForDatabase();
+        int i = locateStudent(studentRollNo);
+        if (i != -1)
         {
-            if (strcmp(students[i].rollNo, studentRollNo) == 0)
-            {
-                printf("Student Login Successful!\n");
-                *studentIndex = i;
-                return STUDENT;
-            }
+            printf("Student Login Successful!\n");
+            traceOperation(TRACE_LOGIN, "%s", studentRollNo);
+            *studentIndex = i;
+            return STUDENT;
         }
 
         printf("Roll Number not found! Please Re-Enter to Login.\n");
@@ -1656,3 +2955,13487 @@ UserRole login(int *studentIndex)
         return login(studentIndex);
     }
 }
+
+
+
+
+/*
+studentTotalMarks - Calculates the total marks of a student.
+
+This function adds up the marks obtained in all theoretical and practical subjects of the given student.
+*/
+int studentTotalMarks(const Student *s)
+{
+    int total = 0;
+
+    for (int i = 0; i < NUM_SUBJECTS; i++)
+    {
+        total += s->obtainedMarks[i];
+    }
+    for (int i = 0; i < NUM_SUBJECTS_PRAC; i++)
+    {
+        total += s->obtainedPracticalMarks[i];
+    }
+
+    return total;
+}
+
+
+
+
+/*
+mapSubjectColumns - Maps each subject of the subjectMarks array to its theory and practical columns.
+
+A subject can have a theory part, a practical part or both. The columns are matched by subject name the first time the function is called,
+so the subjects and practicalSubjects arrays can be kept in any order. A column index of -1 means the subject has no such part.
+*/
+void mapSubjectColumns()
+{
+    static int columnsMapped = 0;
+
+    if (columnsMapped)
+    {
+        return;
+    }
+
+    for (int i = 0; i < TOTAL_SUBJECTS; i++)
+    {
+        subjectTheoryColumn[i] = -1;
+        subjectPracticalColumn[i] = -1;
+
+        for (int j = 0; j < NUM_SUBJECTS; j++)
+        {
+            if (strcasecmp(subjects[j], subjectMarks[i].subject) == 0)
+            {
+                subjectTheoryColumn[i] = j;
+            }
+        }
+        for (int j = 0; j < NUM_SUBJECTS_PRAC; j++)
+        {
+            if (strcasecmp(practicalSubjects[j], subjectMarks[i].subject) == 0)
+            {
+                subjectPracticalColumn[i] = j;
+            }
+        }
+    }
+    columnsMapped = 1;
+}
+
+
+
+
+/*
+subjectTotalMarks - Calculates the marks of a student in one subject of the subjectMarks array.
+
+Parameters:
+- s: The student whose marks are added.
+- subjectIndex: Index of the subject in the "subjectMarks" array.
+
+Returns:
+- The sum of the theory and practical marks of that subject.
+*/
+int subjectTotalMarks(const Student *s, int subjectIndex)
+{
+    mapSubjectColumns();
+
+    int total = 0;
+
+    if (subjectTheoryColumn[subjectIndex] != -1)
+    {
+        total += s->obtainedMarks[subjectTheoryColumn[subjectIndex]];
+    }
+    if (subjectPracticalColumn[subjectIndex] != -1)
+    {
+        total += s->obtainedPracticalMarks[subjectPracticalColumn[subjectIndex]];
+    }
+
+    return total;
+}
+
+
+
+
+// Sort keys used by compareRankOrder(), as qsort() does not pass a context pointer
+const int *rankSortKeys;
+int rankSortByGroup;
+
+/*
+compareRankOrder - qsort comparator ordering student indexes for ranking.
+
+Students are ordered by their key in descending order. When rankSortByGroup is set, they are first grouped by branch and semester.
+Branches are compared ignoring case, like the branch filter of printTopStudents(), so "cse" and "CSE" form one group.
+Students with equal keys keep the order of the database file.
+*/
+int compareRankOrder(const void *a, const void *b)
+{
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+
+    if (rankSortByGroup)
+    {
+        int cmp = strcasecmp(students[x].branch, students[y].branch);
+        if (cmp != 0)
+        {
+            return cmp;
+        }
+        if (students[x].semester != students[y].semester)
+        {
+            return students[x].semester < students[y].semester ? -1 : 1;
+        }
+    }
+
+    if (rankSortKeys[x] != rankSortKeys[y])
+    {
+        return rankSortKeys[x] > rankSortKeys[y] ? -1 : 1;
+    }
+
+    return x - y;
+}
+
+
+
+
+/*
+assignRanks - Assigns ranks to students that are already sorted by compareRankOrder().
+
+Ranks restart at 1 for every branch/semester group when byGroup is set. Tied students get the same rank,
+and the rank of the next student depends on rankTieMode (competition or dense ranking).
+
+Parameters:
+- order: Student indexes in ranking order.
+- n: Number of entries in order.
+- keys: Marks used for ranking, indexed by student.
+- byGroup: Non-zero to rank within each branch/semester.
+- rankOut: Receives the rank of each student, indexed by student.
+- groupSizeOut: Receives the size of the student's group, may be NULL.
+*/
+void assignRanks(const int *order, int n, const int *keys, int byGroup, int *rankOut, int *groupSizeOut)
+{
+    int start = 0;
+
+    while (start < n)
+    {
+        // Find the end of the current group
+        int end = n;
+
+        if (byGroup)
+        {
+            end = start + 1;
+            while (end < n &&
+                   strcasecmp(students[order[end]].branch, students[order[start]].branch) == 0 &&
+                   students[order[end]].semester == students[order[start]].semester)
+            {
+                end++;
+            }
+        }
+
+        int rank = 0;
+        int denseRank = 0;
+
+        for (int i = start; i < end; i++)
+        {
+            // A new rank starts whenever the marks differ from the previous student
+            if (i == start || keys[order[i]] != keys[order[i - 1]])
+            {
+                denseRank++;
+                rank = (rankTieMode == RANK_DENSE) ? denseRank : i - start + 1;
+            }
+
+            rankOut[order[i]] = rank;
+
+            if (groupSizeOut != NULL)
+            {
+                groupSizeOut[order[i]] = end - start;
+            }
+        }
+
+        start = end;
+    }
+}
+
+
+
+
+/*
+computeRanks - Rebuilds the rank cache for all students.
+
+This function computes the overall rank, the rank within the branch/semester and the rank in every subject for each student,
+and stores them in the studentRanks array.
+*/
+void computeRanks()
+{
+    int order[MAX_STUDENTS];
+    int keys[MAX_STUDENTS];
+    int ranks[MAX_STUDENTS];
+    int groupSizes[MAX_STUDENTS];
+    int i;
+
+    loadAllShards(); // Ranks are relative to every student
+
+    for (i = 0; i < studentCount; i++)
+    {
+        studentRanks[i].total = studentTotalMarks(&students[i]);
+        keys[i] = studentRanks[i].total;
+        order[i] = i;
+    }
+
+    rankSortKeys = keys;
+
+    // Overall ranks
+    rankSortByGroup = 0;
+    qsort(order, studentCount, sizeof(int), compareRankOrder);
+    assignRanks(order, studentCount, keys, 0, ranks, NULL);
+    for (i = 0; i < studentCount; i++)
+    {
+        studentRanks[i].overallRank = ranks[i];
+    }
+
+    // Ranks within each branch and semester
+    rankSortByGroup = 1;
+    qsort(order, studentCount, sizeof(int), compareRankOrder);
+    assignRanks(order, studentCount, keys, 1, ranks, groupSizes);
+    for (i = 0; i < studentCount; i++)
+    {
+        studentRanks[i].groupRank = ranks[i];
+        studentRanks[i].groupSize = groupSizes[i];
+    }
+
+    // Ranks in each subject
+    rankSortByGroup = 0;
+    for (int sub = 0; sub < TOTAL_SUBJECTS; sub++)
+    {
+        for (i = 0; i < studentCount; i++)
+        {
+            keys[i] = subjectTotalMarks(&students[i], sub);
+        }
+
+        qsort(order, studentCount, sizeof(int), compareRankOrder);
+        assignRanks(order, studentCount, keys, 0, ranks, NULL);
+
+        for (i = 0; i < studentCount; i++)
+        {
+            studentRanks[i].subjectRank[sub] = ranks[i];
+        }
+    }
+
+    ranksValid = 1;
+}
+
+
+
+
+/*
+invalidateRanks - Marks the rank cache as stale.
+
+It must be called whenever students are added, updated, deleted or reloaded. The ranks are recomputed the next time they are needed.
+*/
+void invalidateRanks()
+{
+    ranksValid = 0;
+}
+
+
+
+
+/*
+getStudentRank - Returns the ranks of a student, recomputing the rank cache if needed.
+
+Returns NULL if the student is not stored in the students array.
+*/
+const StudentRank *getStudentRank(const Student *s)
+{
+    if (s < students || s >= students + studentCount)
+    {
+        return NULL;
+    }
+
+    if (!ranksValid)
+    {
+        computeRanks();
+    }
+
+    return &studentRanks[s - students];
+}
+
+
+
+
+/*
+siftDownMinHeap - Restores the min-heap property of heap[] starting from position i.
+*/
+void siftDownMinHeap(int *heap, int size, int i)
+{
+    while (1)
+    {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = 2 * i + 2;
+
+        if (left < size && heap[left] < heap[smallest])
+        {
+            smallest = left;
+        }
+        if (right < size && heap[right] < heap[smallest])
+        {
+            smallest = right;
+        }
+        if (smallest == i)
+        {
+            return;
+        }
+
+        int temp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = temp;
+        i = smallest;
+    }
+}
+
+
+
+
+/*
+printTopStudents - Prints the top N students of a merit list.
+
+The cut-off marks are found with a min-heap holding the N best marks, so only the selected students are sorted instead of the whole database.
+Students tied with the last place are also listed.
+
+Parameters:
+- n: Number of places to list.
+- branch: Branch to filter on, or NULL for all students.
+- semester: Semester to filter on (used only together with branch).
+- subjectIndex: Index in the "subjectMarks" array, or -1 to rank by total marks.
+*/
+void printTopStudents(int n, const char *branch, int semester, int subjectIndex)
+{
+    int keys[MAX_STUDENTS];
+    int heap[MAX_STUDENTS];
+    int selected[MAX_STUDENTS];
+    int heapSize = 0;
+    int selectedCount = 0;
+    int i;
+
+    if (!ranksValid)
+    {
+        computeRanks();
+    }
+
+    // Keep the N best marks of the matching students in a min-heap
+    for (i = 0; i < studentCount; i++)
+    {
+        if (branch != NULL && (strcasecmp(students[i].branch, branch) != 0 || students[i].semester != semester))
+        {
+            continue;
+        }
+
+        keys[i] = (subjectIndex == -1) ? studentRanks[i].total : subjectTotalMarks(&students[i], subjectIndex);
+
+        if (heapSize < n)
+        {
+            heap[heapSize++] = keys[i];
+
+            // Build the heap once it is full
+            if (heapSize == n)
+            {
+                for (int j = n / 2 - 1; j >= 0; j--)
+                {
+                    siftDownMinHeap(heap, heapSize, j);
+                }
+            }
+        }
+        else if (keys[i] > heap[0])
+        {
+            heap[0] = keys[i];
+            siftDownMinHeap(heap, heapSize, 0);
+        }
+    }
+
+    if (heapSize == 0)
+    {
+        printf("No Student record available for this list.\n\n");
+        return;
+    }
+
+    // The smallest mark in the heap is the cut-off mark
+    int cutoff = heap[0];
+    for (i = 1; i < heapSize && heapSize < n; i++)
+    {
+        if (heap[i] < cutoff)
+        {
+            cutoff = heap[i];
+        }
+    }
+
+    // Collect the students at or above the cut-off and sort only them
+    for (i = 0; i < studentCount; i++)
+    {
+        if (branch != NULL && (strcasecmp(students[i].branch, branch) != 0 || students[i].semester != semester))
+        {
+            continue;
+        }
+        if (keys[i] >= cutoff)
+        {
+            selected[selectedCount++] = i;
+        }
+    }
+
+    rankSortKeys = keys;
+    rankSortByGroup = 0;
+    qsort(selected, selectedCount, sizeof(int), compareRankOrder);
+
+    printf("Rank     Roll No         Name                                Branch/Sem     Marks\n");
+    printf("-----------------------------------------------------------------------------------\n");
+
+    for (i = 0; i < selectedCount; i++)
+    {
+        const Student *s = &students[selected[i]];
+        const StudentRank *rank = &studentRanks[selected[i]];
+        int shownRank;
+
+        if (subjectIndex != -1)
+        {
+            shownRank = rank->subjectRank[subjectIndex];
+        }
+        else if (branch != NULL)
+        {
+            shownRank = rank->groupRank;
+        }
+        else
+        {
+            shownRank = rank->overallRank;
+        }
+
+        printf("%-8d %-15s %-35s %s/%-12d %d\n", shownRank, s->rollNo, s->name, s->branch, s->semester, keys[selected[i]]);
+    }
+    printf("-----------------------------------------------------------------------------------\n\n");
+}
+
+
+
+
+/*
+viewMeritList - Displays merit lists and subject toppers.
+
+This function lets the admin view the overall merit list, the merit list of a branch and semester, or the toppers of a subject.
+It also allows switching between competition ranking (1, 2, 2, 4) and dense ranking (1, 2, 2, 3) for tied students.
+*/
+void viewMeritList()
+{
+    int choice;
+
+    while (1)
+    {
+        printf("\n===== Merit List and Ranks =====\n\n");
+        printf("1. Overall Merit List\n");
+        printf("2. Branch/Semester Merit List\n");
+        printf("3. Subject Toppers\n");
+        printf("4. Change Tie Handling (Current : %s)\n", rankTieMode == RANK_DENSE ? "Dense" : "Competition");
+        printf("5. Return to Admin Menu\n\n");
+        printf("Enter Your Choice : ");
+
+        if (scanf("%d", &choice) != 1)
+        {
+            printf("Invalid Input! Please Enter a Number.\n");
+            clearInputBuffer();
+            continue;
+        }
+
+        if (choice == 5)
+        {
+            return;
+        }
+
+        if (choice == 4)
+        {
+            rankTieMode = (rankTieMode == RANK_DENSE) ? RANK_COMPETITION : RANK_DENSE;
+            invalidateRanks();
+            printf("Tie Handling Changed to %s Ranking.\n", rankTieMode == RANK_DENSE ? "Dense" : "Competition");
+            continue;
+        }
+
+        if (choice < 1 || choice > 5)
+        {
+            printf("Invalid Choice! Please Select a Valid Option.\n");
+            continue;
+        }
+        traceOperation(TRACE_MERIT, "%d", choice);
+
+        char branch[MAX_LENGTH] = "";
+        int semester = 0;
+        int subjectIndex = -1;
+        int topN;
+
+        if (choice == 2)
+        {
+            char branchSem[MAX_LENGTH];
+            printf("Enter Branch/Sem : ");
+            scanf("%29s", branchSem);
+
+            if (sscanf(branchSem, "%29[^/]/%d", branch, &semester) != 2)
+            {
+                printf("Invalid Branch/Sem! Please Enter it like CSE/5.\n");
+                continue;
+            }
+        }
+        else if (choice == 3)
+        {
+            printf("\n");
+            for (int i = 0; i < TOTAL_SUBJECTS; i++)
+            {
+                printf("%d. %s\n", i + 1, subjectMarks[i].subject);
+            }
+            printf("\nEnter Subject : ");
+
+            if (scanf("%d", &subjectIndex) != 1 || subjectIndex < 1 || subjectIndex > TOTAL_SUBJECTS)
+            {
+                printf("Invalid Subject!\n");
+                clearInputBuffer();
+                continue;
+            }
+            subjectIndex--;
+        }
+
+        printf("How many places do you want to see? : ");
+        if (scanf("%d", &topN) != 1 || topN < 1)
+        {
+            printf("Invalid Input! Please Enter a Positive Number.\n");
+            clearInputBuffer();
+            continue;
+        }
+        if (topN > studentCount)
+        {
+            topN = studentCount;
+        }
+
+        if (choice == 1)
+        {
+            printf("\n===== Overall Merit List (Top %d) =====\n\n", topN);
+            printTopStudents(topN, NULL, 0, -1);
+        }
+        else if (choice == 2)
+        {
+            printf("\n===== Merit List For %s/%d (Top %d) =====\n\n", branch, semester, topN);
+            printTopStudents(topN, branch, semester, -1);
+        }
+        else
+        {
+            printf("\n===== Toppers in %s (Top %d) =====\n\n", subjectMarks[subjectIndex].subject, topN);
+            printTopStudents(topN, NULL, 0, subjectIndex);
+        }
+    }
+}
+
+
+
+
+/*
+compareGradeBoundaries - qsort comparator ordering grades from the highest to the lowest minimum percentage.
+*/
+int compareGradeBoundaries(const void *a, const void *b)
+{
+    return ((const GradeBoundary *)b)->minPercent - ((const GradeBoundary *)a)->minPercent;
+}
+
+
+
+
+/*
+loadGradingConfig - Loads subject credits and grade boundaries from GRADING_CONFIG_FILE.
+
+The file is optional, the built-in credits of subjectMarks[] and the built-in gradeScale are used if it does not exist.
+Each line is either a credit entry or a grade entry, lines starting with '#' are ignored :
+
+CREDITS,Java Programming,4
+GRADE,A+,80,9
+
+If the file defines any grade, the built-in grading scale is replaced by the grades of the file.
+*/
+void loadGradingConfig()
+{
+    FILE *fp = fopen(GRADING_CONFIG_FILE, "r");
+
+    if (fp != NULL)
+    {
+        char line[MAX_LINE_LENGTH];
+        GradeBoundary scale[MAX_GRADES];
+        int count = 0;
+        int lineNo = 0;
+
+        while (fgets(line, MAX_LINE_LENGTH, fp))
+        {
+            lineNo++;
+            trim(line);
+
+            if (line[0] == '\0' || line[0] == '#')
+            {
+                continue;
+            }
+
+            char *kind = strtok(line, ",");
+            char *field1 = strtok(NULL, ",");
+            char *field2 = strtok(NULL, ",");
+            char *field3 = strtok(NULL, ",");
+
+            if (kind != NULL && strcasecmp(kind, "CREDITS") == 0 && field1 != NULL && field2 != NULL)
+            {
+                trim(field1);
+                SubjectMaxMarks *subject = findSubjectMaxMarks(field1);
+                int credits = atoi(field2);
+
+                if (subject == NULL || credits < 0)
+                {
+                    printf("Warning : Invalid Credits on Line %d of %s. Ignored.\n", lineNo, GRADING_CONFIG_FILE);
+                    continue;
+                }
+                subject->credits = credits;
+            }
+            else if (kind != NULL && strcasecmp(kind, "GRADE") == 0 && field1 != NULL && field2 != NULL && field3 != NULL && count < MAX_GRADES)
+            {
+                trim(field1);
+                strncpy(scale[count].grade, field1, sizeof(scale[count].grade) - 1);
+                scale[count].grade[sizeof(scale[count].grade) - 1] = '\0';
+                scale[count].minPercent = atoi(field2);
+                scale[count].gradePoint = atoi(field3);
+                count++;
+            }
+            else
+            {
+                printf("Warning : Invalid Entry on Line %d of %s. Ignored.\n", lineNo, GRADING_CONFIG_FILE);
+            }
+        }
+        fclose(fp);
+
+        if (count > 0)
+        {
+            memcpy(gradeScale, scale, count * sizeof(GradeBoundary));
+            gradeCount = count;
+        }
+        printf("Grading Configuration Loaded From %s.\n", GRADING_CONFIG_FILE);
+    }
+
+    qsort(gradeScale, gradeCount, sizeof(GradeBoundary), compareGradeBoundaries);
+    buildGradeLookup();
+}
+
+
+
+
+/*
+buildGradeLookup - Rebuilds the grade lookup table.
+
+For every subject and every possible mark from 0 to the subject's maximum marks in subjectMarks[], the table stores the index of the grade in gradeScale.
+Grading a student then needs one table lookup per subject instead of a percentage calculation and a search through the grading scale.
+*/
+void buildGradeLookup()
+{
+    for (int sub = 0; sub < TOTAL_SUBJECTS; sub++)
+    {
+        int maxMarks = subjectMarks[sub].maxTheory + subjectMarks[sub].maxPractical;
+
+        for (int marks = 0; marks <= MAX_SUBJECT_MARKS; marks++)
+        {
+            int g = gradeCount - 1; // Lowest grade if no boundary is reached
+
+            for (int j = 0; j < gradeCount; j++)
+            {
+                if (marks * 100 >= gradeScale[j].minPercent * maxMarks)
+                {
+                    g = j;
+                    break;
+                }
+            }
+            gradeLookup[sub][marks] = (unsigned char)g;
+        }
+    }
+}
+
+
+
+
+/*
+computeGrades - Computes the grades, SGPA and pass/fail result of a range of students.
+
+The marks are processed one subject column at a time across all students of the range, using the grade lookup table,
+so grading the whole database is a single pass over the marks. The results are stored in the studentGrades cache.
+
+Parameters:
+- first: Index of the first student to grade.
+- last: Index after the last student to grade.
+*/
+void computeGrades(int first, int last)
+{
+    int points[MAX_STUDENTS];
+    int failed[MAX_STUDENTS];
+    int totalCredits = 0;
+    int i;
+
+    for (i = first; i < last; i++)
+    {
+        points[i] = 0;
+        failed[i] = 0;
+    }
+
+    for (int sub = 0; sub < TOTAL_SUBJECTS; sub++)
+    {
+        const unsigned char *lookup = gradeLookup[sub];
+        int credits = subjectMarks[sub].credits;
+        int maxMarks = subjectMarks[sub].maxTheory + subjectMarks[sub].maxPractical;
+
+        totalCredits += credits;
+
+        for (i = first; i < last; i++)
+        {
+            int marks = subjectTotalMarks(&students[i], sub);
+
+            // Keep out of range marks inside the lookup table
+            if (marks < 0)
+            {
+                marks = 0;
+            }
+            if (marks > maxMarks)
+            {
+                marks = maxMarks;
+            }
+
+            int g = lookup[marks];
+            studentGrades[i].gradeIndex[sub] = g;
+            points[i] += credits * gradeScale[g].gradePoint;
+            failed[i] |= (gradeScale[g].gradePoint == 0);
+        }
+    }
+
+    for (i = first; i < last; i++)
+    {
+        studentGrades[i].sgpa = (totalCredits > 0) ? (double)points[i] / totalCredits : 0.0;
+        studentGrades[i].passed = !failed[i];
+    }
+}
+
+
+
+
+/*
+gradeStudent - Computes the grades, SGPA and pass/fail result of a single student.
+
+It is used for students that are not part of the students array, e.g. rows streamed from an archive file,
+and gives the same result as computeGrades().
+*/
+void gradeStudent(const Student *s, StudentGrades *grades)
+{
+    int points = 0;
+    int failed = 0;
+    int totalCredits = 0;
+
+    for (int sub = 0; sub < TOTAL_SUBJECTS; sub++)
+    {
+        int maxMarks = subjectMarks[sub].maxTheory + subjectMarks[sub].maxPractical;
+        int marks = subjectTotalMarks(s, sub);
+
+        if (marks < 0)
+        {
+            marks = 0;
+        }
+        if (marks > maxMarks)
+        {
+            marks = maxMarks;
+        }
+
+        int g = gradeLookup[sub][marks];
+        grades->gradeIndex[sub] = g;
+        points += subjectMarks[sub].credits * gradeScale[g].gradePoint;
+        failed |= (gradeScale[g].gradePoint == 0);
+        totalCredits += subjectMarks[sub].credits;
+    }
+
+    grades->sgpa = (totalCredits > 0) ? (double)points / totalCredits : 0.0;
+    grades->passed = !failed;
+}
+
+
+
+
+/*
+viewGrading - Displays the grading scheme and the SGPA of all students.
+
+This function lets the admin view the subject credits and grade boundaries, list the SGPA and result of every student,
+and reload GRADING_CONFIG_FILE after editing it.
+*/
+void viewGrading()
+{
+    int choice;
+
+    while (1)
+    {
+        printf("\n===== Grades and SGPA =====\n\n");
+        printf("1. View Grading Scheme\n");
+        printf("2. View SGPA of All Students\n");
+        printf("3. Reload Grading Configuration\n");
+        printf("4. Export Result Cards of All Students to Excel ('%s')\n", XLSX_CARDS_FILE);
+        printf("5. Return to Admin Menu\n\n");
+        printf("Enter Your Choice : ");
+
+        if (scanf("%d", &choice) != 1)
+        {
+            printf("Invalid Input! Please Enter a Number.\n");
+            clearInputBuffer();
+            continue;
+        }
+
+        switch (choice)
+        {
+        case 1:
+            printf("\n===== Subject Credits =====\n\n");
+            printf("Subject                              Maximum Marks      Credits\n");
+            printf("-----------------------------------------------------------------\n");
+            for (int i = 0; i < TOTAL_SUBJECTS; i++)
+            {
+                printf("%-36s %-18d %d\n", subjectMarks[i].subject, subjectMarks[i].maxTheory + subjectMarks[i].maxPractical, subjectMarks[i].credits);
+            }
+            printf("-----------------------------------------------------------------\n\n");
+
+            printf("===== Grading Scale =====\n\n");
+            printf("Grade     Minimum Percentage     Grade Point\n");
+            printf("----------------------------------------------\n");
+            for (int i = 0; i < gradeCount; i++)
+            {
+                printf("%-9s %-22d %d\n", gradeScale[i].grade, gradeScale[i].minPercent, gradeScale[i].gradePoint);
+            }
+            printf("----------------------------------------------\n");
+            printf("A grade point of 0 means the subject is failed.\n\n");
+            break;
+
+        case 2:
+        {
+            int passedCount = 0;
+            double sgpaSum = 0.0;
+
+            printf("\nRoll No         Name                                Branch/Sem     SGPA     Result\n");
+            printf("-------------------------------------------------------------------------------------\n");
+            for (int i = 0; i < studentCount; i++)
+            {
+                char branchSem[MAX_LENGTH + 8];
+                sprintf(branchSem, "%s/%d", students[i].branch, students[i].semester);
+                printf("%-15s %-35s %-14s %-8.2f %s\n", students[i].rollNo, students[i].name, branchSem,
+                       studentGrades[i].sgpa, studentGrades[i].passed ? "PASS" : "FAIL");
+
+                passedCount += studentGrades[i].passed;
+                sgpaSum += studentGrades[i].sgpa;
+            }
+            printf("-------------------------------------------------------------------------------------\n");
+
+            if (studentCount > 0)
+            {
+                printf("Passed : %d of %d (%.1f%%)     Average SGPA : %.2f\n\n", passedCount, studentCount,
+                       100.0 * passedCount / studentCount, sgpaSum / studentCount);
+            }
+            break;
+        }
+
+        case 3:
+            loadGradingConfig();
+            computeGrades(0, studentCount);
+            invalidateRanks();
+            printf("Grades Recomputed For %d Students.\n", studentCount);
+            break;
+
+        case 4:
+            exportXlsx(XLSX_CARDS_FILE, XLSX_RESULT_CARDS, 0, students, studentGrades, NULL, studentCount);
+            break;
+
+        case 5:
+            return;
+
+        default:
+            printf("Invalid Choice! Please Select a Valid Option.\n");
+        }
+    }
+}
+
+
+
+
+// SubjectReportFile - Report file of one subject, written by exportAllSubjectReports()
+typedef struct
+{
+    int subjectIndex;                // Index of the subject in the subjectMarks array
+    char fileName[MAX_LINE_LENGTH]; // Report file to write
+    FILE *fp;                        // Open report file, NULL if it could not be created
+    int failed;                      // 1 if the file could not be written
+} SubjectReportFile;
+
+
+
+
+/*
+writeSubjectReport - Writes the report of one subject.
+
+The report has the same layout as the report of viewSubjectWiseResults(). The rows are only read,
+so several reports can be written at the same time from different threads.
+
+Parameters:
+- fp: File (or stdout) to write the report to.
+- subjectIndex: Index of the subject in the "subjectMarks" array.
+- rows: Student array to read, usually the students array.
+- indexes: Indexes in rows of the students to include, or NULL for all rows.
+- count: Number of entries in indexes (or number of rows when indexes is NULL).
+
+Returns:
+- The number of student rows written.
+*/
+int writeSubjectReport(FILE *fp, int subjectIndex, const Student *rows, const int *indexes, int count)
+{
+    writeSubjectReportHeader(fp, subjectIndex);
+    writeSubjectReportRows(fp, subjectIndex, rows, indexes, count);
+    fprintf(fp, "-------------------------------------------------------------------------------------------------------------\n");
+
+    return count;
+}
+
+
+
+
+/*
+writeSubjectReportHeader - Writes the title and column headers of a subject report.
+*/
+void writeSubjectReportHeader(FILE *fp, int subjectIndex)
+{
+    const SubjectMaxMarks *subjectMax = &subjectMarks[subjectIndex];
+
+    fprintf(fp, "\n\n===== Result For %s =====\n\n", subjectMax->subject);
+    fprintf(fp, "-------------------------------------------------------------------------------------------------------------\n");
+    fprintf(fp, "Roll No         Name                Branch    Semester     Theory Marks (Max %d)     Practical Marks (Max %d)\n", subjectMax->maxTheory, subjectMax->maxPractical);
+    fprintf(fp, "-------------------------------------------------------------------------------------------------------------\n");
+}
+
+
+
+
+/*
+writeSubjectReportRows - Writes the rows of a subject report without its header and footer.
+
+It is used directly when a report is written in several parts, e.g. while streaming an archive file.
+*/
+void writeSubjectReportRows(FILE *fp, int subjectIndex, const Student *rows, const int *indexes, int count)
+{
+    mapSubjectColumns();
+
+    int theoryColumn = subjectTheoryColumn[subjectIndex];
+    int practicalColumn = subjectPracticalColumn[subjectIndex];
+
+    for (int k = 0; k < count; k++)
+    {
+        const Student *s = &rows[indexes != NULL ? indexes[k] : k];
+        char theoryMarks[10] = "N/A", practicalMarks[10] = "N/A";
+
+        if (theoryColumn != -1)
+        {
+            sprintf(theoryMarks, "%d", s->obtainedMarks[theoryColumn]);
+        }
+        if (practicalColumn != -1)
+        {
+            sprintf(practicalMarks, "%d", s->obtainedPracticalMarks[practicalColumn]);
+        }
+
+        fprintf(fp, "%-15s %-20s %-12s %-18d %-23s %s\n", s->rollNo, s->name, s->branch, s->semester, theoryMarks, practicalMarks);
+    }
+}
+
+
+
+
+/*
+exportAllSubjectReports - Writes the report of every subject to its own file.
+
+Instead of one menu round-trip and one parse of the database file per subject, the reports of all subjects are written
+from the loaded students array in a single pass : every report file is opened first, then each student is read once and
+its row is written to every report, through a large stdio buffer per file. The files are written by the calling thread :
+with at most MAX_STUDENTS rows per report, a writer thread per file would cost more than the writes it overlaps.
+Each report is saved to SUBJECT_REPORT_PREFIX followed by the subject name, e.g. "subject_wise_result_Java_Programming.txt".
+*/
+void exportAllSubjectReports()
+{
+    SubjectReportFile reports[TOTAL_SUBJECTS];
+    DWORD startTime = GetTickCount();
+    int i;
+
+    mapSubjectColumns();
+
+    for (i = 0; i < TOTAL_SUBJECTS; i++)
+    {
+        reports[i].subjectIndex = i;
+        reports[i].failed = 0;
+
+        // Build the file name, replacing spaces in the subject name
+        snprintf(reports[i].fileName, MAX_LINE_LENGTH, "%s%s.txt", SUBJECT_REPORT_PREFIX, subjectMarks[i].subject);
+        for (char *c = reports[i].fileName; *c; c++)
+        {
+            if (*c == ' ')
+            {
+                *c = '_';
+            }
+        }
+
+        reports[i].fp = fopen(reports[i].fileName, "w");
+        if (reports[i].fp == NULL)
+        {
+            reports[i].failed = 1;
+            continue;
+        }
+        setvbuf(reports[i].fp, NULL, _IOFBF, REPORT_BUFFER_SIZE);
+        writeSubjectReportHeader(reports[i].fp, i);
+    }
+
+    // One pass over the students, each row goes to every report
+    for (int k = 0; k < studentCount; k++)
+    {
+        for (i = 0; i < TOTAL_SUBJECTS; i++)
+        {
+            if (reports[i].fp != NULL)
+            {
+                writeSubjectReportRows(reports[i].fp, i, &students[k], NULL, 1);
+            }
+        }
+    }
+
+    for (i = 0; i < TOTAL_SUBJECTS; i++)
+    {
+        if (reports[i].fp != NULL)
+        {
+            fprintf(reports[i].fp, "-------------------------------------------------------------------------------------------------------------\n");
+            if (ferror(reports[i].fp) | fclose(reports[i].fp))
+            {
+                reports[i].failed = 1;
+            }
+        }
+    }
+
+    printf("\n===== Subject-Wise Reports =====\n\n");
+    printf("Subject                              File\n");
+    printf("--------------------------------------------------------------------------------------------\n");
+    for (i = 0; i < TOTAL_SUBJECTS; i++)
+    {
+        printf("%-36s %s%s\n", subjectMarks[i].subject, reports[i].fileName, reports[i].failed ? "  (Error : Could Not Write File)" : "");
+    }
+    printf("--------------------------------------------------------------------------------------------\n");
+    printf("%d Subject Reports of %d Students Written in %lu ms.\n\n", (int)TOTAL_SUBJECTS, studentCount, (unsigned long)(GetTickCount() - startTime));
+}
+
+
+
+
+/*
+markColumnValue - Returns the marks of a student in one mark column.
+
+Mark columns follow the order of the CSV file : the theory subjects first, then the practical subjects.
+*/
+int markColumnValue(const Student *s, int column)
+{
+    if (column < NUM_SUBJECTS)
+    {
+        return s->obtainedMarks[column];
+    }
+    return s->obtainedPracticalMarks[column - NUM_SUBJECTS];
+}
+
+
+
+
+/*
+setMarkColumnValue - Sets the marks of a student in one mark column.
+*/
+void setMarkColumnValue(Student *s, int column, int marks)
+{
+    if (column < NUM_SUBJECTS)
+    {
+        s->obtainedMarks[column] = marks;
+    }
+    else
+    {
+        s->obtainedPracticalMarks[column - NUM_SUBJECTS] = marks;
+    }
+}
+
+
+
+
+/*
+markColumnValues - Copies every mark column of a student into marks[NUM_MARK_COLUMNS], in the order of markColumnValue().
+
+Loops over all mark columns index this array rather than calling markColumnValue() per column.
+*/
+void markColumnValues(const Student *s, int *marks)
+{
+    memcpy(marks, s->obtainedMarks, sizeof(s->obtainedMarks));
+    memcpy(marks + NUM_SUBJECTS, s->obtainedPracticalMarks, sizeof(s->obtainedPracticalMarks));
+}
+
+
+
+
+/*
+setMarkColumnValues - Sets every mark column of a student from marks[NUM_MARK_COLUMNS].
+*/
+void setMarkColumnValues(Student *s, const int *marks)
+{
+    memcpy(s->obtainedMarks, marks, sizeof(s->obtainedMarks));
+    memcpy(s->obtainedPracticalMarks, marks + NUM_SUBJECTS, sizeof(s->obtainedPracticalMarks));
+}
+
+
+
+
+/*
+changedMarkColumns - Compares the marks of two students.
+
+Returns:
+- A bit mask with bit c set for every mark column c in which the students differ.
+*/
+unsigned int changedMarkColumns(const Student *a, const Student *b)
+{
+    int x[NUM_MARK_COLUMNS], y[NUM_MARK_COLUMNS];
+    unsigned int changed = 0;
+
+    markColumnValues(a, x);
+    markColumnValues(b, y);
+    for (int column = 0; column < NUM_MARK_COLUMNS; column++)
+    {
+        changed |= (unsigned int)(x[column] != y[column]) << column;
+    }
+    return changed;
+}
+
+
+
+
+/*
+markColumnMax - Returns the maximum marks of a mark column, as defined in the subjectMarks array.
+*/
+int markColumnMax(int column)
+{
+    if (column < NUM_SUBJECTS)
+    {
+        SubjectMaxMarks *subject = findSubjectMaxMarks(subjects[column]);
+        return subject != NULL ? subject->maxTheory : 0;
+    }
+
+    SubjectMaxMarks *subject = findSubjectMaxMarks(practicalSubjects[column - NUM_SUBJECTS]);
+    return subject != NULL ? subject->maxPractical : 0;
+}
+
+
+
+
+/*
+markColumnName - Writes the CSV header of a mark column, e.g. "Theory_Java Programming", into name.
+*/
+void markColumnName(int column, char *name)
+{
+    if (column < NUM_SUBJECTS)
+    {
+        sprintf(name, "Theory_%s", subjects[column]);
+    }
+    else
+    {
+        sprintf(name, "Practical_%s", practicalSubjects[column - NUM_SUBJECTS]);
+    }
+}
+
+
+
+
+/*
+validateMarkRows - Checks every mark of a batch of students against the maximum marks in subjectMarks[].
+
+Marks from 0 to the maximum marks of their column are valid. The batch is checked column by column : the maximum of a
+column is looked up once, then compared with that column of every row without branching, so a whole import or
+transaction is validated in one pass over the marks. A negative mark wraps to a large unsigned number and fails the
+same single comparison.
+
+Parameters:
+- rows: Students to check.
+- count: Number of students in rows.
+- invalid: Receives one bit mask per row, bit c set when mark column c of the row is out of range.
+
+Returns:
+- The number of rows with at least one mark out of range.
+*/
+int validateMarkRows(const Student *rows, int count, unsigned int *invalid)
+{
+    int column, row;
+    int bad = 0;
+
+    memset(invalid, 0, count * sizeof(unsigned int));
+
+    for (column = 0; column < NUM_SUBJECTS; column++)
+    {
+        unsigned int limit = (unsigned int)markColumnMax(column);
+
+        for (row = 0; row < count; row++)
+        {
+            invalid[row] |= (unsigned int)((unsigned int)rows[row].obtainedMarks[column] > limit) << column;
+        }
+    }
+    for (column = NUM_SUBJECTS; column < NUM_MARK_COLUMNS; column++)
+    {
+        unsigned int limit = (unsigned int)markColumnMax(column);
+
+        for (row = 0; row < count; row++)
+        {
+            invalid[row] |= (unsigned int)((unsigned int)rows[row].obtainedPracticalMarks[column - NUM_SUBJECTS] > limit) << column;
+        }
+    }
+
+    for (row = 0; row < count; row++)
+    {
+        bad += (invalid[row] != 0);
+    }
+    return bad;
+}
+
+
+
+
+/*
+printMarkErrors - Prints one line per student with marks out of range, as found by validateMarkRows().
+
+Each line holds the roll number and, for every bad column, its name, the marks and the maximum marks, e.g.
+"23090052001          Theory_Java Programming = 35 (Max 30), Practical_Minor Project Work = -2 (Max 50)".
+*/
+void printMarkErrors(FILE *fp, const Student *rows, int count, const unsigned int *invalid)
+{
+    char columnName[MAX_LINE_LENGTH];
+
+    for (int row = 0; row < count; row++)
+    {
+        if (invalid[row] == 0)
+        {
+            continue;
+        }
+
+        fprintf(fp, "  %-20s", rows[row].rollNo);
+        for (int column = 0, first = 1; column < NUM_MARK_COLUMNS; column++)
+        {
+            if (invalid[row] & (1u << column))
+            {
+                markColumnName(column, columnName);
+                fprintf(fp, "%s%s = %d (Max %d)", first ? " " : ", ", columnName, markColumnValue(&rows[row], column), markColumnMax(column));
+                first = 0;
+            }
+        }
+        fprintf(fp, "\n");
+    }
+}
+
+
+
+
+/*
+saveRejectedRows - Appends the students with marks out of range, as found by validateMarkRows(), to REJECTED_ROWS_FILE.
+
+The rows keep the CSV format of DATABASE_FILE, so once corrected they can be copied back into it or imported. A header is
+written when the file is new.
+
+Returns:
+- The number of rows written.
+- -1 if the file could not be written.
+*/
+int saveRejectedRows(const Student *rows, int count, const unsigned int *invalid)
+{
+    char line[MAX_CSV_ROW_LENGTH];
+    int written = 0;
+    FILE *fp = fopen(REJECTED_ROWS_FILE, "a");
+
+    if (fp == NULL)
+    {
+        return -1;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    if (ftell(fp) == 0)
+    {
+        writeCSVHeader(fp);
+    }
+
+    for (int row = 0; row < count; row++)
+    {
+        if (invalid[row] != 0)
+        {
+            fwrite(line, 1, formatCSVRow(line, &rows[row]), fp);
+            written++;
+        }
+    }
+
+    if (ferror(fp) | fclose(fp))
+    {
+        return -1;
+    }
+    return written;
+}
+
+
+
+
+/*
+readMarkColumns - Prompts for the marks of the chosen mark columns of a student, one line per column.
+
+Input that is not a number is asked for again at once; the range of the marks is checked afterwards for the whole student
+with validateMarkRows(), so every mark out of range is reported together.
+*/
+void readMarkColumns(Student *s, unsigned int columns)
+{
+    for (int column = 0; column < NUM_MARK_COLUMNS; column++)
+    {
+        const char *subject = column < NUM_SUBJECTS ? subjects[column] : practicalSubjects[column - NUM_SUBJECTS];
+        int marks, result;
+
+        if (!(columns & (1u << column)))
+        {
+            continue;
+        }
+
+        printf("%-40s %2d%-20s", subject, markColumnMax(column), " "); // Print subject name and max marks
+        while ((result = scanf("%d", &marks)) != 1)
+        {
+            if (result == EOF)
+            {
+                return;
+            }
+            printf("Invalid Input! Please Enter a Number.\n");
+            clearInputBuffer();
+            printf("%-40s %2d%-20s", subject, markColumnMax(column), " ");
+        }
+        setMarkColumnValue(s, column, marks);
+    }
+}
+
+
+
+
+/* QueryTokenType - Enum for the tokens of a query */
+typedef enum
+{
+    QT_END,    // End of the query
+    QT_WORD,   // Keyword, field name or unquoted text
+    QT_NUMBER, // Number, optionally followed by '%'
+    QT_STRING, // Quoted text
+    QT_OP,     // Comparison operator
+    QT_LPAREN, // (
+    QT_RPAREN  // )
+} QueryTokenType;
+
+
+
+// QueryParser - State of the query parser
+typedef struct
+{
+    const char *text;            // Query being parsed
+    const char *pos;             // Current position in the query
+    QueryTokenType type;         // Type of the current token
+    char token[MAX_NAME_LENGTH]; // Text of the current token
+    double number;               // Value of a QT_NUMBER token
+    int percent;                 // 1 if the QT_NUMBER token ends with '%'
+    QueryCompare compare;        // Operator of a QT_OP token
+    int depth;                   // Result vectors in use at this point of the query
+    CompiledQuery *query;
+} QueryParser;
+
+
+
+
+/*
+queryError - Records a parse error with the position where it was found. Only the first error is kept.
+*/
+int queryError(QueryParser *p, const char *message)
+{
+    if (p->query->error[0] == '\0')
+    {
+        snprintf(p->query->error, MAX_LINE_LENGTH, "%s (at position %d)", message, (int)(p->pos - p->text) + 1);
+    }
+    return -1;
+}
+
+
+
+
+/*
+nextQueryToken - Reads the next token of the query into the parser.
+*/
+int nextQueryToken(QueryParser *p)
+{
+    while (isspace((unsigned char)*p->pos))
+    {
+        p->pos++;
+    }
+
+    const char *c = p->pos;
+    int length = 0;
+
+    p->token[0] = '\0';
+    p->percent = 0;
+
+    if (*c == '\0')
+    {
+        p->type = QT_END;
+        return 0;
+    }
+
+    if (*c == '(' || *c == ')')
+    {
+        p->type = (*c == '(') ? QT_LPAREN : QT_RPAREN;
+        p->pos++;
+        return 0;
+    }
+
+    if (strchr("=!<>~", *c) != NULL)
+    {
+        p->type = QT_OP;
+        if (c[0] == '!' && c[1] == '=')
+        {
+            p->compare = QCMP_NE;
+            p->pos += 2;
+        }
+        else if (c[0] == '<' && c[1] == '=')
+        {
+            p->compare = QCMP_LE;
+            p->pos += 2;
+        }
+        else if (c[0] == '>' && c[1] == '=')
+        {
+            p->compare = QCMP_GE;
+            p->pos += 2;
+        }
+        else if (c[0] == '=' && c[1] == '=')
+        {
+            p->compare = QCMP_EQ;
+            p->pos += 2;
+        }
+        else if (c[0] == '<' || c[0] == '>' || c[0] == '=' || c[0] == '~')
+        {
+            p->compare = (c[0] == '<') ? QCMP_LT : (c[0] == '>') ? QCMP_GT : (c[0] == '=') ? QCMP_EQ : QCMP_CONTAINS;
+            p->pos++;
+        }
+        else
+        {
+            return queryError(p, "Unknown operator");
+        }
+        return 0;
+    }
+
+    if (*c == '"' || *c == '\'')
+    {
+        char quote = *c++;
+        while (*c != '\0' && *c != quote)
+        {
+            if (length < MAX_NAME_LENGTH - 1)
+            {
+                p->token[length++] = *c;
+            }
+            c++;
+        }
+        if (*c != quote)
+        {
+            return queryError(p, "Missing closing quote");
+        }
+        p->token[length] = '\0';
+        p->type = QT_STRING;
+        p->pos = c + 1;
+        return 0;
+    }
+
+    if (isdigit((unsigned char)*c) || *c == '.')
+    {
+        while (isdigit((unsigned char)*c) || *c == '.')
+        {
+            if (length < MAX_NAME_LENGTH - 1)
+            {
+                p->token[length++] = *c;
+            }
+            c++;
+        }
+        p->token[length] = '\0';
+        p->number = atof(p->token);
+        if (*c == '%')
+        {
+            p->percent = 1;
+            c++;
+        }
+        p->type = QT_NUMBER;
+        p->pos = c;
+        return 0;
+    }
+
+    if (isalpha((unsigned char)*c) || *c == '_')
+    {
+        while (isalnum((unsigned char)*c) || *c == '_' || *c == '.' || *c == '-')
+        {
+            if (length < MAX_NAME_LENGTH - 1)
+            {
+                p->token[length++] = *c;
+            }
+            c++;
+        }
+        p->token[length] = '\0';
+        p->type = QT_WORD;
+        p->pos = c;
+        return 0;
+    }
+
+    return queryError(p, "Unexpected character");
+}
+
+
+
+
+/*
+isQueryWord - Checks if the current token is the given keyword (case-insensitive).
+*/
+int isQueryWord(const QueryParser *p, const char *word)
+{
+    return p->type == QT_WORD && strcasecmp(p->token, word) == 0;
+}
+
+
+
+
+/*
+emitQueryInstruction - Appends an instruction to the compiled query and tracks the number of result vectors in use.
+*/
+int emitQueryInstruction(QueryParser *p, QueryOpcode opcode, QueryCompare compare, int column, int operand)
+{
+    CompiledQuery *q = p->query;
+
+    if (q->length >= QUERY_MAX_CODE)
+    {
+        return queryError(p, "Query is too long");
+    }
+
+    q->code[q->length].opcode = (unsigned char)opcode;
+    q->code[q->length].compare = (unsigned char)compare;
+    q->code[q->length].column = (short)column;
+    q->code[q->length].operand = operand;
+    q->length++;
+
+    if (opcode == QOP_AND || opcode == QOP_OR)
+    {
+        p->depth--;
+    }
+    else if (opcode != QOP_NOT)
+    {
+        p->depth++;
+        if (p->depth > QUERY_MAX_STACK)
+        {
+            return queryError(p, "Query is nested too deeply");
+        }
+        if (p->depth > q->maxDepth)
+        {
+            q->maxDepth = p->depth;
+        }
+    }
+    return 0;
+}
+
+
+
+
+/*
+parseQueryNumber - Reads the comparison operator and the number of a numeric condition.
+
+The number is returned multiplied by 100. A percentage is converted using maxValue, so "< 50%" of a column with
+maximum marks 25 becomes "< 12.5" without rounding.
+*/
+int parseQueryNumber(QueryParser *p, int maxValue, QueryCompare *compare, int *operand)
+{
+    if (p->type != QT_OP || p->compare == QCMP_CONTAINS)
+    {
+        return queryError(p, "Expected a comparison operator");
+    }
+    *compare = p->compare;
+
+    if (nextQueryToken(p) != 0)
+    {
+        return -1;
+    }
+    if (p->type != QT_NUMBER)
+    {
+        return queryError(p, "Expected a number");
+    }
+
+    if (p->percent)
+    {
+        *operand = (int)(p->number * maxValue + 0.5);
+    }
+    else
+    {
+        *operand = (int)(p->number * 100 + 0.5);
+    }
+
+    return nextQueryToken(p);
+}
+
+
+
+
+/*
+findQueryColumn - Finds the mark column of a subject name typed in a query.
+
+The name is matched case-insensitively against the start of the subject names, so "java" finds "Java Programming".
+Returns -1 if no subject or more than one subject matches.
+*/
+int findQueryColumn(const char *name, int practical)
+{
+    int found = -1;
+    int matches = 0;
+    size_t length = strlen(name);
+
+    for (int i = 0; i < (practical ? NUM_SUBJECTS_PRAC : NUM_SUBJECTS); i++)
+    {
+        const char *subject = practical ? practicalSubjects[i] : subjects[i];
+
+        if (strcasecmp(subject, name) == 0)
+        {
+            return practical ? NUM_SUBJECTS + i : i;
+        }
+        if (strncasecmp(subject, name, length) == 0)
+        {
+            found = practical ? NUM_SUBJECTS + i : i;
+            matches++;
+        }
+    }
+
+    return matches == 1 ? found : -1;
+}
+
+
+
+
+int parseQueryOr(QueryParser *p);
+
+/*
+parseQueryCondition - Parses one condition or a parenthesised sub-query.
+*/
+int parseQueryCondition(QueryParser *p)
+{
+    QueryCompare compare;
+    int operand;
+
+    if (p->type == QT_LPAREN)
+    {
+        if (nextQueryToken(p) != 0 || parseQueryOr(p) != 0)
+        {
+            return -1;
+        }
+        if (p->type != QT_RPAREN)
+        {
+            return queryError(p, "Expected ')'");
+        }
+        return nextQueryToken(p);
+    }
+
+    if (p->type != QT_WORD)
+    {
+        return queryError(p, "Expected a field name");
+    }
+
+    // any / all theory | practical | mark <op> <value> : one condition per column, combined with OR / AND
+    if (isQueryWord(p, "any") || isQueryWord(p, "all"))
+    {
+        QueryOpcode combine = isQueryWord(p, "any") ? QOP_OR : QOP_AND;
+        int first, last;
+
+        if (nextQueryToken(p) != 0)
+        {
+            return -1;
+        }
+        if (isQueryWord(p, "theory"))
+        {
+            first = 0;
+            last = NUM_SUBJECTS;
+        }
+        else if (isQueryWord(p, "practical"))
+        {
+            first = NUM_SUBJECTS;
+            last = NUM_MARK_COLUMNS;
+        }
+        else if (isQueryWord(p, "mark") || isQueryWord(p, "marks"))
+        {
+            first = 0;
+            last = NUM_MARK_COLUMNS;
+        }
+        else
+        {
+            return queryError(p, "Expected theory, practical or mark after any/all");
+        }
+
+        if (nextQueryToken(p) != 0)
+        {
+            return -1;
+        }
+
+        // Remember the condition, the percentage depends on each column's maximum marks
+        if (p->type != QT_OP || p->compare == QCMP_CONTAINS)
+        {
+            return queryError(p, "Expected a comparison operator");
+        }
+        compare = p->compare;
+        if (nextQueryToken(p) != 0)
+        {
+            return -1;
+        }
+        if (p->type != QT_NUMBER)
+        {
+            return queryError(p, "Expected a number");
+        }
+        double number = p->number;
+        int percent = p->percent;
+
+        for (int col = first; col < last; col++)
+        {
+            operand = percent ? (int)(number * markColumnMax(col) + 0.5) : (int)(number * 100 + 0.5);
+
+            if (emitQueryInstruction(p, QOP_MARK, compare, col, operand) != 0)
+            {
+                return -1;
+            }
+            if (col > first && emitQueryInstruction(p, combine, QCMP_EQ, 0, 0) != 0)
+            {
+                return -1;
+            }
+        }
+        return nextQueryToken(p);
+    }
+
+    // theory(<subject>) / practical(<subject>) <op> <value>
+    if (isQueryWord(p, "theory") || isQueryWord(p, "practical"))
+    {
+        int practical = isQueryWord(p, "practical");
+        char name[MAX_NAME_LENGTH] = "";
+
+        if (nextQueryToken(p) != 0)
+        {
+            return -1;
+        }
+        if (p->type != QT_LPAREN)
+        {
+            return queryError(p, "Expected '(' and a subject name");
+        }
+        if (nextQueryToken(p) != 0)
+        {
+            return -1;
+        }
+
+        // The subject name may be quoted or typed as several words
+        while (p->type == QT_WORD || p->type == QT_STRING)
+        {
+            if (name[0] != '\0')
+            {
+                strncat(name, " ", MAX_NAME_LENGTH - strlen(name) - 1);
+            }
+            strncat(name, p->token, MAX_NAME_LENGTH - strlen(name) - 1);
+
+            if (nextQueryToken(p) != 0)
+            {
+                return -1;
+            }
+        }
+        if (p->type != QT_RPAREN)
+        {
+            return queryError(p, "Expected ')' after the subject name");
+        }
+
+        int column = findQueryColumn(name, practical);
+        if (column == -1)
+        {
+            return queryError(p, practical ? "Unknown or ambiguous practical subject" : "Unknown or ambiguous theory subject");
+        }
+
+        if (nextQueryToken(p) != 0 || parseQueryNumber(p, markColumnMax(column), &compare, &operand) != 0)
+        {
+            return -1;
+        }
+        return emitQueryInstruction(p, QOP_MARK, compare, column, operand);
+    }
+
+    // total / sem / semester / sgpa <op> <number>
+    if (isQueryWord(p, "total") || isQueryWord(p, "sem") || isQueryWord(p, "semester") || isQueryWord(p, "sgpa"))
+    {
+        QueryOpcode opcode = isQueryWord(p, "total") ? QOP_TOTAL : isQueryWord(p, "sgpa") ? QOP_SGPA : QOP_SEMESTER;
+        int maxValue = 100;
+
+        if (opcode == QOP_TOTAL)
+        {
+            maxValue = 0;
+            for (int col = 0; col < NUM_MARK_COLUMNS; col++)
+            {
+                maxValue += markColumnMax(col);
+            }
+        }
+        else if (opcode == QOP_SGPA)
+        {
+            maxValue = 10;
+        }
+
+        if (nextQueryToken(p) != 0 || parseQueryNumber(p, maxValue, &compare, &operand) != 0)
+        {
+            return -1;
+        }
+        return emitQueryInstruction(p, opcode, compare, 0, operand);
+    }
+
+    // branch / name / roll <op> <text>
+    if (isQueryWord(p, "branch") || isQueryWord(p, "name") || isQueryWord(p, "roll"))
+    {
+        QueryOpcode opcode = isQueryWord(p, "branch") ? QOP_BRANCH : isQueryWord(p, "name") ? QOP_NAME : QOP_ROLL;
+        CompiledQuery *q = p->query;
+
+        if (nextQueryToken(p) != 0)
+        {
+            return -1;
+        }
+        if (p->type != QT_OP || (p->compare != QCMP_EQ && p->compare != QCMP_NE && p->compare != QCMP_CONTAINS))
+        {
+            return queryError(p, "Text fields only support =, != and ~");
+        }
+        compare = p->compare;
+
+        if (nextQueryToken(p) != 0)
+        {
+            return -1;
+        }
+        if (p->type != QT_WORD && p->type != QT_STRING && p->type != QT_NUMBER)
+        {
+            return queryError(p, "Expected a text value");
+        }
+        if (q->stringCount >= QUERY_MAX_STRINGS)
+        {
+            return queryError(p, "Too many text values");
+        }
+
+        strcpy(q->strings[q->stringCount], p->token);
+        if (emitQueryInstruction(p, opcode, compare, q->stringCount++, 0) != 0)
+        {
+            return -1;
+        }
+        return nextQueryToken(p);
+    }
+
+    return queryError(p, "Unknown field");
+}
+
+
+
+
+/*
+parseQueryNot - Parses an optional chain of "not" before a condition.
+*/
+int parseQueryNot(QueryParser *p)
+{
+    if (isQueryWord(p, "not"))
+    {
+        if (nextQueryToken(p) != 0 || parseQueryNot(p) != 0)
+        {
+            return -1;
+        }
+        return emitQueryInstruction(p, QOP_NOT, QCMP_EQ, 0, 0);
+    }
+    return parseQueryCondition(p);
+}
+
+
+
+
+/*
+parseQueryAnd - Parses conditions joined by "and".
+*/
+int parseQueryAnd(QueryParser *p)
+{
+    if (parseQueryNot(p) != 0)
+    {
+        return -1;
+    }
+
+    while (isQueryWord(p, "and"))
+    {
+        if (nextQueryToken(p) != 0 || parseQueryNot(p) != 0 || emitQueryInstruction(p, QOP_AND, QCMP_EQ, 0, 0) != 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+
+
+/*
+parseQueryOr - Parses conditions joined by "or", which binds weaker than "and".
+*/
+int parseQueryOr(QueryParser *p)
+{
+    if (parseQueryAnd(p) != 0)
+    {
+        return -1;
+    }
+
+    while (isQueryWord(p, "or"))
+    {
+        if (nextQueryToken(p) != 0 || parseQueryAnd(p) != 0 || emitQueryInstruction(p, QOP_OR, QCMP_EQ, 0, 0) != 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+
+
+/*
+compileQuery - Parses a query into postfix instructions.
+
+A query is parsed once and can then be run any number of times. Example :
+
+branch = CSE and sem = 5 and (theory(java) < 12 or any practical < 50%)
+
+Returns:
+- 0 on success, or -1 with the reason stored in query->error.
+*/
+int compileQuery(const char *text, CompiledQuery *query)
+{
+    QueryParser p;
+
+    memset(query, 0, sizeof(CompiledQuery));
+    p.text = text;
+    p.pos = text;
+    p.depth = 0;
+    p.query = query;
+
+    if (nextQueryToken(&p) != 0)
+    {
+        return -1;
+    }
+    if (p.type == QT_END)
+    {
+        return queryError(&p, "Empty query");
+    }
+    if (parseQueryOr(&p) != 0)
+    {
+        return -1;
+    }
+    if (p.type != QT_END)
+    {
+        return queryError(&p, "Unexpected text after the query");
+    }
+    return 0;
+}
+
+
+
+
+/*
+compareQueryColumn - Compares a whole column of values with one operand.
+
+Each operator has its own loop, so the comparison is not re-decoded for every student and the loops stay simple enough for the compiler to vectorize.
+*/
+void compareQueryColumn(const int *values, int n, QueryCompare compare, int operand, unsigned char *out)
+{
+    int i;
+
+    switch (compare)
+    {
+    case QCMP_EQ:
+        for (i = 0; i < n; i++)
+            out[i] = values[i] == operand;
+        break;
+    case QCMP_NE:
+        for (i = 0; i < n; i++)
+            out[i] = values[i] != operand;
+        break;
+    case QCMP_LT:
+        for (i = 0; i < n; i++)
+            out[i] = values[i] < operand;
+        break;
+    case QCMP_LE:
+        for (i = 0; i < n; i++)
+            out[i] = values[i] <= operand;
+        break;
+    case QCMP_GT:
+        for (i = 0; i < n; i++)
+            out[i] = values[i] > operand;
+        break;
+    case QCMP_GE:
+        for (i = 0; i < n; i++)
+            out[i] = values[i] >= operand;
+        break;
+    default:
+        memset(out, 0, n);
+    }
+}
+
+
+
+
+/*
+matchQueryText - Compares a text field with a text value of a query (case-insensitive).
+*/
+int matchQueryText(const char *field, const char *value, QueryCompare compare)
+{
+    if (compare == QCMP_CONTAINS)
+    {
+        size_t length = strlen(value);
+
+        for (const char *c = field; *c; c++)
+        {
+            if (strncasecmp(c, value, length) == 0)
+            {
+                return 1;
+            }
+        }
+        return length == 0;
+    }
+
+    int equal = strcasecmp(field, value) == 0;
+    return compare == QCMP_NE ? !equal : equal;
+}
+
+
+
+
+/*
+runQuery - Runs a compiled query over an array of students.
+
+The query is evaluated one instruction at a time across all rows : every condition reads one column of all students
+into a vector of values and compares it in a single loop, and "and", "or" and "not" combine whole result vectors.
+
+Parameters:
+- query: Query compiled by compileQuery().
+- rows: Students to check, usually the students array.
+- grades: Grades of the rows, in the same order.
+- n: Number of rows.
+- matches: Receives the indexes of the matching rows, must hold n entries.
+
+Returns:
+- The number of matching students, or -1 if memory could not be allocated.
+*/
+int runQuery(const CompiledQuery *query, const Student *rows, const StudentGrades *grades, int n, int *matches)
+{
+    unsigned char *stack[QUERY_MAX_STACK];
+    int *values = malloc((n > 0 ? n : 1) * sizeof(int));
+    int sp = 0;
+    int i, d;
+
+    int allocated = (values != NULL);
+
+    for (d = 0; d < query->maxDepth; d++)
+    {
+        stack[d] = malloc(n > 0 ? n : 1);
+        allocated = allocated && (stack[d] != NULL);
+    }
+
+    if (!allocated)
+    {
+        for (d = 0; d < query->maxDepth; d++)
+        {
+            free(stack[d]);
+        }
+        free(values);
+        return -1;
+    }
+
+    for (int pc = 0; pc < query->length; pc++)
+    {
+        const QueryInstruction *ins = &query->code[pc];
+
+        switch (ins->opcode)
+        {
+        case QOP_MARK:
+            for (i = 0; i < n; i++)
+                values[i] = markColumnValue(&rows[i], ins->column) * 100;
+            compareQueryColumn(values, n, ins->compare, ins->operand, stack[sp++]);
+            break;
+
+        case QOP_TOTAL:
+            for (i = 0; i < n; i++)
+                values[i] = studentTotalMarks(&rows[i]) * 100;
+            compareQueryColumn(values, n, ins->compare, ins->operand, stack[sp++]);
+            break;
+
+        case QOP_SEMESTER:
+            for (i = 0; i < n; i++)
+                values[i] = rows[i].semester * 100;
+            compareQueryColumn(values, n, ins->compare, ins->operand, stack[sp++]);
+            break;
+
+        case QOP_SGPA:
+            for (i = 0; i < n; i++)
+                values[i] = (int)(grades[i].sgpa * 100 + 0.5);
+            compareQueryColumn(values, n, ins->compare, ins->operand, stack[sp++]);
+            break;
+
+        case QOP_BRANCH:
+        case QOP_NAME:
+        case QOP_ROLL:
+        {
+            const char *value = query->strings[ins->column];
+            unsigned char *out = stack[sp++];
+
+            for (i = 0; i < n; i++)
+            {
+                const char *field = (ins->opcode == QOP_BRANCH) ? rows[i].branch : (ins->opcode == QOP_NAME) ? rows[i].name : rows[i].rollNo;
+                out[i] = (unsigned char)matchQueryText(field, value, ins->compare);
+            }
+            break;
+        }
+
+        case QOP_AND:
+            for (i = 0; i < n; i++)
+                stack[sp - 2][i] &= stack[sp - 1][i];
+            sp--;
+            break;
+
+        case QOP_OR:
+            for (i = 0; i < n; i++)
+                stack[sp - 2][i] |= stack[sp - 1][i];
+            sp--;
+            break;
+
+        case QOP_NOT:
+            for (i = 0; i < n; i++)
+                stack[sp - 1][i] ^= 1;
+            break;
+        }
+    }
+
+    int count = 0;
+    for (i = 0; i < n; i++)
+    {
+        if (stack[0][i])
+        {
+            matches[count++] = i;
+        }
+    }
+
+    for (d = 0; d < query->maxDepth; d++)
+    {
+        free(stack[d]);
+    }
+    free(values);
+
+    return count;
+}
+
+
+
+
+/*
+queryStudents - Lists the students matching a query typed by the admin.
+
+The query is compiled once and run over the whole database. The matching students can then be viewed as a list,
+opened one by one, shown in a subject-wise report or saved to QUERY_RESULT_FILE.
+*/
+void queryStudents()
+{
+    char text[MAX_LINE_LENGTH];
+    CompiledQuery query;
+    int matches[MAX_STUDENTS];
+
+    printf("\n===== Query Students =====\n\n");
+    printf("Fields    : branch, sem, roll, name, total, sgpa, theory(<subject>), practical(<subject>)\n");
+    printf("            any theory, any practical, any mark, all theory, all practical, all mark\n");
+    printf("Operators : = != < <= > >= ~ (contains), and, or, not, ( )\n");
+    printf("Marks can be compared with a percentage of the maximum marks, e.g. 50%%.\n\n");
+    printf("Example   : branch = CSE and sem = 5 and (theory(java) < 12 or any practical < 50%%)\n\n");
+
+    clearInputBuffer();
+
+    while (1)
+    {
+        printf("Enter Query (or press Enter to return) : ");
+        if (fgets(text, MAX_LINE_LENGTH, stdin) == NULL)
+        {
+            return;
+        }
+        text[strcspn(text, "\n")] = 0;
+        trim(text);
+
+        if (text[0] == '\0')
+        {
+            return;
+        }
+
+        if (compileQuery(text, &query) != 0)
+        {
+            printf("Invalid Query : %s\n\n", query.error);
+            continue;
+        }
+        traceOperation(TRACE_QUERY, "%s", text);
+
+        DWORD startTime = GetTickCount();
+        if (shardedStorage)
+        {
+            printf("%d of %d Shards Can Match the Query.\n", loadShardsForQuery(&query), shardCount);
+        }
+        int count = runQuery(&query, students, studentGrades, studentCount, matches);
+        if (count < 0)
+        {
+            printf("Error : Not Enough Memory to Run the Query.\n\n");
+            continue;
+        }
+
+        printf("\n%d of %d Students Matched (%lu ms).\n\n", count, studentCount, (unsigned long)(GetTickCount() - startTime));
+        if (count == 0)
+        {
+            continue;
+        }
+        printStudentList(stdout, students, matches, count);
+
+        int choice = 0;
+        while (choice != 6)
+        {
+            printf("1. View Result of a Matched Student\n");
+            printf("2. Subject-Wise Report of Matched Students\n");
+            printf("3. Save Matched Students to '%s'\n", QUERY_RESULT_FILE);
+            printf("4. Export Matched Students to Arrow IPC ('%s')\n", ARROW_QUERY_FILE);
+            printf("5. Export Matched Students to Excel ('%s')\n", XLSX_QUERY_FILE);
+            printf("6. New Query\n\n");
+            printf("Enter Your Choice : ");
+
+            if (scanf("%d", &choice) != 1)
+            {
+                printf("Invalid Input! Please Enter a Number.\n");
+                clearInputBuffer();
+                continue;
+            }
+
+            if (choice == 1)
+            {
+                char rollNo[MAX_ROLLNO_LENGTH];
+                int found = 0;
+
+                printf("Enter the Roll No of the Student: ");
+                scanf("%19s", rollNo);
+
+                for (int k = 0; k < count; k++)
+                {
+                    if (strcmp(students[matches[k]].rollNo, rollNo) == 0)
+                    {
+                        displayStudentWithResults(&students[matches[k]]);
+                        found = 1;
+                        break;
+                    }
+                }
+                if (!found)
+                {
+                    printf("No Matched Student with Roll No %s.\n\n", rollNo);
+                }
+            }
+            else if (choice == 2)
+            {
+                int subjectIndex;
+
+                printf("\n");
+                for (int i = 0; i < TOTAL_SUBJECTS; i++)
+                {
+                    printf("%d. %s\n", i + 1, subjectMarks[i].subject);
+                }
+                printf("\nEnter Subject : ");
+
+                if (scanf("%d", &subjectIndex) != 1 || subjectIndex < 1 || subjectIndex > TOTAL_SUBJECTS)
+                {
+                    printf("Invalid Subject!\n");
+                    clearInputBuffer();
+                    continue;
+                }
+                writeSubjectReport(stdout, subjectIndex - 1, students, matches, count);
+                printf("\n");
+            }
+            else if (choice == 3)
+            {
+                FILE *fp = fopen(QUERY_RESULT_FILE, "w");
+                if (fp == NULL)
+                {
+                    printf("Error : Could not open file to save results.\n");
+                    continue;
+                }
+
+                fprintf(fp, "===== Query : %s =====\n\n", text);
+                printStudentList(fp, students, matches, count);
+                for (int i = 0; i < TOTAL_SUBJECTS; i++)
+                {
+                    writeSubjectReport(fp, i, students, matches, count);
+                }
+                fclose(fp);
+
+                printf("Matched Students have been saved to '%s'.\n\n", QUERY_RESULT_FILE);
+            }
+            else if (choice == 4)
+            {
+                exportArrowStudents(ARROW_QUERY_FILE, students, matches, count);
+                printf("\n");
+            }
+            else if (choice == 5)
+            {
+                exportXlsx(XLSX_QUERY_FILE, XLSX_STUDENT_LIST, 0, students, studentGrades, matches, count);
+                printf("\n");
+            }
+            else if (choice != 6)
+            {
+                printf("Invalid Choice! Please Select a Valid Option.\n");
+            }
+        }
+        clearInputBuffer();
+    }
+}
+
+
+
+
+/*
+streamStudentFile - Scans a CSV file of students in bounded memory.
+
+The file is read in blocks of STREAM_BLOCK_SIZE bytes, opened with FILE_FLAG_SEQUENTIAL_SCAN so Windows reads ahead of the scan.
+Complete lines are parsed into a batch of at most STREAM_BATCH_ROWS students, which is graded and passed to the handler.
+A line split between two blocks is carried over to the next block. Only one block and one batch are held in memory,
+whatever the size of the file, so archives much larger than the students array can be processed.
+
+Parameters:
+- fileName: CSV file with the same layout as DATABASE_FILE.
+- handler: Function called for every batch of students.
+- context: Pointer passed unchanged to the handler.
+
+Returns:
+- The number of students read, or -1 if the file could not be opened or memory could not be allocated.
+*/
+long long streamStudentFile(const char *fileName, StreamBatchHandler handler, void *context)
+{
+    HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return -1;
+    }
+
+    char *buffer = malloc(STREAM_BLOCK_SIZE + MAX_LINE_LENGTH + 1);
+    Student *batch = malloc(STREAM_BATCH_ROWS * sizeof(Student));
+    StudentGrades *grades = malloc(STREAM_BATCH_ROWS * sizeof(StudentGrades));
+
+    if (buffer == NULL || batch == NULL || grades == NULL)
+    {
+        free(buffer);
+        free(batch);
+        free(grades);
+        CloseHandle(file);
+        return -1;
+    }
+
+    long long total = 0;
+    long long lineNumber = 0;
+    int batchCount = 0;
+    int headerSkipped = 0;
+    int skipping = 0; // The block starts inside a line longer than MAX_LINE_LENGTH, dropped up to its newline
+    size_t carry = 0;
+    DWORD bytesRead;
+
+    while (1)
+    {
+        int endOfFile = !ReadFile(file, buffer + carry, STREAM_BLOCK_SIZE, &bytesRead, NULL) || bytesRead == 0;
+        char *end = buffer + carry + (endOfFile ? 0 : bytesRead);
+        char *line = buffer;
+
+        // At the end of the file the last line may have no newline
+        if (endOfFile)
+        {
+            if (carry == 0 && !skipping)
+            {
+                break;
+            }
+            *end++ = '\n';
+        }
+
+        char *newline;
+        while ((newline = memchr(line, '\n', end - line)) != NULL)
+        {
+            *newline = '\0';
+            lineNumber++;
+
+            if (skipping || newline - line >= MAX_LINE_LENGTH)
+            {
+                printf("Warning : Line %lld of %s Is Longer Than %d Characters and Was Skipped.\n", lineNumber, fileName, MAX_LINE_LENGTH - 1);
+                skipping = 0;
+                headerSkipped = 1;
+            }
+            else if (!headerSkipped)
+            {
+                headerSkipped = 1;
+            }
+            else if (parseStudentLine(line, &batch[batchCount]))
+            {
+                gradeStudent(&batch[batchCount], &grades[batchCount]);
+                batchCount++;
+
+                if (batchCount == STREAM_BATCH_ROWS)
+                {
+                    handler(batch, grades, batchCount, context);
+                    total += batchCount;
+                    batchCount = 0;
+                }
+            }
+            line = newline + 1;
+        }
+
+        if (endOfFile)
+        {
+            break;
+        }
+
+        // Keep the incomplete last line for the next block. A line already longer than MAX_LINE_LENGTH is dropped,
+        // and so is the rest of it in the next blocks, up to its newline
+        carry = end - line;
+        if (skipping || carry >= MAX_LINE_LENGTH)
+        {
+            skipping = 1;
+            carry = 0;
+        }
+        memmove(buffer, line, carry);
+    }
+
+    if (batchCount > 0)
+    {
+        handler(batch, grades, batchCount, context);
+        total += batchCount;
+    }
+
+    free(buffer);
+    free(batch);
+    free(grades);
+    CloseHandle(file);
+
+    return total;
+}
+
+
+
+
+// ArchiveStatistics - Structure accumulating statistics while streaming an archive file
+typedef struct
+{
+    long long count;              // Students read
+    int min[NUM_MARK_COLUMNS];    // Lowest marks of each mark column
+    int max[NUM_MARK_COLUMNS];    // Highest marks of each mark column
+    long long sum[NUM_MARK_COLUMNS];
+    long long totalSum;           // Sum of the total marks
+    double sgpaSum;               // Sum of the SGPAs
+    long long passed;             // Students who passed every subject
+} ArchiveStatistics;
+
+
+
+// ArchiveFilter - Context of a filtered listing or export of an archive file
+typedef struct
+{
+    const CompiledQuery *query;   // Query rows must match, NULL for all rows
+    FILE *fp;                     // Output file
+    int csv;                      // 1 to write CSV rows, 0 to write the student list
+    int *matches;                 // Indexes of the matching rows of the current batch
+    long long matched;            // Rows written so far
+    int failed;                   // 1 once a write failed, the later batches are not written
+} ArchiveFilter;
+
+
+
+// ArchiveReport - Context of a subject-wise report of an archive file
+typedef struct
+{
+    FILE *fp;
+    int subjectIndex;
+} ArchiveReport;
+
+
+
+
+/*
+archiveReportBatch - Streaming handler writing the rows of a subject-wise report.
+*/
+void archiveReportBatch(const Student *batch, const StudentGrades *grades, int count, void *context)
+{
+    ArchiveReport *report = (ArchiveReport *)context;
+
+    writeSubjectReportRows(report->fp, report->subjectIndex, batch, NULL, count);
+}
+
+
+
+
+/*
+archiveStatisticsBatch - Streaming handler updating the statistics with one batch, one mark column at a time.
+*/
+void archiveStatisticsBatch(const Student *batch, const StudentGrades *grades, int count, void *context)
+{
+    ArchiveStatistics *stats = (ArchiveStatistics *)context;
+
+    for (int col = 0; col < NUM_MARK_COLUMNS; col++)
+    {
+        int low = stats->min[col];
+        int high = stats->max[col];
+        long long sum = 0;
+
+        for (int i = 0; i < count; i++)
+        {
+            int marks = markColumnValue(&batch[i], col);
+
+            low = marks < low ? marks : low;
+            high = marks > high ? marks : high;
+            sum += marks;
+        }
+
+        stats->min[col] = low;
+        stats->max[col] = high;
+        stats->sum[col] += sum;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        stats->totalSum += studentTotalMarks(&batch[i]);
+        stats->sgpaSum += grades[i].sgpa;
+        stats->passed += grades[i].passed;
+    }
+    stats->count += count;
+}
+
+
+
+
+/*
+archiveSketchBatch - Streaming handler adding a batch to a quantile sketch.
+*/
+void archiveSketchBatch(const Student *batch, const StudentGrades *grades, int count, void *context)
+{
+    addToMarkSketch((MarkSketch *)context, batch, NULL, count);
+}
+
+
+
+
+/*
+archiveFilterBatch - Streaming handler writing the rows of a batch that match the query.
+
+A failed write sets filter->failed, so the export is reported as failed rather than as saved.
+*/
+void archiveFilterBatch(const Student *batch, const StudentGrades *grades, int count, void *context)
+{
+    ArchiveFilter *filter = (ArchiveFilter *)context;
+    int matchCount = count;
+    const int *indexes = NULL;
+
+    if (filter->query != NULL)
+    {
+        matchCount = runQuery(filter->query, batch, grades, count, filter->matches);
+        indexes = filter->matches;
+    }
+    if (matchCount <= 0 || filter->failed)
+    {
+        return;
+    }
+
+    if (filter->csv)
+    {
+        CSVSource source = {NULL, batch, indexes, NULL, 0};
+        if (writeCSVRows(filter->fp, &source, matchCount) != 0)
+        {
+            filter->failed = 1;
+            return;
+        }
+    }
+    else
+    {
+        printStudentListRows(filter->fp, batch, indexes, matchCount);
+    }
+    filter->matched += matchCount;
+}
+
+
+
+
+/*
+readArchiveQuery - Prompts for an optional query and compiles it.
+
+The rest of the previous input line must have been consumed, e.g. with clearInputBuffer() after scanf().
+
+Returns:
+- 1 if a query was compiled, 0 if the admin left it empty, -1 if it is invalid.
+*/
+int readArchiveQuery(CompiledQuery *query)
+{
+    char text[MAX_LINE_LENGTH];
+
+    printf("Enter Query (or press Enter for all students) : ");
+    if (fgets(text, MAX_LINE_LENGTH, stdin) == NULL)
+    {
+        return 0;
+    }
+    text[strcspn(text, "\n")] = 0;
+    trim(text);
+
+    if (text[0] == '\0')
+    {
+        return 0;
+    }
+    if (compileQuery(text, query) != 0)
+    {
+        printf("Invalid Query : %s\n\n", query->error);
+        return -1;
+    }
+    return 1;
+}
+
+
+
+
+// MarkMoments - Exact sums of the mark columns and of their pairwise products, from which covariances and correlations follow
+typedef struct
+{
+    long long count;                                        // Students accumulated
+    long long sum[NUM_MARK_COLUMNS];                        // Sum of each mark column
+    long long products[NUM_MARK_COLUMNS][NUM_MARK_COLUMNS]; // Sum of the products of two columns, filled for i <= j
+
+} MarkMoments;
+
+
+
+// MomentsJob - Rows of a columnar buffer accumulated by one correlation worker
+typedef struct
+{
+    const int *marks;     // Columnar marks : column c of row r is marks[c * stride + r]
+    int stride;
+    int first;            // First row of the worker
+    int last;             // Row after the last row of the worker
+    MarkMoments moments;  // Sums of the worker's rows, merged once it is done
+
+} MomentsJob;
+
+
+
+// CorrelationScan - Context of a correlation scan of an archive file
+typedef struct
+{
+    int *marks;           // Columnar marks of up to CORRELATION_BUFFER_ROWS students, clamped to 0..MAX_SUBJECT_MARKS
+    int rows;             // Students in marks
+    int workers;          // Threads accumulating a full buffer
+    MarkMoments moments;  // Sums of every student processed so far
+
+} CorrelationScan;
+
+
+
+
+/*
+accumulateMarkMoments - Correlation kernel : adds rows first..last-1 of a columnar buffer to the sums.
+
+The rows are processed in blocks of CORRELATION_BLOCK_ROWS, so each column of the block is read from cache for every pair.
+The marks are clamped to 0..MAX_SUBJECT_MARKS when the buffer is filled, so within a block the sums are kept in int
+(at most CORRELATION_BLOCK_ROWS * MAX_SUBJECT_MARKS^2 = 10240000, far below INT_MAX) over
+contiguous arrays, which compilers turn into SIMD loops, and only the block totals are added to the 64-bit sums.
+*/
+static void accumulateMarkMoments(const int *marks, int stride, int first, int last, MarkMoments *moments)
+{
+    for (int block = first; block < last; block += CORRELATION_BLOCK_ROWS)
+    {
+        int end = (last - block < CORRELATION_BLOCK_ROWS) ? last : block + CORRELATION_BLOCK_ROWS;
+
+        for (int i = 0; i < NUM_MARK_COLUMNS; i++)
+        {
+            const int *x = marks + (size_t)i * stride;
+            int sum = 0;
+
+            for (int r = block; r < end; r++)
+            {
+                sum += x[r];
+            }
+            moments->sum[i] += sum;
+
+            for (int j = i; j < NUM_MARK_COLUMNS; j++)
+            {
+                const int *y = marks + (size_t)j * stride;
+                int product = 0;
+
+                for (int r = block; r < end; r++)
+                {
+                    product += x[r] * y[r];
+                }
+                moments->products[i][j] += product;
+            }
+        }
+    }
+    moments->count += last - first;
+}
+
+
+
+
+/*
+mergeMarkMoments - Adds the sums of one worker to the sums of the scan.
+*/
+static void mergeMarkMoments(MarkMoments *into, const MarkMoments *from)
+{
+    into->count += from->count;
+    for (int i = 0; i < NUM_MARK_COLUMNS; i++)
+    {
+        into->sum[i] += from->sum[i];
+        for (int j = i; j < NUM_MARK_COLUMNS; j++)
+        {
+            into->products[i][j] += from->products[i][j];
+        }
+    }
+}
+
+
+
+
+/*
+momentsThread - Thread function accumulating the rows of one MomentsJob into its own sums.
+*/
+DWORD WINAPI momentsThread(LPVOID param)
+{
+    MomentsJob *job = (MomentsJob *)param;
+
+    accumulateMarkMoments(job->marks, job->stride, job->first, job->last, &job->moments);
+    return 0;
+}
+
+
+
+
+/*
+flushCorrelationScan - Accumulates the buffered rows of a scan, split into one range of whole blocks per worker.
+
+Each worker sums its own range into its own MarkMoments, so no sums are shared while the threads run;
+they are merged in worker order afterwards, which keeps the result independent of the thread timing.
+*/
+static void flushCorrelationScan(CorrelationScan *scan)
+{
+    MomentsJob jobs[MAX_CORRELATION_WORKERS];
+    HANDLE threads[MAX_CORRELATION_WORKERS];
+    int blocks = (scan->rows + CORRELATION_BLOCK_ROWS - 1) / CORRELATION_BLOCK_ROWS;
+    int workers = scan->workers < blocks ? scan->workers : blocks;
+    int w;
+
+    for (w = 0; w < workers; w++)
+    {
+        jobs[w].marks = scan->marks;
+        jobs[w].stride = CORRELATION_BUFFER_ROWS;
+        jobs[w].first = (int)((long long)blocks * w / workers) * CORRELATION_BLOCK_ROWS;
+        jobs[w].last = (int)((long long)blocks * (w + 1) / workers) * CORRELATION_BLOCK_ROWS;
+        jobs[w].last = jobs[w].last < scan->rows ? jobs[w].last : scan->rows;
+        memset(&jobs[w].moments, 0, sizeof(MarkMoments));
+
+        // The first range is accumulated by the current thread, as is any range whose thread could not be started
+        threads[w] = (w > 0) ? CreateThread(NULL, 0, momentsThread, &jobs[w], 0, NULL) : NULL;
+    }
+
+    for (w = 0; w < workers; w++)
+    {
+        if (threads[w] == NULL)
+        {
+            momentsThread(&jobs[w]);
+        }
+    }
+    for (w = 0; w < workers; w++)
+    {
+        if (threads[w] != NULL)
+        {
+            WaitForSingleObject(threads[w], INFINITE);
+            CloseHandle(threads[w]);
+        }
+        mergeMarkMoments(&scan->moments, &jobs[w].moments);
+    }
+    scan->rows = 0;
+}
+
+
+
+
+/*
+archiveCorrelationBatch - Streaming handler copying a batch into the columnar buffer, which is processed whenever it is full.
+*/
+void archiveCorrelationBatch(const Student *batch, const StudentGrades *grades, int count, void *context)
+{
+    CorrelationScan *scan = (CorrelationScan *)context;
+
+    for (int k = 0; k < count; k++)
+    {
+        if (scan->rows == CORRELATION_BUFFER_ROWS)
+        {
+            flushCorrelationScan(scan);
+        }
+        for (int col = 0; col < NUM_MARK_COLUMNS; col++)
+        {
+            int marks = markColumnValue(&batch[k], col);
+
+            // Clamped like the sketch, so the int sums of accumulateMarkMoments() cannot overflow on hand-edited marks
+            marks = marks < 0 ? 0 : marks > MAX_SUBJECT_MARKS ? MAX_SUBJECT_MARKS : marks;
+            scan->marks[(size_t)col * CORRELATION_BUFFER_ROWS + scan->rows] = marks;
+        }
+        scan->rows++;
+    }
+}
+
+
+
+
+/*
+markCovariance - Sample covariance of two mark columns (i <= j) from the sums.
+*/
+static double markCovariance(const MarkMoments *m, int i, int j)
+{
+    double n = (double)m->count;
+
+    return ((double)m->products[i][j] - (double)m->sum[i] * (double)m->sum[j] / n) / (n - 1);
+}
+
+
+
+
+/*
+markCorrelation - Pearson correlation of two mark columns from the sums.
+
+Returns:
+- The correlation in [-1, 1], or 2 if one of the columns has the same marks for every student (the correlation is undefined).
+*/
+static double markCorrelation(const MarkMoments *m, int i, int j)
+{
+    int a = i < j ? i : j;
+    int b = i < j ? j : i;
+    double varianceA = markCovariance(m, a, a);
+    double varianceB = markCovariance(m, b, b);
+
+    if (varianceA <= 0 || varianceB <= 0)
+    {
+        return 2;
+    }
+    return markCovariance(m, a, b) / sqrt(varianceA * varianceB);
+}
+
+
+
+
+/*
+printCorrelationMatrix - Prints the correlation matrix (or the covariance matrix) of the mark columns, numbered as in the legend.
+*/
+static void printCorrelationMatrix(FILE *fp, const MarkMoments *m, int covariance)
+{
+    int i, j;
+
+    fprintf(fp, "%-4s", "");
+    for (j = 0; j < NUM_MARK_COLUMNS; j++)
+    {
+        fprintf(fp, " %7d", j + 1);
+    }
+    fprintf(fp, "\n");
+
+    for (i = 0; i < NUM_MARK_COLUMNS; i++)
+    {
+        fprintf(fp, "%-4d", i + 1);
+        for (j = 0; j < NUM_MARK_COLUMNS; j++)
+        {
+            if (covariance)
+            {
+                fprintf(fp, " %7.2f", markCovariance(m, i < j ? i : j, i < j ? j : i));
+            }
+            else
+            {
+                double r = markCorrelation(m, i, j);
+
+                if (r > 1)
+                    fprintf(fp, " %7s", "-");
+                else
+                    fprintf(fp, " %7.3f", r);
+            }
+        }
+        fprintf(fp, "\n");
+    }
+}
+
+
+
+
+/*
+printCorrelationReport - Prints the column legend, the correlation matrix and the correlation of the theory and practical
+marks of every subject that has both; with details set, the covariance matrix is added.
+*/
+static void printCorrelationReport(FILE *fp, const char *archiveFile, const MarkMoments *m, int details)
+{
+    char name[MAX_LINE_LENGTH];
+
+    fprintf(fp, "\n===== Correlation of the Mark Columns of %s (%lld Students) =====\n\n", archiveFile, m->count);
+    for (int col = 0; col < NUM_MARK_COLUMNS; col++)
+    {
+        markColumnName(col, name);
+        fprintf(fp, "%2d. %s\n", col + 1, name);
+    }
+
+    fprintf(fp, "\nPearson Correlation\n\n");
+    printCorrelationMatrix(fp, m, 0);
+    if (details)
+    {
+        fprintf(fp, "\nCovariance\n\n");
+        printCorrelationMatrix(fp, m, 1);
+    }
+
+    fprintf(fp, "\nTheory vs Practical                          Correlation\n");
+    fprintf(fp, "--------------------------------------------------------\n");
+    for (int sub = 0; sub < TOTAL_SUBJECTS; sub++)
+    {
+        if (subjectTheoryColumn[sub] < 0 || subjectPracticalColumn[sub] < 0)
+        {
+            continue;
+        }
+
+        double r = markCorrelation(m, subjectTheoryColumn[sub], NUM_SUBJECTS + subjectPracticalColumn[sub]);
+        if (r > 1)
+            fprintf(fp, "%-44s -\n", subjectMarks[sub].subject);
+        else
+            fprintf(fp, "%-44s %.3f\n", subjectMarks[sub].subject, r);
+    }
+    fprintf(fp, "--------------------------------------------------------\n");
+}
+
+
+
+
+/*
+archiveCorrelation - Computes the Pearson correlation and covariance matrices of all mark columns of an archive file.
+
+The file is streamed once. Its marks are copied column by column into a buffer of CORRELATION_BUFFER_ROWS students,
+and every full buffer is split into row blocks accumulated on one thread per processor. Only exact integer sums of the
+columns and of their pairwise products are kept, so memory stays constant and the single pass loses no precision.
+The correlation matrix is printed and both matrices are saved to ARCHIVE_CORRELATION_FILE.
+*/
+void archiveCorrelation(const char *archiveFile)
+{
+    CorrelationScan scan;
+    SYSTEM_INFO info;
+    DWORD startTime = GetTickCount();
+
+    memset(&scan, 0, sizeof(scan));
+    scan.marks = malloc((size_t)NUM_MARK_COLUMNS * CORRELATION_BUFFER_ROWS * sizeof(int));
+    if (scan.marks == NULL)
+    {
+        printf("Error : Not Enough Memory.\n");
+        return;
+    }
+
+    GetSystemInfo(&info);
+    scan.workers = (int)info.dwNumberOfProcessors;
+    scan.workers = scan.workers < 1 ? 1 : scan.workers > MAX_CORRELATION_WORKERS ? MAX_CORRELATION_WORKERS : scan.workers;
+    mapSubjectColumns();
+
+    long long rows = streamStudentFile(archiveFile, archiveCorrelationBatch, &scan);
+    if (rows >= 0 && scan.rows > 0)
+    {
+        flushCorrelationScan(&scan);
+    }
+    free(scan.marks);
+
+    if (rows < 0)
+    {
+        printf("Error : Could Not Read Archive File %s.\n", archiveFile);
+        return;
+    }
+    if (rows < 2)
+    {
+        printf("At Least Two Students Are Needed for a Correlation.\n");
+        return;
+    }
+
+    printCorrelationReport(stdout, archiveFile, &scan.moments, 0);
+
+    FILE *fp = fopen(ARCHIVE_CORRELATION_FILE, "w");
+    if (fp == NULL)
+    {
+        printf("Error : Could not open file to save results.\n");
+        return;
+    }
+    printCorrelationReport(fp, archiveFile, &scan.moments, 1);
+    fclose(fp);
+
+    printf("\nCorrelation and Covariance Matrices saved to '%s' (%lu ms).\n", ARCHIVE_CORRELATION_FILE, (unsigned long)(GetTickCount() - startTime));
+}
+
+
+
+
+/* GroupField - Enum for the fields a group-by summary can group students on */
+typedef enum
+{
+    GROUP_BRANCH,      // Branch
+    GROUP_SEMESTER,    // Semester
+    GROUP_ROLL_YEAR,   // Admission year, digits 1-2 of the roll number (YYIIIPPSSSS)
+    GROUP_ROLL_CENTRE, // Institute code, digits 3-5 of the roll number
+    GROUP_ROLL_COURSE, // Programme code, digits 6-7 of the roll number
+    GROUP_FIELD_COUNT
+} GroupField;
+
+
+
+// GroupEntry - Aggregates of one group, a slot of a GroupTable
+typedef struct
+{
+    char key[GROUP_KEY_LENGTH]; // Values of the group fields joined with '/', may be empty (e.g. a blank branch)
+    int occupied;               // 1 if the slot holds a group, 0 for an unused slot
+    long long count;            // Students in the group
+    long long sum;              // Sum of the measure
+    long long passed;           // Students who passed the measure
+    int min;                    // Lowest value of the measure
+    int max;                    // Highest value of the measure
+
+} GroupEntry;
+
+
+
+// GroupTable - Open addressing hash table of groups, owned by one thread while the rows are aggregated
+typedef struct
+{
+    GroupEntry *entries;
+    int size;   // Slots, a power of two kept at least twice the number of groups
+    int count;  // Groups in the table
+
+} GroupTable;
+
+
+
+// GroupScan - Context of a group-by summary of an archive file
+typedef struct
+{
+    int fields[GROUP_FIELD_COUNT]; // GroupField values making up the key, in order
+    int fieldCount;
+    int measure;                   // Sketch key (mark column or subject total), or SKETCH_KEYS for the total marks
+    Student *rows;                 // Buffered students, aggregated in parallel when GROUP_BUFFER_ROWS are collected
+    StudentGrades *grades;
+    int buffered;
+    int workers;                   // Threads aggregating a full buffer, each into its own table
+    GroupTable tables[MAX_GROUP_WORKERS];
+    int failed;                    // Set if a table could not grow
+
+} GroupScan;
+
+
+
+// GroupJob - Rows of the buffer aggregated by one group-by worker into its table
+typedef struct
+{
+    const GroupScan *scan;
+    GroupTable *table;
+    int first;
+    int last;
+    int failed;
+
+} GroupJob;
+
+
+
+
+/*
+groupMeasureValue - Value of the summarized measure for a student : a mark column, a subject total or the total marks.
+*/
+static int groupMeasureValue(const Student *s, int measure)
+{
+    if (measure < NUM_MARK_COLUMNS)
+    {
+        return markColumnValue(s, measure);
+    }
+    if (measure < SKETCH_KEYS)
+    {
+        return subjectTotalMarks(s, measure - NUM_MARK_COLUMNS);
+    }
+    return studentTotalMarks(s);
+}
+
+
+
+
+/*
+groupMeasurePassed - Returns 1 if a student passed the summarized measure.
+
+A subject total passes with a non-zero grade point and the total marks pass when every subject does. A single mark
+column passes when its percentage reaches that of the lowest passing grade, as the grading scale only grades whole subjects.
+*/
+static int groupMeasurePassed(const Student *s, const StudentGrades *grades, int measure, int passPercent)
+{
+    if (measure < NUM_MARK_COLUMNS)
+    {
+        return markColumnValue(s, measure) * 100 >= passPercent * markColumnMax(measure);
+    }
+    if (measure < SKETCH_KEYS)
+    {
+        return gradeScale[grades->gradeIndex[measure - NUM_MARK_COLUMNS]].gradePoint > 0;
+    }
+    return grades->passed;
+}
+
+
+
+
+/*
+buildGroupKey - Builds the key of a student's group : the values of the group fields joined with '/', e.g. "CSE/5/23".
+
+Roll number fields are read from roll numbers of the form YYIIIPPSSSS; a roll number too short for a field gives "?".
+*/
+static void buildGroupKey(const Student *s, const int *fields, int fieldCount, char *key)
+{
+    static const int rollStart[GROUP_FIELD_COUNT] = {0, 0, 0, 2, 5};
+    static const int rollLength[GROUP_FIELD_COUNT] = {0, 0, 2, 3, 2};
+    int used = 0;
+
+    key[0] = '\0';
+    for (int f = 0; f < fieldCount && used < GROUP_KEY_LENGTH - 1; f++)
+    {
+        int field = fields[f];
+        char value[MAX_LENGTH];
+
+        if (field == GROUP_BRANCH)
+        {
+            snprintf(value, sizeof(value), "%s", s->branch);
+        }
+        else if (field == GROUP_SEMESTER)
+        {
+            snprintf(value, sizeof(value), "%d", s->semester);
+        }
+        else if ((int)strlen(s->rollNo) >= rollStart[field] + rollLength[field])
+        {
+            snprintf(value, sizeof(value), "%.*s", rollLength[field], s->rollNo + rollStart[field]);
+        }
+        else
+        {
+            strcpy(value, "?");
+        }
+        used += snprintf(key + used, GROUP_KEY_LENGTH - used, f > 0 ? "/%s" : "%s", value);
+    }
+}
+
+
+
+
+/*
+hashGroupKey - FNV-1a hash of a group key.
+*/
+static unsigned int hashGroupKey(const char *key)
+{
+    unsigned int hash = 2166136261u;
+
+    for (; *key != '\0'; key++)
+    {
+        hash = (hash ^ (unsigned char)*key) * 16777619u;
+    }
+    return hash;
+}
+
+
+
+
+/*
+findGroup - Finds the group of a key in a table, adding an empty group if it is not there.
+
+The table is doubled when it becomes half full.
+
+Returns:
+- The group, NULL if the table could not grow.
+*/
+static GroupEntry *findGroup(GroupTable *table, const char *key)
+{
+    if (2 * (table->count + 1) > table->size)
+    {
+        int size = table->size > 0 ? table->size * 2 : 64;
+        GroupEntry *entries = calloc(size, sizeof(GroupEntry));
+
+        if (entries == NULL)
+        {
+            return NULL;
+        }
+        for (int i = 0; i < table->size; i++)
+        {
+            if (table->entries[i].occupied)
+            {
+                unsigned int slot = hashGroupKey(table->entries[i].key) & (size - 1);
+                while (entries[slot].occupied)
+                {
+                    slot = (slot + 1) & (size - 1);
+                }
+                entries[slot] = table->entries[i];
+            }
+        }
+        free(table->entries);
+        table->entries = entries;
+        table->size = size;
+    }
+
+    unsigned int slot = hashGroupKey(key) & (table->size - 1);
+    while (table->entries[slot].occupied)
+    {
+        if (strcmp(table->entries[slot].key, key) == 0)
+        {
+            return &table->entries[slot];
+        }
+        slot = (slot + 1) & (table->size - 1);
+    }
+
+    GroupEntry *group = &table->entries[slot];
+    snprintf(group->key, GROUP_KEY_LENGTH, "%s", key);
+    group->occupied = 1;
+    group->min = INT_MAX;
+    group->max = INT_MIN;
+    table->count++;
+    return group;
+}
+
+
+
+
+/*
+groupRowsThread - Thread function aggregating the rows of one GroupJob into the worker's own table.
+*/
+DWORD WINAPI groupRowsThread(LPVOID param)
+{
+    GroupJob *job = (GroupJob *)param;
+    const GroupScan *scan = job->scan;
+    char key[GROUP_KEY_LENGTH];
+    int passPercent = 0;
+
+    for (int g = 0; g < gradeCount; g++)
+    {
+        if (gradeScale[g].gradePoint > 0)
+        {
+            passPercent = gradeScale[g].minPercent; // The scale is ordered from the highest grade, the last passing one is the lowest
+        }
+    }
+
+    for (int i = job->first; i < job->last; i++)
+    {
+        const Student *s = &scan->rows[i];
+
+        buildGroupKey(s, scan->fields, scan->fieldCount, key);
+        GroupEntry *group = findGroup(job->table, key);
+        if (group == NULL)
+        {
+            job->failed = 1;
+            return 0;
+        }
+
+        int value = groupMeasureValue(s, scan->measure);
+        group->count++;
+        group->sum += value;
+        group->passed += groupMeasurePassed(s, &scan->grades[i], scan->measure, passPercent);
+        group->min = value < group->min ? value : group->min;
+        group->max = value > group->max ? value : group->max;
+    }
+    return 0;
+}
+
+
+
+
+/*
+flushGroupScan - Aggregates the buffered rows, one contiguous range per worker and table.
+*/
+static void flushGroupScan(GroupScan *scan)
+{
+    GroupJob jobs[MAX_GROUP_WORKERS];
+    HANDLE threads[MAX_GROUP_WORKERS];
+    int workers = scan->workers < scan->buffered ? scan->workers : scan->buffered;
+    int w;
+
+    for (w = 0; w < workers; w++)
+    {
+        jobs[w].scan = scan;
+        jobs[w].table = &scan->tables[w];
+        jobs[w].first = (int)((long long)scan->buffered * w / workers);
+        jobs[w].last = (int)((long long)scan->buffered * (w + 1) / workers);
+        jobs[w].failed = 0;
+
+        // The first range is aggregated by the current thread, as is any range whose thread could not be started
+        threads[w] = (w > 0) ? CreateThread(NULL, 0, groupRowsThread, &jobs[w], 0, NULL) : NULL;
+    }
+
+    for (w = 0; w < workers; w++)
+    {
+        if (threads[w] == NULL)
+        {
+            groupRowsThread(&jobs[w]);
+        }
+    }
+    for (w = 0; w < workers; w++)
+    {
+        if (threads[w] != NULL)
+        {
+            WaitForSingleObject(threads[w], INFINITE);
+            CloseHandle(threads[w]);
+        }
+        scan->failed |= jobs[w].failed;
+    }
+    scan->buffered = 0;
+}
+
+
+
+
+/*
+archiveGroupBatch - Streaming handler buffering a batch, which is aggregated in parallel whenever the buffer is full.
+*/
+void archiveGroupBatch(const Student *batch, const StudentGrades *grades, int count, void *context)
+{
+    GroupScan *scan = (GroupScan *)context;
+
+    while (count > 0)
+    {
+        int take = GROUP_BUFFER_ROWS - scan->buffered;
+        take = take < count ? take : count;
+
+        memcpy(&scan->rows[scan->buffered], batch, take * sizeof(Student));
+        memcpy(&scan->grades[scan->buffered], grades, take * sizeof(StudentGrades));
+        scan->buffered += take;
+        batch += take;
+        grades += take;
+        count -= take;
+
+        if (scan->buffered == GROUP_BUFFER_ROWS)
+        {
+            flushGroupScan(scan);
+        }
+    }
+}
+
+
+
+
+/*
+compareGroupKeys - qsort() comparison of two groups by key.
+*/
+static int compareGroupKeys(const void *a, const void *b)
+{
+    return strcmp(((const GroupEntry *)a)->key, ((const GroupEntry *)b)->key);
+}
+
+
+
+
+/*
+mergeGroupTables - Merges the tables of every worker into the first one.
+
+Returns:
+- 0 on success, -1 if the first table could not grow.
+*/
+static int mergeGroupTables(GroupScan *scan)
+{
+    for (int w = 1; w < scan->workers; w++)
+    {
+        const GroupTable *table = &scan->tables[w];
+
+        for (int i = 0; i < table->size; i++)
+        {
+            const GroupEntry *from = &table->entries[i];
+            if (!from->occupied)
+            {
+                continue;
+            }
+
+            GroupEntry *into = findGroup(&scan->tables[0], from->key);
+            if (into == NULL)
+            {
+                return -1;
+            }
+            into->count += from->count;
+            into->sum += from->sum;
+            into->passed += from->passed;
+            into->min = from->min < into->min ? from->min : into->min;
+            into->max = from->max > into->max ? from->max : into->max;
+        }
+    }
+    return 0;
+}
+
+
+
+
+/*
+printGroupSummary - Prints the groups of the merged table, ordered by key.
+*/
+static void printGroupSummary(FILE *fp, const char *archiveFile, const GroupScan *scan, const GroupEntry *groups, int groupCount)
+{
+    static const char *fieldNames[GROUP_FIELD_COUNT] = {"Branch", "Semester", "Year", "Institute", "Programme"};
+    char header[MAX_LINE_LENGTH] = "";
+    char measure[MAX_LINE_LENGTH];
+
+    for (int f = 0; f < scan->fieldCount; f++)
+    {
+        strcat(header, f > 0 ? "/" : "");
+        strcat(header, fieldNames[scan->fields[f]]);
+    }
+    if (scan->measure < SKETCH_KEYS)
+        markSketchKeyName(scan->measure, measure);
+    else
+        strcpy(measure, "Total Marks");
+
+    fprintf(fp, "\n===== %s by %s (%s) =====\n\n", measure, header, archiveFile);
+    fprintf(fp, "%-24s %-10s %-12s %-9s %-6s %-6s %s\n", header, "Count", "Sum", "Average", "Min", "Max", "Pass %");
+    fprintf(fp, "-------------------------------------------------------------------------------\n");
+    for (int k = 0; k < groupCount; k++)
+    {
+        const GroupEntry *g = &groups[k];
+
+        fprintf(fp, "%-24s %-10lld %-12lld %-9.2f %-6d %-6d %.1f\n", g->key[0] != '\0' ? g->key : "(blank)", g->count, g->sum, (double)g->sum / g->count,
+                g->min, g->max, 100.0 * g->passed / g->count);
+    }
+    fprintf(fp, "-------------------------------------------------------------------------------\n");
+    fprintf(fp, "%d Groups\n", groupCount);
+}
+
+
+
+
+/*
+readGroupBy - Asks which fields to group on and which measure to summarize.
+
+Returns:
+- 1 if the choices are valid, 0 otherwise.
+*/
+static int readGroupBy(GroupScan *scan)
+{
+    char line[MAX_LINE_LENGTH];
+    char name[MAX_LINE_LENGTH];
+
+    printf("\nGroup Fields : 1. Branch  2. Semester  3. Admission Year  4. Institute  5. Programme\n");
+    printf("(Year, Institute and Programme are digits 1-2, 3-5 and 6-7 of the roll number)\n");
+    printf("Enter Fields to Group By (e.g. 1 2) : ");
+    clearInputBuffer();
+    if (fgets(line, MAX_LINE_LENGTH, stdin) == NULL)
+    {
+        return 0;
+    }
+
+    char *cursor = line;
+    int field, used;
+    scan->fieldCount = 0;
+    while (sscanf(cursor, "%d%n", &field, &used) == 1 && scan->fieldCount < GROUP_FIELD_COUNT)
+    {
+        if (field < 1 || field > GROUP_FIELD_COUNT)
+        {
+            printf("Invalid Field %d!\n", field);
+            return 0;
+        }
+        scan->fields[scan->fieldCount++] = field - 1;
+        cursor += used;
+    }
+    if (scan->fieldCount == 0)
+    {
+        printf("Enter at Least One Field!\n");
+        return 0;
+    }
+
+    printf("\n");
+    for (int key = 0; key < SKETCH_KEYS; key++)
+    {
+        markSketchKeyName(key, name);
+        printf("%2d. %s\n", key + 1, name);
+    }
+    printf("%2d. Total Marks\n", SKETCH_KEYS + 1);
+    printf("\nEnter Measure to Summarize : ");
+    if (scanf("%d", &scan->measure) != 1 || scan->measure < 1 || scan->measure > SKETCH_KEYS + 1)
+    {
+        printf("Invalid Measure!\n");
+        clearInputBuffer();
+        return 0;
+    }
+    scan->measure--;
+    return 1;
+}
+
+
+
+
+/*
+archiveGroupBy - Summarizes an archive file by groups of branch, semester and roll number fields.
+
+The file is streamed once into a buffer of GROUP_BUFFER_ROWS students. Every full buffer is split into one range per
+processor and each worker aggregates its range into its own hash table (count, sum, min, max and passes of the measure),
+so no table is shared while the threads run. The tables are merged at the end and the groups are printed in key order
+and saved to ARCHIVE_GROUP_FILE.
+*/
+void archiveGroupBy(const char *archiveFile)
+{
+    GroupScan scan;
+    SYSTEM_INFO info;
+    int w;
+
+    memset(&scan, 0, sizeof(scan));
+    if (!readGroupBy(&scan))
+    {
+        return;
+    }
+
+    DWORD startTime = GetTickCount();
+    scan.rows = malloc(GROUP_BUFFER_ROWS * sizeof(Student));
+    scan.grades = malloc(GROUP_BUFFER_ROWS * sizeof(StudentGrades));
+    GetSystemInfo(&info);
+    scan.workers = (int)info.dwNumberOfProcessors;
+    scan.workers = scan.workers < 1 ? 1 : scan.workers > MAX_GROUP_WORKERS ? MAX_GROUP_WORKERS : scan.workers;
+    mapSubjectColumns();
+
+    long long rows = -1;
+    if (scan.rows != NULL && scan.grades != NULL)
+    {
+        rows = streamStudentFile(archiveFile, archiveGroupBatch, &scan);
+        if (rows >= 0 && scan.buffered > 0)
+        {
+            flushGroupScan(&scan);
+        }
+    }
+    free(scan.rows);
+    free(scan.grades);
+
+    if (rows < 0)
+    {
+        printf("Error : Could Not Read Archive File %s.\n", archiveFile);
+    }
+    else if (scan.failed || mergeGroupTables(&scan) != 0)
+    {
+        printf("Error : Not Enough Memory for the Groups.\n");
+    }
+    else if (rows == 0)
+    {
+        printf("No Student record available in %s.\n", archiveFile);
+    }
+    else
+    {
+        // Pack the merged groups and order them by key
+        GroupTable *table = &scan.tables[0];
+        int groupCount = 0;
+
+        for (int i = 0; i < table->size; i++)
+        {
+            if (table->entries[i].occupied)
+            {
+                table->entries[groupCount++] = table->entries[i];
+            }
+        }
+        qsort(table->entries, groupCount, sizeof(GroupEntry), compareGroupKeys);
+
+        printGroupSummary(stdout, archiveFile, &scan, table->entries, groupCount);
+
+        FILE *fp = fopen(ARCHIVE_GROUP_FILE, "w");
+        if (fp != NULL)
+        {
+            printGroupSummary(fp, archiveFile, &scan, table->entries, groupCount);
+            fclose(fp);
+            printf("Summary of %lld Students saved to '%s' (%lu ms).\n", rows, ARCHIVE_GROUP_FILE, (unsigned long)(GetTickCount() - startTime));
+        }
+        else
+        {
+            printf("Error : Could not open file to save results.\n");
+        }
+    }
+
+    for (w = 0; w < MAX_GROUP_WORKERS; w++)
+    {
+        free(scan.tables[w].entries);
+    }
+}
+
+
+
+
+/*
+archivePercentiles - Prints the percentiles of every mark column and subject of an archive file and answers percentile lookups.
+
+The quantile sketch saved next to the file is used if the file has not changed since it was built. Otherwise the file is
+streamed once to build the sketch, which is then saved for the next time. Every lookup reads only the sketch.
+*/
+void archivePercentiles(const char *archiveFile)
+{
+    MarkSketch *sketch = malloc(sizeof(MarkSketch));
+    DWORD startTime = GetTickCount();
+    int key;
+    double percent;
+
+    if (sketch == NULL)
+    {
+        printf("Error : Not Enough Memory.\n");
+        return;
+    }
+
+    if (loadMarkSketch(archiveFile, sketch))
+    {
+        printf("\nUsing the Saved Sketch of %s (%lld Students).\n", archiveFile, sketch->count);
+    }
+    else
+    {
+        FileSignature signature;
+
+        fileSignature(archiveFile, &signature); // Taken first, so a change during the scan invalidates the saved sketch
+        clearMarkSketch(sketch);
+        if (streamStudentFile(archiveFile, archiveSketchBatch, sketch) < 0)
+        {
+            printf("Error : Could Not Read Archive File %s.\n", archiveFile);
+            free(sketch);
+            return;
+        }
+        if (saveMarkSketch(archiveFile, &signature, sketch) != 0)
+        {
+            printf("Warning : Could Not Save the Sketch of %s.\n", archiveFile);
+        }
+        printf("\nSketch of %s Built From %lld Students (%lu ms).\n", archiveFile, sketch->count, (unsigned long)(GetTickCount() - startTime));
+    }
+
+    if (sketch->count == 0)
+    {
+        printf("No Student record available in %s.\n", archiveFile);
+        free(sketch);
+        return;
+    }
+
+    printf("\n");
+    printMarkSketch(stdout, sketch);
+
+    while (1)
+    {
+        printf("\nEnter Distribution No. and Percentile (e.g. 3 75), or 0 to Return : ");
+        if (scanf("%d", &key) != 1 || key == 0)
+        {
+            break;
+        }
+        if (scanf("%lf", &percent) != 1 || key < 1 || key > SKETCH_KEYS || percent < 0 || percent > 100)
+        {
+            printf("Invalid Input! Enter a Number From 1 to %d and a Percentile From 0 to 100.\n", SKETCH_KEYS);
+            clearInputBuffer();
+            continue;
+        }
+
+        char name[MAX_LINE_LENGTH];
+        markSketchKeyName(key - 1, name);
+        printf("%.1fth Percentile of %s : %d\n", percent, name, markSketchPercentile(sketch, key - 1, percent));
+    }
+
+    free(sketch);
+}
+
+
+
+
+/*
+archiveMode - Runs reports over an archive file streamed in bounded memory.
+
+Archive files have the same layout as DATABASE_FILE but may be far too large for the students array, e.g. several years of results.
+Subject-wise reports, statistics, filtered listings and exports are computed in a single streaming scan of the file
+and written to files, so memory use stays constant whatever the size of the archive.
+*/
+void archiveMode()
+{
+    char archiveFile[MAX_LINE_LENGTH] = DATABASE_FILE;
+    int choice;
+
+    while (1)
+    {
+        printf("\n===== Archive (Streaming) Mode =====\n\n");
+        printf("Archive File : %s\n\n", archiveFile);
+        printf("1. Subject-Wise Report\n");
+        printf("2. Statistics\n");
+        printf("3. Filtered Listing\n");
+        printf("4. Export Filtered Students to CSV\n");
+        printf("5. Percentiles (Median, Quartiles, Top 10%%)\n");
+        printf("6. Correlation Matrix of the Mark Columns\n");
+        printf("7. Group-By Summary (Branch, Semester, Roll Fields)\n");
+        printf("8. Export Filtered Students to Arrow IPC\n");
+        printf("9. Export Filtered Students to Excel\n");
+        printf("10. Change Archive File\n");
+        printf("11. Return to Admin Menu\n\n");
+        printf("Enter Your Choice : ");
+
+        if (scanf("%d", &choice) != 1)
+        {
+            printf("Invalid Input! Please Enter a Number.\n");
+            clearInputBuffer();
+            continue;
+        }
+
+        DWORD startTime = GetTickCount();
+        long long rows;
+
+        if (choice == 1)
+        {
+            ArchiveReport report;
+
+            printf("\n");
+            for (int i = 0; i < TOTAL_SUBJECTS; i++)
+            {
+                printf("%d. %s\n", i + 1, subjectMarks[i].subject);
+            }
+            printf("\nEnter Subject : ");
+
+            if (scanf("%d", &report.subjectIndex) != 1 || report.subjectIndex < 1 || report.subjectIndex > TOTAL_SUBJECTS)
+            {
+                printf("Invalid Subject!\n");
+                clearInputBuffer();
+                continue;
+            }
+            report.subjectIndex--;
+
+            report.fp = fopen(ARCHIVE_REPORT_FILE, "w");
+            if (report.fp == NULL)
+            {
+                printf("Error : Could not open file to save results.\n");
+                continue;
+            }
+            setvbuf(report.fp, NULL, _IOFBF, REPORT_BUFFER_SIZE);
+
+            startTime = GetTickCount();
+            writeSubjectReportHeader(report.fp, report.subjectIndex);
+            rows = streamStudentFile(archiveFile, archiveReportBatch, &report);
+            fprintf(report.fp, "-------------------------------------------------------------------------------------------------------------\n");
+            fclose(report.fp);
+
+            if (rows < 0)
+            {
+                printf("Error : Could Not Read Archive File %s.\n", archiveFile);
+                continue;
+            }
+            printf("Subject-Wise Report of %lld Students saved to '%s' (%lu ms).\n", rows, ARCHIVE_REPORT_FILE, (unsigned long)(GetTickCount() - startTime));
+        }
+        else if (choice == 2)
+        {
+            ArchiveStatistics stats;
+
+            memset(&stats, 0, sizeof(stats));
+            for (int col = 0; col < NUM_MARK_COLUMNS; col++)
+            {
+                stats.min[col] = INT_MAX;
+                stats.max[col] = INT_MIN;
+            }
+
+            rows = streamStudentFile(archiveFile, archiveStatisticsBatch, &stats);
+            if (rows < 0)
+            {
+                printf("Error : Could Not Read Archive File %s.\n", archiveFile);
+                continue;
+            }
+            if (rows == 0)
+            {
+                printf("No Student record available in %s.\n", archiveFile);
+                continue;
+            }
+
+            printf("\n===== Statistics of %s (%lld Students, %lu ms) =====\n\n", archiveFile, rows, (unsigned long)(GetTickCount() - startTime));
+            printf("Column                                          Max Marks   Lowest   Highest   Average\n");
+            printf("-----------------------------------------------------------------------------------------\n");
+            for (int col = 0; col < NUM_MARK_COLUMNS; col++)
+            {
+                char name[MAX_LINE_LENGTH];
+                markColumnName(col, name);
+                printf("%-47s %-11d %-8d %-9d %.2f\n", name, markColumnMax(col), stats.min[col], stats.max[col], (double)stats.sum[col] / stats.count);
+            }
+            printf("-----------------------------------------------------------------------------------------\n");
+            printf("Average Total Marks : %.2f\n", (double)stats.totalSum / stats.count);
+            printf("Average SGPA        : %.2f\n", stats.sgpaSum / stats.count);
+            printf("Passed              : %lld of %lld (%.1f%%)\n\n", stats.passed, stats.count, 100.0 * stats.passed / stats.count);
+        }
+        else if (choice == 3 || choice == 4)
+        {
+            CompiledQuery query;
+            ArchiveFilter filter;
+            const char *outputFile = (choice == 3) ? ARCHIVE_LIST_FILE : ARCHIVE_EXPORT_FILE;
+
+            clearInputBuffer();
+            int hasQuery = readArchiveQuery(&query);
+            if (hasQuery < 0)
+            {
+                continue;
+            }
+
+            filter.query = hasQuery ? &query : NULL;
+            filter.csv = (choice == 4);
+            filter.matched = 0;
+            filter.failed = 0;
+            filter.matches = malloc(STREAM_BATCH_ROWS * sizeof(int));
+            filter.fp = fopen(outputFile, "w");
+
+            if (filter.fp == NULL || filter.matches == NULL)
+            {
+                printf("Error : Could not open file to save results.\n");
+                if (filter.fp != NULL)
+                {
+                    fclose(filter.fp);
+                }
+                free(filter.matches);
+                continue;
+            }
+            setvbuf(filter.fp, NULL, _IOFBF, REPORT_BUFFER_SIZE);
+
+            startTime = GetTickCount();
+            if (filter.csv)
+            {
+                writeCSVHeader(filter.fp);
+            }
+            else
+            {
+                fprintf(filter.fp, "Roll No\t\t\t\tName\t\t\t\tBranch/Sem\n");
+                fprintf(filter.fp, "------------------------------------------------------------------------------\n");
+            }
+
+            rows = streamStudentFile(archiveFile, archiveFilterBatch, &filter);
+
+            if (!filter.csv)
+            {
+                fprintf(filter.fp, "------------------------------------------------------------------------------\n");
+            }
+            if (ferror(filter.fp) | fclose(filter.fp))
+            {
+                filter.failed = 1;
+            }
+            free(filter.matches);
+
+            if (rows < 0)
+            {
+                printf("Error : Could Not Read Archive File %s.\n", archiveFile);
+                continue;
+            }
+            if (filter.failed)
+            {
+                printf("Error : Could Not Write '%s', the Results Are Incomplete.\n", outputFile);
+                continue;
+            }
+            printf("%lld of %lld Students saved to '%s' (%lu ms).\n", filter.matched, rows, outputFile, (unsigned long)(GetTickCount() - startTime));
+        }
+        else if (choice == 5)
+        {
+            archivePercentiles(archiveFile);
+        }
+        else if (choice == 6)
+        {
+            archiveCorrelation(archiveFile);
+        }
+        else if (choice == 7)
+        {
+            archiveGroupBy(archiveFile);
+        }
+        else if (choice == 8)
+        {
+            archiveArrowExport(archiveFile);
+        }
+        else if (choice == 9)
+        {
+            archiveXlsxExport(archiveFile);
+        }
+        else if (choice == 10)
+        {
+            printf("Enter Archive File Name : ");
+            scanf("%1023s", archiveFile);
+        }
+        else if (choice == 11)
+        {
+            return;
+        }
+        else
+        {
+            printf("Invalid Choice! Please Select a Valid Option.\n");
+        }
+    }
+}
+
+
+
+
+/*
+backgroundSaverThread - Thread function saving the database after edits.
+
+The thread sleeps until an edit is made. It then waits until no new edit has arrived for SAVE_COALESCE_MS
+(but never longer than SAVE_MAX_DELAY_MS), so a burst of edits is saved with a single write of the database file.
+With sharded storage only the shards changed since the last save are written, followed by the manifest.
+The records are read from the current store snapshot without any lock, so the admin is never blocked by the disk
+and a save never contains half of a transaction. The saved snapshot is remembered, so reloadExternalEdits() can tell
+the program's own saves from edits made outside it, and a save waits while an external edit has not been merged yet.
+*/
+DWORD WINAPI backgroundSaverThread(LPVOID param)
+{
+    static Shard shardTable[MAX_SHARDS]; // Copy of the shard table being saved, only used by this thread
+    EnterCriticalSection(&storeLock);
+
+    while (1)
+    {
+        while (editGeneration == savedGeneration && !saverStopping)
+        {
+            SleepConditionVariableCS(&saverWake, &storeLock, INFINITE);
+        }
+
+        if (editGeneration == savedGeneration && saverStopping)
+        {
+            break;
+        }
+
+        // Coalesce the burst of edits
+        DWORD firstEdit = GetTickCount();
+        long seenGeneration;
+        do
+        {
+            seenGeneration = editGeneration;
+            if (saverStopping)
+            {
+                break;
+            }
+            SleepConditionVariableCS(&saverWake, &storeLock, SAVE_COALESCE_MS);
+        } while (editGeneration != seenGeneration && GetTickCount() - firstEdit < SAVE_MAX_DELAY_MS);
+
+        // Edits are published before they are requested, so the snapshot contains at least this generation
+        long generation = editGeneration;
+        int sharded = shardedStorage;
+        int tableCount = shardCount;
+        memcpy(shardTable, shards, shardCount * sizeof(Shard));
+
+        savingDatabaseFile = 1;
+
+        LeaveCriticalSection(&storeLock);
+        StoreSnapshot *snapshot = acquireSnapshot();
+        int result = sharded ? saveDirtyShards(shardTable, tableCount, snapshot) : saveDatabaseFile(snapshot);
+        EnterCriticalSection(&storeLock);
+        savingDatabaseFile = 0;
+        releaseSnapshot(snapshot);
+
+        // An edit made outside the program, or a save of another program, must be merged by the main thread first
+        if (result == 1)
+        {
+            InterlockedExchange(&externalEditPending, 1);
+            if (saverStopping)
+            {
+                InterlockedExchange(&saveNeedsMerge, 1); // stopBackgroundSaver() merges and saves
+                break;
+            }
+            SleepConditionVariableCS(&saverWake, &storeLock, SAVE_MAX_DELAY_MS);
+            continue;
+        }
+
+        if (result == 0)
+        {
+            savedGeneration = generation;
+            dropRecordStamps(generation);
+            for (int k = 0; k < tableCount; k++)
+            {
+                shards[k].savedGeneration = shardTable[k].editGeneration;
+            }
+        }
+        else if (saverStopping)
+        {
+            break; // The error has been reported, do not retry forever on exit
+        }
+        else
+        {
+            // Keep the edits pending and retry later
+            SleepConditionVariableCS(&saverWake, &storeLock, SAVE_MAX_DELAY_MS);
+        }
+    }
+
+    LeaveCriticalSection(&storeLock);
+    return 0;
+}
+
+
+
+
+/*
+startBackgroundSaver - Starts the background saver thread.
+
+If the thread cannot be started, requestSave() falls back to saving synchronously.
+*/
+void startBackgroundSaver()
+{
+    static int lockInitialized = 0;
+
+    if (!lockInitialized)
+    {
+        InitializeCriticalSection(&storeLock);
+        InitializeConditionVariable(&saverWake);
+        lockInitialized = 1;
+    }
+
+    saverStopping = 0;
+    saverThread = CreateThread(NULL, 0, backgroundSaverThread, NULL, 0, NULL);
+    if (saverThread == NULL)
+    {
+        printf("Warning : Could Not Start Background Saver. Changes Will Be Saved Immediately.\n");
+    }
+}
+
+
+
+
+/*
+requestSave - Marks the database as changed and returns immediately.
+
+The background saver writes the changes to DATABASE_FILE shortly after the last edit of a burst.
+*/
+void requestSave()
+{
+    if (saverThread == NULL)
+    {
+        saveToCSV();
+        return;
+    }
+
+    EnterCriticalSection(&storeLock);
+    editGeneration++;
+    WakeConditionVariable(&saverWake);
+    LeaveCriticalSection(&storeLock);
+}
+
+
+
+
+/*
+stopBackgroundSaver - Saves all pending edits and stops the background saver.
+
+It must be called before the program exits, otherwise the last edits could be lost.
+*/
+void stopBackgroundSaver()
+{
+    if (saverThread == NULL)
+    {
+        return;
+    }
+
+    EnterCriticalSection(&storeLock);
+    int pending = (editGeneration != savedGeneration);
+    saverStopping = 1;
+    WakeConditionVariable(&saverWake);
+    LeaveCriticalSection(&storeLock);
+
+    if (pending)
+    {
+        printf("Saving Changes...\n");
+    }
+
+    WaitForSingleObject(saverThread, INFINITE);
+    CloseHandle(saverThread);
+    saverThread = NULL;
+
+    if (InterlockedExchange(&saveNeedsMerge, 0))
+    {
+        saveToCSV(); // Merges the rows another program saved, then saves
+    }
+    else if (pending && editGeneration == savedGeneration)
+    {
+        printf("Database Saved Successfully!\n");
+    }
+}
+
+
+
+
+/*
+encodeRecord - Packs a student into a fixed-width record of RECORD_SIZE bytes.
+
+Layout : live flag (1 byte), roll number, name, branch (fixed-width, zero padded), semester (4 bytes, little endian),
+then every mark column (2 bytes each, little endian). The rest of the record is zero.
+*/
+void encodeRecord(const Student *s, unsigned char *record)
+{
+    unsigned char *p = record;
+
+    memset(record, 0, RECORD_SIZE);
+    *p++ = 1;
+    memcpy(p, s->rollNo, strnlen(s->rollNo, MAX_ROLLNO_LENGTH - 1)); // The record is zeroed, each field stays terminated
+    p += MAX_ROLLNO_LENGTH;
+    memcpy(p, s->name, strnlen(s->name, MAX_NAME_LENGTH - 1));
+    p += MAX_NAME_LENGTH;
+    memcpy(p, s->branch, strnlen(s->branch, MAX_LENGTH - 1));
+    p += MAX_LENGTH;
+
+    unsigned int semester = (unsigned int)s->semester;
+    for (int b = 0; b < 4; b++)
+    {
+        *p++ = (unsigned char)(semester >> (8 * b));
+    }
+
+    int marks[NUM_MARK_COLUMNS];
+    markColumnValues(s, marks);
+    for (int col = 0; col < NUM_MARK_COLUMNS; col++)
+    {
+        unsigned short value = (unsigned short)marks[col];
+        *p++ = (unsigned char)(value & 0xFF);
+        *p++ = (unsigned char)(value >> 8);
+    }
+}
+
+
+
+
+/*
+decodeRecord - Unpacks a fixed-width record written by encodeRecord().
+
+Returns:
+- 1 if the record holds a live student, 0 if the slot is deleted.
+*/
+int decodeRecord(const unsigned char *record, Student *s)
+{
+    const unsigned char *p = record;
+
+    if (*p++ != 1)
+    {
+        return 0;
+    }
+
+    memcpy(s->rollNo, p, MAX_ROLLNO_LENGTH);
+    s->rollNo[MAX_ROLLNO_LENGTH - 1] = '\0';
+    p += MAX_ROLLNO_LENGTH;
+    memcpy(s->name, p, MAX_NAME_LENGTH);
+    s->name[MAX_NAME_LENGTH - 1] = '\0';
+    p += MAX_NAME_LENGTH;
+    memcpy(s->branch, p, MAX_LENGTH);
+    s->branch[MAX_LENGTH - 1] = '\0';
+    p += MAX_LENGTH;
+
+    s->semester = (int)(p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24));
+    p += 4;
+
+    int marks[NUM_MARK_COLUMNS];
+    for (int col = 0; col < NUM_MARK_COLUMNS; col++)
+    {
+        marks[col] = (short)(p[0] | (p[1] << 8));
+        p += 2;
+    }
+    setMarkColumnValues(s, marks);
+    return 1;
+}
+
+
+
+
+/*
+writeRecordBytes - Writes bytes at an offset of the record store with a single positioned write.
+*/
+int writeRecordBytes(long long offset, const void *data, DWORD size)
+{
+    OVERLAPPED position;
+    DWORD written = 0;
+
+    memset(&position, 0, sizeof(position));
+    position.Offset = (DWORD)(offset & 0xFFFFFFFF);
+    position.OffsetHigh = (DWORD)(offset >> 32);
+
+    if (!WriteFile(recordStore, data, size, &written, &position) || written != size)
+    {
+        printf("Error : Could Not Write to %s (Error %lu).\n", RECORD_STORE_FILE, (unsigned long)GetLastError());
+        return -1;
+    }
+    return 0;
+}
+
+
+
+
+/*
+loadFromRecordStore - Loads the database from the fixed-width record store.
+
+Slots whose live flag is cleared are deleted students, they are remembered so new students can reuse them.
+
+Returns:
+- 1 if the record store exists and was loaded, 0 if the CSV file should be used instead.
+*/
+int loadFromRecordStore()
+{
+    HANDLE file = CreateFileA(RECORD_STORE_FILE, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_WRITE_THROUGH, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return 0;
+    }
+
+    unsigned char header[RECORD_HEADER_SIZE];
+    DWORD bytesRead = 0;
+
+    if (!ReadFile(file, header, RECORD_HEADER_SIZE, &bytesRead, NULL) || bytesRead != RECORD_HEADER_SIZE ||
+        memcmp(header, RECORD_STORE_MAGIC, 8) != 0 || header[8] != RECORD_SIZE || header[12] != NUM_MARK_COLUMNS)
+    {
+        reportLoad("Warning : %s Is Not a Valid Record Store. Using %s Instead.\n", RECORD_STORE_FILE, DATABASE_FILE);
+        CloseHandle(file);
+        return 0;
+    }
+
+    unsigned char record[RECORD_SIZE];
+    studentCount = 0;
+    freeSlotCount = 0;
+    recordSlotCount = 0;
+
+    while (ReadFile(file, record, RECORD_SIZE, &bytesRead, NULL) && bytesRead == RECORD_SIZE)
+    {
+        Student s;
+
+        if (!decodeRecord(record, &s))
+        {
+            if (freeSlotCount < MAX_STUDENTS)
+            {
+                freeSlots[freeSlotCount++] = recordSlotCount;
+            }
+        }
+        else if (studentCount < MAX_STUDENTS)
+        {
+            studentSlots[studentCount] = recordSlotCount;
+            students[studentCount++] = s;
+        }
+        recordSlotCount++;
+    }
+
+    recordStore = file;
+    buildRollIndex();
+    invalidateRanks();
+    computeGrades(0, studentCount);
+    reportLoad("Record Store Loaded Successfully! Total Students: %d\n", studentCount);
+    return 1;
+}
+
+
+
+
+/*
+convertToRecordStore - Creates the record store from the loaded students.
+
+From then on every edit writes only the changed record, and DATABASE_FILE is kept as an export for MS Excel.
+
+Returns:
+- 0 on success, -1 if the record store could not be created.
+*/
+int convertToRecordStore()
+{
+    HANDLE file = CreateFileA(RECORD_STORE_FILE, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_WRITE_THROUGH, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        printf("Error : Could Not Create %s.\n", RECORD_STORE_FILE);
+        return -1;
+    }
+
+    unsigned char header[RECORD_HEADER_SIZE];
+    memset(header, 0, RECORD_HEADER_SIZE);
+    memcpy(header, RECORD_STORE_MAGIC, 8);
+    header[8] = RECORD_SIZE;
+    header[12] = NUM_MARK_COLUMNS;
+
+    recordStore = file;
+    if (writeRecordBytes(0, header, RECORD_HEADER_SIZE) != 0)
+    {
+        CloseHandle(file);
+        recordStore = NULL;
+        DeleteFileA(RECORD_STORE_FILE);
+        return -1;
+    }
+
+    for (int i = 0; i < studentCount; i++)
+    {
+        unsigned char record[RECORD_SIZE];
+
+        encodeRecord(&students[i], record);
+        if (writeRecordBytes(RECORD_HEADER_SIZE + (long long)i * RECORD_SIZE, record, RECORD_SIZE) != 0)
+        {
+            CloseHandle(file);
+            recordStore = NULL;
+            DeleteFileA(RECORD_STORE_FILE);
+            return -1;
+        }
+        studentSlots[i] = i;
+    }
+
+    recordSlotCount = studentCount;
+    freeSlotCount = 0;
+    return 0;
+}
+
+
+
+
+/*
+closeRecordStore - Exports pending changes to DATABASE_FILE and closes the record store.
+*/
+void closeRecordStore()
+{
+    if (recordStore == NULL)
+    {
+        return;
+    }
+
+    if (csvExportPending)
+    {
+        printf("Exporting %s...\n", DATABASE_FILE);
+        saveToCSV();
+        csvExportPending = 0;
+    }
+
+    CloseHandle(recordStore);
+    recordStore = NULL;
+}
+
+
+
+
+/*
+saveStudentRecord - Persists a student that was added or updated.
+
+With the record store, only the student's slot is written, with a single positioned write at
+RECORD_HEADER_SIZE + slot * RECORD_SIZE, so the cost does not grow with the database. New students reuse a deleted slot if there is one.
+Without the record store, the background saver rewrites the CSV file.
+*/
+void saveStudentRecord(int index)
+{
+    if (recordStore == NULL)
+    {
+        requestSave();
+        return;
+    }
+
+    if (studentSlots[index] == -1)
+    {
+        studentSlots[index] = (freeSlotCount > 0) ? freeSlots[--freeSlotCount] : recordSlotCount++;
+    }
+
+    unsigned char record[RECORD_SIZE];
+    encodeRecord(&students[index], record);
+
+    if (writeRecordBytes(RECORD_HEADER_SIZE + (long long)studentSlots[index] * RECORD_SIZE, record, RECORD_SIZE) == 0)
+    {
+        csvExportPending = 1;
+    }
+}
+
+
+
+
+/*
+deleteStudentRecord - Persists the deletion of a student.
+
+With the record store, only the live flag of the student's slot is cleared (one byte written) and the slot is kept for reuse.
+Without the record store, the background saver rewrites the CSV file.
+*/
+void deleteStudentRecord(int slot)
+{
+    if (recordStore == NULL || slot < 0)
+    {
+        requestSave();
+        return;
+    }
+
+    unsigned char deleted = 0;
+
+    if (writeRecordBytes(RECORD_HEADER_SIZE + (long long)slot * RECORD_SIZE, &deleted, 1) == 0)
+    {
+        if (freeSlotCount < MAX_STUDENTS)
+        {
+            freeSlots[freeSlotCount++] = slot;
+        }
+        csvExportPending = 1;
+    }
+}
+
+
+
+
+/*
+viewRecordStore - Record store and CSV export menu.
+
+The admin can switch the database to the fixed-width record store, where an edit writes a single record instead of the whole file,
+and export the CSV file for MS Excel at any time. The CSV file is also exported when the program exits.
+*/
+void viewRecordStore()
+{
+    int choice;
+
+    while (1)
+    {
+        printf("\n===== Record Store and CSV Export =====\n\n");
+        if (shardedStorage)
+        {
+            int loaded = 0;
+            for (int k = 0; k < shardCount; k++)
+            {
+                loaded += shards[k].loaded;
+            }
+            printf("Database Storage : %s, %d Branch/Semester Shards (%d Loaded)\n", SHARD_MANIFEST_FILE, shardCount, loaded);
+            printf("CSV Export       : %s Is Only Written When Exported\n\n", DATABASE_FILE);
+        }
+        else if (recordStore != NULL)
+        {
+            printf("Database Storage : %s (%d Slots, %d Free)\n", RECORD_STORE_FILE, recordSlotCount, freeSlotCount);
+            printf("CSV Export       : %s\n\n", csvExportPending ? "Out of Date (Exported on Exit)" : "Up to Date");
+        }
+        else
+        {
+            printf("Database Storage : %s\n\n", DATABASE_FILE);
+        }
+
+        printf("1. Convert Database to Record Store\n");
+        printf("2. Export %s Now\n", DATABASE_FILE);
+        printf("3. Split Database into Branch/Semester Shards\n");
+        printf("4. Export Database to Arrow IPC ('%s')\n", ARROW_EXPORT_FILE);
+        printf("5. Export Database to Excel ('%s')\n", XLSX_EXPORT_FILE);
+        printf("6. Return to Admin Menu\n\n");
+        printf("Enter Your Choice : ");
+
+        if (scanf("%d", &choice) != 1)
+        {
+            printf("Invalid Input! Please Enter a Number.\n");
+            clearInputBuffer();
+            continue;
+        }
+
+        switch (choice)
+        {
+        case 1:
+            if (recordStore != NULL)
+            {
+                printf("The Database Already Uses the Record Store.\n");
+                break;
+            }
+            if (shardedStorage)
+            {
+                printf("A Sharded Database Cannot Use the Record Store.\n");
+                break;
+            }
+
+            // Make sure no CSV save is still pending before switching
+            stopBackgroundSaver();
+
+            if (convertToRecordStore() == 0)
+            {
+                printf("Database Converted to %s. Edits Now Write Only the Changed Record.\n", RECORD_STORE_FILE);
+            }
+            startBackgroundSaver();
+            break;
+
+        case 2:
+            loadAllShards();
+            saveToCSV();
+            csvExportPending = 0;
+            break;
+
+        case 3:
+            if (shardedStorage || recordStore != NULL)
+            {
+                printf("Only a Database Stored in %s Can Be Split into Shards.\n", DATABASE_FILE);
+                break;
+            }
+
+            stopBackgroundSaver();
+            if (convertToShards() == 0)
+            {
+                printf("Database Split into %d Shards Listed in %s. Edits Now Rewrite Only Their Shard.\n", shardCount, SHARD_MANIFEST_FILE);
+            }
+            startBackgroundSaver();
+            break;
+
+        case 4:
+            loadAllShards();
+            exportArrowStudents(ARROW_EXPORT_FILE, students, NULL, studentCount);
+            break;
+
+        case 5:
+            loadAllShards();
+            exportXlsx(XLSX_EXPORT_FILE, XLSX_STUDENT_LIST, 0, students, studentGrades, NULL, studentCount);
+            break;
+
+        case 6:
+            return;
+
+        default:
+            printf("Invalid Choice! Please Select a Valid Option.\n");
+        }
+    }
+}
+
+
+
+
+/*
+hashRollNo - FNV-1a hash of a roll number, used by the roll number index.
+*/
+static unsigned int hashRollNo(const char *rollNo)
+{
+    unsigned int hash = 2166136261u;
+
+    while (*rollNo)
+    {
+        hash ^= (unsigned char)*rollNo++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+
+
+
+/*
+insertRollIndex - Adds rows[index] to a roll number index (open addressing, linear probing).
+
+An index holds (index in rows + 1) in each used slot and 0 in empty slots; size is a power of two larger than the number of rows.
+*/
+static void insertRollIndex(int *index, int size, const Student *rows, int row)
+{
+    unsigned int slot = hashRollNo(rows[row].rollNo) & (size - 1);
+
+    while (index[slot] != 0)
+    {
+        slot = (slot + 1) & (size - 1);
+    }
+    index[slot] = row + 1;
+}
+
+
+
+
+/*
+lookupRollIndex - Finds a roll number in a roll number index.
+
+Returns:
+- The index of the student in rows, -1 if no student has this roll number.
+*/
+static int lookupRollIndex(const int *index, int size, const Student *rows, const char *rollNo)
+{
+    unsigned int slot = hashRollNo(rollNo) & (size - 1);
+
+    while (index[slot] != 0)
+    {
+        int row = index[slot] - 1;
+
+        if (strcmp(rows[row].rollNo, rollNo) == 0)
+        {
+            return row;
+        }
+        slot = (slot + 1) & (size - 1);
+    }
+    return -1;
+}
+
+
+
+
+/*
+buildRollIndex - Rebuilds the roll number index from the students array.
+
+It must be called whenever students move inside the array, i.e. after loading and committing.
+*/
+void buildRollIndex()
+{
+    memset(rollIndex, 0, sizeof(rollIndex));
+
+    for (int i = 0; i < studentCount; i++)
+    {
+        insertRollIndex(rollIndex, ROLL_INDEX_SIZE, students, i);
+    }
+}
+
+
+
+
+/*
+findStudentByRoll - Finds a student by roll number using the roll number index.
+
+Only the students already in the students array are searched; with sharded storage use locateStudent() for a roll number
+typed by the admin or a student.
+
+Returns:
+- The index of the student in the students array, -1 if no student has this roll number.
+*/
+int findStudentByRoll(const char *rollNo)
+{
+    return lookupRollIndex(rollIndex, ROLL_INDEX_SIZE, students, rollNo);
+}
+
+
+
+
+/*
+locateStudent - Finds a student by roll number, loading the shards whose roll range may hold it if it is not loaded yet.
+
+Without sharded storage it is findStudentByRoll(). Loading a shard may unload other saved shards to make room,
+so an index found before this call may no longer be valid after it.
+
+Returns:
+- The index of the student in the students array, -1 if no student has this roll number.
+*/
+int locateStudent(const char *rollNo)
+{
+    int index = findStudentByRoll(rollNo);
+
+    if (index == -1 && shardedStorage && loadShardsForRoll(rollNo) > 0)
+    {
+        index = findStudentByRoll(rollNo);
+    }
+    return index;
+}
+
+
+
+
+/*
+initDatabase - Prepares an empty database context for a CSV file. Nothing is read until loadDatabase() is called.
+*/
+void initDatabase(Database *db, const char *fileName)
+{
+    memset(db, 0, sizeof(Database));
+    snprintf(db->fileName, MAX_LINE_LENGTH, "%s", fileName);
+    db->schema = subjectMarks;
+    db->schemaCount = TOTAL_SUBJECTS;
+}
+
+
+
+
+/*
+loadDatabase - Loads a database context from its CSV file, builds its roll number index and grades every student.
+
+The function only touches the context and read-only shared tables and prints nothing, so different contexts can be
+loaded at the same time from different threads. mapSubjectColumns() must have been called once before.
+Unlike the interactive database, the number of students is only limited by memory.
+
+Returns:
+- 0 on success, -1 if the file could not be opened, -2 if there is not enough memory.
+*/
+int loadDatabase(Database *db)
+{
+    char line[MAX_LINE_LENGTH];
+    Student s;
+    FILE *fp = fopen(db->fileName, "r");
+
+    if (fp == NULL)
+    {
+        return -1;
+    }
+
+    if (fgets(line, MAX_LINE_LENGTH, fp) != NULL) // Skip the header line
+    {
+        skipLongLine(line, fp);
+    }
+
+    while (fgets(line, MAX_LINE_LENGTH, fp))
+    {
+        if (skipLongLine(line, fp))
+        {
+            db->longLines++;
+            continue;
+        }
+        if (!parseStudentLine(line, &s))
+        {
+            continue;
+        }
+
+        if (db->count == db->capacity)
+        {
+            int capacity = (db->capacity > 0) ? db->capacity * 2 : 64;
+            Student *rows = realloc(db->students, capacity * sizeof(Student));
+
+            if (rows == NULL)
+            {
+                fclose(fp);
+                return -2;
+            }
+            db->students = rows;
+            db->capacity = capacity;
+        }
+        db->students[db->count++] = s;
+    }
+    fclose(fp);
+
+    // Roll number index, at most half full
+    db->rollIndexSize = 16;
+    while (db->rollIndexSize < 2 * db->count)
+    {
+        db->rollIndexSize *= 2;
+    }
+    db->rollIndex = calloc(db->rollIndexSize, sizeof(int));
+    db->grades = malloc((db->count > 0 ? db->count : 1) * sizeof(StudentGrades));
+    if (db->rollIndex == NULL || db->grades == NULL)
+    {
+        return -2;
+    }
+
+    for (int i = 0; i < db->count; i++)
+    {
+        insertRollIndex(db->rollIndex, db->rollIndexSize, db->students, i);
+        gradeStudent(&db->students[i], &db->grades[i]);
+    }
+    return 0;
+}
+
+
+
+
+/*
+findDatabaseStudent - Finds a student of a loaded database context by roll number.
+
+Returns:
+- The index of the student in db->students, -1 if no student has this roll number.
+*/
+int findDatabaseStudent(const Database *db, const char *rollNo)
+{
+    if (db->rollIndex == NULL)
+    {
+        return -1;
+    }
+    return lookupRollIndex(db->rollIndex, db->rollIndexSize, db->students, rollNo);
+}
+
+
+
+
+/*
+freeDatabase - Frees the students, grades and index owned by a database context and leaves it empty.
+*/
+void freeDatabase(Database *db)
+{
+    free(db->students);
+    free(db->grades);
+    free(db->rollIndex);
+    db->students = NULL;
+    db->grades = NULL;
+    db->rollIndex = NULL;
+    db->count = 0;
+    db->capacity = 0;
+}
+
+
+
+
+/* BulkMarkEntry - One staged row of a bulk marks entry */
+typedef struct
+{
+    char rollNo[MAX_ROLLNO_LENGTH]; // Roll number of the student, looked up again when the entries are applied
+    int marks;                      // New marks for the chosen mark column
+    int line;                       // Line of the input the entry came from, for the error report
+
+} BulkMarkEntry;
+
+
+
+/*
+stageBulkMarkLine - Parses one "RollNo,Marks" line of a bulk marks entry and stages it.
+
+Roll number and marks may be separated by a comma, a tab or spaces. The roll number is looked up in the roll number index
+and the marks are checked against the maximum marks of the column; a student appearing twice is rejected, the first entry wins.
+The entries are applied as one transaction, so lines after the first MAX_TRANSACTION_OPS entries are rejected.
+
+Returns:
+- 1 if the entry was staged, 0 if the line is blank or a header, -1 if it was rejected (the reason is printed).
+*/
+static int stageBulkMarkLine(char *line, int lineNumber, int column, BulkMarkEntry *entries, int *entryCount)
+{
+    char *separator;
+    char *marksText;
+    char *end;
+    long marks;
+    int index;
+
+    line[strcspn(line, "\r\n")] = 0;
+    trim(line);
+    if (line[0] == '\0')
+    {
+        return 0;
+    }
+
+    separator = line + strcspn(line, ", \t");
+    if (*separator == '\0')
+    {
+        printf("  Line %-4d %-20s Missing Marks\n", lineNumber, line);
+        return -1;
+    }
+    *separator = '\0';
+    marksText = separator + 1;
+    trim(line);
+    trim(marksText);
+    if (*marksText == ',')
+    {
+        marksText++;
+        trim(marksText);
+    }
+
+    marks = strtol(marksText, &end, 10);
+    if (end == marksText || *end != '\0')
+    {
+        if (lineNumber == 1)
+        {
+            return 0; // Header line such as "RollNo,Marks"
+        }
+        printf("  Line %-4d %-20s Marks '%s' Is Not a Number\n", lineNumber, line, marksText);
+        return -1;
+    }
+
+    if (locateStudent(line) == -1)
+    {
+        printf("  Line %-4d %-20s No Such Roll Number\n", lineNumber, line);
+        return -1;
+    }
+    if (marks < 0 || marks > markColumnMax(column))
+    {
+        printf("  Line %-4d %-20s Marks %ld Out of Range (0 - %d)\n", lineNumber, line, marks, markColumnMax(column));
+        return -1;
+    }
+    for (index = 0; index < *entryCount; index++)
+    {
+        if (strcmp(entries[index].rollNo, line) == 0)
+        {
+            printf("  Line %-4d %-20s Duplicate Entry (Line %d Is Used)\n", lineNumber, line, entries[index].line);
+            return -1;
+        }
+    }
+    if (*entryCount == MAX_TRANSACTION_OPS)
+    {
+        printf("  Line %-4d %-20s More Than %d Entries (One Transaction)\n", lineNumber, line, MAX_TRANSACTION_OPS);
+        return -1;
+    }
+
+    if (strlen(line) >= MAX_ROLLNO_LENGTH) // Matched by locateStudent(), so it always fits; checked rather than cut
+    {
+        printf("  Line %-4d %-20s No Such Roll Number\n", lineNumber, line);
+        return -1;
+    }
+    memcpy(entries[*entryCount].rollNo, line, strlen(line) + 1);
+    entries[*entryCount].marks = (int)marks;
+    entries[*entryCount].line = lineNumber;
+    (*entryCount)++;
+    return 1;
+}
+
+
+
+
+/*
+bulkMarksEntry - Enters one subject's marks for many students in one transaction.
+
+The admin picks a mark column and supplies "RollNo,Marks" lines, either from a file (e.g. a column exported from MS Excel)
+or typed at the prompt. Every line is validated first and the rejected lines are reported together. After confirmation all
+valid entries are committed as one transaction by commitTransaction() : readers see the new snapshot with all of them or none,
+grades are recomputed for the touched students only, and the database is persisted once instead of once per student.
+*/
+void bulkMarksEntry()
+{
+    BulkMarkEntry entries[MAX_TRANSACTION_OPS];
+    int entryCount = 0;
+    int rejected = 0;
+    int lineNumber = 0;
+    int column, source, i;
+    char line[MAX_LINE_LENGTH];
+    char columnName[MAX_LINE_LENGTH];
+    FILE *fp = NULL;
+
+    printf("\n===== Bulk Marks Entry (One Subject) =====\n\n");
+    for (i = 0; i < NUM_MARK_COLUMNS; i++)
+    {
+        markColumnName(i, columnName);
+        printf("%2d. %-40s (Max %d)\n", i + 1, columnName, markColumnMax(i));
+    }
+    printf("\nSelect Marks Column : ");
+    if (scanf("%d", &column) != 1 || column < 1 || column > NUM_MARK_COLUMNS)
+    {
+        printf("Invalid Column!\n");
+        clearInputBuffer();
+        return;
+    }
+    column--;
+    markColumnName(column, columnName);
+
+    printf("\n1. Read RollNo,Marks Lines From a File\n");
+    printf("2. Type RollNo,Marks Lines (Empty Line to Finish)\n\n");
+    printf("Enter Your Choice : ");
+    if (scanf("%d", &source) != 1 || (source != 1 && source != 2))
+    {
+        printf("Invalid Choice!\n");
+        clearInputBuffer();
+        return;
+    }
+    clearInputBuffer();
+
+    if (source == 1)
+    {
+        printf("Enter File Name : ");
+        if (fgets(line, MAX_LINE_LENGTH, stdin) == NULL)
+        {
+            return;
+        }
+        line[strcspn(line, "\n")] = 0;
+        trim(line);
+
+        fp = fopen(line, "r");
+        if (fp == NULL)
+        {
+            printf("Error Opening %s!\n", line);
+            return;
+        }
+    }
+
+    printf("\nValidating Entries for %s...\n", columnName);
+    while (fgets(line, MAX_LINE_LENGTH, fp != NULL ? fp : stdin) != NULL)
+    {
+        lineNumber++;
+        if (fp == NULL && (line[0] == '\n' || line[0] == '\r'))
+        {
+            break;
+        }
+
+        if (stageBulkMarkLine(line, lineNumber, column, entries, &entryCount) < 0)
+        {
+            rejected++;
+        }
+    }
+    if (fp != NULL)
+    {
+        fclose(fp);
+    }
+
+    printf("\n%d Valid Entries, %d Rejected.\n", entryCount, rejected);
+    if (entryCount == 0)
+    {
+        printf("Nothing to Apply.\n");
+        return;
+    }
+
+    printf("Apply %d Entries to %s? (y/n) : ", entryCount, columnName);
+    if (fgets(line, MAX_LINE_LENGTH, stdin) == NULL || (line[0] != 'y' && line[0] != 'Y'))
+    {
+        printf("Bulk Entry Cancelled. No Marks Were Changed.\n");
+        return;
+    }
+
+    // Commit every entry in one transaction so no reader ever sees a half applied column
+    Transaction txn;
+
+    beginTransaction(&txn);
+    for (i = 0; i < entryCount; i++)
+    {
+        // With sharded storage a later line may have unloaded the student's shard, so the student is located again
+        int index = locateStudent(entries[i].rollNo);
+        if (index == -1)
+        {
+            printf("Roll No %s Is No Longer in the Database. No Marks Were Changed.\n", entries[i].rollNo);
+            return;
+        }
+
+        Student updated = students[index];
+
+        setMarkColumnValue(&updated, column, entries[i].marks);
+        if (stageOperation(&txn, TXN_UPDATE, &updated) != 0)
+        {
+            printf("Error : One Bulk Entry Can Update at Most %d Students. No Marks Were Changed.\n", MAX_TRANSACTION_OPS);
+            return;
+        }
+    }
+
+    if (commitTransaction(&txn) == 0)
+    {
+        printf("Marks of %d Students Updated in %s.\n", entryCount, columnName);
+    }
+}
+
+
+
+
+/*
+acquireSnapshot - Takes a reference on the current store snapshot.
+
+The read path takes no lock : the reader announces itself in snapshotReaders while it loads currentSnapshot and increments
+the snapshot's reference count, and a commit waits for snapshotReaders to drop to zero before it releases the old version.
+The snapshot never changes while it is held, so a reader always sees whole transactions.
+*/
+StoreSnapshot *acquireSnapshot()
+{
+    InterlockedIncrement(&snapshotReaders);
+    StoreSnapshot *snapshot = currentSnapshot;
+    InterlockedIncrement(&snapshot->refCount);
+    InterlockedDecrement(&snapshotReaders);
+
+    return snapshot;
+}
+
+
+
+
+/*
+releaseSnapshot - Drops a reference on a snapshot. The last reference frees the snapshot and the pages no other snapshot uses.
+*/
+void releaseSnapshot(StoreSnapshot *snapshot)
+{
+    if (InterlockedDecrement(&snapshot->refCount) != 0)
+    {
+        return;
+    }
+
+    for (int p = 0; p < STORE_PAGE_COUNT && snapshot->pages[p] != NULL; p++)
+    {
+        if (InterlockedDecrement(&snapshot->pages[p]->refCount) == 0)
+        {
+            free(snapshot->pages[p]);
+        }
+    }
+    free(snapshot);
+}
+
+
+
+
+/*
+snapshotRow - Returns the student at an index of a snapshot.
+*/
+const Student *snapshotRow(const StoreSnapshot *snapshot, int index)
+{
+    return &snapshot->pages[index / STORE_PAGE_ROWS]->rows[index % STORE_PAGE_ROWS];
+}
+
+
+
+
+/*
+buildSnapshot - Builds a new store snapshot from an array of students.
+
+Pages whose students are identical in the current snapshot are shared with it (copy-on-write), so a commit only copies the pages it changed.
+Only the main thread replaces currentSnapshot, so it can read it here without taking a reference.
+
+Returns:
+- The new snapshot with one reference, NULL if there is not enough memory.
+*/
+static StoreSnapshot *buildSnapshot(const Student *rows, int count)
+{
+    StoreSnapshot *old = currentSnapshot;
+    StoreSnapshot *snapshot = calloc(1, sizeof(StoreSnapshot));
+
+    if (snapshot == NULL)
+    {
+        return NULL;
+    }
+    snapshot->refCount = 1;
+    snapshot->count = count;
+
+    for (int p = 0; p * STORE_PAGE_ROWS < count; p++)
+    {
+        const Student *pageRows = &rows[p * STORE_PAGE_ROWS];
+        int pageCount = (count - p * STORE_PAGE_ROWS < STORE_PAGE_ROWS) ? count - p * STORE_PAGE_ROWS : STORE_PAGE_ROWS;
+        int oldPageCount = (old != NULL) ? old->count - p * STORE_PAGE_ROWS : 0;
+
+        if (oldPageCount > STORE_PAGE_ROWS)
+        {
+            oldPageCount = STORE_PAGE_ROWS;
+        }
+
+        // Share the page if none of its students changed
+        if (oldPageCount == pageCount && memcmp(old->pages[p]->rows, pageRows, pageCount * sizeof(Student)) == 0)
+        {
+            InterlockedIncrement(&old->pages[p]->refCount);
+            snapshot->pages[p] = old->pages[p];
+            continue;
+        }
+
+        snapshot->pages[p] = malloc(sizeof(StorePage));
+        if (snapshot->pages[p] == NULL)
+        {
+            releaseSnapshot(snapshot);
+            return NULL;
+        }
+        snapshot->pages[p]->refCount = 1;
+        memcpy(snapshot->pages[p]->rows, pageRows, pageCount * sizeof(Student));
+    }
+
+    return snapshot;
+}
+
+
+
+
+/*
+installSnapshot - Makes a snapshot the current store version and releases the previous one.
+*/
+static void installSnapshot(StoreSnapshot *snapshot)
+{
+    snapshot->version = ++storeVersion;
+    StoreSnapshot *old = InterlockedExchangePointer((PVOID volatile *)&currentSnapshot, snapshot);
+
+    if (old == NULL)
+    {
+        return;
+    }
+
+    // Grace period : a reader that loaded the old pointer has taken its reference once snapshotReaders is zero
+    while (snapshotReaders != 0)
+    {
+        Sleep(0);
+    }
+    releaseSnapshot(old);
+}
+
+
+
+
+/*
+publishSnapshot - Publishes the students array as the current store snapshot, e.g. after the database is loaded.
+
+Returns:
+- 0 on success, -1 if there is not enough memory (the previous snapshot stays current).
+*/
+int publishSnapshot()
+{
+    StoreSnapshot *snapshot = buildSnapshot(students, studentCount);
+
+    if (snapshot == NULL)
+    {
+        return -1;
+    }
+    installSnapshot(snapshot);
+    return 0;
+}
+
+
+
+
+/*
+beginTransaction - Starts an empty transaction.
+*/
+void beginTransaction(Transaction *txn)
+{
+    txn->count = 0;
+}
+
+
+
+
+/*
+stageOperation - Stages an add, update or delete. Nothing is changed until commitTransaction() is called.
+
+Returns:
+- 0 on success, -1 if the transaction already holds MAX_TRANSACTION_OPS operations.
+*/
+int stageOperation(Transaction *txn, TransactionOpType type, const Student *s)
+{
+    if (txn->count >= MAX_TRANSACTION_OPS)
+    {
+        return -1;
+    }
+
+    txn->ops[txn->count].type = type;
+    txn->ops[txn->count].student = *s;
+    txn->count++;
+    return 0;
+}
+
+
+
+
+/*
+stagedStudent - Looks up a student as the transaction would leave it.
+
+The last staged operation on the roll number wins; without one, the committed student is returned.
+
+Returns:
+- 1 if the student exists (s is filled in), 0 if it does not or the transaction deletes it.
+*/
+int stagedStudent(const Transaction *txn, const char *rollNo, Student *s)
+{
+    for (int k = txn->count - 1; k >= 0; k--)
+    {
+        if (strcmp(txn->ops[k].student.rollNo, rollNo) == 0)
+        {
+            if (txn->ops[k].type == TXN_DELETE)
+            {
+                return 0;
+            }
+            *s = txn->ops[k].student;
+            return 1;
+        }
+    }
+
+    int index = locateStudent(rollNo);
+    if (index == -1)
+    {
+        return 0;
+    }
+    *s = students[index];
+    return 1;
+}
+
+
+
+
+/*
+findRowByRoll - Linear search of a roll number in a working copy of the students array, used while a transaction is applied.
+*/
+static int findRowByRoll(const Student *rows, int count, const char *rollNo)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (strcmp(rows[i].rollNo, rollNo) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+
+
+/*
+commitTransaction - Applies all staged operations atomically as a new version of the store.
+
+The operations are applied in order to a working copy of the students and their record store slots. If any of them fails
+(marks out of range, duplicate roll number, unknown roll number, database full) or memory runs out, nothing is changed. Otherwise the working
+copy replaces the students array and is published as a new snapshot in one step, so readers see all of the transaction or none of it.
+The database is then persisted once : one CSV save, one rewrite of each changed shard with sharded storage,
+or one record write per changed student with the record store.
+
+Returns:
+- 0 if the transaction was committed, -1 if it was rolled back (the reason is printed).
+*/
+int commitTransaction(Transaction *txn)
+{
+    Student *rows = malloc(MAX_STUDENTS * sizeof(Student));
+    int slots[MAX_STUDENTS];
+    int deletedSlots[MAX_TRANSACTION_OPS];
+    int deletedCount = 0;
+    unsigned char loadedShards[MAX_SHARDS] = {0}; // Shards loaded for the transaction, unloaded again if it is rolled back
+    int shardsBefore = shardCount;
+    int count;
+    int k, index;
+
+    if (rows == NULL)
+    {
+        printf("Error : Not Enough Memory. Transaction Rolled Back.\n");
+        return -1;
+    }
+
+    // With sharded storage, every shard the transaction touches must be loaded so it can be checked and rewritten whole
+    if (shardedStorage && loadShardsForTransaction(txn, loadedShards) != 0)
+    {
+        printf("Transaction Rolled Back.\n");
+        dropTransactionShards(loadedShards, shardsBefore);
+        free(rows);
+        return -1;
+    }
+
+    // Every added or updated student is checked against the maximum marks in one pass before anything is applied
+    Student checked[MAX_TRANSACTION_OPS];
+    unsigned int invalid[MAX_TRANSACTION_OPS];
+    unsigned int changed[MAX_TRANSACTION_OPS]; // Mark columns each op sets, an update only answers for the columns it changes
+    int checkedCount = 0, bad = 0;
+
+    for (k = 0; k < txn->count; k++)
+    {
+        if (txn->ops[k].type == TXN_DELETE)
+        {
+            continue;
+        }
+
+        changed[checkedCount] = ALL_MARK_COLUMNS;
+        index = txn->ops[k].type == TXN_UPDATE ? findStudentByRoll(txn->ops[k].student.rollNo) : -1;
+        if (index != -1)
+        {
+            changed[checkedCount] = changedMarkColumns(&txn->ops[k].student, &students[index]);
+        }
+        checked[checkedCount++] = txn->ops[k].student;
+    }
+    validateMarkRows(checked, checkedCount, invalid);
+    for (k = 0; k < checkedCount; k++)
+    {
+        invalid[k] &= changed[k]; // Marks already out of range before the transaction are left as they are
+        bad += (invalid[k] != 0);
+    }
+    if (bad > 0)
+    {
+        printf("Changed Marks Out of Range (Valid Marks Are 0 to the Maximum Marks) :\n");
+        printMarkErrors(stdout, checked, checkedCount, invalid);
+        printf("Transaction Rolled Back.\n");
+        if (shardedStorage)
+        {
+            dropTransactionShards(loadedShards, shardsBefore);
+        }
+        free(rows);
+        return -1;
+    }
+
+    count = studentCount;
+    memcpy(rows, students, count * sizeof(Student));
+    memcpy(slots, studentSlots, count * sizeof(int));
+
+    for (k = 0; k < txn->count; k++)
+    {
+        const TransactionOp *op = &txn->ops[k];
+        const char *failure = NULL;
+
+        index = findRowByRoll(rows, count, op->student.rollNo);
+
+        switch (op->type)
+        {
+        case TXN_ADD:
+            if (index != -1)
+                failure = "Roll Number Already Exists";
+            else if (count >= MAX_STUDENTS)
+                failure = "Maximum Limit Reached";
+            else
+            {
+                rows[count] = op->student;
+                slots[count] = -1;
+                count++;
+            }
+            break;
+
+        case TXN_UPDATE:
+            if (index == -1)
+                failure = "Roll Number Not Found";
+            else
+                rows[index] = op->student;
+            break;
+
+        case TXN_DELETE:
+            if (index == -1)
+                failure = "Roll Number Not Found";
+            else
+            {
+                deletedSlots[deletedCount++] = slots[index];
+                memmove(&rows[index], &rows[index + 1], (count - index - 1) * sizeof(Student));
+                memmove(&slots[index], &slots[index + 1], (count - index - 1) * sizeof(int));
+                count--;
+            }
+            break;
+        }
+
+        if (failure != NULL)
+        {
+            printf("Operation %d (Roll No %s) Failed : %s. Transaction Rolled Back.\n", k + 1, op->student.rollNo, failure);
+            if (shardedStorage)
+            {
+                dropTransactionShards(loadedShards, shardsBefore);
+            }
+            free(rows);
+            return -1;
+        }
+    }
+
+    StoreSnapshot *snapshot = buildSnapshot(rows, count);
+    if (snapshot == NULL)
+    {
+        printf("Error : Not Enough Memory. Transaction Rolled Back.\n");
+        if (shardedStorage)
+        {
+            dropTransactionShards(loadedShards, shardsBefore);
+        }
+        free(rows);
+        return -1;
+    }
+
+    // Commit point : the new version replaces the old one for the main thread and for snapshot readers
+    memcpy(students, rows, count * sizeof(Student));
+    memcpy(studentSlots, slots, count * sizeof(int));
+    studentCount = count;
+    free(rows);
+    buildRollIndex();
+    installSnapshot(snapshot);
+
+    invalidateRanks();
+    if (deletedCount > 0)
+    {
+        computeGrades(0, studentCount); // Students after a deleted one have moved
+    }
+    else
+    {
+        for (k = 0; k < txn->count; k++)
+        {
+            index = findStudentByRoll(txn->ops[k].student.rollNo);
+            computeGrades(index, index + 1);
+        }
+    }
+
+    // Stream the committed version to the followers and record it in the session trace
+    for (k = 0; k < txn->count; k++)
+    {
+        replicateChange(txn->ops[k].type, &txn->ops[k].student);
+        traceEdit(&txn->ops[k]);
+    }
+
+    // Persist the new version
+    if (shardedStorage)
+    {
+        markShardsChanged(txn);
+    }
+    if (recordStore == NULL)
+    {
+        stampRecords(txn);
+        requestSave();
+        return 0;
+    }
+
+    for (k = 0; k < deletedCount; k++)
+    {
+        if (deletedSlots[k] >= 0) // Students added and deleted in the same transaction were never written
+        {
+            deleteStudentRecord(deletedSlots[k]);
+        }
+    }
+    for (k = 0; k < txn->count; k++)
+    {
+        index = findStudentByRoll(txn->ops[k].student.rollNo);
+        if (txn->ops[k].type != TXN_DELETE && index != -1)
+        {
+            saveStudentRecord(index);
+        }
+    }
+    return 0;
+}
+
+
+
+
+/*
+printStagedOperations - Lists the operations staged in a transaction.
+*/
+static void printStagedOperations(const Transaction *txn)
+{
+    static const char *opNames[] = {"Add", "Update", "Delete"};
+
+    printf("\n===== Staged Changes (%d) =====\n\n", txn->count);
+    printf("No.   Operation   Roll No             Name\n");
+    printf("------------------------------------------------------------------\n");
+    for (int k = 0; k < txn->count; k++)
+    {
+        const Student *s = &txn->ops[k].student;
+        printf("%-5d %-11s %-20s%s\n", k + 1, opNames[txn->ops[k].type], s->rollNo, txn->ops[k].type == TXN_DELETE ? "" : s->name);
+    }
+    printf("------------------------------------------------------------------\n");
+}
+
+
+
+
+/*
+batchEdit - Stages several adds, updates and deletes and commits them together.
+
+Nothing is written until the admin commits : the whole batch is then applied as one new version of the store,
+or rolled back entirely if any operation fails. Updates and deletes see the students staged earlier in the batch.
+*/
+void batchEdit()
+{
+    Transaction txn;
+    Student s;
+    char rollNo[MAX_ROLLNO_LENGTH];
+    int choice;
+
+    beginTransaction(&txn);
+
+    while (1)
+    {
+        printf("\n===== Batch Edit (Transaction) =====\n\n");
+        printf("Staged Operations : %d of %d\n\n", txn.count, MAX_TRANSACTION_OPS);
+        printf("1. Stage Add Student\n");
+        printf("2. Stage Update Student\n");
+        printf("3. Stage Delete Student\n");
+        printf("4. View Staged Changes\n");
+        printf("5. Commit\n");
+        printf("6. Discard and Return to Admin Menu\n\n");
+        printf("Enter Your Choice : ");
+
+        if (scanf("%d", &choice) != 1)
+        {
+            printf("Invalid Input! Please Enter a Number.\n");
+            clearInputBuffer();
+            continue;
+        }
+
+        if (choice >= 1 && choice <= 3 && txn.count >= MAX_TRANSACTION_OPS)
+        {
+            printf("The Transaction Is Full. Commit or Discard It First.\n");
+            continue;
+        }
+
+        switch (choice)
+        {
+        case 1:
+            if (readNewStudent(&s))
+            {
+                stageOperation(&txn, TXN_ADD, &s);
+                printf("Add of %s Staged.\n", s.rollNo);
+            }
+            break;
+
+        case 2:
+        case 3:
+            printf("Enter Student Roll Number : ");
+            scanf("%s", rollNo);
+            clearInputBuffer();
+
+            if (!stagedStudent(&txn, rollNo, &s))
+            {
+                printf("Student with Roll Number %s not found.\n", rollNo);
+                break;
+            }
+
+            if (choice == 3)
+            {
+                stageOperation(&txn, TXN_DELETE, &s);
+                printf("Delete of %s Staged.\n", rollNo);
+            }
+            else if (editStudentCopy(&s))
+            {
+                stageOperation(&txn, TXN_UPDATE, &s);
+                printf("\nUpdate of %s Staged.\n", rollNo);
+            }
+            break;
+
+        case 4:
+            printStagedOperations(&txn);
+            break;
+
+        case 5:
+            if (txn.count == 0)
+            {
+                printf("Nothing to Commit.\n");
+                break;
+            }
+            if (commitTransaction(&txn) == 0)
+            {
+                printf("%d Operations Committed as Store Version %ld.\n", txn.count, storeVersion);
+                beginTransaction(&txn);
+            }
+            break;
+
+        case 6:
+            if (txn.count > 0)
+            {
+                printf("%d Staged Operations Discarded.\n", txn.count);
+            }
+            return;
+
+        default:
+            printf("Invalid Choice! Please Select a Valid Option.\n");
+        }
+    }
+}
+
+
+
+
+// CampusJob - Structure describing the database loaded and summarized by one campus report worker
+typedef struct
+{
+    Database db;                                   // Context of the database, freed after it is summarized
+    int students;                                  // Students in the database
+    int status;                                    // Result of loadDatabase(), or 1 while not loaded
+    int matched;                                   // Students matching the query (all students without a query)
+    int passed;                                    // Matched students who passed every subject
+    long long totalMarks;                          // Sum of the total marks of the matched students
+    double totalSgpa;                              // Sum of the SGPA of the matched students
+    long long subjectMarksSum[TOTAL_SUBJECTS];     // Sum of theory + practical marks per subject
+    Student topper;                                // Matched student with the highest total marks
+    int topperTotal;                               // Total marks of the topper, -1 if no student matched
+    MarkSketch sketch;                             // Quantile sketch of the matched students
+
+} CampusJob;
+
+
+
+// CampusWork - Work shared by the campus report workers
+typedef struct
+{
+    CampusJob *jobs;
+    int jobCount;
+    volatile LONG nextJob;          // Next job to take, incremented by each worker
+    const CompiledQuery *query;     // Compiled query, NULL to include every student
+
+} CampusWork;
+
+
+
+
+/*
+summarizeCampusJob - Loads one database of the campus report, runs the query on it and summarizes the matched students.
+*/
+static void summarizeCampusJob(CampusJob *job, const CompiledQuery *query)
+{
+    Database *db = &job->db;
+    int *matches = NULL;
+    int count;
+    FileSignature signature;
+
+    fileSignature(db->fileName, &signature);
+    job->status = loadDatabase(db);
+    job->topperTotal = -1;
+    if (job->status != 0)
+    {
+        freeDatabase(db);
+        return;
+    }
+
+    count = db->count;
+    if (query != NULL)
+    {
+        matches = malloc((db->count > 0 ? db->count : 1) * sizeof(int));
+        count = (matches != NULL) ? runQuery(query, db->students, db->grades, db->count, matches) : -1;
+        if (count < 0)
+        {
+            job->status = -2;
+            free(matches);
+            freeDatabase(db);
+            return;
+        }
+    }
+
+    for (int k = 0; k < count; k++)
+    {
+        int i = (matches != NULL) ? matches[k] : k;
+        const Student *s = &db->students[i];
+        int total = studentTotalMarks(s);
+
+        job->matched++;
+        job->passed += db->grades[i].passed;
+        job->totalMarks += total;
+        job->totalSgpa += db->grades[i].sgpa;
+        for (int sub = 0; sub < db->schemaCount; sub++)
+        {
+            job->subjectMarksSum[sub] += subjectTotalMarks(s, sub);
+        }
+        if (total > job->topperTotal)
+        {
+            job->topperTotal = total;
+            job->topper = *s;
+        }
+    }
+
+    // Without a query the sketch describes the whole file and is saved next to it for later percentile queries
+    addToMarkSketch(&job->sketch, db->students, matches, count);
+    if (query == NULL)
+    {
+        saveMarkSketch(db->fileName, &signature, &job->sketch);
+    }
+
+    job->students = db->count;
+    free(matches);
+    freeDatabase(db);
+}
+
+
+
+
+/*
+campusReportThread - Thread function of a campus report worker. Workers take databases until none is left.
+*/
+DWORD WINAPI campusReportThread(LPVOID param)
+{
+    CampusWork *work = (CampusWork *)param;
+    int job;
+
+    while ((job = InterlockedIncrement(&work->nextJob) - 1) < work->jobCount)
+    {
+        summarizeCampusJob(&work->jobs[job], work->query);
+    }
+    return 0;
+}
+
+
+
+
+/*
+printCampusReport - Prints the per-database and campus-wide summary of a campus report.
+*/
+static void printCampusReport(FILE *fp, const CampusJob *jobs, int jobCount, int hasQuery)
+{
+    int matched = 0, passed = 0, students = 0;
+    long long totalMarks = 0;
+    double totalSgpa = 0;
+    long long subjectSum[TOTAL_SUBJECTS] = {0};
+    const CampusJob *topper = NULL;
+    MarkSketch campusSketch; // Sketches of every database merged
+
+    clearMarkSketch(&campusSketch);
+
+    fprintf(fp, "===== Campus-Wide Report =====\n\n");
+    fprintf(fp, "%-32s %-10s %-10s %-10s %-9s %-8s %s\n", "Database", "Students", hasQuery ? "Matched" : "", "Avg Total", "Avg SGPA", "Pass %", "Topper");
+    fprintf(fp, "---------------------------------------------------------------------------------------------------------------\n");
+
+    for (int j = 0; j < jobCount; j++)
+    {
+        const CampusJob *job = &jobs[j];
+
+        if (job->status != 0)
+        {
+            fprintf(fp, "%-32s %s\n", job->db.fileName, job->status == -1 ? "Error : Could Not Open File" : "Error : Not Enough Memory");
+            continue;
+        }
+
+        students += job->students;
+        matched += job->matched;
+        passed += job->passed;
+        totalMarks += job->totalMarks;
+        totalSgpa += job->totalSgpa;
+        for (int sub = 0; sub < TOTAL_SUBJECTS; sub++)
+        {
+            subjectSum[sub] += job->subjectMarksSum[sub];
+        }
+        mergeMarkSketch(&campusSketch, &job->sketch);
+        if (job->topperTotal >= 0 && (topper == NULL || job->topperTotal > topper->topperTotal))
+        {
+            topper = job;
+        }
+
+        if (job->matched == 0)
+        {
+            fprintf(fp, "%-32s %-10d %-10s No Students\n", job->db.fileName, job->students, hasQuery ? "0" : "");
+            continue;
+        }
+
+        char matchedText[16] = "";
+        if (hasQuery)
+        {
+            snprintf(matchedText, sizeof(matchedText), "%d", job->matched);
+        }
+        fprintf(fp, "%-32s %-10d %-10s %-10.2f %-9.2f %-8.1f %s (%d)\n", job->db.fileName, job->students, matchedText,
+                (double)job->totalMarks / job->matched, job->totalSgpa / job->matched, 100.0 * job->passed / job->matched,
+                job->topper.name, job->topperTotal);
+    }
+    fprintf(fp, "---------------------------------------------------------------------------------------------------------------\n");
+
+    if (matched == 0)
+    {
+        fprintf(fp, "Campus : %d Students, None Matched.\n\n", students);
+        return;
+    }
+
+    fprintf(fp, "Campus : %d Students", students);
+    if (hasQuery)
+    {
+        fprintf(fp, ", %d Matched", matched);
+    }
+    fprintf(fp, ", Average Total %.2f, Average SGPA %.2f, Pass %.1f%%\n", (double)totalMarks / matched, totalSgpa / matched, 100.0 * passed / matched);
+    fprintf(fp, "Campus Topper : %s (%s, %s/%d) with %d Marks in %s\n\n", topper->topper.name, topper->topper.rollNo,
+            topper->topper.branch, topper->topper.semester, topper->topperTotal, topper->db.fileName);
+
+    fprintf(fp, "Subject                              Campus Average   Median   Top 10%% From\n");
+    fprintf(fp, "---------------------------------------------------------------------------\n");
+    for (int sub = 0; sub < TOTAL_SUBJECTS; sub++)
+    {
+        char average[32];
+
+        snprintf(average, sizeof(average), "%.2f / %d", (double)subjectSum[sub] / matched, subjectMarks[sub].maxTheory + subjectMarks[sub].maxPractical);
+        fprintf(fp, "%-36s %-16s %-8d %d\n", subjectMarks[sub].subject, average, markSketchPercentile(&campusSketch, NUM_MARK_COLUMNS + sub, 50),
+                markSketchPercentile(&campusSketch, NUM_MARK_COLUMNS + sub, 90));
+    }
+    fprintf(fp, "---------------------------------------------------------------------------\n\n");
+}
+
+
+
+
+/*
+campusReport - Loads many databases in parallel and aggregates them into a campus-wide report.
+
+The databases (one CSV file per branch and semester) are listed one per line in a manifest file. Each database is loaded into
+its own Database context, graded and optionally filtered with a query by a pool of worker threads, one per processor.
+The summary is printed and saved to CAMPUS_REPORT_FILE. The interactive database is not changed.
+*/
+void campusReport()
+{
+    char manifest[MAX_LINE_LENGTH];
+    char line[MAX_LINE_LENGTH];
+    CompiledQuery query;
+    CampusWork work;
+    HANDLE threads[MAX_DATABASES];
+    int threadCount = 0;
+    SYSTEM_INFO info;
+
+    printf("\n===== Campus-Wide Report =====\n\n");
+    printf("Enter Database List File (or press Enter for %s) : ", CAMPUS_MANIFEST_FILE);
+    clearInputBuffer();
+    if (fgets(manifest, MAX_LINE_LENGTH, stdin) == NULL)
+    {
+        return;
+    }
+    manifest[strcspn(manifest, "\n")] = 0;
+    trim(manifest);
+    if (manifest[0] == '\0')
+    {
+        strcpy(manifest, CAMPUS_MANIFEST_FILE);
+    }
+
+    FILE *fp = fopen(manifest, "r");
+    if (fp == NULL)
+    {
+        printf("Error Opening %s! List One Database CSV File per Line.\n", manifest);
+        return;
+    }
+
+    CampusJob *jobs = calloc(MAX_DATABASES, sizeof(CampusJob));
+    if (jobs == NULL)
+    {
+        fclose(fp);
+        printf("Error : Not Enough Memory.\n");
+        return;
+    }
+
+    work.jobs = jobs;
+    work.jobCount = 0;
+    work.nextJob = 0;
+    while (fgets(line, MAX_LINE_LENGTH, fp) && work.jobCount < MAX_DATABASES)
+    {
+        line[strcspn(line, "\r\n")] = 0;
+        trim(line);
+        if (line[0] == '\0' || line[0] == '#')
+        {
+            continue;
+        }
+        initDatabase(&jobs[work.jobCount].db, line);
+        jobs[work.jobCount].status = 1;
+        work.jobCount++;
+    }
+    fclose(fp);
+
+    if (work.jobCount == 0)
+    {
+        printf("No Databases Listed in %s.\n", manifest);
+        free(jobs);
+        return;
+    }
+
+    int hasQuery = readArchiveQuery(&query);
+    if (hasQuery < 0)
+    {
+        free(jobs);
+        return;
+    }
+    work.query = hasQuery ? &query : NULL;
+
+    DWORD startTime = GetTickCount();
+    mapSubjectColumns(); // Shared by every worker, must be ready before they start
+
+    GetSystemInfo(&info);
+    int workers = (int)info.dwNumberOfProcessors;
+    if (workers > work.jobCount)
+    {
+        workers = work.jobCount;
+    }
+    for (int t = 0; t < workers; t++)
+    {
+        threads[threadCount] = CreateThread(NULL, 0, campusReportThread, &work, 0, NULL);
+        if (threads[threadCount] != NULL)
+        {
+            threadCount++;
+        }
+    }
+
+    // The current thread also takes jobs, so the report completes even if no worker could be started
+    campusReportThread(&work);
+
+    WaitForMultipleObjects(threadCount, threads, TRUE, INFINITE);
+    for (int t = 0; t < threadCount; t++)
+    {
+        CloseHandle(threads[t]);
+    }
+
+    printf("\n");
+    printCampusReport(stdout, jobs, work.jobCount, hasQuery);
+    printf("%d Databases Summarized in %lu ms.\n", work.jobCount, (unsigned long)(GetTickCount() - startTime));
+
+    fp = fopen(CAMPUS_REPORT_FILE, "w");
+    if (fp != NULL)
+    {
+        printCampusReport(fp, jobs, work.jobCount, hasQuery);
+        fclose(fp);
+        printf("Report Saved to %s\n", CAMPUS_REPORT_FILE);
+    }
+    else
+    {
+        printf("Error : Could Not Write %s.\n", CAMPUS_REPORT_FILE);
+    }
+
+    free(jobs);
+}
+
+
+
+
+/*
+shardFileName - Builds the file name of a new branch/semester shard, e.g. "students_CSE_5.csv".
+
+Characters of the branch that are not letters or digits become '_', so two branches such as "CSE/1" and "CSE_1" can give
+the same name, and so can branches differing only in case on Windows. A name already used by a shard of the table gets
+a "-2", "-3"... suffix, which a replaced name never contains, so every shard keeps its own file.
+*/
+static void shardFileName(const char *branch, int semester, char *fileName)
+{
+    char base[MAX_LINE_LENGTH - 16]; // Leaves room for the suffix and ".csv"
+    int length = snprintf(base, sizeof(base), "%s%s_%d", SHARD_FILE_PREFIX, branch, semester);
+
+    length = length < (int)sizeof(base) ? length : (int)sizeof(base) - 1;
+
+    // Keep the name valid whatever the branch contains
+    for (int i = (int)strlen(SHARD_FILE_PREFIX); i < length; i++)
+    {
+        if (!isalnum((unsigned char)base[i]) && base[i] != '_')
+        {
+            base[i] = '_';
+        }
+    }
+
+    snprintf(fileName, MAX_LINE_LENGTH, "%s.csv", base);
+    for (int copy = 2, k = 0; k < shardCount; k++)
+    {
+        if (strcasecmp(shards[k].fileName, fileName) == 0)
+        {
+            snprintf(fileName, MAX_LINE_LENGTH, "%s-%d.csv", base, copy++);
+            k = -1; // Check the new name against every shard again
+        }
+    }
+}
+
+
+
+
+/*
+findShard - Returns the index of the shard of a branch/semester partition, -1 if there is none.
+*/
+static int findShard(const char *branch, int semester)
+{
+    for (int k = 0; k < shardCount; k++)
+    {
+        if (shards[k].semester == semester && strcmp(shards[k].branch, branch) == 0)
+        {
+            return k;
+        }
+    }
+    return -1;
+}
+
+
+
+
+/*
+updateShardStatistics - Recomputes the student count and roll number range of a loaded shard from the students array.
+
+It must be called by the main thread under storeLock, since the background saver copies the shard table.
+*/
+static void updateShardStatistics(Shard *shard)
+{
+    shard->studentCount = 0;
+    shard->firstRoll[0] = '\0';
+    shard->lastRoll[0] = '\0';
+
+    for (int i = 0; i < studentCount; i++)
+    {
+        const Student *s = &students[i];
+
+        if (s->semester != shard->semester || strcmp(s->branch, shard->branch) != 0)
+        {
+            continue;
+        }
+        if (shard->studentCount == 0 || strcmp(s->rollNo, shard->firstRoll) < 0)
+        {
+            strcpy(shard->firstRoll, s->rollNo);
+        }
+        if (shard->studentCount == 0 || strcmp(s->rollNo, shard->lastRoll) > 0)
+        {
+            strcpy(shard->lastRoll, s->rollNo);
+        }
+        shard->studentCount++;
+    }
+}
+
+
+
+
+/*
+writeShardManifest - Atomically replaces SHARD_MANIFEST_FILE with a shard table.
+
+Returns:
+- 0 on success, -1 if the manifest could not be written (the old one is kept).
+*/
+static int writeShardManifest(const Shard *table, int count)
+{
+    const char *tempFileName = SHARD_MANIFEST_FILE ".tmp";
+    FILE *fp = fopen(tempFileName, "w");
+
+    if (fp == NULL)
+    {
+        printf("Error : Could Not Open %s For Writing.\n", SHARD_MANIFEST_FILE);
+        return -1;
+    }
+
+    fprintf(fp, "Branch,Semester,File,Students,FirstRoll,LastRoll\n");
+    for (int k = 0; k < count; k++)
+    {
+        fprintf(fp, "%s,%d,%s,%d,%s,%s\n", table[k].branch, table[k].semester, table[k].fileName,
+                table[k].studentCount, table[k].firstRoll, table[k].lastRoll);
+    }
+
+    int failed = (fflush(fp) != 0) || (_commit(_fileno(fp)) != 0);
+    failed = (fclose(fp) != 0) || failed;
+
+    if (failed || !MoveFileExA(tempFileName, SHARD_MANIFEST_FILE, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    {
+        printf("Error : Could Not Save %s (Error %lu).\n", SHARD_MANIFEST_FILE, (unsigned long)GetLastError());
+        DeleteFileA(tempFileName);
+        return -1;
+    }
+    return 0;
+}
+
+
+
+
+/*
+saveDirtyShards - Writes the shards changed since they were last saved, then the manifest. Called by the background saver.
+
+Only the students of a changed shard are written, so an edit in one branch/semester never rewrites another one.
+
+Returns:
+- 0 if every changed shard and the manifest were written, -1 otherwise.
+*/
+int saveDirtyShards(const Shard *table, int count, const StoreSnapshot *snapshot)
+{
+    char tempFileName[MAX_LINE_LENGTH + 8];
+    int result = 0;
+
+    for (int k = 0; k < count; k++)
+    {
+        if (table[k].editGeneration == table[k].savedGeneration)
+        {
+            continue;
+        }
+
+        snprintf(tempFileName, sizeof(tempFileName), "%s.tmp", table[k].fileName);
+        if (writeStudentFile(table[k].fileName, tempFileName, snapshot, table[k].branch, table[k].semester) != 0)
+        {
+            result = -1;
+        }
+    }
+
+    if (writeShardManifest(table, count) != 0)
+    {
+        result = -1;
+    }
+    return result;
+}
+
+
+
+
+/*
+loadShardManifest - Opens the sharded layout if SHARD_MANIFEST_FILE exists.
+
+Only the manifest is read : shards are loaded when a login, lookup, query or edit first needs them.
+
+Returns:
+- 1 if the database is sharded, 0 if there is no manifest.
+*/
+int loadShardManifest()
+{
+    char line[MAX_LINE_LENGTH];
+    FILE *fp = fopen(SHARD_MANIFEST_FILE, "r");
+    int lineNumber = 1;
+
+    if (fp == NULL)
+    {
+        return 0;
+    }
+
+    shardCount = 0;
+    if (fgets(line, MAX_LINE_LENGTH, fp) != NULL) // Skip the header line
+    {
+        skipLongLine(line, fp);
+    }
+
+    while (fgets(line, MAX_LINE_LENGTH, fp) && shardCount < MAX_SHARDS)
+    {
+        Shard *shard = &shards[shardCount];
+        char *cursor = line;
+        char *fields[6]; // Branch,Semester,File,Students,FirstRoll,LastRoll
+
+        lineNumber++;
+        if (skipLongLine(line, fp))
+        {
+            printf("Warning : Line %d of %s Is Longer Than %d Characters and Was Skipped.\n", lineNumber, SHARD_MANIFEST_FILE, MAX_LINE_LENGTH - 1);
+            continue;
+        }
+        line[strcspn(line, "\r\n")] = 0;
+        for (int k = 0; k < 6; k++)
+        {
+            fields[k] = nextCSVField(&cursor);
+        }
+        if (fields[0] == NULL || fields[0][0] == '\0' || fields[1] == NULL || fields[2] == NULL || fields[2][0] == '\0')
+        {
+            continue;
+        }
+
+        // A cut field would name another branch or route logins wrongly, so the whole line is rejected
+        if (strlen(fields[0]) >= sizeof(shard->branch) || (fields[4] != NULL && strlen(fields[4]) >= sizeof(shard->firstRoll)) ||
+            (fields[5] != NULL && strlen(fields[5]) >= sizeof(shard->lastRoll)))
+        {
+            printf("Warning : Line %d of %s Was Skipped, a Branch or Roll Number Is Too Long.\n", lineNumber, SHARD_MANIFEST_FILE);
+            continue;
+        }
+
+        memset(shard, 0, sizeof(Shard));
+        memcpy(shard->branch, fields[0], strlen(fields[0]) + 1);
+        shard->semester = atoi(fields[1]);
+        memcpy(shard->fileName, fields[2], strlen(fields[2]) + 1); // The whole line fits in fileName
+        if (fields[3] != NULL)
+            shard->studentCount = atoi(fields[3]);
+        if (fields[4] != NULL)
+            memcpy(shard->firstRoll, fields[4], strlen(fields[4]) + 1);
+        if (fields[5] != NULL)
+            memcpy(shard->lastRoll, fields[5], strlen(fields[5]) + 1);
+
+        shardCount++;
+    }
+    fclose(fp);
+
+    studentCount = 0;
+    shardedStorage = 1;
+    buildRollIndex();
+    invalidateRanks();
+    reportLoad("Sharded Database Opened! %d Branch/Semester Shards Listed in %s.\n", shardCount, SHARD_MANIFEST_FILE);
+    return 1;
+}
+
+
+
+
+/*
+unloadShard - Removes the students of a loaded shard from the students array.
+
+Only a shard whose edits are all saved can be unloaded; it is read from its file again when it is needed.
+The students after it move down, so indexes into the students array are no longer valid afterwards.
+Must be called by the main thread; a new snapshot is published for the background saver.
+
+Returns:
+- 0 if the shard was unloaded, -1 if it is not loaded or has unsaved edits.
+*/
+static int unloadShard(int shard)
+{
+    Shard *sh = &shards[shard];
+
+    EnterCriticalSection(&storeLock);
+    int unsaved = (sh->editGeneration != sh->savedGeneration);
+    LeaveCriticalSection(&storeLock);
+
+    if (!sh->loaded || unsaved)
+    {
+        return -1;
+    }
+
+    int count = 0;
+    for (int i = 0; i < studentCount; i++)
+    {
+        if (students[i].semester != sh->semester || strcmp(students[i].branch, sh->branch) != 0)
+        {
+            students[count] = students[i];
+            studentGrades[count] = studentGrades[i];
+            studentSlots[count] = studentSlots[i];
+            count++;
+        }
+    }
+    studentCount = count;
+    sh->loaded = 0;
+    buildRollIndex();
+    invalidateRanks();
+    if (publishSnapshot() != 0)
+    {
+        printf("Error : Not Enough Memory to Publish the Students After Unloading Shard %s/%d.\n", sh->branch, sh->semester);
+    }
+    return 0;
+}
+
+
+
+
+/*
+makeRoomForShard - Unloads the least recently used saved shards until the students of a shard fit in the students array.
+
+Shards marked in keep (e.g. the other shards of the same transaction) and shards with unsaved edits are never unloaded.
+The shard's size is taken from the manifest.
+
+Returns:
+- 0 if the shard fits, -1 if it does not fit even with every other shard that can be unloaded gone.
+*/
+static int makeRoomForShard(int shard, const unsigned char *keep)
+{
+    while (studentCount + shards[shard].studentCount > MAX_STUDENTS)
+    {
+        int oldest = -1;
+
+        for (int k = 0; k < shardCount; k++)
+        {
+            if (k != shard && shards[k].loaded && (keep == NULL || !keep[k]) &&
+                (oldest == -1 || shards[k].lastUsed < shards[oldest].lastUsed))
+            {
+                EnterCriticalSection(&storeLock);
+                int unsaved = (shards[k].editGeneration != shards[k].savedGeneration);
+                LeaveCriticalSection(&storeLock);
+
+                if (!unsaved)
+                {
+                    oldest = k;
+                }
+            }
+        }
+        if (oldest == -1 || unloadShard(oldest) != 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+
+
+/*
+loadShardKeeping - Appends the students of a shard to the students array, unloading other shards if it does not fit.
+
+The shard is only loaded if all of its students fit, so a loaded shard is always complete and can be rewritten safely.
+Saved shards that are not in keep may be unloaded to make room, least recently used first (see makeRoomForShard()).
+Must be called by the main thread; a new snapshot is published for the background saver.
+
+Returns:
+- 0 on success (or if the shard was already loaded), -1 if the shard could not be loaded.
+*/
+static int loadShardKeeping(int shard, const unsigned char *keep)
+{
+    Shard *sh = &shards[shard];
+    char line[MAX_LINE_LENGTH];
+    Student s;
+
+    sh->lastUsed = ++shardClock;
+    if (sh->loaded)
+    {
+        return 0;
+    }
+    if (makeRoomForShard(shard, keep) != 0)
+    {
+        printf("Error : Shard %s/%d Does Not Fit in Memory (Maximum %d Students, Unsaved Shards Stay Loaded).\n",
+               sh->branch, sh->semester, MAX_STUDENTS);
+        return -1;
+    }
+
+    FILE *fp = fopen(sh->fileName, "r");
+    if (fp == NULL)
+    {
+        printf("Error : Could Not Open Shard %s.\n", sh->fileName);
+        return -1;
+    }
+
+    int first = studentCount;
+    int count = studentCount;
+    int complete = 1;
+
+    if (fgets(line, MAX_LINE_LENGTH, fp) != NULL) // Skip the header line
+    {
+        skipLongLine(line, fp);
+    }
+    while (fgets(line, MAX_LINE_LENGTH, fp))
+    {
+        if (skipLongLine(line, fp))
+        {
+            printf("Warning : A Line of Shard %s Is Longer Than %d Characters and Was Skipped.\n", sh->fileName, MAX_LINE_LENGTH - 1);
+            continue;
+        }
+        if (!parseStudentLine(line, &s))
+        {
+            continue;
+        }
+        if (count >= MAX_STUDENTS)
+        {
+            complete = 0;
+            break;
+        }
+        studentSlots[count] = -1;
+        students[count++] = s;
+    }
+    fclose(fp);
+
+    if (!complete)
+    {
+        printf("Error : Shard %s/%d Does Not Fit in Memory (Maximum %d Students).\n", sh->branch, sh->semester, MAX_STUDENTS);
+        return -1;
+    }
+
+    // Rows are appended after the committed ones
+    studentCount = count;
+    sh->loaded = 1;
+    buildRollIndex();
+    invalidateRanks();
+    computeGrades(first, studentCount);
+    if (publishSnapshot() != 0)
+    {
+        printf("Error : Not Enough Memory to Load Shard %s/%d.\n", sh->branch, sh->semester);
+        studentCount = first;
+        sh->loaded = 0;
+        buildRollIndex();
+        return -1;
+    }
+    return 0;
+}
+
+
+
+
+/*
+loadShard - Appends the students of a shard to the students array, unloading the least recently used saved shards if needed.
+
+Returns:
+- 0 on success (or if the shard was already loaded), -1 if the shard could not be loaded.
+*/
+int loadShard(int shard)
+{
+    return loadShardKeeping(shard, NULL);
+}
+
+
+
+
+/*
+loadAllShards - Loads every shard that is not loaded yet. Does nothing unless the database is sharded.
+
+No shard is unloaded to make room, so indexes found before the call stay valid. Shards that do not fit are skipped,
+with one warning per run, and the callers work on the students that are loaded.
+*/
+void loadAllShards()
+{
+    static int warned = 0;
+    unsigned char keep[MAX_SHARDS];
+
+    memset(keep, 1, sizeof(keep));
+    for (int k = 0; shardedStorage && k < shardCount; k++)
+    {
+        if (shards[k].loaded || studentCount + shards[k].studentCount <= MAX_STUDENTS)
+        {
+            loadShardKeeping(k, keep);
+        }
+        else if (!warned)
+        {
+            printf("Warning : The Shards Hold More Than %d Students. Lists and Ranks Only Cover the %d Students Loaded.\n",
+                   MAX_STUDENTS, studentCount);
+            warned = 1;
+        }
+    }
+}
+
+
+
+
+/*
+loadShardsForRoll - Loads the shards whose roll number range (from the manifest) may hold a roll number.
+
+Returns:
+- The number of shards loaded.
+*/
+int loadShardsForRoll(const char *rollNo)
+{
+    unsigned char keep[MAX_SHARDS] = {0}; // Shards that may hold the roll number, none of them is unloaded for another
+    int loaded = 0;
+
+    for (int k = 0; k < shardCount; k++)
+    {
+        keep[k] = shards[k].studentCount > 0 && strcmp(rollNo, shards[k].firstRoll) >= 0 && strcmp(rollNo, shards[k].lastRoll) <= 0;
+    }
+    for (int k = 0; k < shardCount; k++)
+    {
+        if (keep[k] && !shards[k].loaded && loadShardKeeping(k, keep) == 0)
+        {
+            loaded++;
+        }
+    }
+    return loaded;
+}
+
+
+
+
+/*
+queryCanMatchShard - Decides whether a compiled query can match any student of a shard.
+
+The query is evaluated once with three-valued logic : branch and semester conditions are known for the whole shard,
+every other condition is unknown. The shard can be skipped only when the result is false.
+*/
+static int queryCanMatchShard(const CompiledQuery *query, const Shard *shard)
+{
+    enum { QUERY_FALSE, QUERY_TRUE, QUERY_UNKNOWN };
+    unsigned char stack[QUERY_MAX_STACK];
+    int sp = 0;
+
+    for (int pc = 0; pc < query->length; pc++)
+    {
+        const QueryInstruction *ins = &query->code[pc];
+        unsigned char a, b;
+
+        switch (ins->opcode)
+        {
+        case QOP_SEMESTER:
+        {
+            int value = shard->semester * 100;
+            compareQueryColumn(&value, 1, ins->compare, ins->operand, &stack[sp++]);
+            break;
+        }
+
+        case QOP_BRANCH:
+            stack[sp++] = (unsigned char)matchQueryText(shard->branch, query->strings[ins->column], ins->compare);
+            break;
+
+        case QOP_AND:
+            b = stack[--sp];
+            a = stack[sp - 1];
+            stack[sp - 1] = (a == QUERY_FALSE || b == QUERY_FALSE) ? QUERY_FALSE : (a == QUERY_TRUE && b == QUERY_TRUE) ? QUERY_TRUE : QUERY_UNKNOWN;
+            break;
+
+        case QOP_OR:
+            b = stack[--sp];
+            a = stack[sp - 1];
+            stack[sp - 1] = (a == QUERY_TRUE || b == QUERY_TRUE) ? QUERY_TRUE : (a == QUERY_FALSE && b == QUERY_FALSE) ? QUERY_FALSE : QUERY_UNKNOWN;
+            break;
+
+        case QOP_NOT:
+            if (stack[sp - 1] != QUERY_UNKNOWN)
+            {
+                stack[sp - 1] ^= 1;
+            }
+            break;
+
+        default:
+            stack[sp++] = QUERY_UNKNOWN;
+        }
+    }
+
+    return stack[0] != QUERY_FALSE;
+}
+
+
+
+
+/*
+loadShardsForQuery - Loads the shards a query can match, e.g. only CSE/5 for "branch = CSE and sem = 5 and sgpa < 6".
+
+Returns:
+- The number of shards the query can match.
+*/
+int loadShardsForQuery(const CompiledQuery *query)
+{
+    unsigned char keep[MAX_SHARDS] = {0}; // Shards the query can match, none of them is unloaded for another
+    int matching = 0;
+
+    for (int k = 0; k < shardCount; k++)
+    {
+        keep[k] = (unsigned char)queryCanMatchShard(query, &shards[k]);
+        matching += keep[k];
+    }
+    for (int k = 0; k < shardCount; k++)
+    {
+        if (keep[k])
+        {
+            loadShardKeeping(k, keep);
+        }
+    }
+    return matching;
+}
+
+
+
+
+/*
+loadShardsForTransaction - Loads every shard a transaction reads or writes before it is applied.
+
+For each operation, the shards whose roll range may hold the roll number are loaded (to find the student or detect a duplicate),
+and so is the shard of the student's branch/semester, since it will be rewritten. A new branch/semester gets a new, empty shard.
+None of these shards is unloaded to make room for another one of the same transaction. The shards loaded here are marked
+in loadedShards, so dropTransactionShards() can unload them again if the transaction is rolled back.
+
+Returns:
+- 0 on success, -1 if a shard could not be loaded.
+*/
+int loadShardsForTransaction(const Transaction *txn, unsigned char *loadedShards)
+{
+    unsigned char keep[MAX_SHARDS] = {0}; // Every shard the transaction needs, found first so loading one never unloads another
+    int k;
+
+    for (k = 0; k < txn->count; k++)
+    {
+        const Student *s = &txn->ops[k].student;
+        int shard = findShard(s->branch, s->semester);
+
+        for (int r = 0; r < shardCount; r++)
+        {
+            if (shards[r].studentCount > 0 && strcmp(s->rollNo, shards[r].firstRoll) >= 0 && strcmp(s->rollNo, shards[r].lastRoll) <= 0)
+            {
+                keep[r] = 1;
+            }
+        }
+        if (shard != -1)
+        {
+            keep[shard] = 1;
+        }
+    }
+
+    for (k = 0; k < shardCount; k++)
+    {
+        int wasLoaded = shards[k].loaded;
+
+        if (keep[k] && loadShardKeeping(k, keep) != 0)
+        {
+            return -1;
+        }
+        loadedShards[k] = keep[k] && !wasLoaded;
+    }
+
+    // A new branch/semester gets a new, empty shard
+    for (k = 0; k < txn->count; k++)
+    {
+        const Student *s = &txn->ops[k].student;
+        int shard = findShard(s->branch, s->semester);
+
+        if (shard == -1 && txn->ops[k].type == TXN_ADD)
+        {
+            if (shardCount >= MAX_SHARDS)
+            {
+                printf("Error : No More Than %d Branch/Semester Shards Are Supported.\n", MAX_SHARDS);
+                return -1;
+            }
+
+            EnterCriticalSection(&storeLock);
+            memset(&shards[shardCount], 0, sizeof(Shard));
+            snprintf(shards[shardCount].branch, MAX_LENGTH, "%s", s->branch);
+            shards[shardCount].semester = s->semester;
+            shardFileName(s->branch, s->semester, shards[shardCount].fileName);
+            shards[shardCount].loaded = 1;
+            shards[shardCount].lastUsed = ++shardClock;
+            keep[shardCount] = 1;
+            shardCount++;
+            LeaveCriticalSection(&storeLock);
+        }
+    }
+    return 0;
+}
+
+
+
+
+/*
+dropTransactionShards - Undoes the shard loads of a rolled back transaction.
+
+The shards marked in loadedShards are unloaded again and the empty shards created for new branch/semester partitions
+(those from shardsBefore on) are removed from the table, so a failed transaction leaves the shards as it found them.
+*/
+void dropTransactionShards(const unsigned char *loadedShards, int shardsBefore)
+{
+    EnterCriticalSection(&storeLock);
+    if (shardCount > shardsBefore)
+    {
+        shardCount = shardsBefore;
+    }
+    LeaveCriticalSection(&storeLock);
+
+    for (int k = 0; k < shardCount; k++)
+    {
+        if (loadedShards[k])
+        {
+            unloadShard(k);
+        }
+    }
+}
+
+
+
+
+/*
+markShardsChanged - Updates the manifest entries of the shards changed by a committed transaction and marks them for saving.
+
+Only these shards are rewritten by the background saver. Edits never change a student's branch or semester,
+so the shard of each operation's student is the only shard it changes.
+*/
+void markShardsChanged(const Transaction *txn)
+{
+    EnterCriticalSection(&storeLock);
+    for (int k = 0; k < txn->count; k++)
+    {
+        const Student *s = &txn->ops[k].student;
+        int shard = findShard(s->branch, s->semester);
+
+        if (shard != -1)
+        {
+            updateShardStatistics(&shards[shard]);
+            shards[shard].editGeneration++;
+        }
+    }
+    LeaveCriticalSection(&storeLock);
+}
+
+
+
+
+/*
+convertToShards - Splits the loaded database into one shard file per branch/semester and writes the manifest.
+
+The background saver must be stopped. DATABASE_FILE is left as it is; from now on the shards are the database,
+and DATABASE_FILE is only written when it is exported.
+
+Returns:
+- 0 on success, -1 if a file could not be written (the database stays in DATABASE_FILE).
+*/
+int convertToShards()
+{
+    char tempFileName[MAX_LINE_LENGTH + 8];
+
+    for (int i = 0; i < studentCount; i++)
+    {
+        if (findShard(students[i].branch, students[i].semester) != -1)
+        {
+            continue;
+        }
+        if (shardCount >= MAX_SHARDS)
+        {
+            printf("Error : No More Than %d Branch/Semester Shards Are Supported.\n", MAX_SHARDS);
+            shardCount = 0;
+            return -1;
+        }
+
+        Shard *shard = &shards[shardCount++];
+        memset(shard, 0, sizeof(Shard));
+        snprintf(shard->branch, MAX_LENGTH, "%s", students[i].branch);
+        shard->semester = students[i].semester;
+        shardFileName(shard->branch, shard->semester, shard->fileName);
+        shard->loaded = 1;
+        updateShardStatistics(shard);
+    }
+
+    StoreSnapshot *snapshot = acquireSnapshot();
+    int result = 0;
+
+    for (int k = 0; k < shardCount && result == 0; k++)
+    {
+        snprintf(tempFileName, sizeof(tempFileName), "%s.tmp", shards[k].fileName);
+        result = writeStudentFile(shards[k].fileName, tempFileName, snapshot, shards[k].branch, shards[k].semester);
+    }
+    releaseSnapshot(snapshot);
+
+    // The manifest is written last : until it exists, the database is still DATABASE_FILE
+    if (result != 0 || writeShardManifest(shards, shardCount) != 0)
+    {
+        shardCount = 0;
+        return -1;
+    }
+
+    shardedStorage = 1;
+    return 0;
+}
+
+
+
+
+/*
+reportLoad - Prints a message of the database loader.
+
+While the database is loaded in the background, the message is kept in loadReport and printed by waitForDatabase(),
+so it never appears in the middle of the login prompt.
+*/
+void reportLoad(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+
+    if (loadingInBackground)
+    {
+        size_t used = strlen(loadReport);
+        vsnprintf(loadReport + used, sizeof(loadReport) - used, format, args);
+    }
+    else
+    {
+        vprintf(format, args);
+    }
+    va_end(args);
+}
+
+
+
+
+/*
+databaseLoaderThread - Thread function loading the database : parsing, roll number index, grades and the first snapshot.
+
+It uses the sharded layout or the record store if one exists, otherwise DATABASE_FILE, then sets databaseLoaded.
+*/
+DWORD WINAPI databaseLoaderThread(LPVOID param)
+{
+    if (!loadShardManifest() && !loadFromRecordStore())
+    {
+        loadFromCSV();
+    }
+    databaseLoadFailed = (publishSnapshot() != 0); // First store version, read by the background saver
+
+    SetEvent(databaseLoaded);
+    return 0;
+}
+
+
+
+
+/*
+startDatabaseLoad - Starts loading the database on a background thread and returns at once.
+
+The login prompt is shown while the file is parsed, which hides the load time behind the time the user takes to type.
+The main thread must call waitForDatabase() before its first use of the data. If no thread can be started, the database is loaded now.
+*/
+void startDatabaseLoad()
+{
+    databaseLoaded = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (databaseLoaded != NULL)
+    {
+        loadingInBackground = 1;
+        loaderThread = CreateThread(NULL, 0, databaseLoaderThread, NULL, 0, NULL);
+    }
+
+    if (loaderThread == NULL)
+    {
+        loadingInBackground = 0;
+        if (!loadShardManifest() && !loadFromRecordStore())
+        {
+            loadFromCSV();
+        }
+        databaseLoadFailed = (publishSnapshot() != 0);
+    }
+}
+
+
+
+
+/*
+waitForDatabase - Blocks until the background load is complete, the first time the data is needed.
+
+It then prints the loader's messages and starts the background saver. Later calls return at once.
+*/
+void waitForDatabase()
+{
+    if (databaseReady)
+    {
+        return;
+    }
+
+    if (loaderThread != NULL)
+    {
+        if (WaitForSingleObject(databaseLoaded, 0) != WAIT_OBJECT_0)
+        {
+            printf("Loading Database...\n");
+            WaitForSingleObject(databaseLoaded, INFINITE);
+        }
+        WaitForSingleObject(loaderThread, INFINITE);
+        CloseHandle(loaderThread);
+        loaderThread = NULL;
+
+        loadingInBackground = 0;
+        printf("%s", loadReport);
+    }
+    if (databaseLoaded != NULL)
+    {
+        CloseHandle(databaseLoaded);
+        databaseLoaded = NULL;
+    }
+
+    if (databaseLoadFailed)
+    {
+        printf("Error : Not Enough Memory to Load the Database.\n");
+        exit(1);
+    }
+
+    databaseReady = 1;
+    startBackgroundSaver(); // Save edits in the background
+}
+
+
+
+
+/*
+fileSignature - Reads the size and last write time of a file. A missing file gets size -1.
+*/
+void fileSignature(const char *fileName, FileSignature *signature)
+{
+    WIN32_FILE_ATTRIBUTE_DATA data;
+
+    if (!GetFileAttributesExA(fileName, GetFileExInfoStandard, &data))
+    {
+        signature->size = -1;
+        signature->writeTime = 0;
+        return;
+    }
+    signature->size = ((long long)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    signature->writeTime = ((long long)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+}
+
+
+
+
+/*
+sameFileSignature - Returns 1 if two signatures describe the same version of a file.
+*/
+int sameFileSignature(const FileSignature *a, const FileSignature *b)
+{
+    return a->size == b->size && a->writeTime == b->writeTime;
+}
+
+
+
+
+/*
+rememberDatabaseFile - Records that DATABASE_FILE now holds the students of a snapshot.
+
+The snapshot is the base of the next external edit : only the rows in which the file differs from it were edited outside the program.
+*/
+void rememberDatabaseFile(StoreSnapshot *snapshot)
+{
+    EnterCriticalSection(&storeLock);
+
+    InterlockedIncrement(&snapshot->refCount);
+    if (savedFileSnapshot != NULL)
+    {
+        releaseSnapshot(savedFileSnapshot);
+    }
+    savedFileSnapshot = snapshot;
+    fileSignature(DATABASE_FILE, &savedFileSignature);
+
+    LeaveCriticalSection(&storeLock);
+}
+
+
+
+
+/*
+lockDatabaseFile - Takes the lock that every program running on DATABASE_FILE holds while it saves the file.
+
+The lock is a byte range of DATABASE_LOCK_FILE, not of DATABASE_FILE itself, because a save replaces DATABASE_FILE.
+It is only held for the few milliseconds of a save, so admins on several stations edit at the same time and only
+their saves take turns. It waits for another program's save to finish.
+
+Returns:
+- The open lock file, or INVALID_HANDLE_VALUE if it could not be opened or locked (the save then goes ahead unlocked).
+*/
+HANDLE lockDatabaseFile()
+{
+    OVERLAPPED range;
+    HANDLE lock = CreateFileA(DATABASE_LOCK_FILE, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (lock == INVALID_HANDLE_VALUE)
+    {
+        printf("Warning : Could Not Open %s (Error %lu). Saving Without the Lock.\n", DATABASE_LOCK_FILE, (unsigned long)GetLastError());
+        return INVALID_HANDLE_VALUE;
+    }
+
+    memset(&range, 0, sizeof(range));
+    if (!LockFileEx(lock, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &range))
+    {
+        printf("Warning : Could Not Lock %s (Error %lu). Saving Without the Lock.\n", DATABASE_LOCK_FILE, (unsigned long)GetLastError());
+        CloseHandle(lock);
+        return INVALID_HANDLE_VALUE;
+    }
+    return lock;
+}
+
+
+
+
+/*
+unlockDatabaseFile - Releases the lock taken by lockDatabaseFile().
+*/
+void unlockDatabaseFile(HANDLE lock)
+{
+    OVERLAPPED range;
+
+    if (lock == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+
+    memset(&range, 0, sizeof(range));
+    UnlockFileEx(lock, 0, 1, 0, &range);
+    CloseHandle(lock);
+}
+
+
+
+
+/*
+saveDatabaseFile - Saves a snapshot to DATABASE_FILE, unless another program saved the file since this one last saved
+or merged it.
+
+The check and the write happen under the database lock, so no other program can save in between. A file changed by
+another program must first be merged by reloadExternalEdits(), which keeps its rows and detects conflicting edits;
+the save that follows then adds only this program's own changes to it. When DATABASE_FILE is only an export (record
+store or sharded storage), it is written without the check.
+
+Returns:
+- 0 if the file was saved, 1 if another program saved it first and nothing was written, -1 on error.
+*/
+int saveDatabaseFile(StoreSnapshot *snapshot)
+{
+    HANDLE lock = lockDatabaseFile();
+    int changed = 0;
+
+    if (recordStore == NULL && !shardedStorage)
+    {
+        FileSignature signature;
+        fileSignature(DATABASE_FILE, &signature);
+
+        EnterCriticalSection(&storeLock);
+        changed = (savedFileSnapshot != NULL && !sameFileSignature(&signature, &savedFileSignature));
+        LeaveCriticalSection(&storeLock);
+    }
+
+    int result = changed ? 1 : writeDatabaseFile(snapshot);
+    if (result == 0)
+    {
+        rememberDatabaseFile(snapshot); // Our own save must not look like an external edit
+    }
+
+    unlockDatabaseFile(lock);
+    return result;
+}
+
+
+
+
+/*
+stampRecords - Gives every student a committed transaction changed a version stamp : the editGeneration of the save
+that will contain the change. A student stays stamped until that save is done, so reloadExternalEdits() knows which
+rows this program changed when another program saves the same file in the meantime.
+*/
+void stampRecords(const Transaction *txn)
+{
+    if (recordStore != NULL || shardedStorage)
+    {
+        return;
+    }
+
+    EnterCriticalSection(&storeLock);
+
+    if (recordStampCount + txn->count > recordStampCapacity)
+    {
+        int capacity = (recordStampCapacity > 0) ? recordStampCapacity : 64;
+        while (capacity < recordStampCount + txn->count)
+        {
+            capacity *= 2;
+        }
+
+        RecordStamp *stamps = realloc(recordStamps, capacity * sizeof(RecordStamp));
+        if (stamps == NULL)
+        {
+            printf("Warning : Not Enough Memory to Track the Changed Students. Conflicts May Not Be Detected.\n");
+            LeaveCriticalSection(&storeLock);
+            return;
+        }
+        recordStamps = stamps;
+        recordStampCapacity = capacity;
+    }
+
+    // The same roll number may be stamped again by a later commit, lookups take the highest version
+    for (int k = 0; k < txn->count; k++)
+    {
+        strcpy(recordStamps[recordStampCount].rollNo, txn->ops[k].student.rollNo);
+        recordStamps[recordStampCount].version = editGeneration + 1; // requestSave() moves editGeneration to it
+        recordStampCount++;
+    }
+
+    LeaveCriticalSection(&storeLock);
+}
+
+
+
+
+/*
+dropRecordStamps - Forgets the stamps of the changes a save contains (version up to the saved generation). The caller holds storeLock.
+*/
+void dropRecordStamps(long version)
+{
+    int count = 0;
+
+    for (int k = 0; k < recordStampCount; k++)
+    {
+        if (recordStamps[k].version > version)
+        {
+            recordStamps[count++] = recordStamps[k];
+        }
+    }
+    recordStampCount = count;
+}
+
+
+
+
+/*
+compareRecordStamps - qsort/bsearch comparator ordering stamps by roll number.
+*/
+static int compareRecordStamps(const void *a, const void *b)
+{
+    return strcmp(((const RecordStamp *)a)->rollNo, ((const RecordStamp *)b)->rollNo);
+}
+
+
+
+
+/*
+sortRecordStamps - Sorts the stamps by roll number and keeps one per student, the highest version. The caller holds storeLock.
+*/
+static void sortRecordStamps()
+{
+    int count = 0;
+
+    qsort(recordStamps, recordStampCount, sizeof(RecordStamp), compareRecordStamps);
+    for (int k = 0; k < recordStampCount; k++)
+    {
+        if (count > 0 && strcmp(recordStamps[count - 1].rollNo, recordStamps[k].rollNo) == 0)
+        {
+            if (recordStamps[k].version > recordStamps[count - 1].version)
+            {
+                recordStamps[count - 1].version = recordStamps[k].version;
+            }
+            continue;
+        }
+        recordStamps[count++] = recordStamps[k];
+    }
+    recordStampCount = count;
+}
+
+
+
+
+/*
+findRecordStamp - Looks up the stamp of a roll number. The stamps must be sorted with sortRecordStamps().
+
+Returns:
+- The stamp, or NULL if the student has no unsaved change.
+*/
+static RecordStamp *findRecordStamp(const char *rollNo)
+{
+    RecordStamp key;
+
+    if (recordStampCount == 0)
+    {
+        return NULL;
+    }
+    strcpy(key.rollNo, rollNo);
+    return bsearch(&key, recordStamps, recordStampCount, sizeof(RecordStamp), compareRecordStamps);
+}
+
+
+
+
+/*
+fileWatcherThread - Thread function waiting for changes in DATABASE_DIRECTORY.
+
+It only sets externalEditPending : the changed rows are merged by the main thread in reloadExternalEdits(), between two menu options.
+*/
+DWORD WINAPI fileWatcherThread(LPVOID param)
+{
+    HANDLE change = (HANDLE)param;
+    HANDLE events[2] = {fileWatcherStop, change};
+
+    while (WaitForMultipleObjects(2, events, FALSE, INFINITE) == WAIT_OBJECT_0 + 1)
+    {
+        InterlockedExchange(&externalEditPending, 1);
+        if (!FindNextChangeNotification(change))
+        {
+            break;
+        }
+    }
+
+    FindCloseChangeNotification(change);
+    return 0;
+}
+
+
+
+
+/*
+startFileWatcher - Starts watching DATABASE_FILE for edits made outside the program.
+
+The students loaded from the file become the base of the first external edit. If no change notification or thread
+is available, reloadExternalEdits() falls back to checking the file's signature on every call.
+*/
+void startFileWatcher()
+{
+    fileWatcherStarted = 1;
+
+    StoreSnapshot *snapshot = acquireSnapshot();
+    EnterCriticalSection(&storeLock);
+    FileSignature loaded = savedFileSignature; // Taken by loadFromCSV() before the file was read
+    rememberDatabaseFile(snapshot);
+    savedFileSignature = loaded;
+    LeaveCriticalSection(&storeLock);
+    releaseSnapshot(snapshot);
+
+    HANDLE change = FindFirstChangeNotificationA(DATABASE_DIRECTORY, FALSE,
+                                                 FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE);
+    if (change == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+
+    fileWatcherStop = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (fileWatcherStop != NULL)
+    {
+        fileWatcher = CreateThread(NULL, 0, fileWatcherThread, change, 0, NULL);
+    }
+    if (fileWatcher == NULL)
+    {
+        FindCloseChangeNotification(change);
+    }
+}
+
+
+
+
+/*
+stopFileWatcher - Stops the watcher thread, if it is running.
+*/
+void stopFileWatcher()
+{
+    if (fileWatcher == NULL)
+    {
+        return;
+    }
+
+    SetEvent(fileWatcherStop);
+    WaitForSingleObject(fileWatcher, INFINITE);
+    CloseHandle(fileWatcher);
+    CloseHandle(fileWatcherStop);
+    fileWatcher = NULL;
+    fileWatcherStop = NULL;
+}
+
+
+
+
+/*
+sameStudent - Compares the details and marks of two students, ignoring the unused bytes of their text fields.
+*/
+static int sameStudent(const Student *a, const Student *b)
+{
+    return strcmp(a->rollNo, b->rollNo) == 0 && strcmp(a->name, b->name) == 0 && strcmp(a->branch, b->branch) == 0 &&
+           a->semester == b->semester &&
+           memcmp(a->obtainedMarks, b->obtainedMarks, sizeof(a->obtainedMarks)) == 0 &&
+           memcmp(a->obtainedPracticalMarks, b->obtainedPracticalMarks, sizeof(a->obtainedPracticalMarks)) == 0;
+}
+
+
+
+
+/*
+applyExternalRow - Stores a student edited outside the program in students[], replacing the student with the same roll number or appending it.
+
+Only this row of the roll number index and of the grade cache is touched.
+
+Returns:
+- 0 on success, -1 if the student is new and the database is full.
+*/
+static int applyExternalRow(const Student *s, const StudentGrades *grades)
+{
+    int index = findStudentByRoll(s->rollNo);
+
+    if (index == -1)
+    {
+        if (studentCount >= MAX_STUDENTS)
+        {
+            return -1;
+        }
+        index = studentCount++;
+        students[index] = *s;
+        studentSlots[index] = -1;
+        insertRollIndex(rollIndex, ROLL_INDEX_SIZE, students, index);
+    }
+    else
+    {
+        students[index] = *s;
+    }
+    studentGrades[index] = *grades;
+    return 0;
+}
+
+
+
+
+/*
+sameRow - Compares two rows that may be missing (NULL), e.g. a student deleted on one side.
+*/
+static int sameRow(const Student *a, const Student *b)
+{
+    if (a == NULL || b == NULL)
+    {
+        return a == b;
+    }
+    return sameStudent(a, b);
+}
+
+
+
+
+/*
+conflictingEdit - Checks a row another program changed (theirs, NULL if it deleted the student) against this program's
+unsaved change of the same student. base is the row both programs started from, NULL if the student is new.
+
+Returns:
+- 1 if this program changed the student too, to something else, 0 otherwise. mine is set to this program's row.
+*/
+static int conflictingEdit(const char *rollNo, const Student *base, const Student *theirs, const Student **mine)
+{
+    int index = findStudentByRoll(rollNo);
+
+    *mine = (index != -1) ? &students[index] : NULL;
+    return findRecordStamp(rollNo) != NULL && !sameRow(*mine, base) && !sameRow(*mine, theirs);
+}
+
+
+
+
+/*
+reportConflict - Records an edit of this program that lost to a save of another program. The row kept (the other
+program's, or none if it deleted the student) and the edit (none if this program deleted the student) are appended
+to CONFLICT_FILE as CSV rows, so the edit can be checked and entered again.
+*/
+static void reportConflict(FILE **fp, const char *rollNo, const Student *mine, const Student *theirs)
+{
+    char line[MAX_CSV_ROW_LENGTH + 1];
+
+    printf("Conflict : Roll No %s Was %s Here and %s by Another Program. The Saved Version Was Kept.\n", rollNo,
+           mine != NULL ? "Changed" : "Deleted", theirs != NULL ? "Changed" : "Deleted");
+
+    if (*fp == NULL)
+    {
+        *fp = fopen(CONFLICT_FILE, "a");
+        if (*fp == NULL)
+        {
+            printf("Error : Could Not Open %s.\n", CONFLICT_FILE);
+            return;
+        }
+    }
+
+    // The rows are written without their newline, every block is then followed by the same blank line
+    fprintf(*fp, "Roll No %s\n", rollNo);
+    if (theirs != NULL)
+    {
+        line[formatCSVRow(line, theirs) - 1] = '\0';
+        fprintf(*fp, "Kept (Other Program) : %s\n", line);
+    }
+    else
+    {
+        fprintf(*fp, "Kept (Other Program) : Deleted\n");
+    }
+    if (mine != NULL)
+    {
+        line[formatCSVRow(line, mine) - 1] = '\0';
+        fprintf(*fp, "Lost (This Program)  : %s\n", line);
+    }
+    else
+    {
+        fprintf(*fp, "Lost (This Program)  : Deleted\n");
+    }
+    fprintf(*fp, "\n");
+}
+
+
+
+
+/*
+reloadExternalEdits - Merges the rows of DATABASE_FILE edited outside the program (e.g. in MS Excel) into students[].
+
+The file is only read when the watcher has seen a change and its signature differs from the program's last save or load.
+It is then compared by roll number with the snapshot last saved to it, so the rows added, changed or deleted outside the
+program are found without reloading anything else. Only those rows are applied to students[], the roll number index and
+the grade cache, and edits the admin made since the last save are kept. storeLock is held throughout, so the background
+saver cannot replace the file while it is read or save a version without the merged rows.
+The file may also have been saved by another program running on the same database. A student both programs changed
+since they last synchronised, each to something different, is a conflict : the version saved first is kept, and the
+edit of this program is reported and written to CONFLICT_FILE instead of being silently lost. A student deleted here
+and not saved yet is still part of the base : its row in the file is not taken for a new student, so it stays deleted.
+The marks of the whole file are validated in one pass : changed or added rows with marks out of range are not merged,
+they are reported and the file is saved again with their previous version.
+Only the CSV database is watched : with the record store or sharded storage DATABASE_FILE is not the database.
+*/
+void reloadExternalEdits()
+{
+    if (recordStore != NULL || shardedStorage)
+    {
+        return;
+    }
+    if (!fileWatcherStarted)
+    {
+        startFileWatcher();
+    }
+    if (fileWatcher != NULL && InterlockedExchange(&externalEditPending, 0) == 0)
+    {
+        return;
+    }
+
+    EnterCriticalSection(&storeLock);
+
+    FileSignature signature;
+    fileSignature(DATABASE_FILE, &signature);
+
+    if (savingDatabaseFile)
+    {
+        InterlockedExchange(&externalEditPending, 1); // Our own save is in progress, look again later
+        LeaveCriticalSection(&storeLock);
+        return;
+    }
+    if (sameFileSignature(&signature, &savedFileSignature))
+    {
+        LeaveCriticalSection(&storeLock);
+        return;
+    }
+
+    Database db;
+    initDatabase(&db, DATABASE_FILE);
+    int result = loadDatabase(&db);
+
+    if (result != 0)
+    {
+        // A missing or locked file (e.g. while MS Excel saves it) is not an edit, try again after the next change
+        if (result == -2)
+        {
+            printf("Error : Not Enough Memory to Reload %s.\n", DATABASE_FILE);
+        }
+        freeDatabase(&db);
+        LeaveCriticalSection(&storeLock);
+        return;
+    }
+
+    const StoreSnapshot *base = savedFileSnapshot;
+    unsigned char *inBase = calloc(db.count + 1, 1);                    // Rows of the file that were already in the base
+    unsigned int *invalid = malloc((db.count + 1) * sizeof(unsigned int)); // Mark columns of each row out of range
+    int removed[MAX_STUDENTS] = {0};                                    // Students of students[] deleted outside the program
+    int updated = 0, added = 0, deleted = 0, skipped = 0, conflicts = 0, rejected = 0, rejectedNew = 0;
+    FILE *conflictFile = NULL;
+    const Student *mine;
+    int i, row;
+
+    if (inBase == NULL || invalid == NULL)
+    {
+        printf("Error : Not Enough Memory to Reload %s.\n", DATABASE_FILE);
+        free(inBase);
+        free(invalid);
+        freeDatabase(&db);
+        LeaveCriticalSection(&storeLock);
+        return;
+    }
+
+    // The whole file is validated in one pass, changed or added rows with marks out of range are not merged
+    validateMarkRows(db.students, db.count, invalid);
+
+    sortRecordStamps();
+
+    // Rows of the base deleted or changed in the file
+    for (i = 0; i < base->count; i++)
+    {
+        const Student *old = snapshotRow(base, i);
+        row = findDatabaseStudent(&db, old->rollNo);
+
+        if (row == -1)
+        {
+            int index = findStudentByRoll(old->rollNo);
+            if (index != -1 && !removed[index])
+            {
+                if (conflictingEdit(old->rollNo, old, NULL, &mine))
+                {
+                    reportConflict(&conflictFile, old->rollNo, mine, NULL);
+                    findRecordStamp(old->rollNo)->version = 0;
+                    conflicts++;
+                }
+                replicateChange(TXN_DELETE, old);
+                removed[index] = 1;
+                deleted++;
+            }
+            continue;
+        }
+
+        inBase[row] = 1;
+        if (sameStudent(old, &db.students[row]))
+        {
+            invalid[row] = 0; // Not edited, so not rejected either
+        }
+        else if (invalid[row] != 0)
+        {
+            rejected++;
+        }
+        else
+        {
+            if (conflictingEdit(old->rollNo, old, &db.students[row], &mine))
+            {
+                reportConflict(&conflictFile, old->rollNo, mine, &db.students[row]);
+                findRecordStamp(old->rollNo)->version = 0;
+                conflicts++;
+            }
+            if (applyExternalRow(&db.students[row], &db.grades[row]) == 0)
+            {
+                replicateChange(TXN_UPDATE, &db.students[row]);
+                updated++;
+            }
+            else
+            {
+                skipped++; // Deleted here, and there is no room to bring it back
+            }
+        }
+    }
+
+    // Rows added to the file
+    for (row = 0; row < db.count; row++)
+    {
+        if (inBase[row])
+        {
+            continue;
+        }
+        if (invalid[row] != 0)
+        {
+            rejected++;
+            rejectedNew++;
+            continue;
+        }
+
+        // A student deleted here since the last save belongs to the base : the row is this program's deleted row,
+        // not a new student, and the deletion is kept
+        if (findRecordStamp(db.students[row].rollNo) != NULL && findStudentByRoll(db.students[row].rollNo) == -1)
+        {
+            continue;
+        }
+        if (conflictingEdit(db.students[row].rollNo, NULL, &db.students[row], &mine))
+        {
+            reportConflict(&conflictFile, db.students[row].rollNo, mine, &db.students[row]);
+            findRecordStamp(db.students[row].rollNo)->version = 0;
+            conflicts++;
+        }
+        if (applyExternalRow(&db.students[row], &db.grades[row]) == 0)
+        {
+            replicateChange(TXN_ADD, &db.students[row]);
+            added++;
+        }
+        else
+        {
+            skipped++;
+        }
+    }
+    free(inBase);
+
+    // Deleted students leave the array, the index is rebuilt because they cannot be removed from an open addressing table
+    if (deleted > 0)
+    {
+        int count = 0;
+
+        for (i = 0; i < studentCount; i++)
+        {
+            if (!removed[i])
+            {
+                students[count] = students[i];
+                studentGrades[count] = studentGrades[i];
+                studentSlots[count] = studentSlots[i];
+                count++;
+            }
+        }
+        studentCount = count;
+        buildRollIndex();
+    }
+
+    if (updated + added + deleted > 0)
+    {
+        invalidateRanks();
+        if (publishSnapshot() != 0)
+        {
+            printf("Error : Not Enough Memory to Publish the Reloaded Students.\n");
+        }
+        printf("\n%s Was Edited Outside the Program : %d Updated, %d Added, %d Deleted.\n", DATABASE_FILE, updated, added, deleted);
+    }
+    if (skipped > 0)
+    {
+        printf("Warning : %d Students Were Not Added, Maximum Limit Reached.\n", skipped);
+    }
+    if (rejected > 0)
+    {
+        printf("Warning : %d Rows Edited Outside the Program Have Marks Out of Range and Were Not Merged :\n", rejected);
+        printMarkErrors(stdout, db.students, db.count, invalid);
+        if (rejected > rejectedNew)
+        {
+            printf("%d Changed Students Keep Their Previous Version in %s.\n", rejected - rejectedNew, DATABASE_FILE);
+        }
+        if (rejectedNew > 0)
+        {
+            printf("%d New Students Were Not Added.\n", rejectedNew);
+        }
+
+        // The rows leave DATABASE_FILE at the next save, so the edits are kept aside to be corrected
+        if (saveRejectedRows(db.students, db.count, invalid) >= 0)
+        {
+            printf("The Rejected Rows Are Kept in %s, Correct Them There and Copy Them Back.\n", REJECTED_ROWS_FILE);
+        }
+        else
+        {
+            printf("Error : Could Not Write %s, the Rejected Rows Will Be Lost at the Next Save.\n", REJECTED_ROWS_FILE);
+        }
+    }
+    free(invalid);
+    if (conflicts > 0)
+    {
+        dropRecordStamps(0); // The conflicting edits are gone, those students now hold the saved version
+        printf("Warning : %d of Your Edits Conflicted With Another Program's Save and Were Not Kept. They Are Listed in %s.\n",
+               conflicts, CONFLICT_FILE);
+    }
+    if (conflictFile != NULL)
+    {
+        fclose(conflictFile);
+    }
+
+    // The file is the base of the next external edit
+    StoreSnapshot *fileSnapshot = buildSnapshot(db.students, db.count < MAX_STUDENTS ? db.count : MAX_STUDENTS);
+    if (fileSnapshot != NULL)
+    {
+        releaseSnapshot(savedFileSnapshot);
+        savedFileSnapshot = fileSnapshot;
+        savedFileSignature = signature;
+    }
+    freeDatabase(&db);
+    WakeConditionVariable(&saverWake); // A save waiting for the merge can go ahead
+
+    LeaveCriticalSection(&storeLock);
+
+    if (rejected > 0)
+    {
+        requestSave(); // Replaces the rejected rows in the file
+    }
+}
+
+
+
+
+/*
+compareStudentRoll - qsort() comparison of two student pointers by roll number, then by position so file order is kept for duplicates.
+*/
+static int compareStudentRoll(const void *a, const void *b)
+{
+    const Student *x = *(const Student *const *)a;
+    const Student *y = *(const Student *const *)b;
+    int cmp = strcmp(x->rollNo, y->rollNo);
+
+    if (cmp != 0)
+    {
+        return cmp;
+    }
+    return (x > y) - (x < y);
+}
+
+
+
+
+/*
+loadReconcileSide - Thread function loading one database of a reconciliation and ordering it by roll number.
+
+A file that is already in roll number order (e.g. a sorted export) is used as it is, otherwise it is sorted in O(n log n).
+*/
+DWORD WINAPI loadReconcileSide(LPVOID param)
+{
+    ReconcileSide *side = (ReconcileSide *)param;
+
+    side->result = loadDatabase(&side->db);
+    if (side->result != 0)
+    {
+        return 0;
+    }
+
+    side->order = malloc((side->db.count > 0 ? side->db.count : 1) * sizeof(const Student *));
+    if (side->order == NULL)
+    {
+        side->result = -2;
+        return 0;
+    }
+
+    side->sorted = 1;
+    for (int i = 0; i < side->db.count; i++)
+    {
+        side->order[i] = &side->db.students[i];
+        if (i > 0 && strcmp(side->db.students[i - 1].rollNo, side->db.students[i].rollNo) > 0)
+        {
+            side->sorted = 0;
+        }
+    }
+    if (!side->sorted)
+    {
+        qsort(side->order, side->db.count, sizeof(const Student *), compareStudentRoll);
+    }
+
+    for (int i = 1; i < side->db.count; i++)
+    {
+        if (strcmp(side->order[i - 1]->rollNo, side->order[i]->rollNo) == 0)
+        {
+            side->duplicates++;
+        }
+    }
+    return 0;
+}
+
+
+
+
+/*
+resolveStudent - Builds the merged row of a student found in both files, following a reconciliation policy.
+*/
+static void resolveStudent(const Student *first, const Student *second, ReconcilePolicy policy, Student *merged)
+{
+    *merged = (policy == RECONCILE_SECOND) ? *second : *first;
+
+    if (policy != RECONCILE_HIGHER && policy != RECONCILE_AVERAGE)
+    {
+        return;
+    }
+
+    int x[NUM_MARK_COLUMNS], y[NUM_MARK_COLUMNS];
+    markColumnValues(first, x);
+    markColumnValues(second, y);
+    for (int col = 0; col < NUM_MARK_COLUMNS; col++)
+    {
+        x[col] = (policy == RECONCILE_HIGHER) ? (x[col] > y[col] ? x[col] : y[col]) : (x[col] + y[col] + 1) / 2;
+    }
+    setMarkColumnValues(merged, x);
+}
+
+
+
+
+/*
+reportStudentChanges - Writes one report line per column in which a student differs between the two files.
+
+Parameters:
+- columnChanges: Changes counted per column : name, branch, semester, then every mark column.
+
+Returns:
+- 1 if the student differs in any column, 0 if both rows are the same.
+*/
+static int reportStudentChanges(FILE *fp, const Student *first, const Student *second, long long *columnChanges)
+{
+    char name[MAX_LINE_LENGTH];
+    int changed = 0;
+
+    if (strcmp(first->name, second->name) != 0)
+    {
+        fprintf(fp, "%-20s Changed    %-48s %-20s %s\n", first->rollNo, "Name", first->name, second->name);
+        columnChanges[0]++;
+        changed = 1;
+    }
+    if (strcmp(first->branch, second->branch) != 0)
+    {
+        fprintf(fp, "%-20s Changed    %-48s %-20s %s\n", first->rollNo, "Branch", first->branch, second->branch);
+        columnChanges[1]++;
+        changed = 1;
+    }
+    if (first->semester != second->semester)
+    {
+        fprintf(fp, "%-20s Changed    %-48s %-20d %d\n", first->rollNo, "Semester", first->semester, second->semester);
+        columnChanges[2]++;
+        changed = 1;
+    }
+
+    for (int col = 0; col < NUM_MARK_COLUMNS; col++)
+    {
+        int x = markColumnValue(first, col);
+        int y = markColumnValue(second, col);
+
+        if (x != y)
+        {
+            markColumnName(col, name);
+            fprintf(fp, "%-20s Changed    %-48s %-20d %d\n", first->rollNo, name, x, y);
+            columnChanges[3 + col]++;
+            changed = 1;
+        }
+    }
+    return changed;
+}
+
+
+
+
+/*
+readReconcileFileName - Reads a file name typed by the admin, or returns defaultName if the line is empty (and defaultName is not NULL).
+
+Returns:
+- 1 if a file name was read, 0 otherwise.
+*/
+static int readReconcileFileName(const char *prompt, const char *defaultName, char *fileName)
+{
+    printf("%s", prompt);
+    if (fgets(fileName, MAX_LINE_LENGTH, stdin) == NULL)
+    {
+        return 0;
+    }
+    fileName[strcspn(fileName, "\n")] = 0;
+    trim(fileName);
+
+    if (fileName[0] == '\0')
+    {
+        if (defaultName == NULL)
+        {
+            return 0;
+        }
+        strcpy(fileName, defaultName);
+    }
+    return 1;
+}
+
+
+
+
+/*
+sameFileName - Tells whether two file names typed by the admin name the same file, e.g. "students.csv" and ".\\Students.csv".
+
+The names are compared as full paths, ignoring case like Windows does.
+*/
+static int sameFileName(const char *a, const char *b)
+{
+    char fullA[MAX_LINE_LENGTH], fullB[MAX_LINE_LENGTH];
+
+    if (_fullpath(fullA, a, MAX_LINE_LENGTH) == NULL || _fullpath(fullB, b, MAX_LINE_LENGTH) == NULL)
+    {
+        return strcasecmp(a, b) == 0;
+    }
+    return strcasecmp(fullA, fullB) == 0;
+}
+
+
+
+
+/*
+mergeReconcileSides - Walks two roll number orders together, reporting every difference and writing the merged database.
+
+The merged rows are collected in batches of STREAM_BATCH_ROWS and written with writeCSVRows(), so the merged database
+never has to be held in memory. output is NULL when no merged database is wanted.
+
+Returns:
+- 0 on success, -1 if the merged database could not be written.
+*/
+static int mergeReconcileSides(const ReconcileSide *sides, FILE *report, FILE *output, ReconcilePolicy policy, int keepUnmatched, ReconcileCounts *counts)
+{
+    const Student **a = sides[0].order;
+    const Student **b = sides[1].order;
+    int na = sides[0].db.count, nb = sides[1].db.count;
+    int i = 0, j = 0;
+    Student *batch = NULL;
+    int batchCount = 0;
+    CSVSource source = {NULL, NULL, NULL, NULL, 0};
+
+    if (output != NULL)
+    {
+        batch = malloc(STREAM_BATCH_ROWS * sizeof(Student));
+        if (batch == NULL)
+        {
+            return -1;
+        }
+        source.rows = batch;
+    }
+
+    fprintf(report, "===== Reconciliation of %s (First) and %s (Second) =====\n\n", sides[0].db.fileName, sides[1].db.fileName);
+    fprintf(report, "Roll No              Change     Column                                           First                Second\n");
+    fprintf(report, "------------------------------------------------------------------------------------------------------------------------\n");
+
+    while (i < na || j < nb)
+    {
+        int cmp = (i >= na) ? 1 : (j >= nb) ? -1 : strcmp(a[i]->rollNo, b[j]->rollNo);
+        const Student *keep = NULL;
+
+        if (cmp < 0)
+        {
+            fprintf(report, "%-20s Removed    %-48s %s\n", a[i]->rollNo, "-", a[i]->name);
+            counts->removed++;
+            keep = keepUnmatched ? a[i] : NULL;
+            i++;
+        }
+        else if (cmp > 0)
+        {
+            fprintf(report, "%-20s Added      %-48s %-20s %s\n", b[j]->rollNo, "-", "", b[j]->name);
+            counts->added++;
+            keep = keepUnmatched ? b[j] : NULL;
+            j++;
+        }
+        else
+        {
+            if (reportStudentChanges(report, a[i], b[j], counts->columnChanges))
+            {
+                counts->changed++;
+            }
+            else
+            {
+                counts->same++;
+            }
+            if (output != NULL)
+            {
+                resolveStudent(a[i], b[j], policy, &batch[batchCount++]);
+            }
+            i++;
+            j++;
+        }
+
+        if (output == NULL)
+        {
+            continue;
+        }
+        if (keep != NULL)
+        {
+            batch[batchCount++] = *keep;
+        }
+        if (batchCount == STREAM_BATCH_ROWS || (i >= na && j >= nb))
+        {
+            if (writeCSVRows(output, &source, batchCount) != 0)
+            {
+                free(batch);
+                return -1;
+            }
+            counts->written += batchCount;
+            batchCount = 0;
+        }
+    }
+
+    fprintf(report, "------------------------------------------------------------------------------------------------------------------------\n");
+    fprintf(report, "Same : %lld   Changed : %lld   Added : %lld   Removed : %lld\n", counts->same, counts->changed, counts->added, counts->removed);
+
+    free(batch);
+    return 0;
+}
+
+
+
+
+/*
+printReconcileSummary - Prints the counts of a reconciliation and the number of changed students per column.
+*/
+static void printReconcileSummary(const ReconcileSide *sides, const ReconcileCounts *counts)
+{
+    printf("\n===== %s (First) vs %s (Second) =====\n\n", sides[0].db.fileName, sides[1].db.fileName);
+    printf("Students in First File    : %d%s\n", sides[0].db.count, sides[0].sorted ? " (already in roll number order)" : "");
+    printf("Students in Second File   : %d%s\n", sides[1].db.count, sides[1].sorted ? " (already in roll number order)" : "");
+    printf("Same in Both Files        : %lld\n", counts->same);
+    printf("Changed                   : %lld\n", counts->changed);
+    printf("Added (Second File Only)  : %lld\n", counts->added);
+    printf("Removed (First File Only) : %lld\n", counts->removed);
+
+    if (counts->changed == 0)
+    {
+        return;
+    }
+
+    printf("\nColumn                                           Students Changed\n");
+    printf("-----------------------------------------------------------------\n");
+    for (int k = 0; k < 3 + NUM_MARK_COLUMNS; k++)
+    {
+        char name[MAX_LINE_LENGTH];
+
+        if (counts->columnChanges[k] == 0)
+        {
+            continue;
+        }
+        if (k < 3)
+        {
+            strcpy(name, k == 0 ? "Name" : k == 1 ? "Branch" : "Semester");
+        }
+        else
+        {
+            markColumnName(k - 3, name);
+        }
+        printf("%-48s %lld\n", name, counts->columnChanges[k]);
+    }
+    printf("-----------------------------------------------------------------\n");
+}
+
+
+
+
+/*
+reconcileDatabases - Compares two database files by roll number and optionally writes a merged database.
+
+Both files (e.g. the marks of the internal and of the external examiner) are loaded at the same time on two threads and
+ordered by roll number, then walked together in a single linear merge. Students found only in the first file are reported
+as removed, students found only in the second as added, and students found in both are compared column by column.
+Every difference is written to RECONCILE_REPORT_FILE in roll number order, with a summary per column on screen.
+The merged database resolves the students found in both files with the chosen policy and is written in batches while
+the merge runs, so the whole reconciliation is O(n log n) and the files may hold millions of students.
+The interactive database is not changed.
+*/
+void reconcileDatabases()
+{
+    ReconcileSide sides[2];
+    ReconcileCounts counts;
+    char firstFile[MAX_LINE_LENGTH];
+    char secondFile[MAX_LINE_LENGTH];
+    char mergedFile[MAX_LINE_LENGTH] = "";
+    char choice[MAX_LINE_LENGTH];
+    ReconcilePolicy policy = RECONCILE_FIRST;
+    int merge, keepUnmatched = 1;
+    int failed = 0;
+    int k;
+
+    printf("\n===== Compare and Reconcile Two Databases =====\n\n");
+    clearInputBuffer();
+
+    if (!readReconcileFileName("Enter First File (or press Enter for " DATABASE_FILE ") : ", DATABASE_FILE, firstFile) ||
+        !readReconcileFileName("Enter Second File : ", NULL, secondFile))
+    {
+        printf("Reconciliation Cancelled.\n");
+        return;
+    }
+
+    printf("\n1. Report Differences Only\n");
+    printf("2. Report Differences and Write a Merged Database\n\n");
+    printf("Enter Your Choice : ");
+    if (fgets(choice, MAX_LINE_LENGTH, stdin) == NULL || (choice[0] != '1' && choice[0] != '2'))
+    {
+        printf("Invalid Choice!\n");
+        return;
+    }
+    merge = (choice[0] == '2');
+
+    if (merge)
+    {
+        printf("\nMarks of Students Found in Both Files :\n");
+        printf("1. Keep the First File's Row\n");
+        printf("2. Keep the Second File's Row\n");
+        printf("3. Keep the Higher Marks of Each Subject\n");
+        printf("4. Average the Marks of Each Subject (Rounded Up)\n\n");
+        printf("Enter Policy : ");
+        if (fgets(choice, MAX_LINE_LENGTH, stdin) == NULL || choice[0] < '1' || choice[0] > '4')
+        {
+            printf("Invalid Policy!\n");
+            return;
+        }
+        policy = (ReconcilePolicy)(choice[0] - '1');
+
+        printf("Keep Students Found in Only One File? (y/n) : ");
+        if (fgets(choice, MAX_LINE_LENGTH, stdin) == NULL)
+        {
+            return;
+        }
+        keepUnmatched = (choice[0] == 'y' || choice[0] == 'Y');
+
+        if (!readReconcileFileName("Enter Merged File Name (or press Enter for " RECONCILE_MERGED_FILE ") : ", RECONCILE_MERGED_FILE, mergedFile))
+        {
+            return;
+        }
+
+        // The merged file is written from scratch, it must not replace the live database or a file being compared
+        if (sameFileName(mergedFile, DATABASE_FILE) || sameFileName(mergedFile, firstFile) || sameFileName(mergedFile, secondFile))
+        {
+            printf("Error : The Merged File Must Not Be %s or One of the Compared Files. Reconciliation Cancelled.\n", DATABASE_FILE);
+            return;
+        }
+    }
+
+    DWORD startTime = GetTickCount();
+    mapSubjectColumns(); // Used by the loaders, must be ready before they start
+
+    memset(sides, 0, sizeof(sides));
+    initDatabase(&sides[0].db, firstFile);
+    initDatabase(&sides[1].db, secondFile);
+
+    // The second file is loaded on its own thread while this thread loads the first
+    HANDLE thread = CreateThread(NULL, 0, loadReconcileSide, &sides[1], 0, NULL);
+    loadReconcileSide(&sides[0]);
+    if (thread != NULL)
+    {
+        WaitForSingleObject(thread, INFINITE);
+        CloseHandle(thread);
+    }
+    else
+    {
+        loadReconcileSide(&sides[1]);
+    }
+
+    for (k = 0; k < 2 && !failed; k++)
+    {
+        if (sides[k].result != 0)
+        {
+            if (sides[k].result == -1)
+                printf("Error Opening %s!\n", sides[k].db.fileName);
+            else
+                printf("Error : Not Enough Memory to Load %s.\n", sides[k].db.fileName);
+            failed = 1;
+        }
+        else if (sides[k].duplicates > 0)
+        {
+            printf("Warning : %d Duplicate Roll Numbers in %s, Matched in File Order.\n", sides[k].duplicates, sides[k].db.fileName);
+        }
+    }
+
+    FILE *report = failed ? NULL : fopen(RECONCILE_REPORT_FILE, "w");
+    FILE *output = (failed || !merge) ? NULL : fopen(mergedFile, "w");
+
+    if (!failed && (report == NULL || (merge && output == NULL)))
+    {
+        printf("Error : Could Not Write %s.\n", report == NULL ? RECONCILE_REPORT_FILE : mergedFile);
+        failed = 1;
+    }
+
+    if (!failed)
+    {
+        setvbuf(report, NULL, _IOFBF, REPORT_BUFFER_SIZE);
+        if (output != NULL)
+        {
+            setvbuf(output, NULL, _IOFBF, REPORT_BUFFER_SIZE);
+            writeCSVHeader(output);
+        }
+
+        memset(&counts, 0, sizeof(counts));
+        int result = mergeReconcileSides(sides, report, output, policy, keepUnmatched, &counts);
+
+        // The merged file is only complete once it is closed
+        if (output != NULL && fclose(output) != 0)
+        {
+            result = -1;
+        }
+        output = NULL;
+
+        if (result != 0)
+        {
+            printf("Error : Could Not Write %s.\n", mergedFile);
+        }
+        else
+        {
+            printReconcileSummary(sides, &counts);
+            printf("\nDifferences Saved to %s (%lu ms).\n", RECONCILE_REPORT_FILE, (unsigned long)(GetTickCount() - startTime));
+            if (merge)
+            {
+                printf("Merged Database of %lld Students Saved to %s.\n", counts.written, mergedFile);
+            }
+        }
+    }
+
+    if (report != NULL)
+    {
+        fclose(report);
+    }
+    if (output != NULL)
+    {
+        fclose(output);
+    }
+    for (k = 0; k < 2; k++)
+    {
+        free(sides[k].order);
+        freeDatabase(&sides[k].db);
+    }
+}
+
+
+
+
+/*
+clearMarkSketch - Empties a quantile sketch.
+*/
+void clearMarkSketch(MarkSketch *sketch)
+{
+    memset(sketch, 0, sizeof(MarkSketch));
+}
+
+
+
+
+/*
+addToMarkSketch - Adds students to a quantile sketch, one distribution at a time so each pass touches a single row of counters.
+
+Parameters:
+- indexes: Indexes in rows of the students to add, NULL to add rows[0..count-1].
+*/
+void addToMarkSketch(MarkSketch *sketch, const Student *rows, const int *indexes, int count)
+{
+    for (int key = 0; key < SKETCH_KEYS; key++)
+    {
+        long long *histogram = sketch->histogram[key];
+
+        for (int k = 0; k < count; k++)
+        {
+            const Student *s = &rows[indexes != NULL ? indexes[k] : k];
+            int marks = (key < NUM_MARK_COLUMNS) ? markColumnValue(s, key) : subjectTotalMarks(s, key - NUM_MARK_COLUMNS);
+
+            marks = marks < 0 ? 0 : marks > MAX_SUBJECT_MARKS ? MAX_SUBJECT_MARKS : marks;
+            histogram[marks]++;
+        }
+    }
+    sketch->count += count;
+}
+
+
+
+
+/*
+mergeMarkSketch - Adds the students of one sketch to another, e.g. the sketches of several databases or threads.
+*/
+void mergeMarkSketch(MarkSketch *into, const MarkSketch *from)
+{
+    for (int key = 0; key < SKETCH_KEYS; key++)
+    {
+        for (int marks = 0; marks <= MAX_SUBJECT_MARKS; marks++)
+        {
+            into->histogram[key][marks] += from->histogram[key][marks];
+        }
+    }
+    into->count += from->count;
+}
+
+
+
+
+/*
+markSketchPercentile - Returns the marks at a percentile of one distribution of a sketch (nearest rank).
+
+The result is the lowest marks such that at least percent % of the students have these marks or less, e.g. 50 gives the median
+and 90 the marks from which the top 10% of the students start. Only the MAX_SUBJECT_MARKS + 1 counters are read.
+
+Returns:
+- The marks, -1 if the sketch is empty.
+*/
+int markSketchPercentile(const MarkSketch *sketch, int key, double percent)
+{
+    if (sketch->count == 0)
+    {
+        return -1;
+    }
+
+    double exactRank = percent / 100.0 * sketch->count;
+    long long rank = (long long)exactRank;
+    long long seen = 0;
+
+    if (rank < exactRank)
+    {
+        rank++;
+    }
+
+    rank = rank < 1 ? 1 : rank > sketch->count ? sketch->count : rank;
+    for (int marks = 0; marks <= MAX_SUBJECT_MARKS; marks++)
+    {
+        seen += sketch->histogram[key][marks];
+        if (seen >= rank)
+        {
+            return marks;
+        }
+    }
+    return MAX_SUBJECT_MARKS;
+}
+
+
+
+
+/*
+markSketchKeyName - Name of a distribution of a sketch : a mark column's CSV header, or "Total_<Subject>".
+*/
+void markSketchKeyName(int key, char *name)
+{
+    if (key < NUM_MARK_COLUMNS)
+    {
+        markColumnName(key, name);
+    }
+    else
+    {
+        sprintf(name, "Total_%s", subjectMarks[key - NUM_MARK_COLUMNS].subject);
+    }
+}
+
+
+
+
+/*
+saveMarkSketch - Saves the sketch of a database file next to it, in <fileName>.sketch.
+
+The file holds SKETCH_MAGIC, the signature of the database file when the sketch was built and the counters,
+so later percentile queries can use it without reading the database as long as the file is unchanged.
+
+Returns:
+- 0 on success, -1 if the sketch could not be written.
+*/
+int saveMarkSketch(const char *fileName, const FileSignature *signature, const MarkSketch *sketch)
+{
+    char sketchFile[MAX_LINE_LENGTH + sizeof(SKETCH_FILE_SUFFIX)];
+    int layout[2] = {SKETCH_KEYS, MAX_SUBJECT_MARKS + 1};
+
+    sprintf(sketchFile, "%s%s", fileName, SKETCH_FILE_SUFFIX);
+    FILE *fp = fopen(sketchFile, "wb");
+    if (fp == NULL)
+    {
+        return -1;
+    }
+
+    int failed = fwrite(SKETCH_MAGIC, 1, 8, fp) != 8 || fwrite(signature, sizeof(FileSignature), 1, fp) != 1 ||
+                 fwrite(layout, sizeof(layout), 1, fp) != 1 || fwrite(sketch, sizeof(MarkSketch), 1, fp) != 1;
+    failed = (fclose(fp) != 0) || failed;
+
+    if (failed)
+    {
+        DeleteFileA(sketchFile);
+        return -1;
+    }
+    return 0;
+}
+
+
+
+
+/*
+loadMarkSketch - Loads the saved sketch of a database file.
+
+Returns:
+- 1 if the sketch was loaded, 0 if there is none or it was built from another version of the file or another schema.
+*/
+int loadMarkSketch(const char *fileName, MarkSketch *sketch)
+{
+    char sketchFile[MAX_LINE_LENGTH + sizeof(SKETCH_FILE_SUFFIX)];
+    char magic[8];
+    FileSignature saved, current;
+    int layout[2];
+
+    sprintf(sketchFile, "%s%s", fileName, SKETCH_FILE_SUFFIX);
+    FILE *fp = fopen(sketchFile, "rb");
+    if (fp == NULL)
+    {
+        return 0;
+    }
+
+    fileSignature(fileName, &current);
+    int loaded = fread(magic, 1, 8, fp) == 8 && memcmp(magic, SKETCH_MAGIC, 8) == 0 &&
+                 fread(&saved, sizeof(FileSignature), 1, fp) == 1 && sameFileSignature(&saved, &current) &&
+                 fread(layout, sizeof(layout), 1, fp) == 1 && layout[0] == SKETCH_KEYS && layout[1] == MAX_SUBJECT_MARKS + 1 &&
+                 fread(sketch, sizeof(MarkSketch), 1, fp) == 1;
+    fclose(fp);
+
+    return loaded;
+}
+
+
+
+
+/*
+printMarkSketch - Prints the median, quartiles and the marks from which the top 10% start for every distribution of a sketch.
+*/
+void printMarkSketch(FILE *fp, const MarkSketch *sketch)
+{
+    char name[MAX_LINE_LENGTH];
+
+    fprintf(fp, "No.  Distribution                                    Max   P25    Median   P75    Top 10%% From\n");
+    fprintf(fp, "-----------------------------------------------------------------------------------------------\n");
+    for (int key = 0; key < SKETCH_KEYS; key++)
+    {
+        int max = (key < NUM_MARK_COLUMNS) ? markColumnMax(key)
+                                           : subjectMarks[key - NUM_MARK_COLUMNS].maxTheory + subjectMarks[key - NUM_MARK_COLUMNS].maxPractical;
+
+        markSketchKeyName(key, name);
+        fprintf(fp, "%-4d %-47s %-5d %-6d %-8d %-6d %d\n", key + 1, name, max, markSketchPercentile(sketch, key, 25),
+                markSketchPercentile(sketch, key, 50), markSketchPercentile(sketch, key, 75), markSketchPercentile(sketch, key, 90));
+    }
+    fprintf(fp, "-----------------------------------------------------------------------------------------------\n");
+}
+
+
+
+
+/*
+putVarint - Writes an unsigned value as a varint : 7 bits per byte, lowest bits first, the high bit set on every byte but the last.
+
+Returns:
+- Number of bytes written, at most 5.
+*/
+static int putVarint(unsigned char *out, unsigned int value)
+{
+    int length = 0;
+
+    while (value >= 0x80)
+    {
+        out[length++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (unsigned char)value;
+    return length;
+}
+
+
+
+
+/*
+getVarint - Reads a varint written by putVarint(), advancing *cursor past it.
+
+Returns:
+- 0 on success, -1 if the varint runs past end or is longer than 5 bytes.
+*/
+static int getVarint(const unsigned char **cursor, const unsigned char *end, unsigned int *value)
+{
+    unsigned int result = 0;
+
+    for (int shift = 0; shift < 35 && *cursor < end; shift += 7)
+    {
+        unsigned char byte = *(*cursor)++;
+
+        result |= (unsigned int)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            *value = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+
+
+
+/*
+encodeSemesterSheets - Packs the sheets of a student into a cold block.
+
+Each sheet is stored as the difference from the sheet before it (the first one from zero) : the semester, then every
+mark column. A student's marks change little from one semester to the next, so the zigzag-encoded differences are
+small and almost every value fits in one varint byte.
+
+Returns:
+- Length of the block, at most count * HISTORY_SHEET_BYTES.
+*/
+static int encodeSemesterSheets(const SemesterSheet *sheets, int count, unsigned char *block)
+{
+    SemesterSheet previous;
+    int length = 0;
+
+    memset(&previous, 0, sizeof(previous));
+    for (int k = 0; k < count; k++)
+    {
+        int delta = sheets[k].semester - previous.semester;
+        length += putVarint(block + length, ((unsigned int)delta << 1) ^ (unsigned int)(delta >> 31));
+
+        for (int col = 0; col < NUM_MARK_COLUMNS; col++)
+        {
+            delta = sheets[k].marks[col] - previous.marks[col];
+            length += putVarint(block + length, ((unsigned int)delta << 1) ^ (unsigned int)(delta >> 31));
+        }
+        previous = sheets[k];
+    }
+    return length;
+}
+
+
+
+
+/*
+decodeSemesterSheets - Unpacks a cold block written by encodeSemesterSheets().
+
+Returns:
+- 0 on success, -1 if the block is damaged.
+*/
+static int decodeSemesterSheets(const unsigned char *block, int length, int count, SemesterSheet *sheets)
+{
+    const unsigned char *cursor = block;
+    const unsigned char *end = block + length;
+    SemesterSheet previous;
+    unsigned int value;
+
+    memset(&previous, 0, sizeof(previous));
+    for (int k = 0; k < count; k++)
+    {
+        if (getVarint(&cursor, end, &value) != 0)
+        {
+            return -1;
+        }
+        sheets[k].semester = previous.semester + (int)((value >> 1) ^ (0u - (value & 1)));
+
+        for (int col = 0; col < NUM_MARK_COLUMNS; col++)
+        {
+            if (getVarint(&cursor, end, &value) != 0)
+            {
+                return -1;
+            }
+            sheets[k].marks[col] = previous.marks[col] + (int)((value >> 1) ^ (0u - (value & 1)));
+        }
+        previous = sheets[k];
+    }
+    return cursor == end ? 0 : -1;
+}
+
+
+
+
+/*
+freeHistory - Frees the history held in memory. It is read again from HISTORY_FILE when it is next needed.
+*/
+void freeHistory()
+{
+    for (int h = 0; h < historyCount; h++)
+    {
+        free(history[h].block);
+        free(history[h].sheets);
+    }
+    free(history);
+    history = NULL;
+    historyCount = 0;
+    historyCapacity = 0;
+    historyLoaded = 0;
+}
+
+
+
+
+/*
+loadHistory - Reads HISTORY_FILE once, the first time a transcript or a promotion needs it.
+
+Only the cold blocks are read; a student's sheets are decoded when they are first asked for.
+
+Layout : HISTORY_MAGIC, the number of mark columns and of students (4 bytes each, little endian), then for every student
+ordered by roll number : the roll number's length (1 byte) and characters, the number of sheets and the block's length
+(varints), and the block.
+
+Returns:
+- 0 on success (a missing file is an empty history), -1 if the file is damaged or was written for another schema.
+*/
+int loadHistory()
+{
+    unsigned char *data = NULL;
+    long size = 0;
+    int failed = 0;
+
+    if (historyLoaded)
+    {
+        return 0;
+    }
+
+    FILE *fp = fopen(HISTORY_FILE, "rb");
+    if (fp != NULL)
+    {
+        if (fseek(fp, 0, SEEK_END) == 0 && (size = ftell(fp)) > 0 && fseek(fp, 0, SEEK_SET) == 0)
+        {
+            data = malloc(size);
+        }
+        failed = (data == NULL || fread(data, 1, size, fp) != (size_t)size);
+        fclose(fp);
+    }
+
+    if (fp != NULL && !failed)
+    {
+        const unsigned char *cursor = data + 16;
+        const unsigned char *end = data + size;
+        unsigned int columns = 0, count = 0;
+
+        if (size >= 16 && memcmp(data, HISTORY_MAGIC, 8) == 0)
+        {
+            columns = data[8] | (data[9] << 8) | (data[10] << 16) | ((unsigned int)data[11] << 24);
+            count = data[12] | (data[13] << 8) | (data[14] << 16) | ((unsigned int)data[15] << 24);
+        }
+        failed = (columns != NUM_MARK_COLUMNS || count > (unsigned int)(size / 3));
+
+        history = failed ? NULL : calloc(count > 0 ? count : 1, sizeof(StudentHistory));
+        failed = failed || history == NULL;
+        historyCapacity = failed ? 0 : (int)count;
+
+        while (!failed && historyCount < (int)count)
+        {
+            StudentHistory *h = &history[historyCount];
+            unsigned int rollLength, sheetCount, blockLength;
+
+            rollLength = (cursor < end) ? *cursor++ : MAX_ROLLNO_LENGTH;
+            failed = rollLength >= MAX_ROLLNO_LENGTH || (unsigned int)(end - cursor) < rollLength;
+            if (!failed)
+            {
+                memcpy(h->rollNo, cursor, rollLength);
+                cursor += rollLength;
+                failed = getVarint(&cursor, end, &sheetCount) != 0 || getVarint(&cursor, end, &blockLength) != 0 ||
+                         sheetCount == 0 || sheetCount > MAX_SEMESTERS || (unsigned int)(end - cursor) < blockLength;
+            }
+            if (!failed)
+            {
+                h->block = malloc(blockLength > 0 ? blockLength : 1);
+                failed = (h->block == NULL);
+            }
+            if (!failed)
+            {
+                memcpy(h->block, cursor, blockLength);
+                cursor += blockLength;
+                h->blockLength = (int)blockLength;
+                h->sheetCount = (int)sheetCount;
+                historyCount++;
+            }
+        }
+        failed = failed || cursor != end;
+    }
+    free(data);
+
+    if (failed)
+    {
+        printf("Error : %s Is Damaged or Was Written for Other Subjects.\n", HISTORY_FILE);
+        freeHistory();
+        return -1;
+    }
+    historyLoaded = 1;
+    return 0;
+}
+
+
+
+
+/*
+saveHistory - Atomically replaces HISTORY_FILE with the history held in memory.
+
+Returns:
+- 0 on success, -1 if the file could not be written (the old one is kept).
+*/
+int saveHistory()
+{
+    const char *tempFileName = HISTORY_FILE ".tmp";
+    unsigned char header[16];
+    unsigned char prefix[1 + MAX_ROLLNO_LENGTH + 10];
+    FILE *fp = fopen(tempFileName, "wb");
+
+    if (fp == NULL)
+    {
+        printf("Error : Could Not Open %s For Writing.\n", HISTORY_FILE);
+        return -1;
+    }
+
+    memcpy(header, HISTORY_MAGIC, 8);
+    for (int b = 0; b < 4; b++)
+    {
+        header[8 + b] = (unsigned char)((unsigned int)NUM_MARK_COLUMNS >> (8 * b));
+        header[12 + b] = (unsigned char)((unsigned int)historyCount >> (8 * b));
+    }
+    int failed = fwrite(header, 1, sizeof(header), fp) != sizeof(header);
+
+    for (int h = 0; h < historyCount && !failed; h++)
+    {
+        int length = (int)strlen(history[h].rollNo);
+
+        prefix[0] = (unsigned char)length;
+        memcpy(prefix + 1, history[h].rollNo, length);
+        length++;
+        length += putVarint(prefix + length, (unsigned int)history[h].sheetCount);
+        length += putVarint(prefix + length, (unsigned int)history[h].blockLength);
+        failed = fwrite(prefix, 1, length, fp) != (size_t)length ||
+                 fwrite(history[h].block, 1, history[h].blockLength, fp) != (size_t)history[h].blockLength;
+    }
+
+    failed = failed || (fflush(fp) != 0) || (_commit(_fileno(fp)) != 0);
+    failed = (fclose(fp) != 0) || failed;
+
+    if (failed || !MoveFileExA(tempFileName, HISTORY_FILE, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    {
+        printf("Error : Could Not Save %s (Error %lu).\n", HISTORY_FILE, (unsigned long)GetLastError());
+        DeleteFileA(tempFileName);
+        return -1;
+    }
+    return 0;
+}
+
+
+
+
+/*
+findHistory - Binary search of the history, which is kept ordered by roll number.
+
+Returns:
+- Index of the student's history, or -(insertion point) - 1 if the student has none.
+*/
+static int findHistory(const char *rollNo)
+{
+    int low = 0, high = historyCount - 1;
+
+    while (low <= high)
+    {
+        int middle = (low + high) / 2;
+        int order = strcmp(history[middle].rollNo, rollNo);
+
+        if (order == 0)
+        {
+            return middle;
+        }
+        if (order < 0)
+            low = middle + 1;
+        else
+            high = middle - 1;
+    }
+    return -low - 1;
+}
+
+
+
+
+/*
+historySheets - Sheets of a student's history, decoding its cold block on first access.
+
+Returns:
+- The sheets, oldest first, or NULL if the block is damaged or memory ran out.
+*/
+static const SemesterSheet *historySheets(StudentHistory *h)
+{
+    if (h->sheets == NULL)
+    {
+        SemesterSheet *sheets = malloc(MAX_SEMESTERS * sizeof(SemesterSheet));
+
+        if (sheets == NULL || decodeSemesterSheets(h->block, h->blockLength, h->sheetCount, sheets) != 0)
+        {
+            printf("Error : History of Roll No %s Is Damaged.\n", h->rollNo);
+            free(sheets);
+            return NULL;
+        }
+        h->sheets = sheets;
+    }
+    return h->sheets;
+}
+
+
+
+
+/*
+archiveSemesterSheet - Adds a student's current marks sheet to their history, before the student is promoted.
+
+A sheet of the same semester already in the history is replaced, so promoting again after a failed commit does not
+duplicate it. The cold block is encoded again; HISTORY_FILE is only written by saveHistory().
+
+Returns:
+- 0 on success, -1 if the history is full or memory ran out.
+*/
+int archiveSemesterSheet(const Student *s)
+{
+    unsigned char block[MAX_SEMESTERS * HISTORY_SHEET_BYTES];
+    int h = findHistory(s->rollNo);
+
+    if (h < 0)
+    {
+        if (historyCount == historyCapacity)
+        {
+            int capacity = historyCapacity > 0 ? historyCapacity * 2 : 64;
+            StudentHistory *grown = realloc(history, capacity * sizeof(StudentHistory));
+
+            if (grown == NULL)
+            {
+                printf("Error : Not Enough Memory for the History.\n");
+                return -1;
+            }
+            history = grown;
+            historyCapacity = capacity;
+        }
+
+        h = -h - 1;
+        memmove(&history[h + 1], &history[h], (historyCount - h) * sizeof(StudentHistory));
+        memset(&history[h], 0, sizeof(StudentHistory));
+        snprintf(history[h].rollNo, MAX_ROLLNO_LENGTH, "%s", s->rollNo);
+        history[h].sheets = malloc(MAX_SEMESTERS * sizeof(SemesterSheet));
+        historyCount++;
+        if (history[h].sheets == NULL)
+        {
+            printf("Error : Not Enough Memory for the History.\n");
+            return -1;
+        }
+    }
+    else if (historySheets(&history[h]) == NULL)
+    {
+        return -1;
+    }
+
+    StudentHistory *entry = &history[h];
+    int k = entry->sheetCount;
+    if (k > 0 && entry->sheets[k - 1].semester == s->semester)
+    {
+        k--;
+    }
+    else if (k == MAX_SEMESTERS)
+    {
+        printf("Error : Roll No %s Already Has %d Semesters of History.\n", s->rollNo, MAX_SEMESTERS);
+        return -1;
+    }
+
+    entry->sheets[k].semester = s->semester;
+    markColumnValues(s, entry->sheets[k].marks);
+
+    int length = encodeSemesterSheets(entry->sheets, k + 1, block);
+    unsigned char *copy = malloc(length);
+    if (copy == NULL)
+    {
+        printf("Error : Not Enough Memory for the History.\n");
+        return -1;
+    }
+    memcpy(copy, block, length);
+    free(entry->block);
+    entry->block = copy;
+    entry->blockLength = length;
+    entry->sheetCount = k + 1;
+    return 0;
+}
+
+
+
+
+/*
+printTranscriptRow - Prints one semester of a transcript and adds its SGPA to the CGPA sums.
+*/
+static void printTranscriptRow(FILE *fp, const Student *s, const char *note, StudentGrades *grades, double *sgpaSum)
+{
+    int maxTotal = 0;
+
+    for (int sub = 0; sub < TOTAL_SUBJECTS; sub++)
+    {
+        maxTotal += subjectMarks[sub].maxTheory + subjectMarks[sub].maxPractical;
+    }
+
+    gradeStudent(s, grades);
+    *sgpaSum += grades->sgpa;
+
+    char total[24];
+    sprintf(total, "%d/%d", studentTotalMarks(s), maxTotal);
+    fprintf(fp, "%-6d %-11s %-9.1f %-7.2f %s%s%s\n", s->semester, total, 100.0 * studentTotalMarks(s) / maxTotal,
+            grades->sgpa, grades->passed ? "PASS" : "FAIL", note[0] != '\0' ? " " : "", note);
+}
+
+
+
+
+/*
+printTranscript - Prints every semester of a student : the archived sheets, then the current one if the student is
+still enrolled, with the SGPA of each semester, the CGPA and the grade of every subject in every semester.
+
+Every semester has the same subjects and credits, so the CGPA is the average of the SGPAs. A current semester whose
+marks are not entered yet (e.g. just after a promotion) is listed but not graded.
+
+Returns:
+- Number of semesters printed, 0 if the student has no marks at all.
+*/
+int printTranscript(FILE *fp, const char *rollNo, const Student *current)
+{
+    StudentGrades grades[MAX_SEMESTERS + 1];
+    int semesters[MAX_SEMESTERS + 1];
+    const SemesterSheet *sheets = NULL;
+    double sgpaSum = 0;
+    int count = 0;
+    Student s;
+
+    int h = findHistory(rollNo);
+    if (h >= 0 && (sheets = historySheets(&history[h])) == NULL)
+    {
+        return 0;
+    }
+    if (sheets == NULL && current == NULL)
+    {
+        return 0;
+    }
+
+    fprintf(fp, "\n===== Transcript : %s", rollNo);
+    if (current != NULL)
+    {
+        fprintf(fp, " (%s, %s)", current->name, current->branch);
+    }
+    fprintf(fp, " =====\n\n");
+    fprintf(fp, "Sem    Total       Percent   SGPA    Result\n");
+    fprintf(fp, "---------------------------------------------------\n");
+
+    if (sheets != NULL)
+    {
+        memset(&s, 0, sizeof(s));
+        for (int k = 0; k < history[h].sheetCount; k++)
+        {
+            s.semester = sheets[k].semester;
+            setMarkColumnValues(&s, sheets[k].marks);
+            printTranscriptRow(fp, &s, "", &grades[count], &sgpaSum);
+            semesters[count++] = s.semester;
+        }
+    }
+    if (current != NULL && count > 0 && studentTotalMarks(current) == 0)
+    {
+        fprintf(fp, "%-6d %-11s %-9s %-7s %-4s (Current, Marks Not Entered)\n", current->semester, "-", "-", "-", "-");
+    }
+    else if (current != NULL && (count == 0 || semesters[count - 1] != current->semester))
+    {
+        printTranscriptRow(fp, current, "(Current)", &grades[count], &sgpaSum);
+        semesters[count++] = current->semester;
+    }
+    fprintf(fp, "---------------------------------------------------\n");
+    fprintf(fp, "CGPA : %.2f over %d Semester%s\n\n", sgpaSum / count, count, count == 1 ? "" : "s");
+
+    fprintf(fp, "%-36s", "Grades");
+    for (int k = 0; k < count; k++)
+    {
+        fprintf(fp, " Sem %-3d", semesters[k]);
+    }
+    fprintf(fp, "\n");
+    for (int sub = 0; sub < TOTAL_SUBJECTS; sub++)
+    {
+        fprintf(fp, "%-36s", subjectMarks[sub].subject);
+        for (int k = 0; k < count; k++)
+        {
+            fprintf(fp, " %-7s", gradeScale[grades[k].gradeIndex[sub]].grade);
+        }
+        fprintf(fp, "\n");
+    }
+    fprintf(fp, "\n");
+    return count;
+}
+
+
+
+
+/*
+viewTranscript - Prints and saves the transcript of a student, who may have left (only their history is then shown).
+*/
+void viewTranscript(const Student *current, const char *rollNo)
+{
+    if (loadHistory() != 0)
+    {
+        return;
+    }
+
+    if (printTranscript(stdout, rollNo, current) == 0)
+    {
+        printf("No Marks Found for Roll No %s.\n", rollNo);
+        return;
+    }
+
+    FILE *fp = fopen(TRANSCRIPT_FILE, "w");
+    if (fp == NULL)
+    {
+        printf("Error : Could not open file to save results.\n");
+        return;
+    }
+    printTranscript(fp, rollNo, current);
+    fclose(fp);
+    printf("Transcript saved to '%s'.\n", TRANSCRIPT_FILE);
+}
+
+
+
+
+/*
+promoteStudents - Promotes students to their next semester.
+
+Every student's marks sheet is archived in the history and HISTORY_FILE is saved first; the students then move to the
+next semester with empty marks, all in one transaction, so either every student is promoted or none is. With sharded
+storage a promoted student changes shard, so the student is deleted from the old shard and added to the new one.
+A student in the final semester (MAX_SEMESTERS), or whose history already holds a later semester than the current one,
+is not promoted, and neither is the rest of the group. If the commit fails, the archived sheets stay in HISTORY_FILE and
+are replaced when the promotion is done again.
+
+Returns:
+- Number of students promoted, count or 0.
+*/
+int promoteStudents(const int *indexes, int count)
+{
+    Student *promoted = malloc(count * sizeof(Student));
+    int opsPerStudent = shardedStorage ? 2 : 1;
+    int k;
+
+    if (count * opsPerStudent > MAX_TRANSACTION_OPS)
+    {
+        printf("Error : At Most %d Students Can Be Promoted at Once. No Student Was Promoted.\n", MAX_TRANSACTION_OPS / opsPerStudent);
+        free(promoted);
+        return 0;
+    }
+    if (promoted == NULL || loadHistory() != 0)
+    {
+        free(promoted);
+        return 0;
+    }
+
+    // Every student is checked before any sheet is archived
+    for (k = 0; k < count; k++)
+    {
+        const Student *s = &students[indexes[k]];
+        int h = findHistory(s->rollNo);
+        const SemesterSheet *sheets = h >= 0 ? historySheets(&history[h]) : NULL;
+
+        if (s->semester >= MAX_SEMESTERS)
+        {
+            printf("Error : Roll No %s Is in the Final Semester (%d).\n", s->rollNo, s->semester);
+            break;
+        }
+        if (sheets != NULL && sheets[history[h].sheetCount - 1].semester > s->semester)
+        {
+            printf("Error : Roll No %s Was Already Promoted Past Semester %d.\n", s->rollNo, s->semester);
+            break;
+        }
+    }
+    if (k < count)
+    {
+        printf("No Student Was Promoted.\n");
+        free(promoted);
+        return 0;
+    }
+
+    for (k = 0; k < count; k++)
+    {
+        if (archiveSemesterSheet(&students[indexes[k]]) != 0)
+        {
+            break;
+        }
+        promoted[k] = students[indexes[k]];
+    }
+    if (k < count || saveHistory() != 0)
+    {
+        printf("No Student Was Promoted.\n");
+        freeHistory(); // Drop the sheets archived in memory only, the saved history is read again
+        free(promoted);
+        return 0;
+    }
+
+    Transaction txn;
+    beginTransaction(&txn);
+    for (k = 0; k < count; k++)
+    {
+        Student next = promoted[k];
+
+        next.semester++;
+        memset(next.obtainedMarks, 0, sizeof(next.obtainedMarks));
+        memset(next.obtainedPracticalMarks, 0, sizeof(next.obtainedPracticalMarks));
+
+        if (shardedStorage)
+        {
+            stageOperation(&txn, TXN_DELETE, &promoted[k]);
+            stageOperation(&txn, TXN_ADD, &next);
+        }
+        else
+        {
+            stageOperation(&txn, TXN_UPDATE, &next);
+        }
+    }
+    free(promoted);
+    return commitTransaction(&txn) == 0 ? count : 0;
+}
+
+
+
+
+/*
+semesterHistory - Menu for promoting students and viewing transcripts.
+*/
+void semesterHistory()
+{
+    char rollNo[MAX_ROLLNO_LENGTH];
+    char branchSem[MAX_LINE_LENGTH];
+    char branch[MAX_LENGTH];
+    int indexes[MAX_STUDENTS];
+    int choice, semester, count, index;
+
+    while (1)
+    {
+        printf("\n===== Semester History =====\n\n");
+        printf("1. Promote a Student to the Next Semester\n");
+        printf("2. Promote a Branch/Semester\n");
+        printf("3. View Transcript (All Semesters)\n");
+        printf("4. Return to Admin Menu\n\n");
+        printf("Enter Your Choice : ");
+
+        if (scanf("%d", &choice) != 1)
+        {
+            printf("Invalid Input! Please Enter a Number.\n");
+            clearInputBuffer();
+            continue;
+        }
+
+        if (choice == 1 || choice == 3)
+        {
+            printf("Enter Student Roll Number : ");
+            scanf("%19s", rollNo);
+            index = locateStudent(rollNo);
+
+            if (choice == 3)
+            {
+                viewTranscript(index != -1 ? &students[index] : NULL, rollNo);
+            }
+            else if (index == -1)
+            {
+                printf("Student with Roll Number %s not found.\n", rollNo);
+            }
+            else if (promoteStudents(&index, 1) == 1)
+            {
+                printf("Roll No %s Promoted to Semester %d.\n", rollNo, students[findStudentByRoll(rollNo)].semester);
+            }
+        }
+        else if (choice == 2)
+        {
+            printf("Enter Branch/Semester (e.g. CSE/5) : ");
+            scanf("%1023s", branchSem);
+            if (sscanf(branchSem, "%29[^/]/%d", branch, &semester) != 2)
+            {
+                printf("Invalid Format! Use Branch/Semester, e.g. CSE/5.\n");
+                continue;
+            }
+
+            count = 0;
+            for (int i = 0; i < studentCount; i++)
+            {
+                if (strcmp(students[i].branch, branch) == 0 && students[i].semester == semester)
+                {
+                    indexes[count++] = i;
+                }
+            }
+            if (count == 0)
+            {
+                printf("No Students in %s/%d.\n", branch, semester);
+                continue;
+            }
+
+            int promoted = promoteStudents(indexes, count);
+            printf("%d of %d Students Promoted from %s/%d to %s/%d.\n", promoted, count, branch, semester, branch, semester + 1);
+        }
+        else if (choice == 4)
+        {
+            return;
+        }
+        else
+        {
+            printf("Invalid Choice! Please Select a Valid Option.\n");
+        }
+    }
+}
+
+
+
+
+/* ArrowSource - Enum for the student values an Arrow column can hold */
+typedef enum
+{
+    ARROW_ROLL_NO,       // Roll number, utf8
+    ARROW_NAME,          // Name, utf8
+    ARROW_BRANCH,        // Branch, utf8 dictionary-encoded with int16 indices
+    ARROW_SEMESTER,      // Semester, uint8
+    ARROW_MARK_COLUMN,   // One mark column, uint8
+    ARROW_SUBJECT_TOTAL, // Theory + practical marks of a subject, uint8
+    ARROW_SUBJECT_GRADE  // Grade of a subject, utf8
+} ArrowSource;
+
+
+
+// ArrowColumn - One column of an Arrow export
+typedef struct
+{
+    char name[MAX_LINE_LENGTH];
+    ArrowSource source;
+    int index; // Mark column or subject the values come from
+
+} ArrowColumn;
+
+
+
+// FlatBuilder - Flatbuffer under construction. Like the reference builder it grows from the end of the buffer towards the
+// start, so every object is finished before the objects referring to it, and offsets are counted from the end
+typedef struct
+{
+    unsigned char *data;
+    int capacity;
+    int size;                    // Bytes built, at data + capacity - size
+    int minAlign;                // Largest alignment used, the finished buffer is padded to it
+    int tableStart;              // Size when the current table was started
+    int fieldCount;              // Fields in the vtable of the current table
+    int fields[FLAT_MAX_FIELDS]; // Size just after each field of the current table was added, 0 if it is absent
+    int failed;                  // Set if memory ran out
+
+} FlatBuilder;
+
+
+
+// ArrowBody - Body of an Arrow IPC message : its buffers, each padded to 8 bytes
+typedef struct
+{
+    unsigned char *data;
+    long long length;
+    long long capacity;
+    long long buffers[2 * 3 * ARROW_MAX_COLUMNS]; // Offset and length of every buffer, at most 3 buffers per column
+    int bufferCount;
+    int failed;
+
+} ArrowBody;
+
+
+
+// ArrowWriter - Arrow IPC file being written, one record batch at a time
+typedef struct
+{
+    FILE *fp;
+    long long position;                                // Bytes written to the file
+    ArrowColumn columns[ARROW_MAX_COLUMNS];
+    int columnCount;
+    char dictionary[ARROW_MAX_DICTIONARY][MAX_LENGTH]; // Distinct branches, a branch is stored as its index here
+    int dictionaryCount;
+    int lastCode;                                      // Dictionary index of the previous row's branch
+    long long dictionaryBlock[3];                      // Offset, metadata length and body length of the dictionary batch
+    long long *blocks;                                 // Same for every record batch, listed in the footer
+    int blockCount;
+    int blockCapacity;
+    long long rows;                                    // Rows written
+    int failed;
+
+} ArrowWriter;
+
+
+
+// ArrowArchiveExport - Context of the two passes of an Arrow export of an archive file
+typedef struct
+{
+    ArrowWriter *writer;
+    const CompiledQuery *query; // Query rows must match, NULL for all rows
+    int *matches;               // Indexes of the matching rows of the current batch
+
+} ArrowArchiveExport;
+
+
+
+
+/*
+flatPrep - Makes room for a value of additional bytes, padding first so that the value ends aligned to align bytes.
+*/
+static void flatPrep(FlatBuilder *b, int align, int additional)
+{
+    int pad = (-(b->size + additional)) & (align - 1);
+
+    if (align > b->minAlign)
+    {
+        b->minAlign = align;
+    }
+    if (b->failed)
+    {
+        return;
+    }
+
+    if (b->size + pad + additional > b->capacity)
+    {
+        int capacity = b->capacity > 0 ? b->capacity : 1024;
+        while (b->size + pad + additional > capacity)
+        {
+            capacity *= 2;
+        }
+
+        unsigned char *data = malloc(capacity);
+        if (data == NULL)
+        {
+            b->failed = 1;
+            return;
+        }
+        memcpy(data + capacity - b->size, b->data + b->capacity - b->size, b->size);
+        free(b->data);
+        b->data = data;
+        b->capacity = capacity;
+    }
+
+    memset(b->data + b->capacity - b->size - pad, 0, pad);
+    b->size += pad;
+}
+
+
+
+
+/*
+flatPush - Prepends a little endian scalar of 1 to 8 bytes, the room must have been made by flatPrep().
+*/
+static void flatPush(FlatBuilder *b, unsigned long long value, int bytes)
+{
+    if (b->failed)
+    {
+        return;
+    }
+
+    b->size += bytes;
+    unsigned char *p = b->data + b->capacity - b->size;
+    for (int i = 0; i < bytes; i++)
+    {
+        p[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+
+
+
+/*
+flatPushOffset - Prepends an offset to an object built earlier, given by the size of the builder just after it was built.
+*/
+static void flatPushOffset(FlatBuilder *b, int object)
+{
+    flatPrep(b, 4, 4);
+    flatPush(b, (unsigned int)(b->size + 4 - object), 4);
+}
+
+
+
+
+/*
+flatString - Builds a string : its length, the characters and a terminating zero.
+
+Returns:
+- The string, to be referred to by flatAddOffset() or a vector.
+*/
+static int flatString(FlatBuilder *b, const char *text)
+{
+    int length = (int)strlen(text);
+
+    flatPrep(b, 4, length + 1);
+    if (!b->failed)
+    {
+        b->size += length + 1;
+        memcpy(b->data + b->capacity - b->size, text, length + 1);
+    }
+    flatPrep(b, 4, 4);
+    flatPush(b, (unsigned int)length, 4);
+    return b->size;
+}
+
+
+
+
+/*
+flatOffsetVector - Builds a vector of offsets to tables or strings built earlier.
+*/
+static int flatOffsetVector(FlatBuilder *b, const int *objects, int count)
+{
+    flatPrep(b, 4, 4 * count);
+    for (int k = count - 1; k >= 0; k--)
+    {
+        flatPushOffset(b, objects[k]);
+    }
+    flatPrep(b, 4, 4);
+    flatPush(b, (unsigned int)count, 4);
+    return b->size;
+}
+
+
+
+
+/*
+flatStructVector - Builds a vector of structs made of structLongs 8-byte integers each.
+
+Arrow's FieldNode and Buffer structs are two longs. Its Block struct is a long, an int padded to 8 bytes and a long,
+which is laid out exactly like three longs on a little endian file.
+*/
+static int flatStructVector(FlatBuilder *b, const long long *values, int structLongs, int count)
+{
+    int longs = structLongs * count;
+
+    flatPrep(b, 4, 8 * longs);
+    flatPrep(b, 8, 8 * longs);
+    for (int k = longs - 1; k >= 0; k--)
+    {
+        flatPush(b, (unsigned long long)values[k], 8);
+    }
+    flatPrep(b, 4, 4);
+    flatPush(b, (unsigned int)count, 4);
+    return b->size;
+}
+
+
+
+
+/*
+flatStartTable - Starts a table of fieldCount fields. Strings, vectors and tables it refers to must be built before.
+*/
+static void flatStartTable(FlatBuilder *b, int fieldCount)
+{
+    memset(b->fields, 0, sizeof(b->fields));
+    b->fieldCount = fieldCount;
+    b->tableStart = b->size;
+}
+
+
+
+
+/*
+flatAddScalar - Adds a scalar field of 1 to 8 bytes to the current table.
+*/
+static void flatAddScalar(FlatBuilder *b, int field, long long value, int bytes)
+{
+    flatPrep(b, bytes, bytes);
+    flatPush(b, (unsigned long long)value, bytes);
+    b->fields[field] = b->size;
+}
+
+
+
+
+/*
+flatAddOffset - Adds a field referring to a string, vector or table to the current table.
+*/
+static void flatAddOffset(FlatBuilder *b, int field, int object)
+{
+    flatPushOffset(b, object);
+    b->fields[field] = b->size;
+}
+
+
+
+
+/*
+flatEndTable - Finishes the current table : the offset to its vtable, then the vtable holding the position of each field.
+
+Returns:
+- The table, to be referred to by flatAddOffset(), a vector or flatFinish().
+*/
+static int flatEndTable(FlatBuilder *b)
+{
+    int vtableBytes = 4 + 2 * b->fieldCount;
+
+    flatPrep(b, 4, 4);
+    flatPush(b, 0, 4); // Offset to the vtable, set below
+    int table = b->size;
+
+    flatPrep(b, 2, vtableBytes);
+    for (int f = b->fieldCount - 1; f >= 0; f--)
+    {
+        flatPush(b, b->fields[f] != 0 ? (unsigned int)(table - b->fields[f]) : 0, 2);
+    }
+    flatPush(b, (unsigned int)(table - b->tableStart), 2);
+    flatPush(b, (unsigned int)vtableBytes, 2);
+
+    if (!b->failed)
+    {
+        unsigned int vtable = (unsigned int)(b->size - table);
+        unsigned char *p = b->data + b->capacity - table;
+        for (int i = 0; i < 4; i++)
+        {
+            p[i] = (unsigned char)(vtable >> (8 * i));
+        }
+    }
+    return table;
+}
+
+
+
+
+/*
+flatFinish - Finishes the buffer with the offset to its root table. The buffer is data + capacity - size.
+*/
+static void flatFinish(FlatBuilder *b, int root)
+{
+    flatPrep(b, b->minAlign > 8 ? b->minAlign : 8, 4);
+    flatPushOffset(b, root);
+}
+
+
+
+
+/*
+flatIntType - Builds an Arrow Int type table.
+*/
+static int flatIntType(FlatBuilder *b, int bitWidth, int isSigned)
+{
+    flatStartTable(b, 2);
+    flatAddScalar(b, 0, bitWidth, 4);
+    flatAddScalar(b, 1, isSigned, 1);
+    return flatEndTable(b);
+}
+
+
+
+
+/*
+arrowSchema - Builds the Arrow Schema table of a writer's columns.
+
+Text columns are Utf8, numbers are unsigned 8-bit Ints, and the branch is Utf8 encoded with dictionary 0 and int16 indices.
+*/
+static int arrowSchema(FlatBuilder *b, const ArrowWriter *w)
+{
+    int fields[ARROW_MAX_COLUMNS];
+
+    for (int c = 0; c < w->columnCount; c++)
+    {
+        const ArrowColumn *column = &w->columns[c];
+        int text = (column->source == ARROW_ROLL_NO || column->source == ARROW_NAME || column->source == ARROW_BRANCH ||
+                    column->source == ARROW_SUBJECT_GRADE);
+        int dictionary = 0;
+        int type;
+
+        int name = flatString(b, column->name);
+        if (text)
+        {
+            flatStartTable(b, 0); // Utf8 has no fields
+            type = flatEndTable(b);
+        }
+        else
+        {
+            type = flatIntType(b, 8, 0);
+        }
+        if (column->source == ARROW_BRANCH)
+        {
+            int indexType = flatIntType(b, 16, 1);
+
+            flatStartTable(b, 3);
+            flatAddScalar(b, 0, 0, 8); // Dictionary id
+            flatAddOffset(b, 1, indexType);
+            flatAddScalar(b, 2, 0, 1); // Not ordered
+            dictionary = flatEndTable(b);
+        }
+        int children = flatOffsetVector(b, NULL, 0);
+
+        flatStartTable(b, 6);
+        flatAddOffset(b, 0, name);
+        flatAddScalar(b, 1, 0, 1);                  // Not nullable
+        flatAddScalar(b, 2, text ? 5 : 2, 1);       // Type union : Utf8 or Int
+        flatAddOffset(b, 3, type);
+        if (dictionary != 0)
+        {
+            flatAddOffset(b, 4, dictionary);
+        }
+        flatAddOffset(b, 5, children);
+        fields[c] = flatEndTable(b);
+    }
+
+    int fieldVector = flatOffsetVector(b, fields, w->columnCount);
+    flatStartTable(b, 2);
+    flatAddScalar(b, 0, 0, 2); // Little endian
+    flatAddOffset(b, 1, fieldVector);
+    return flatEndTable(b);
+}
+
+
+
+
+/*
+arrowRecordBatch - Builds an Arrow RecordBatch table from the field nodes and buffers of a body.
+*/
+static int arrowRecordBatch(FlatBuilder *b, long long length, const long long *nodes, int nodeCount, const ArrowBody *body)
+{
+    int nodeVector = flatStructVector(b, nodes, 2, nodeCount);
+    int bufferVector = flatStructVector(b, body->buffers, 2, body->bufferCount);
+
+    flatStartTable(b, 3);
+    flatAddScalar(b, 0, length, 8);
+    flatAddOffset(b, 1, nodeVector);
+    flatAddOffset(b, 2, bufferVector);
+    return flatEndTable(b);
+}
+
+
+
+
+/*
+arrowMessage - Builds and finishes an Arrow Message table (metadata version 5) around a header.
+*/
+static void arrowMessage(FlatBuilder *b, int headerType, int header, long long bodyLength)
+{
+    flatStartTable(b, 4);
+    flatAddScalar(b, 3, bodyLength, 8);
+    flatAddOffset(b, 2, header);
+    flatAddScalar(b, 0, 4, 2); // MetadataVersion V5
+    flatAddScalar(b, 1, headerType, 1);
+    flatFinish(b, flatEndTable(b));
+}
+
+
+
+
+/*
+arrowBodyBuffer - Adds a buffer of length bytes to a message body, padded to 8 bytes with zeros.
+
+Returns:
+- Where the buffer's bytes are to be written, valid until the next buffer is added; NULL if memory ran out.
+*/
+static unsigned char *arrowBodyBuffer(ArrowBody *body, long long length)
+{
+    long long padded = (length + 7) & ~7LL;
+
+    if (body->failed)
+    {
+        return NULL;
+    }
+    if (body->length + padded > body->capacity)
+    {
+        long long capacity = body->capacity > 0 ? body->capacity : 65536;
+        while (body->length + padded > capacity)
+        {
+            capacity *= 2;
+        }
+
+        unsigned char *data = realloc(body->data, (size_t)capacity);
+        if (data == NULL)
+        {
+            body->failed = 1;
+            return NULL;
+        }
+        body->data = data;
+        body->capacity = capacity;
+    }
+
+    unsigned char *buffer = body->data + body->length;
+    memset(buffer + length, 0, (size_t)(padded - length));
+    body->buffers[2 * body->bufferCount] = body->length;
+    body->buffers[2 * body->bufferCount + 1] = length;
+    body->bufferCount++;
+    body->length += padded;
+    return buffer;
+}
+
+
+
+
+/*
+arrowWriteMessage - Writes a finished message to the file : the continuation marker, the metadata length, the metadata
+padded to 8 bytes and the body.
+
+Parameters:
+- block: Receives the offset, metadata length and body length of the message, as listed in the footer (may be NULL).
+*/
+static void arrowWriteMessage(ArrowWriter *w, const FlatBuilder *b, const ArrowBody *body, long long *block)
+{
+    static const unsigned char zeros[8] = {0};
+    unsigned char prefix[8] = {0xFF, 0xFF, 0xFF, 0xFF};
+    int metadataLength = (b->size + 7) & ~7;
+    long long bodyLength = (body != NULL) ? body->length : 0;
+
+    if (b->failed || (body != NULL && body->failed))
+    {
+        w->failed = 1;
+        return;
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        prefix[4 + i] = (unsigned char)((unsigned int)metadataLength >> (8 * i));
+    }
+    if (fwrite(prefix, 1, 8, w->fp) != 8 || fwrite(b->data + b->capacity - b->size, 1, b->size, w->fp) != (size_t)b->size ||
+        fwrite(zeros, 1, metadataLength - b->size, w->fp) != (size_t)(metadataLength - b->size) ||
+        (bodyLength > 0 && fwrite(body->data, 1, (size_t)bodyLength, w->fp) != (size_t)bodyLength))
+    {
+        w->failed = 1;
+        return;
+    }
+
+    if (block != NULL)
+    {
+        block[0] = w->position;
+        block[1] = 8 + metadataLength;
+        block[2] = bodyLength;
+    }
+    w->position += 8 + metadataLength + bodyLength;
+}
+
+
+
+
+/*
+arrowColumnText - Value of a text column for a student.
+*/
+static const char *arrowColumnText(const ArrowColumn *column, const Student *s)
+{
+    if (column->source == ARROW_ROLL_NO)
+    {
+        return s->rollNo;
+    }
+    if (column->source == ARROW_NAME)
+    {
+        return s->name;
+    }
+    if (column->source == ARROW_BRANCH)
+    {
+        return s->branch;
+    }
+
+    int marks = subjectTotalMarks(s, column->index);
+    marks = marks < 0 ? 0 : marks > MAX_SUBJECT_MARKS ? MAX_SUBJECT_MARKS : marks;
+    return gradeScale[gradeLookup[column->index][marks]].grade;
+}
+
+
+
+
+/*
+arrowColumnNumber - Value of a uint8 column for a student, clamped to 0-255.
+*/
+static int arrowColumnNumber(const ArrowColumn *column, const Student *s)
+{
+    int value;
+
+    if (column->source == ARROW_SEMESTER)
+        value = s->semester;
+    else if (column->source == ARROW_MARK_COLUMN)
+        value = markColumnValue(s, column->index);
+    else
+        value = subjectTotalMarks(s, column->index);
+
+    return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+
+
+
+/*
+arrowDictionaryCode - Index of a branch in the writer's dictionary, -1 if it is not there.
+*/
+static int arrowDictionaryCode(ArrowWriter *w, const char *branch)
+{
+    if (w->lastCode < w->dictionaryCount && strcmp(w->dictionary[w->lastCode], branch) == 0)
+    {
+        return w->lastCode;
+    }
+    for (int code = 0; code < w->dictionaryCount; code++)
+    {
+        if (strcmp(w->dictionary[code], branch) == 0)
+        {
+            w->lastCode = code;
+            return code;
+        }
+    }
+    return -1;
+}
+
+
+
+
+/*
+arrowCollectDictionary - Adds the branches of students (those listed in indexes, or all rows if NULL) to the dictionary.
+
+The dictionary batch is written before the first record batch, so every branch must be collected before arrowOpen().
+*/
+void arrowCollectDictionary(ArrowWriter *w, const Student *rows, const int *indexes, int count)
+{
+    for (int k = 0; k < count; k++)
+    {
+        const Student *s = &rows[indexes != NULL ? indexes[k] : k];
+
+        if (arrowDictionaryCode(w, s->branch) != -1)
+        {
+            continue;
+        }
+        if (w->dictionaryCount == ARROW_MAX_DICTIONARY)
+        {
+            w->failed = 1;
+            return;
+        }
+        snprintf(w->dictionary[w->dictionaryCount++], MAX_LENGTH, "%s", s->branch);
+    }
+}
+
+
+
+
+/*
+arrowStudentColumns - Sets the columns of a full student export : roll number, name, branch, semester and every mark column.
+*/
+void arrowStudentColumns(ArrowWriter *w)
+{
+    static const ArrowSource sources[] = {ARROW_ROLL_NO, ARROW_NAME, ARROW_BRANCH, ARROW_SEMESTER};
+    static const char *names[] = {"RollNo", "Name", "Branch", "Semester"};
+
+    memset(w, 0, sizeof(ArrowWriter));
+    for (int c = 0; c < 4; c++)
+    {
+        strcpy(w->columns[c].name, names[c]);
+        w->columns[c].source = sources[c];
+    }
+    for (int col = 0; col < NUM_MARK_COLUMNS; col++)
+    {
+        markColumnName(col, w->columns[4 + col].name);
+        w->columns[4 + col].source = ARROW_MARK_COLUMN;
+        w->columns[4 + col].index = col;
+    }
+    w->columnCount = 4 + NUM_MARK_COLUMNS;
+}
+
+
+
+
+/*
+arrowSubjectColumns - Sets the columns of a subject-wise export : the student, the subject's theory and practical marks
+(those the subject has), its total and the grade.
+*/
+void arrowSubjectColumns(ArrowWriter *w, int subjectIndex)
+{
+    arrowStudentColumns(w);
+    w->columnCount = 4;
+    mapSubjectColumns();
+
+    if (subjectTheoryColumn[subjectIndex] != -1)
+    {
+        strcpy(w->columns[w->columnCount].name, "Theory");
+        w->columns[w->columnCount].source = ARROW_MARK_COLUMN;
+        w->columns[w->columnCount++].index = subjectTheoryColumn[subjectIndex];
+    }
+    if (subjectPracticalColumn[subjectIndex] != -1)
+    {
+        strcpy(w->columns[w->columnCount].name, "Practical");
+        w->columns[w->columnCount].source = ARROW_MARK_COLUMN;
+        w->columns[w->columnCount++].index = NUM_SUBJECTS + subjectPracticalColumn[subjectIndex];
+    }
+    strcpy(w->columns[w->columnCount].name, "Total");
+    w->columns[w->columnCount].source = ARROW_SUBJECT_TOTAL;
+    w->columns[w->columnCount++].index = subjectIndex;
+    strcpy(w->columns[w->columnCount].name, "Grade");
+    w->columns[w->columnCount].source = ARROW_SUBJECT_GRADE;
+    w->columns[w->columnCount++].index = subjectIndex;
+}
+
+
+
+
+/*
+arrowOpen - Creates an Arrow IPC file : the magic, the schema message and the dictionary batch of the branches.
+
+Returns:
+- 0 on success, -1 if the file could not be created or too many branches were collected.
+*/
+int arrowOpen(ArrowWriter *w, const char *fileName)
+{
+    static const char magic[8] = ARROW_MAGIC;
+    FlatBuilder b;
+    ArrowBody body;
+
+    if (w->failed)
+    {
+        printf("Error : More Than %d Branches, They Cannot Be Exported to Arrow.\n", ARROW_MAX_DICTIONARY);
+        return -1;
+    }
+
+    w->fp = fopen(fileName, "wb");
+    if (w->fp == NULL)
+    {
+        printf("Error : Could not open file to save results.\n");
+        return -1;
+    }
+    setvbuf(w->fp, NULL, _IOFBF, REPORT_BUFFER_SIZE);
+    w->failed = fwrite(magic, 1, 8, w->fp) != 8; // "ARROW1" padded to 8 bytes
+    w->position = 8;
+
+    memset(&b, 0, sizeof(b));
+    arrowMessage(&b, 1, arrowSchema(&b, w), 0);
+    arrowWriteMessage(w, &b, NULL, NULL);
+
+    // Dictionary batch : one utf8 column holding the branches
+    long long node[2] = {w->dictionaryCount, 0};
+    int textLength = 0;
+
+    memset(&body, 0, sizeof(body));
+    arrowBodyBuffer(&body, 0); // No validity bitmap, there are no nulls
+    unsigned char *offsets = arrowBodyBuffer(&body, 4 * (w->dictionaryCount + 1));
+    for (int code = 0; offsets != NULL && code <= w->dictionaryCount; code++)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            offsets[4 * code + i] = (unsigned char)((unsigned int)textLength >> (8 * i));
+        }
+        textLength += (code < w->dictionaryCount) ? (int)strlen(w->dictionary[code]) : 0;
+    }
+    unsigned char *text = arrowBodyBuffer(&body, textLength);
+    for (int code = 0; text != NULL && code < w->dictionaryCount; code++)
+    {
+        int length = (int)strlen(w->dictionary[code]);
+        memcpy(text, w->dictionary[code], length);
+        text += length;
+    }
+
+    b.size = 0;
+    b.minAlign = 0;
+    int batch = arrowRecordBatch(&b, w->dictionaryCount, node, 1, &body);
+    flatStartTable(&b, 3);
+    flatAddScalar(&b, 0, 0, 8); // Dictionary id
+    flatAddOffset(&b, 1, batch);
+    flatAddScalar(&b, 2, 0, 1); // Not a delta
+    arrowMessage(&b, 2, flatEndTable(&b), body.length);
+    arrowWriteMessage(w, &b, &body, w->dictionaryBlock);
+
+    free(b.data);
+    free(body.data);
+    if (w->failed)
+    {
+        printf("Error : Could Not Write %s.\n", fileName);
+        fclose(w->fp);
+        return -1;
+    }
+    return 0;
+}
+
+
+
+
+/*
+arrowWriteBatch - Writes students (those listed in indexes, or all rows if NULL) as one record batch.
+
+Each column is laid out as Arrow expects : an empty validity bitmap, then the uint8 values, the int16 dictionary
+indices, or the int32 offsets and the characters of a utf8 column.
+*/
+void arrowWriteBatch(ArrowWriter *w, const Student *rows, const int *indexes, int count)
+{
+    long long nodes[2 * ARROW_MAX_COLUMNS];
+    ArrowBody body;
+    FlatBuilder b;
+
+    if (count <= 0 || w->failed)
+    {
+        return;
+    }
+
+    memset(&body, 0, sizeof(body));
+    for (int c = 0; c < w->columnCount; c++)
+    {
+        const ArrowColumn *column = &w->columns[c];
+        int k;
+
+        nodes[2 * c] = count;
+        nodes[2 * c + 1] = 0;
+        arrowBodyBuffer(&body, 0);
+
+        if (column->source == ARROW_BRANCH)
+        {
+            unsigned char *codes = arrowBodyBuffer(&body, 2LL * count);
+            for (k = 0; codes != NULL && k < count; k++)
+            {
+                int code = arrowDictionaryCode(w, rows[indexes != NULL ? indexes[k] : k].branch);
+                codes[2 * k] = (unsigned char)(code & 0xFF);
+                codes[2 * k + 1] = (unsigned char)(code >> 8);
+            }
+        }
+        else if (column->source == ARROW_ROLL_NO || column->source == ARROW_NAME || column->source == ARROW_SUBJECT_GRADE)
+        {
+            unsigned char *offsets = arrowBodyBuffer(&body, 4LL * (count + 1));
+            unsigned int textLength = 0;
+
+            for (k = 0; offsets != NULL && k <= count; k++)
+            {
+                for (int i = 0; i < 4; i++)
+                {
+                    offsets[4 * k + i] = (unsigned char)(textLength >> (8 * i));
+                }
+                textLength += (k < count) ? (unsigned int)strlen(arrowColumnText(column, &rows[indexes != NULL ? indexes[k] : k])) : 0;
+            }
+
+            unsigned char *text = arrowBodyBuffer(&body, textLength);
+            for (k = 0; text != NULL && k < count; k++)
+            {
+                const char *value = arrowColumnText(column, &rows[indexes != NULL ? indexes[k] : k]);
+                size_t length = strlen(value);
+                memcpy(text, value, length);
+                text += length;
+            }
+        }
+        else
+        {
+            unsigned char *values = arrowBodyBuffer(&body, count);
+            for (k = 0; values != NULL && k < count; k++)
+            {
+                values[k] = (unsigned char)arrowColumnNumber(column, &rows[indexes != NULL ? indexes[k] : k]);
+            }
+        }
+    }
+
+    if (w->blockCount == w->blockCapacity)
+    {
+        int capacity = w->blockCapacity > 0 ? w->blockCapacity * 2 : 64;
+        long long *blocks = realloc(w->blocks, 3 * capacity * sizeof(long long));
+
+        if (blocks == NULL)
+        {
+            w->failed = 1;
+            free(body.data);
+            return;
+        }
+        w->blocks = blocks;
+        w->blockCapacity = capacity;
+    }
+
+    memset(&b, 0, sizeof(b));
+    arrowMessage(&b, 3, arrowRecordBatch(&b, count, nodes, w->columnCount, &body), body.length);
+    arrowWriteMessage(w, &b, &body, &w->blocks[3 * w->blockCount]);
+    if (!w->failed)
+    {
+        w->blockCount++;
+        w->rows += count;
+    }
+
+    free(b.data);
+    free(body.data);
+}
+
+
+
+
+/*
+arrowClose - Finishes an Arrow IPC file : the end-of-stream marker, the footer listing the schema and the position of
+every batch, the footer's length and the closing magic. The writer's memory is freed.
+
+Returns:
+- 0 on success, -1 if the file could not be written completely.
+*/
+int arrowClose(ArrowWriter *w)
+{
+    static const unsigned char endOfStream[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0};
+    unsigned char trailer[10] = {0, 0, 0, 0, 'A', 'R', 'R', 'O', 'W', '1'};
+    FlatBuilder b;
+
+    memset(&b, 0, sizeof(b));
+    int schema = arrowSchema(&b, w);
+    int dictionaries = flatStructVector(&b, w->dictionaryBlock, 3, 1);
+    int batches = flatStructVector(&b, w->blocks, 3, w->blockCount);
+    flatStartTable(&b, 4);
+    flatAddOffset(&b, 1, schema);
+    flatAddOffset(&b, 2, dictionaries);
+    flatAddOffset(&b, 3, batches);
+    flatAddScalar(&b, 0, 4, 2); // MetadataVersion V5
+    flatFinish(&b, flatEndTable(&b));
+
+    int failed = w->failed || b.failed || fwrite(endOfStream, 1, 8, w->fp) != 8 ||
+                 fwrite(b.data + b.capacity - b.size, 1, b.size, w->fp) != (size_t)b.size;
+    for (int i = 0; i < 4; i++)
+    {
+        trailer[i] = (unsigned char)((unsigned int)b.size >> (8 * i));
+    }
+    failed = failed || fwrite(trailer, 1, sizeof(trailer), w->fp) != sizeof(trailer);
+    failed = (fclose(w->fp) != 0) || failed;
+
+    free(b.data);
+    free(w->blocks);
+    w->blocks = NULL;
+    return failed ? -1 : 0;
+}
+
+
+
+
+/*
+exportArrow - Writes students (those listed in indexes, or all rows if NULL) to an Arrow IPC file, in record batches of
+ARROW_BATCH_ROWS students. The writer's columns must be set.
+
+Returns:
+- 0 on success, -1 otherwise.
+*/
+int exportArrow(ArrowWriter *w, const char *fileName, const Student *rows, const int *indexes, int count)
+{
+    DWORD startTime = GetTickCount();
+
+    arrowCollectDictionary(w, rows, indexes, count);
+    if (arrowOpen(w, fileName) != 0)
+    {
+        return -1;
+    }
+    for (int first = 0; first < count; first += ARROW_BATCH_ROWS)
+    {
+        int batchRows = (count - first < ARROW_BATCH_ROWS) ? count - first : ARROW_BATCH_ROWS;
+        arrowWriteBatch(w, indexes != NULL ? rows : rows + first, indexes != NULL ? indexes + first : NULL, batchRows);
+    }
+    if (arrowClose(w) != 0)
+    {
+        printf("Error : Could Not Write %s.\n", fileName);
+        return -1;
+    }
+
+    printf("%lld Students Exported to '%s' (Arrow IPC, %lu ms).\n", w->rows, fileName, (unsigned long)(GetTickCount() - startTime));
+    return 0;
+}
+
+
+
+
+/*
+exportArrowStudents - Exports students with all their mark columns to an Arrow IPC file.
+*/
+int exportArrowStudents(const char *fileName, const Student *rows, const int *indexes, int count)
+{
+    ArrowWriter writer;
+
+    arrowStudentColumns(&writer);
+    return exportArrow(&writer, fileName, rows, indexes, count);
+}
+
+
+
+
+/*
+exportArrowSubject - Exports the subject-wise result of one subject to an Arrow IPC file.
+*/
+int exportArrowSubject(const char *fileName, int subjectIndex, const Student *rows, const int *indexes, int count)
+{
+    ArrowWriter writer;
+
+    arrowSubjectColumns(&writer, subjectIndex);
+    return exportArrow(&writer, fileName, rows, indexes, count);
+}
+
+
+
+
+/*
+arrowArchiveDictionaryBatch - Streaming handler of the first pass of an archive export, collecting the branches.
+*/
+void arrowArchiveDictionaryBatch(const Student *batch, const StudentGrades *grades, int count, void *context)
+{
+    ArrowArchiveExport *scan = (ArrowArchiveExport *)context;
+    const int *indexes = NULL;
+
+    if (scan->query != NULL)
+    {
+        count = runQuery(scan->query, batch, grades, count, scan->matches);
+        indexes = scan->matches;
+    }
+    arrowCollectDictionary(scan->writer, batch, indexes, count);
+}
+
+
+
+
+/*
+arrowArchiveBatch - Streaming handler of the second pass of an archive export, writing each batch as a record batch.
+*/
+void arrowArchiveBatch(const Student *batch, const StudentGrades *grades, int count, void *context)
+{
+    ArrowArchiveExport *scan = (ArrowArchiveExport *)context;
+    const int *indexes = NULL;
+
+    if (scan->query != NULL)
+    {
+        count = runQuery(scan->query, batch, grades, count, scan->matches);
+        indexes = scan->matches;
+    }
+    arrowWriteBatch(scan->writer, batch, indexes, count);
+}
+
+
+
+
+/*
+archiveArrowExport - Exports the students of an archive file matching a query to ARCHIVE_ARROW_FILE.
+
+The file is streamed twice in bounded memory : once to collect the branches, whose dictionary batch must come first,
+then to write every streamed batch of matching students as its own record batch.
+*/
+void archiveArrowExport(const char *archiveFile)
+{
+    CompiledQuery query;
+    ArrowArchiveExport scan;
+    ArrowWriter *writer = malloc(sizeof(ArrowWriter));
+
+    clearInputBuffer();
+    int hasQuery = readArchiveQuery(&query);
+    scan.matches = malloc(STREAM_BATCH_ROWS * sizeof(int));
+    if (hasQuery < 0 || writer == NULL || scan.matches == NULL)
+    {
+        free(writer);
+        free(scan.matches);
+        return;
+    }
+
+    DWORD startTime = GetTickCount();
+    arrowStudentColumns(writer);
+    scan.writer = writer;
+    scan.query = hasQuery ? &query : NULL;
+
+    long long rows = streamStudentFile(archiveFile, arrowArchiveDictionaryBatch, &scan);
+    if (rows < 0)
+    {
+        printf("Error : Could Not Read Archive File %s.\n", archiveFile);
+    }
+    else if (arrowOpen(writer, ARCHIVE_ARROW_FILE) == 0)
+    {
+        rows = streamStudentFile(archiveFile, arrowArchiveBatch, &scan);
+        if (arrowClose(writer) != 0 || rows < 0)
+        {
+            printf("Error : Could Not Write %s.\n", ARCHIVE_ARROW_FILE);
+        }
+        else
+        {
+            printf("%lld of %lld Students saved to '%s' (Arrow IPC, %d Record Batches, %lu ms).\n", writer->rows, rows,
+                   ARCHIVE_ARROW_FILE, writer->blockCount, (unsigned long)(GetTickCount() - startTime));
+        }
+    }
+
+    free(writer->blocks);
+    free(writer);
+    free(scan.matches);
+}
+
+
+
+
+// Deflater - Streaming deflate compressor : LZ77 matches over a 32 KB window, coded with the fixed Huffman codes
+typedef struct
+{
+    unsigned char window[2 * DEFLATE_WINDOW]; // Up to DEFLATE_WINDOW bytes already compressed, then the bytes waiting
+    int length;                               // Bytes in window
+    int position;                             // Next byte of window to compress
+    int head[DEFLATE_HASH_SIZE];              // Latest position of each hash of 3 bytes, -1 if none
+    int prev[DEFLATE_WINDOW];                 // Previous position with the same hash, indexed by position % DEFLATE_WINDOW
+    unsigned int bits;                        // Bits not written yet, the first one lowest
+    int bitCount;
+    unsigned char output[DEFLATE_OUTPUT_SIZE]; // Compressed bytes not written yet
+    int outputLength;
+
+} Deflater;
+
+
+
+// ZipEntry - File of a zip archive, listed in the central directory
+typedef struct
+{
+    char name[64];
+    unsigned int crc;
+    long long compressedSize;
+    long long size;
+    long long offset; // Offset of the local header
+
+} ZipEntry;
+
+
+
+// ZipWriter - Zip archive written in one pass : every entry is deflated as it is written and followed by a data descriptor
+typedef struct
+{
+    FILE *fp;
+    long long position; // Bytes written to the file
+    ZipEntry entries[ZIP_MAX_ENTRIES];
+    int entryCount;
+    Deflater deflater;  // Compressor of the current entry
+    int failed;
+
+} ZipWriter;
+
+
+
+// XlsxWriter - Excel workbook whose worksheets are streamed row by row into the zip archive
+typedef struct
+{
+    ZipWriter zip;
+    char sheets[XLSX_MAX_SHEETS][32]; // Worksheet names, Excel allows 31 characters
+    int sheetCount;
+    long rowCount;                    // Rows of the current worksheet
+    int columnCount;                  // Cells of the current row
+    int rowOpen;                      // Set while a row is being written
+
+} XlsxWriter;
+
+
+
+// XlsxArchiveExport - Context of an Excel export of an archive file
+typedef struct
+{
+    XlsxWriter *writer;
+    const CompiledQuery *query; // Query rows must match, NULL for all rows
+    int *matches;               // Indexes of the matching rows of the current batch
+    long long matched;          // Students written
+
+} XlsxArchiveExport;
+
+
+
+// Deflate length and distance codes : base value and extra bits of every symbol
+static const unsigned short deflateLengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                                     35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const unsigned char deflateLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                                     3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const unsigned short deflateDistanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+                                                       513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const unsigned char deflateDistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7,
+                                                       8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+
+
+
+/*
+crc32Update - Updates the CRC-32 of a zip entry with more bytes.
+*/
+static unsigned int crc32Update(unsigned int crc, const unsigned char *data, size_t length)
+{
+    static unsigned int table[256];
+    static int tableBuilt = 0;
+
+    if (!tableBuilt)
+    {
+        for (unsigned int n = 0; n < 256; n++)
+        {
+            unsigned int c = n;
+            for (int k = 0; k < 8; k++)
+            {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+        tableBuilt = 1;
+    }
+
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+
+
+
+/*
+zipWriteBytes - Writes bytes to the zip file, counting the compressed size of the current entry.
+*/
+static void zipWriteBytes(ZipWriter *z, const void *data, size_t length, int compressed)
+{
+    if (z->failed || fwrite(data, 1, length, z->fp) != length)
+    {
+        z->failed = 1;
+        return;
+    }
+    z->position += length;
+    if (compressed)
+    {
+        z->entries[z->entryCount - 1].compressedSize += length;
+    }
+}
+
+
+
+
+/*
+deflatePutBits - Appends bits to the compressed stream, lowest bit first.
+*/
+static void deflatePutBits(ZipWriter *z, unsigned int value, int count)
+{
+    Deflater *d = &z->deflater;
+
+    d->bits |= value << d->bitCount;
+    d->bitCount += count;
+    while (d->bitCount >= 8)
+    {
+        d->output[d->outputLength++] = (unsigned char)d->bits;
+        d->bits >>= 8;
+        d->bitCount -= 8;
+        if (d->outputLength == DEFLATE_OUTPUT_SIZE)
+        {
+            zipWriteBytes(z, d->output, DEFLATE_OUTPUT_SIZE, 1);
+            d->outputLength = 0;
+        }
+    }
+}
+
+
+
+
+/*
+deflatePutCode - Appends a Huffman code, which deflate stores from its highest bit.
+*/
+static void deflatePutCode(ZipWriter *z, unsigned int code, int length)
+{
+    unsigned int reversed = 0;
+
+    for (int i = 0; i < length; i++)
+    {
+        reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    deflatePutBits(z, reversed, length);
+}
+
+
+
+
+/*
+deflatePutSymbol - Appends a literal/length symbol with its fixed Huffman code.
+*/
+static void deflatePutSymbol(ZipWriter *z, int symbol)
+{
+    if (symbol < 144)
+        deflatePutCode(z, 0x30 + symbol, 8);
+    else if (symbol < 256)
+        deflatePutCode(z, 0x190 + symbol - 144, 9);
+    else if (symbol < 280)
+        deflatePutCode(z, symbol - 256, 7);
+    else
+        deflatePutCode(z, 0xC0 + symbol - 280, 8);
+}
+
+
+
+
+/*
+deflatePutMatch - Appends a match : the length symbol and its extra bits, then the distance code and its extra bits.
+*/
+static void deflatePutMatch(ZipWriter *z, int length, int distance)
+{
+    int code = 28;
+    while (deflateLengthBase[code] > length)
+    {
+        code--;
+    }
+    deflatePutSymbol(z, 257 + code);
+    deflatePutBits(z, length - deflateLengthBase[code], deflateLengthExtra[code]);
+
+    code = 29;
+    while (deflateDistanceBase[code] > distance)
+    {
+        code--;
+    }
+    deflatePutCode(z, code, 5);
+    deflatePutBits(z, distance - deflateDistanceBase[code], deflateDistanceExtra[code]);
+}
+
+
+
+
+/*
+deflateInsert - Adds the 3 bytes at a window position to the hash chains.
+*/
+static void deflateInsert(Deflater *d, int position)
+{
+    const unsigned char *p = d->window + position;
+    int hash = ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & (DEFLATE_HASH_SIZE - 1);
+
+    d->prev[position & (DEFLATE_WINDOW - 1)] = d->head[hash];
+    d->head[hash] = position;
+}
+
+
+
+
+/*
+deflateCompress - Compresses the waiting bytes of the window. Unless final, the last DEFLATE_MAX_MATCH bytes are kept
+back so a match can still be extended by the bytes that follow them.
+
+Each position takes the longest of the last DEFLATE_MAX_CHAIN earlier positions with the same hash, so the
+repetitive worksheet XML compresses well at a bounded cost per byte.
+*/
+static void deflateCompress(ZipWriter *z, int final)
+{
+    Deflater *d = &z->deflater;
+    int limit = final ? d->length : d->length - DEFLATE_MAX_MATCH;
+
+    while (d->position < limit)
+    {
+        int best = 0, distance = 0;
+        int maxLength = d->length - d->position;
+        maxLength = maxLength < DEFLATE_MAX_MATCH ? maxLength : DEFLATE_MAX_MATCH;
+
+        if (maxLength >= 3)
+        {
+            const unsigned char *p = d->window + d->position;
+            int candidate = d->head[((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & (DEFLATE_HASH_SIZE - 1)];
+
+            for (int chain = 0; chain < DEFLATE_MAX_CHAIN && candidate >= 0 && d->position - candidate <= DEFLATE_WINDOW; chain++)
+            {
+                const unsigned char *q = d->window + candidate;
+                int length = 0;
+
+                // A longer match must also agree on the byte the best one ended at, which rules most candidates out at once
+                if (q[best] == p[best] || best == 0)
+                {
+                    while (length < maxLength && q[length] == p[length])
+                    {
+                        length++;
+                    }
+                }
+                if (length > best)
+                {
+                    best = length;
+                    distance = d->position - candidate;
+                    if (length == maxLength)
+                    {
+                        break;
+                    }
+                }
+
+                int next = d->prev[candidate & (DEFLATE_WINDOW - 1)];
+                if (next >= candidate)
+                {
+                    break; // The slot was reused by a newer position, the chain ends here
+                }
+                candidate = next;
+            }
+            deflateInsert(d, d->position);
+        }
+
+        if (best >= 3)
+        {
+            deflatePutMatch(z, best, distance);
+            for (int k = 1; k < best; k++)
+            {
+                if (d->position + k + 2 < d->length)
+                {
+                    deflateInsert(d, d->position + k);
+                }
+            }
+            d->position += best;
+        }
+        else
+        {
+            deflatePutSymbol(z, d->window[d->position]);
+            d->position++;
+        }
+    }
+}
+
+
+
+
+/*
+zipBeginEntry - Starts a deflated entry. Its CRC and sizes are not known yet, they follow the data in a data descriptor.
+*/
+void zipBeginEntry(ZipWriter *z, const char *name)
+{
+    unsigned char header[30] = {0x50, 0x4B, 0x03, 0x04, 20, 0, 0x08, 0, 8, 0, 0, 0, 0x21, 0}; // Deflated, sizes after the data, 1 Jan 1980
+    int nameLength = (int)strlen(name);
+
+    if (z->failed || z->entryCount == ZIP_MAX_ENTRIES)
+    {
+        z->failed = 1;
+        return;
+    }
+
+    ZipEntry *entry = &z->entries[z->entryCount++];
+    memset(entry, 0, sizeof(ZipEntry));
+    snprintf(entry->name, sizeof(entry->name), "%s", name);
+    entry->offset = z->position;
+
+    header[26] = (unsigned char)nameLength;
+    zipWriteBytes(z, header, sizeof(header), 0);
+    zipWriteBytes(z, name, nameLength, 0);
+
+    Deflater *d = &z->deflater;
+    d->length = 0;
+    d->position = 0;
+    d->bits = 0;
+    d->bitCount = 0;
+    d->outputLength = 0;
+    memset(d->head, 0xFF, sizeof(d->head)); // -1 everywhere
+    deflatePutBits(z, 0, 1);                // Not the last block
+    deflatePutBits(z, 1, 2);                // Fixed Huffman codes
+}
+
+
+
+
+/*
+zipWrite - Adds bytes to the current entry. They are compressed whenever the window is full, so memory stays constant.
+*/
+void zipWrite(ZipWriter *z, const void *data, size_t length)
+{
+    Deflater *d = &z->deflater;
+    const unsigned char *bytes = (const unsigned char *)data;
+    ZipEntry *entry = &z->entries[z->entryCount - 1];
+
+    if (z->failed)
+    {
+        return;
+    }
+    entry->crc = crc32Update(entry->crc, bytes, length);
+    entry->size += length;
+
+    while (length > 0)
+    {
+        if (d->length == 2 * DEFLATE_WINDOW)
+        {
+            deflateCompress(z, 0);
+
+            // Slide the window : keep the last DEFLATE_WINDOW bytes as history for the next matches
+            memmove(d->window, d->window + DEFLATE_WINDOW, d->length - DEFLATE_WINDOW);
+            d->length -= DEFLATE_WINDOW;
+            d->position -= DEFLATE_WINDOW;
+            for (int h = 0; h < DEFLATE_HASH_SIZE; h++)
+            {
+                d->head[h] = d->head[h] >= DEFLATE_WINDOW ? d->head[h] - DEFLATE_WINDOW : -1;
+            }
+            for (int k = 0; k < DEFLATE_WINDOW; k++)
+            {
+                d->prev[k] = d->prev[k] >= DEFLATE_WINDOW ? d->prev[k] - DEFLATE_WINDOW : -1;
+            }
+        }
+
+        size_t take = 2 * DEFLATE_WINDOW - d->length;
+        take = take < length ? take : length;
+        memcpy(d->window + d->length, bytes, take);
+        d->length += (int)take;
+        bytes += take;
+        length -= take;
+    }
+}
+
+
+
+
+/*
+zipEndEntry - Compresses the rest of the current entry, ends the deflate stream with an empty last block, and writes
+the data descriptor.
+*/
+void zipEndEntry(ZipWriter *z)
+{
+    Deflater *d = &z->deflater;
+    ZipEntry *entry = &z->entries[z->entryCount - 1];
+    unsigned char descriptor[16] = {0x50, 0x4B, 0x07, 0x08};
+
+    deflateCompress(z, 1);
+    deflatePutSymbol(z, 256); // End of block
+    deflatePutBits(z, 1, 1);  // Last block
+    deflatePutBits(z, 1, 2);  // Fixed Huffman codes
+    deflatePutSymbol(z, 256);
+    deflatePutBits(z, 0, (8 - d->bitCount) % 8); // Flush the last partial byte
+    zipWriteBytes(z, d->output, d->outputLength, 1);
+
+    if (entry->size > 0xFFFFFFFFLL || z->position > 0xFFFFFFFFLL)
+    {
+        printf("Error : The Workbook Is Larger Than 4 GB.\n");
+        z->failed = 1;
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        descriptor[4 + i] = (unsigned char)(entry->crc >> (8 * i));
+        descriptor[8 + i] = (unsigned char)(entry->compressedSize >> (8 * i));
+        descriptor[12 + i] = (unsigned char)(entry->size >> (8 * i));
+    }
+    zipWriteBytes(z, descriptor, sizeof(descriptor), 0);
+}
+
+
+
+
+/*
+zipClose - Writes the central directory listing every entry and closes the file.
+
+Returns:
+- 0 on success, -1 if anything could not be written.
+*/
+int zipClose(ZipWriter *z)
+{
+    unsigned char record[46];
+    long long directory = z->position;
+
+    for (int k = 0; k < z->entryCount; k++)
+    {
+        const ZipEntry *entry = &z->entries[k];
+        unsigned long long fields[4] = {entry->crc, (unsigned long long)entry->compressedSize, (unsigned long long)entry->size, 0};
+        int nameLength = (int)strlen(entry->name);
+
+        memset(record, 0, sizeof(record));
+        memcpy(record, "\x50\x4B\x01\x02\x14\x00\x14\x00\x08\x00\x08\x00\x00\x00\x21\x00", 16);
+        for (int f = 0; f < 3; f++)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                record[16 + 4 * f + i] = (unsigned char)(fields[f] >> (8 * i));
+            }
+        }
+        record[28] = (unsigned char)nameLength;
+        for (int i = 0; i < 4; i++)
+        {
+            record[42 + i] = (unsigned char)((unsigned long long)entry->offset >> (8 * i));
+        }
+        zipWriteBytes(z, record, sizeof(record), 0);
+        zipWriteBytes(z, entry->name, nameLength, 0);
+    }
+
+    unsigned char end[22] = {0x50, 0x4B, 0x05, 0x06};
+    long long directorySize = z->position - directory;
+    end[8] = end[10] = (unsigned char)z->entryCount;
+    for (int i = 0; i < 4; i++)
+    {
+        end[12 + i] = (unsigned char)((unsigned long long)directorySize >> (8 * i));
+        end[16 + i] = (unsigned char)((unsigned long long)directory >> (8 * i));
+    }
+    zipWriteBytes(z, end, sizeof(end), 0);
+
+    int failed = z->failed;
+    failed = (fclose(z->fp) != 0) || failed;
+    return failed ? -1 : 0;
+}
+
+
+
+
+/*
+xlsxPart - Writes a whole entry holding one XML part of the workbook.
+*/
+static void xlsxPart(XlsxWriter *x, const char *name, const char *xml)
+{
+    zipBeginEntry(&x->zip, name);
+    zipWrite(&x->zip, xml, strlen(xml));
+    zipEndEntry(&x->zip);
+}
+
+
+
+
+/*
+xlsxOpen - Creates a workbook file. Worksheets are then written one at a time with xlsxBeginSheet() and xlsxEndSheet().
+
+Returns:
+- 0 on success, -1 if the file could not be created.
+*/
+int xlsxOpen(XlsxWriter *x, const char *fileName)
+{
+    memset(x, 0, sizeof(XlsxWriter));
+    x->zip.fp = fopen(fileName, "wb");
+    if (x->zip.fp == NULL)
+    {
+        printf("Error : Could not open file to save results.\n");
+        return -1;
+    }
+    setvbuf(x->zip.fp, NULL, _IOFBF, REPORT_BUFFER_SIZE);
+    return 0;
+}
+
+
+
+
+/*
+xlsxBeginSheet - Starts a worksheet. Names longer than the 31 characters Excel allows are cut.
+*/
+void xlsxBeginSheet(XlsxWriter *x, const char *name)
+{
+    static const char header[] = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+                                 "<worksheet xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\"><sheetData>";
+    char part[64];
+
+    if (x->sheetCount == XLSX_MAX_SHEETS)
+    {
+        printf("Error : A Workbook Holds At Most %d Worksheets.\n", XLSX_MAX_SHEETS);
+        x->zip.failed = 1;
+        return;
+    }
+
+    snprintf(x->sheets[x->sheetCount++], sizeof(x->sheets[0]), "%s", name);
+    sprintf(part, "xl/worksheets/sheet%d.xml", x->sheetCount);
+    zipBeginEntry(&x->zip, part);
+    zipWrite(&x->zip, header, sizeof(header) - 1);
+    x->rowCount = 0;
+    x->rowOpen = 0;
+}
+
+
+
+
+/*
+xlsxRow - Starts the next row of the current worksheet, ending the previous one.
+*/
+void xlsxRow(XlsxWriter *x)
+{
+    char row[32];
+
+    if (x->rowOpen)
+    {
+        zipWrite(&x->zip, "</row>", 6);
+    }
+    x->rowCount++;
+    x->columnCount = 0;
+    x->rowOpen = 1;
+    zipWrite(&x->zip, row, sprintf(row, "<row r=\"%ld\">", x->rowCount));
+}
+
+
+
+
+/*
+xlsxCellStart - Writes the start of the next cell of the row, "<c r="<column><row>"" followed by its style if any.
+*/
+static void xlsxCellStart(XlsxWriter *x, int style)
+{
+    char cell[48];
+    char column[4];
+    int length = 0;
+    int n = x->columnCount++;
+
+    if (n >= 26)
+    {
+        column[length++] = (char)('A' + n / 26 - 1);
+    }
+    column[length++] = (char)('A' + n % 26);
+    column[length] = '\0';
+
+    length = sprintf(cell, "<c r=\"%s%ld\"", column, x->rowCount);
+    if (style != 0)
+    {
+        length += sprintf(cell + length, " s=\"%d\"", style);
+    }
+    zipWrite(&x->zip, cell, length);
+}
+
+
+
+
+/*
+xmlEscape - Copies text into XML, escaping the characters XML reserves and dropping the control characters it cannot hold.
+
+Returns:
+- The length of the escaped text.
+*/
+static int xmlEscape(char *out, int size, const char *text)
+{
+    int length = 0;
+
+    for (const char *p = text; *p != '\0' && length < size - 8; p++)
+    {
+        if (*p == '&')
+            length += sprintf(out + length, "&amp;");
+        else if (*p == '<')
+            length += sprintf(out + length, "&lt;");
+        else if (*p == '>')
+            length += sprintf(out + length, "&gt;");
+        else if (*p == '"')
+            length += sprintf(out + length, "&quot;");
+        else if ((unsigned char)*p >= 0x20 || *p == '\t')
+            out[length++] = *p;
+    }
+    out[length] = '\0';
+    return length;
+}
+
+
+
+
+/*
+xlsxText - Writes a text cell as an inline string, escaping the characters XML reserves. Style 1 is bold.
+*/
+void xlsxText(XlsxWriter *x, const char *text, int style)
+{
+    char escaped[MAX_LINE_LENGTH * 6];
+    int length = xmlEscape(escaped, sizeof(escaped), text);
+
+    xlsxCellStart(x, style);
+    zipWrite(&x->zip, " t=\"inlineStr\"><is><t>", 22);
+    zipWrite(&x->zip, escaped, length);
+    zipWrite(&x->zip, "</t></is></c>", 13);
+}
+
+
+
+
+/*
+xlsxNumber - Writes a numeric cell holding an integer, e.g. marks, so Excel can sort and sum it.
+*/
+void xlsxNumber(XlsxWriter *x, int value)
+{
+    char cell[32];
+    int length;
+
+    xlsxCellStart(x, 0);
+    memcpy(cell, "><v>", 4);
+    length = 4 + formatInt(cell + 4, value);
+    memcpy(cell + length, "</v></c>", 8);
+    zipWrite(&x->zip, cell, length + 8);
+}
+
+
+
+
+/*
+xlsxDecimal - Writes a numeric cell shown with two decimals (style 2), e.g. an SGPA.
+*/
+void xlsxDecimal(XlsxWriter *x, double value)
+{
+    char cell[48];
+
+    xlsxCellStart(x, 2);
+    zipWrite(&x->zip, cell, sprintf(cell, "><v>%.2f</v></c>", value));
+}
+
+
+
+
+/*
+xlsxEndSheet - Ends the current worksheet.
+*/
+void xlsxEndSheet(XlsxWriter *x)
+{
+    if (x->rowOpen)
+    {
+        zipWrite(&x->zip, "</row>", 6);
+        x->rowOpen = 0;
+    }
+    zipWrite(&x->zip, "</sheetData></worksheet>", 24);
+    zipEndEntry(&x->zip);
+}
+
+
+
+
+/*
+xlsxClose - Writes the parts listing the worksheets (workbook, relationships and content types) and the styles, then
+closes the file. The current worksheet must be ended.
+
+Returns:
+- 0 on success, -1 if the file could not be written completely.
+*/
+int xlsxClose(XlsxWriter *x)
+{
+    static const char xmlHeader[] = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n";
+    static const char styles[] =
+        "<styleSheet xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\">"
+        "<fonts count=\"2\"><font><sz val=\"11\"/><name val=\"Calibri\"/></font><font><b/><sz val=\"11\"/><name val=\"Calibri\"/></font></fonts>"
+        "<fills count=\"2\"><fill><patternFill patternType=\"none\"/></fill><fill><patternFill patternType=\"gray125\"/></fill></fills>"
+        "<borders count=\"1\"><border><left/><right/><top/><bottom/><diagonal/></border></borders>"
+        "<cellStyleXfs count=\"1\"><xf numFmtId=\"0\" fontId=\"0\" fillId=\"0\" borderId=\"0\"/></cellStyleXfs>"
+        "<cellXfs count=\"3\"><xf numFmtId=\"0\" fontId=\"0\" fillId=\"0\" borderId=\"0\" xfId=\"0\"/>"
+        "<xf numFmtId=\"0\" fontId=\"1\" fillId=\"0\" borderId=\"0\" xfId=\"0\" applyFont=\"1\"/>"
+        "<xf numFmtId=\"2\" fontId=\"0\" fillId=\"0\" borderId=\"0\" xfId=\"0\" applyNumberFormat=\"1\"/></cellXfs>"
+        "<cellStyles count=\"1\"><cellStyle name=\"Normal\" xfId=\"0\" builtinId=\"0\"/></cellStyles></styleSheet>";
+    char xml[2048 + XLSX_MAX_SHEETS * 320];
+    char name[MAX_LINE_LENGTH];
+    int length, k;
+
+    sprintf(xml, "%s%s", xmlHeader, styles);
+    xlsxPart(x, "xl/styles.xml", xml);
+
+    length = sprintf(xml, "%s<workbook xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\" "
+                          "xmlns:r=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships\"><sheets>", xmlHeader);
+    for (k = 0; k < x->sheetCount; k++)
+    {
+        xmlEscape(name, sizeof(name), x->sheets[k]);
+        length += sprintf(xml + length, "<sheet name=\"%s\" sheetId=\"%d\" r:id=\"rId%d\"/>", name, k + 1, k + 1);
+    }
+    sprintf(xml + length, "</sheets></workbook>");
+    xlsxPart(x, "xl/workbook.xml", xml);
+
+    length = sprintf(xml, "%s<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">", xmlHeader);
+    for (k = 0; k < x->sheetCount; k++)
+    {
+        length += sprintf(xml + length, "<Relationship Id=\"rId%d\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/worksheet\" "
+                                        "Target=\"worksheets/sheet%d.xml\"/>", k + 1, k + 1);
+    }
+    sprintf(xml + length, "<Relationship Id=\"rId%d\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/styles\" "
+                          "Target=\"styles.xml\"/></Relationships>", k + 1);
+    xlsxPart(x, "xl/_rels/workbook.xml.rels", xml);
+
+    sprintf(xml, "%s<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+                 "<Relationship Id=\"rId1\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/officeDocument\" "
+                 "Target=\"xl/workbook.xml\"/></Relationships>", xmlHeader);
+    xlsxPart(x, "_rels/.rels", xml);
+
+    length = sprintf(xml, "%s<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
+                          "<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>"
+                          "<Default Extension=\"xml\" ContentType=\"application/xml\"/>"
+                          "<Override PartName=\"/xl/workbook.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.sheet.main+xml\"/>"
+                          "<Override PartName=\"/xl/styles.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.styles+xml\"/>", xmlHeader);
+    for (k = 0; k < x->sheetCount; k++)
+    {
+        length += sprintf(xml + length, "<Override PartName=\"/xl/worksheets/sheet%d.xml\" "
+                                        "ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.worksheet+xml\"/>", k + 1);
+    }
+    sprintf(xml + length, "</Types>");
+    xlsxPart(x, "[Content_Types].xml", xml);
+
+    return zipClose(&x->zip);
+}
+
+
+
+
+/*
+xlsxNextSheet - Starts a new worksheet when the current one cannot take that many more rows, since Excel reads at most
+XLSX_SHEET_ROWS rows per worksheet. The new one is named after the first, e.g. "Students 2".
+
+Returns:
+- 1 if a new worksheet was started, 0 otherwise.
+*/
+static int xlsxNextSheet(XlsxWriter *x, int rows)
+{
+    char name[48];
+
+    if (x->rowCount + rows <= XLSX_SHEET_ROWS)
+    {
+        return 0;
+    }
+
+    xlsxEndSheet(x);
+    snprintf(name, sizeof(name), "%.24s %d", x->sheets[0], x->sheetCount + 1);
+    xlsxBeginSheet(x, name);
+    return 1;
+}
+
+
+
+
+/*
+xlsxStudentHeader - Writes the bold header row of a student list.
+*/
+static void xlsxStudentHeader(XlsxWriter *x)
+{
+    static const char *names[] = {"RollNo", "Name", "Branch", "Semester"};
+    char name[MAX_LINE_LENGTH];
+
+    xlsxRow(x);
+    for (int c = 0; c < 4; c++)
+    {
+        xlsxText(x, names[c], 1);
+    }
+    for (int col = 0; col < NUM_MARK_COLUMNS; col++)
+    {
+        markColumnName(col, name);
+        xlsxText(x, name, 1);
+    }
+    xlsxText(x, "Total", 1);
+    xlsxText(x, "SGPA", 1);
+    xlsxText(x, "Result", 1);
+}
+
+
+
+
+/*
+xlsxStudentRow - Writes a student as a row of a student list. The roll number and name are text, so Excel keeps the
+roll number's digits as they are, while the semester, marks, total and SGPA are numbers.
+*/
+void xlsxStudentRow(XlsxWriter *x, const Student *s, const StudentGrades *grades)
+{
+    if (xlsxNextSheet(x, 1))
+    {
+        xlsxStudentHeader(x);
+    }
+
+    xlsxRow(x);
+    xlsxText(x, s->rollNo, 0);
+    xlsxText(x, s->name, 0);
+    xlsxText(x, s->branch, 0);
+    xlsxNumber(x, s->semester);
+    for (int col = 0; col < NUM_MARK_COLUMNS; col++)
+    {
+        xlsxNumber(x, markColumnValue(s, col));
+    }
+    xlsxNumber(x, studentTotalMarks(s));
+    xlsxDecimal(x, grades->sgpa);
+    xlsxText(x, grades->passed ? "PASS" : "FAIL", 0);
+}
+
+
+
+
+/*
+xlsxResultCard - Writes the result card of a student as a block of rows : their details, a row per subject with its
+marks, maximum marks, credits and grade, then the total, SGPA and result, followed by an empty row.
+*/
+void xlsxResultCard(XlsxWriter *x, const Student *s, const StudentGrades *grades)
+{
+    int maxTotal = 0;
+
+    xlsxNextSheet(x, TOTAL_SUBJECTS + 8);
+
+    xlsxRow(x);
+    xlsxText(x, "Roll No", 1);
+    xlsxText(x, s->rollNo, 0);
+    xlsxRow(x);
+    xlsxText(x, "Name", 1);
+    xlsxText(x, s->name, 0);
+    xlsxRow(x);
+    xlsxText(x, "Branch/Sem", 1);
+    xlsxText(x, s->branch, 0);
+    xlsxNumber(x, s->semester);
+
+    xlsxRow(x);
+    xlsxText(x, "Subject", 1);
+    xlsxText(x, "Marks", 1);
+    xlsxText(x, "Maximum Marks", 1);
+    xlsxText(x, "Credits", 1);
+    xlsxText(x, "Grade", 1);
+    for (int i = 0; i < TOTAL_SUBJECTS; i++)
+    {
+        int maxMarks = subjectMarks[i].maxTheory + subjectMarks[i].maxPractical;
+
+        xlsxRow(x);
+        xlsxText(x, subjectMarks[i].subject, 0);
+        xlsxNumber(x, subjectTotalMarks(s, i));
+        xlsxNumber(x, maxMarks);
+        xlsxNumber(x, subjectMarks[i].credits);
+        xlsxText(x, gradeScale[grades->gradeIndex[i]].grade, 0);
+        maxTotal += maxMarks;
+    }
+
+    xlsxRow(x);
+    xlsxText(x, "Total Marks", 1);
+    xlsxNumber(x, studentTotalMarks(s));
+    xlsxNumber(x, maxTotal);
+    xlsxRow(x);
+    xlsxText(x, "SGPA", 1);
+    xlsxDecimal(x, grades->sgpa);
+    xlsxRow(x);
+    xlsxText(x, "Result", 1);
+    xlsxText(x, grades->passed ? "PASS" : "FAIL", 0);
+    xlsxRow(x);
+}
+
+
+
+
+/*
+xlsxSubjectHeader - Writes the bold header row of a subject-wise result.
+*/
+static void xlsxSubjectHeader(XlsxWriter *x, int subjectIndex)
+{
+    xlsxRow(x);
+    xlsxText(x, "RollNo", 1);
+    xlsxText(x, "Name", 1);
+    xlsxText(x, "Branch", 1);
+    xlsxText(x, "Semester", 1);
+    if (subjectTheoryColumn[subjectIndex] != -1)
+    {
+        xlsxText(x, "Theory", 1);
+    }
+    if (subjectPracticalColumn[subjectIndex] != -1)
+    {
+        xlsxText(x, "Practical", 1);
+    }
+    xlsxText(x, "Total", 1);
+    xlsxText(x, "Grade", 1);
+}
+
+
+
+
+/*
+xlsxSubjectRow - Writes a student's theory, practical and total marks and grade in one subject as a row.
+*/
+void xlsxSubjectRow(XlsxWriter *x, int subjectIndex, const Student *s, const StudentGrades *grades)
+{
+    if (xlsxNextSheet(x, 1))
+    {
+        xlsxSubjectHeader(x, subjectIndex);
+    }
+
+    xlsxRow(x);
+    xlsxText(x, s->rollNo, 0);
+    xlsxText(x, s->name, 0);
+    xlsxText(x, s->branch, 0);
+    xlsxNumber(x, s->semester);
+    if (subjectTheoryColumn[subjectIndex] != -1)
+    {
+        xlsxNumber(x, markColumnValue(s, subjectTheoryColumn[subjectIndex]));
+    }
+    if (subjectPracticalColumn[subjectIndex] != -1)
+    {
+        xlsxNumber(x, markColumnValue(s, NUM_SUBJECTS + subjectPracticalColumn[subjectIndex]));
+    }
+    xlsxNumber(x, subjectTotalMarks(s, subjectIndex));
+    xlsxText(x, gradeScale[grades->gradeIndex[subjectIndex]].grade, 0);
+}
+
+
+
+
+/*
+xlsxFinish - Ends the last worksheet, closes the workbook and reports how many students it holds.
+
+Returns:
+- 0 on success, -1 if the file could not be written completely.
+*/
+static int xlsxFinish(XlsxWriter *x, const char *fileName, long long students, DWORD startTime)
+{
+    int sheets = x->sheetCount;
+
+    xlsxEndSheet(x);
+    if (xlsxClose(x) != 0)
+    {
+        printf("Error : Could Not Write %s.\n", fileName);
+        return -1;
+    }
+
+    printf("%lld Students Exported to '%s' (Excel, %d Worksheet%s, %lu ms).\n", students, fileName, sheets,
+           sheets == 1 ? "" : "s", (unsigned long)(GetTickCount() - startTime));
+    return 0;
+}
+
+
+
+
+/*
+exportXlsx - Writes students (those listed in indexes, or all rows if NULL) to an Excel workbook, as a student list,
+result cards or the subject-wise result of subjectIndex. grades is parallel to rows.
+
+Returns:
+- 0 on success, -1 otherwise.
+*/
+int exportXlsx(const char *fileName, XlsxLayout layout, int subjectIndex, const Student *rows, const StudentGrades *grades,
+               const int *indexes, int count)
+{
+    static const char *sheetNames[] = {"Students", "Result Cards", "Subject-Wise Result"};
+    DWORD startTime = GetTickCount();
+    XlsxWriter *x = malloc(sizeof(XlsxWriter));
+
+    if (x == NULL || xlsxOpen(x, fileName) != 0)
+    {
+        free(x);
+        return -1;
+    }
+
+    mapSubjectColumns();
+    xlsxBeginSheet(x, sheetNames[layout]);
+    if (layout == XLSX_STUDENT_LIST)
+    {
+        xlsxStudentHeader(x);
+    }
+    else if (layout == XLSX_SUBJECT_RESULT)
+    {
+        xlsxSubjectHeader(x, subjectIndex);
+    }
+
+    for (int k = 0; k < count; k++)
+    {
+        int i = (indexes != NULL) ? indexes[k] : k;
+
+        if (layout == XLSX_STUDENT_LIST)
+            xlsxStudentRow(x, &rows[i], &grades[i]);
+        else if (layout == XLSX_RESULT_CARDS)
+            xlsxResultCard(x, &rows[i], &grades[i]);
+        else
+            xlsxSubjectRow(x, subjectIndex, &rows[i], &grades[i]);
+    }
+
+    int result = xlsxFinish(x, fileName, count, startTime);
+    free(x);
+    return result;
+}
+
+
+
+
+/*
+xlsxArchiveBatch - Streaming handler of an Excel export of an archive file, writing the matching students of a batch.
+*/
+void xlsxArchiveBatch(const Student *batch, const StudentGrades *grades, int count, void *context)
+{
+    XlsxArchiveExport *scan = (XlsxArchiveExport *)context;
+
+    if (scan->query != NULL)
+    {
+        count = runQuery(scan->query, batch, grades, count, scan->matches);
+        for (int k = 0; k < count; k++)
+        {
+            xlsxStudentRow(scan->writer, &batch[scan->matches[k]], &grades[scan->matches[k]]);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < count; i++)
+        {
+            xlsxStudentRow(scan->writer, &batch[i], &grades[i]);
+        }
+    }
+    scan->matched += count;
+}
+
+
+
+
+/*
+archiveXlsxExport - Exports the students of an archive file matching a query to ARCHIVE_XLSX_FILE.
+
+The file is streamed once : every row is compressed into the workbook as soon as its batch is read, so memory stays
+constant however many students are exported. Above XLSX_SHEET_ROWS rows the list continues on further worksheets.
+*/
+void archiveXlsxExport(const char *archiveFile)
+{
+    CompiledQuery query;
+    XlsxArchiveExport scan;
+
+    clearInputBuffer();
+    int hasQuery = readArchiveQuery(&query);
+    scan.matches = malloc(STREAM_BATCH_ROWS * sizeof(int));
+    scan.writer = malloc(sizeof(XlsxWriter));
+    if (hasQuery < 0 || scan.matches == NULL || scan.writer == NULL || xlsxOpen(scan.writer, ARCHIVE_XLSX_FILE) != 0)
+    {
+        free(scan.writer);
+        free(scan.matches);
+        return;
+    }
+
+    DWORD startTime = GetTickCount();
+    scan.query = hasQuery ? &query : NULL;
+    scan.matched = 0;
+    xlsxBeginSheet(scan.writer, "Students");
+    xlsxStudentHeader(scan.writer);
+
+    long long rows = streamStudentFile(archiveFile, xlsxArchiveBatch, &scan);
+    if (rows < 0)
+    {
+        printf("Error : Could Not Read Archive File %s.\n", archiveFile);
+        xlsxEndSheet(scan.writer);
+        xlsxClose(scan.writer);
+    }
+    else
+    {
+        xlsxFinish(scan.writer, ARCHIVE_XLSX_FILE, scan.matched, startTime);
+    }
+
+    free(scan.writer);
+    free(scan.matches);
+}
+
+
+
+
+// Replica - Read-only copy of a primary's database kept by a follower
+//
+// The receiver thread applies the primary's changes under lock while the menu serves lookups from the same copy.
+// Grades are computed when a student is looked up, so only the students and their roll number index are kept.
+typedef struct
+{
+    Database db;                  // Copy of the primary's students, db.grades is not used
+    char host[256];               // Primary to follow
+    char port[16];
+    long long epoch;              // Epoch of the primary the copy comes from, 0 before the first snapshot
+    long long appliedLsn;         // Log position of the last applied change
+    long long primaryLsn;         // Last log position the primary reported
+    long long lastCommitTime;     // Commit time of the last applied change (primary clock, ms), 0 after a snapshot
+    long long lastApplyTime;      // Time it was applied (ms)
+    long long lastContact;        // Time of the last frame from the primary (ms)
+    long changesApplied;
+    int snapshotsLoaded;
+    int connected;
+    char error[MAX_LINE_LENGTH];  // Why the last connection ended, empty if it did not fail
+    SOCKET socket;                // Connection to the primary, INVALID_SOCKET while disconnected
+    volatile LONG stopping;
+    CRITICAL_SECTION lock;        // Held while the fields above change
+    HANDLE thread;                // Receiver thread
+    unsigned char buffer[REPLICATION_BUFFER_SIZE]; // Bytes received and not parsed yet, only used by the receiver thread
+    int bufferStart;
+    int bufferEnd;
+
+} Replica;
+
+
+
+
+/*
+wallClockMs - Returns the current time in milliseconds, comparable between programs on one computer.
+*/
+static long long wallClockMs()
+{
+    FILETIME now;
+
+    GetSystemTimeAsFileTime(&now);
+    return (long long)((((unsigned long long)now.dwHighDateTime << 32) | now.dwLowDateTime) / 10000);
+}
+
+
+
+
+/*
+putInt64 - Writes a 64-bit number in little endian order.
+*/
+static void putInt64(unsigned char *p, long long value)
+{
+    for (int b = 0; b < 8; b++)
+    {
+        p[b] = (unsigned char)((unsigned long long)value >> (8 * b));
+    }
+}
+
+
+
+
+/*
+getInt64 - Reads a 64-bit number written by putInt64().
+*/
+static long long getInt64(const unsigned char *p)
+{
+    unsigned long long value = 0;
+
+    for (int b = 7; b >= 0; b--)
+    {
+        value = (value << 8) | p[b];
+    }
+    return (long long)value;
+}
+
+
+
+
+/*
+putFrameHeader - Writes the header of a replication frame : type (1 byte), log position (8 bytes), time (8 bytes) and the
+number of records that follow (4 bytes), all little endian. Records are RECORD_SIZE bytes encoded by encodeRecord().
+*/
+static void putFrameHeader(unsigned char *frame, ReplicationFrame type, long long lsn, long long time, unsigned int count)
+{
+    frame[0] = (unsigned char)type;
+    putInt64(frame + 1, lsn);
+    putInt64(frame + 9, time);
+    for (int b = 0; b < 4; b++)
+    {
+        frame[17 + b] = (unsigned char)(count >> (8 * b));
+    }
+}
+
+
+
+
+/*
+sendAll - Sends a whole buffer on a socket.
+
+Returns:
+- 0 on success, -1 if the connection was closed or failed.
+*/
+static int sendAll(SOCKET s, const unsigned char *data, int length)
+{
+    while (length > 0)
+    {
+        int sent = send(s, (const char *)data, length, 0);
+
+        if (sent <= 0)
+        {
+            return -1;
+        }
+        data += sent;
+        length -= sent;
+    }
+    return 0;
+}
+
+
+
+
+/*
+recvAll - Receives exactly length bytes from a socket.
+
+Returns:
+- 0 on success, -1 if the connection was closed or failed first.
+*/
+static int recvAll(SOCKET s, unsigned char *data, int length)
+{
+    while (length > 0)
+    {
+        int received = recv(s, (char *)data, length, 0);
+
+        if (received <= 0)
+        {
+            return -1;
+        }
+        data += received;
+        length -= received;
+    }
+    return 0;
+}
+
+
+
+
+/*
+socketReadable - Waits up to timeoutMs milliseconds for a socket to have data (or a closed connection) to read.
+
+Returns:
+- 1 if the socket is readable, 0 otherwise.
+*/
+static int socketReadable(SOCKET s, int timeoutMs)
+{
+    fd_set readSet;
+    struct timeval timeout;
+
+    FD_ZERO(&readSet);
+    FD_SET(s, &readSet);
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_usec = (timeoutMs % 1000) * 1000;
+    return select((int)s + 1, &readSet, NULL, NULL, &timeout) > 0;
+}
+
+
+
+
+/*
+replicateChange - Appends a committed change to the replication log and wakes the threads streaming it to the followers.
+
+commitTransaction() logs its changes only after installing the new snapshot, and reloadExternalEdits() logs and
+publishes under storeLock, which sendSnapshot() also takes, so every change up to a log position is in a snapshot
+read together with that position. Only the main thread starts and stops the primary, so no lock is needed to see
+that this program is not serving followers.
+*/
+void replicateChange(TransactionOpType type, const Student *s)
+{
+    static const char frameTypes[] = {FRAME_ADD, FRAME_UPDATE, FRAME_DELETE}; // In TransactionOpType order
+
+    if (replicationLog == NULL)
+    {
+        return;
+    }
+
+    EnterCriticalSection(&replicationLock);
+    replicationLsn++;
+    ReplicationEntry *entry = &replicationLog[replicationLsn & (REPLICATION_LOG_SIZE - 1)];
+    entry->commitTime = wallClockMs();
+    entry->type = frameTypes[type];
+    encodeRecord(s, entry->record);
+    WakeAllConditionVariable(&replicationWake);
+    LeaveCriticalSection(&replicationLock);
+}
+
+
+
+
+/*
+sendSnapshot - Sends a follower every student of the current snapshot, together with the log position it contains.
+
+The snapshot may already hold a few changes logged after the position. The follower then applies them a second time,
+which has no effect : an added or updated student is stored over the one with the same roll number and a deleted
+student that is already gone is ignored.
+
+Returns:
+- 0 on success, -1 if the follower disconnected or there is not enough memory.
+*/
+static int sendSnapshot(Follower *f, long long *nextLsn)
+{
+    unsigned char *buffer = malloc(REPLICATION_BUFFER_SIZE);
+
+    if (buffer == NULL)
+    {
+        return -1;
+    }
+
+    EnterCriticalSection(&storeLock);
+    EnterCriticalSection(&replicationLock);
+    long long lsn = replicationLsn;
+    StoreSnapshot *snapshot = acquireSnapshot();
+    LeaveCriticalSection(&replicationLock);
+    LeaveCriticalSection(&storeLock);
+
+    int length = REPLICATION_FRAME_HEADER;
+    int result = 0;
+
+    putFrameHeader(buffer, FRAME_SNAPSHOT, lsn, replicationEpoch, (unsigned int)snapshot->count);
+    for (int i = 0; i < snapshot->count && result == 0; i++)
+    {
+        if (length + RECORD_SIZE > REPLICATION_BUFFER_SIZE)
+        {
+            result = sendAll(f->socket, buffer, length);
+            length = 0;
+        }
+        encodeRecord(snapshotRow(snapshot, i), buffer + length);
+        length += RECORD_SIZE;
+    }
+    if (result == 0)
+    {
+        result = sendAll(f->socket, buffer, length);
+    }
+
+    releaseSnapshot(snapshot);
+    free(buffer);
+    *nextLsn = lsn + 1;
+    return result;
+}
+
+
+
+
+/*
+followerAckThread - Reads the acknowledgements of one follower while followerThread() streams the log to it.
+
+The thread waits on the socket with select(), so an acknowledgement is read, and the lag measured, as soon as it
+arrives, without the streaming thread having to poll for it. It stops when the follower disconnects or when the
+streaming thread sets closing.
+*/
+DWORD WINAPI followerAckThread(LPVOID param)
+{
+    Follower *f = param;
+    unsigned char ack[REPLICATION_FRAME_HEADER];
+
+    while (1)
+    {
+        EnterCriticalSection(&replicationLock);
+        int closing = f->closing;
+        LeaveCriticalSection(&replicationLock);
+
+        if (closing)
+        {
+            break;
+        }
+        if (!socketReadable(f->socket, REPLICATION_HEARTBEAT_MS))
+        {
+            continue;
+        }
+
+        if (recvAll(f->socket, ack, REPLICATION_FRAME_HEADER) != 0 || ack[0] != FRAME_ACK)
+        {
+            EnterCriticalSection(&replicationLock);
+            f->ackFailed = 1;
+            WakeAllConditionVariable(&replicationWake); // The streaming thread disconnects the follower
+            LeaveCriticalSection(&replicationLock);
+            break;
+        }
+
+        long long ackedLsn = getInt64(ack + 1);
+        long long commitTime = getInt64(ack + 9);
+
+        // Heartbeats are acknowledged too, the lag is only measured when a new change is acknowledged
+        EnterCriticalSection(&replicationLock);
+        if (ackedLsn > f->ackedLsn)
+        {
+            f->ackLag = (commitTime > 0) ? wallClockMs() - commitTime : 0;
+        }
+        f->ackedLsn = ackedLsn;
+        LeaveCriticalSection(&replicationLock);
+    }
+    return 0;
+}
+
+
+
+
+/*
+followerThread - Streams the replication log to one follower.
+
+A follower connects with the epoch and log position of its copy. If it follows this primary and the changes after its
+position are still in the log, streaming resumes there; otherwise it first receives a snapshot. Changes are sent in
+batches as soon as they are committed, a heartbeat tells an idle follower the log position, and the follower's
+acknowledgements, read by followerAckThread(), give its lag. A follower that falls more than REPLICATION_LOG_SIZE changes
+behind gets a new snapshot.
+*/
+DWORD WINAPI followerThread(LPVOID param)
+{
+    Follower *f = param;
+    unsigned char hello[REPLICATION_HELLO_SIZE];
+    HANDLE ackThread = NULL;
+    unsigned char *buffer = malloc(REPLICATION_BATCH * (REPLICATION_FRAME_HEADER + RECORD_SIZE));
+    long long nextLsn = 0;
+    DWORD lastSent = GetTickCount();
+    int failed = (buffer == NULL || recvAll(f->socket, hello, REPLICATION_HELLO_SIZE) != 0 ||
+                  memcmp(hello, REPLICATION_MAGIC, 8) != 0 ||
+                  (hello[24] | hello[25] << 8) != RECORD_SIZE || (hello[26] | hello[27] << 8) != NUM_MARK_COLUMNS);
+
+    if (!failed)
+    {
+        long long epoch = getInt64(hello + 8);
+        long long lastLsn = getInt64(hello + 16);
+
+        EnterCriticalSection(&replicationLock);
+        int resume = (epoch == replicationEpoch && lastLsn <= replicationLsn);
+        LeaveCriticalSection(&replicationLock);
+
+        nextLsn = lastLsn + 1;
+        if (!resume)
+        {
+            failed = (sendSnapshot(f, &nextLsn) != 0);
+        }
+    }
+    if (!failed)
+    {
+        ackThread = CreateThread(NULL, 0, followerAckThread, f, 0, NULL);
+        failed = (ackThread == NULL);
+    }
+
+    while (!failed)
+    {
+        int length = 0, n = 0, behind;
+        long long lsn;
+
+        // Woken by a commit, by replication stopping or by the acknowledgement reader losing the follower
+        EnterCriticalSection(&replicationLock);
+        if (nextLsn > replicationLsn && !replicationStopping && !f->ackFailed)
+        {
+            SleepConditionVariableCS(&replicationWake, &replicationLock, REPLICATION_HEARTBEAT_MS);
+        }
+        if (replicationStopping || f->ackFailed)
+        {
+            LeaveCriticalSection(&replicationLock);
+            break;
+        }
+
+        // The ring buffer holds the last REPLICATION_LOG_SIZE changes
+        lsn = replicationLsn;
+        behind = (lsn - nextLsn >= REPLICATION_LOG_SIZE);
+        for (; !behind && nextLsn + n <= lsn && n < REPLICATION_BATCH; n++)
+        {
+            const ReplicationEntry *entry = &replicationLog[(nextLsn + n) & (REPLICATION_LOG_SIZE - 1)];
+
+            putFrameHeader(buffer + length, (ReplicationFrame)entry->type, nextLsn + n, entry->commitTime, 1);
+            memcpy(buffer + length + REPLICATION_FRAME_HEADER, entry->record, RECORD_SIZE);
+            length += REPLICATION_FRAME_HEADER + RECORD_SIZE;
+        }
+        LeaveCriticalSection(&replicationLock);
+
+        if (behind)
+        {
+            failed = (sendSnapshot(f, &nextLsn) != 0);
+            lastSent = GetTickCount();
+        }
+        else if (n > 0)
+        {
+            failed = (sendAll(f->socket, buffer, length) != 0);
+            nextLsn += n;
+            lastSent = GetTickCount();
+        }
+        else if (GetTickCount() - lastSent >= REPLICATION_HEARTBEAT_MS)
+        {
+            putFrameHeader(buffer, FRAME_HEARTBEAT, lsn, wallClockMs(), 0);
+            failed = (sendAll(f->socket, buffer, REPLICATION_FRAME_HEADER) != 0);
+            lastSent = GetTickCount();
+        }
+    }
+
+    // The acknowledgement reader uses the socket until it has stopped, the shutdown wakes it from select() at once
+    if (ackThread != NULL)
+    {
+        EnterCriticalSection(&replicationLock);
+        f->closing = 1;
+        LeaveCriticalSection(&replicationLock);
+        shutdown(f->socket, SD_BOTH);
+        WaitForSingleObject(ackThread, INFINITE);
+        CloseHandle(ackThread);
+    }
+
+    EnterCriticalSection(&replicationLock);
+    closesocket(f->socket);
+    f->socket = INVALID_SOCKET;
+    f->active = 0;
+    LeaveCriticalSection(&replicationLock);
+
+    free(buffer);
+    return 0;
+}
+
+
+
+
+/*
+acceptFollowersThread - Accepts the connections of followers and starts a streaming thread for each of them.
+
+The listening socket is polled so the thread notices replicationStopping within REPLICATION_HEARTBEAT_MS.
+*/
+DWORD WINAPI acceptFollowersThread(LPVOID param)
+{
+    while (!replicationStopping)
+    {
+        struct sockaddr_storage address;
+        socklen_t addressLength = sizeof(address);
+        int noDelay = 1;
+        Follower *f = NULL;
+
+        if (!socketReadable(replicationListener, REPLICATION_HEARTBEAT_MS))
+        {
+            continue;
+        }
+
+        SOCKET client = accept(replicationListener, (struct sockaddr *)&address, &addressLength);
+        if (client == INVALID_SOCKET)
+        {
+            continue;
+        }
+
+        // Free the slots of followers that disconnected
+        for (int i = 0; i < MAX_FOLLOWERS; i++)
+        {
+            EnterCriticalSection(&replicationLock);
+            int disconnected = !followers[i].active;
+            LeaveCriticalSection(&replicationLock);
+
+            if (followers[i].thread != NULL && disconnected)
+            {
+                WaitForSingleObject(followers[i].thread, INFINITE);
+                CloseHandle(followers[i].thread);
+                followers[i].thread = NULL;
+            }
+            if (followers[i].thread == NULL && f == NULL)
+            {
+                f = &followers[i];
+            }
+        }
+        if (f == NULL)
+        {
+            closesocket(client); // MAX_FOLLOWERS already connected
+            continue;
+        }
+
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, (const char *)&noDelay, sizeof(noDelay));
+
+        EnterCriticalSection(&replicationLock);
+        f->socket = client;
+        if (getnameinfo((struct sockaddr *)&address, addressLength, f->address, sizeof(f->address), NULL, 0, NI_NUMERICHOST) != 0)
+        {
+            strcpy(f->address, "?");
+        }
+        f->ackedLsn = 0;
+        f->ackLag = 0;
+        f->ackFailed = 0;
+        f->closing = 0;
+        f->active = 1;
+        LeaveCriticalSection(&replicationLock);
+
+        f->thread = CreateThread(NULL, 0, followerThread, f, 0, NULL);
+        if (f->thread == NULL)
+        {
+            EnterCriticalSection(&replicationLock);
+            closesocket(f->socket);
+            f->socket = INVALID_SOCKET;
+            f->active = 0;
+            LeaveCriticalSection(&replicationLock);
+        }
+    }
+    return 0;
+}
+
+
+
+
+/*
+startReplicationPrimary - Listens for followers on an address and port and starts logging every committed change.
+
+Every student must be loaded, so with sharded storage loadAllShards() is called first.
+
+Returns:
+- 0 on success, -1 if the address cannot be listened on or there is not enough memory.
+*/
+int startReplicationPrimary(const char *address, const char *port)
+{
+    static int lockInitialized = 0;
+    struct addrinfo hints, *addresses;
+    WSADATA wsaData;
+
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+    {
+        printf("Error : Could Not Start Windows Sockets.\n");
+        return -1;
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    if (getaddrinfo(address, port, &hints, &addresses) != 0)
+    {
+        printf("Error : Invalid Address %s:%s.\n", address, port);
+        WSACleanup();
+        return -1;
+    }
+
+    replicationListener = socket(addresses->ai_family, addresses->ai_socktype, addresses->ai_protocol);
+    if (replicationListener == INVALID_SOCKET || bind(replicationListener, addresses->ai_addr, (int)addresses->ai_addrlen) != 0 ||
+        listen(replicationListener, MAX_FOLLOWERS) != 0)
+    {
+        printf("Error : Could Not Listen on %s:%s (Error %d).\n", address, port, WSAGetLastError());
+        if (replicationListener != INVALID_SOCKET)
+        {
+            closesocket(replicationListener);
+            replicationListener = INVALID_SOCKET;
+        }
+        freeaddrinfo(addresses);
+        WSACleanup();
+        return -1;
+    }
+    freeaddrinfo(addresses);
+
+    if (!lockInitialized)
+    {
+        InitializeCriticalSection(&replicationLock);
+        InitializeConditionVariable(&replicationWake);
+        lockInitialized = 1;
+    }
+
+    ReplicationEntry *log = malloc(REPLICATION_LOG_SIZE * sizeof(ReplicationEntry));
+    replicationLsn = 0;
+    replicationEpoch = wallClockMs();
+    replicationStopping = 0;
+    memset(followers, 0, sizeof(followers));
+    followerAcceptThread = (log != NULL) ? CreateThread(NULL, 0, acceptFollowersThread, NULL, 0, NULL) : NULL;
+
+    if (followerAcceptThread == NULL)
+    {
+        printf("Error : Not Enough Memory to Serve Followers.\n");
+        free(log);
+        closesocket(replicationListener);
+        replicationListener = INVALID_SOCKET;
+        WSACleanup();
+        return -1;
+    }
+
+    replicationLog = log; // Commits are logged from now on
+    return 0;
+}
+
+
+
+
+/*
+stopReplicationPrimary - Disconnects every follower, stops the listening thread and stops logging changes.
+
+Shutting down the sockets ends sends blocked on a slow follower. Does nothing unless this program serves followers.
+*/
+void stopReplicationPrimary()
+{
+    int i;
+
+    if (replicationLog == NULL)
+    {
+        return;
+    }
+
+    EnterCriticalSection(&replicationLock);
+    replicationStopping = 1;
+    WakeAllConditionVariable(&replicationWake);
+    for (i = 0; i < MAX_FOLLOWERS; i++)
+    {
+        if (followers[i].active)
+        {
+            shutdown(followers[i].socket, SD_BOTH);
+        }
+    }
+    LeaveCriticalSection(&replicationLock);
+
+    WaitForSingleObject(followerAcceptThread, INFINITE);
+    CloseHandle(followerAcceptThread);
+    followerAcceptThread = NULL;
+
+    for (i = 0; i < MAX_FOLLOWERS; i++)
+    {
+        if (followers[i].thread != NULL)
+        {
+            WaitForSingleObject(followers[i].thread, INFINITE);
+            CloseHandle(followers[i].thread);
+            followers[i].thread = NULL;
+        }
+    }
+
+    closesocket(replicationListener);
+    replicationListener = INVALID_SOCKET;
+    free(replicationLog);
+    replicationLog = NULL;
+    WSACleanup();
+}
+
+
+
+
+/*
+printReplicationStatus - Prints the log position of the primary and the position and lag of every follower.
+*/
+static void printReplicationStatus()
+{
+    int connected = 0;
+
+    EnterCriticalSection(&replicationLock);
+
+    printf("\n===== Replication Status (Primary) =====\n\n");
+    printf("Log Position    : %lld\n", replicationLsn);
+    printf("Oldest in Log   : %lld\n\n", (replicationLsn > REPLICATION_LOG_SIZE) ? replicationLsn - REPLICATION_LOG_SIZE + 1 : 1);
+    printf("Follower                  Applied         Behind (Changes)  Lag (ms)\n");
+    printf("----------------------------------------------------------------------\n");
+    for (int i = 0; i < MAX_FOLLOWERS; i++)
+    {
+        if (followers[i].active)
+        {
+            printf("%-25s %-15lld %-17lld %lld\n", followers[i].address, followers[i].ackedLsn,
+                   replicationLsn - followers[i].ackedLsn, followers[i].ackLag);
+            connected++;
+        }
+    }
+    printf("----------------------------------------------------------------------\n");
+    printf("%d Followers Connected. Lag is the time from a commit to the follower's acknowledgement of it.\n", connected);
+
+    LeaveCriticalSection(&replicationLock);
+}
+
+
+
+
+/*
+growReplicaIndex - Rebuilds the roll number index of a replica's copy with at least size slots.
+
+Returns:
+- 0 on success, -1 if there is not enough memory.
+*/
+static int growReplicaIndex(Database *db, int size)
+{
+    int *index = calloc(size, sizeof(int));
+
+    if (index == NULL)
+    {
+        return -1;
+    }
+    free(db->rollIndex);
+    db->rollIndex = index;
+    db->rollIndexSize = size;
+    for (int i = 0; i < db->count; i++)
+    {
+        insertRollIndex(db->rollIndex, db->rollIndexSize, db->students, i);
+    }
+    return 0;
+}
+
+
+
+
+/*
+replicaIndexSlot - Returns the slot of the roll number index of a replica's copy that holds a row.
+*/
+static unsigned int replicaIndexSlot(const Database *db, int row)
+{
+    unsigned int slot = hashRollNo(db->students[row].rollNo) & (db->rollIndexSize - 1);
+
+    while (db->rollIndex[slot] != row + 1)
+    {
+        slot = (slot + 1) & (db->rollIndexSize - 1);
+    }
+    return slot;
+}
+
+
+
+
+/*
+replicaUpsert - Stores a student in a replica's copy, over the student with the same roll number or appended.
+
+Returns:
+- 0 on success, -1 if there is not enough memory.
+*/
+static int replicaUpsert(Database *db, const Student *s)
+{
+    int row = findDatabaseStudent(db, s->rollNo);
+
+    if (row != -1)
+    {
+        db->students[row] = *s;
+        return 0;
+    }
+
+    if (db->count == db->capacity)
+    {
+        int capacity = (db->capacity > 0) ? db->capacity * 2 : 64;
+        Student *rows = realloc(db->students, capacity * sizeof(Student));
+
+        if (rows == NULL)
+        {
+            return -1;
+        }
+        db->students = rows;
+        db->capacity = capacity;
+    }
+
+    // The index stays at most half full
+    if (2 * (db->count + 1) > db->rollIndexSize && growReplicaIndex(db, db->rollIndexSize > 0 ? db->rollIndexSize * 2 : 16) != 0)
+    {
+        return -1;
+    }
+
+    db->students[db->count] = *s;
+    insertRollIndex(db->rollIndex, db->rollIndexSize, db->students, db->count);
+    db->count++;
+    return 0;
+}
+
+
+
+
+/*
+replicaDelete - Removes a student from a replica's copy, if it is there.
+
+The last student takes the place of the removed one, so only two index slots change. The removed slot is closed by
+backward shift deletion : later entries of the same probe run move up unless their home slot lies after the hole.
+*/
+static void replicaDelete(Database *db, const char *rollNo)
+{
+    int row = findDatabaseStudent(db, rollNo);
+    unsigned int mask = db->rollIndexSize - 1;
+
+    if (row == -1)
+    {
+        return;
+    }
+
+    unsigned int hole = replicaIndexSlot(db, row);
+    unsigned int slot = hole;
+
+    db->rollIndex[hole] = 0;
+    while (1)
+    {
+        slot = (slot + 1) & mask;
+        if (db->rollIndex[slot] == 0)
+        {
+            break;
+        }
+
+        unsigned int home = hashRollNo(db->students[db->rollIndex[slot] - 1].rollNo) & mask;
+        if (((slot - home) & mask) >= ((slot - hole) & mask))
+        {
+            db->rollIndex[hole] = db->rollIndex[slot];
+            db->rollIndex[slot] = 0;
+            hole = slot;
+        }
+    }
+
+    int last = db->count - 1;
+    if (row != last)
+    {
+        db->rollIndex[replicaIndexSlot(db, last)] = row + 1;
+        db->students[row] = db->students[last];
+    }
+    db->count--;
+}
+
+
+
+
+/*
+replicaRead - Reads exactly length bytes sent by the primary, through the replica's receive buffer.
+
+Returns:
+- 0 on success, -1 if the connection was closed or failed first.
+*/
+static int replicaRead(Replica *r, unsigned char *data, int length)
+{
+    while (length > 0)
+    {
+        if (r->bufferStart == r->bufferEnd)
+        {
+            int received = recv(r->socket, (char *)r->buffer, REPLICATION_BUFFER_SIZE, 0);
+
+            if (received <= 0)
+            {
+                return -1;
+            }
+            r->bufferStart = 0;
+            r->bufferEnd = received;
+        }
+
+        int n = (length < r->bufferEnd - r->bufferStart) ? length : r->bufferEnd - r->bufferStart;
+        memcpy(data, r->buffer + r->bufferStart, n);
+        r->bufferStart += n;
+        data += n;
+        length -= n;
+    }
+    return 0;
+}
+
+
+
+
+/*
+replicaLoadSnapshot - Receives a snapshot of count students into a new copy and swaps it in for the old one.
+
+Lookups keep using the old copy until the whole snapshot has arrived.
+
+Returns:
+- 0 on success, -1 if the connection failed, the count is above REPLICATION_MAX_SNAPSHOT or there is not enough memory.
+*/
+static int replicaLoadSnapshot(Replica *r, long long lsn, long long epoch, unsigned int count)
+{
+    unsigned char record[RECORD_SIZE];
+    Database copy;
+    int result = 0;
+
+    // The count comes from the network, a corrupt frame must not size the allocation
+    if (count > REPLICATION_MAX_SNAPSHOT)
+    {
+        EnterCriticalSection(&r->lock);
+        snprintf(r->error, MAX_LINE_LENGTH, "Snapshot of %u Students Is Larger Than %d", count, REPLICATION_MAX_SNAPSHOT);
+        LeaveCriticalSection(&r->lock);
+        return -1;
+    }
+
+    initDatabase(&copy, r->host);
+    copy.capacity = (count > 64) ? (int)count : 64;
+    copy.students = malloc(copy.capacity * sizeof(Student));
+    if (copy.students == NULL || growReplicaIndex(&copy, 16) != 0)
+    {
+        result = -1;
+    }
+
+    for (unsigned int i = 0; i < count && result == 0; i++)
+    {
+        Student s;
+
+        if (replicaRead(r, record, RECORD_SIZE) != 0)
+        {
+            result = -1;
+        }
+        else if (decodeRecord(record, &s) && replicaUpsert(&copy, &s) != 0)
+        {
+            result = -1;
+            snprintf(r->error, MAX_LINE_LENGTH, "Not Enough Memory for %u Students", count);
+        }
+    }
+
+    if (result != 0)
+    {
+        freeDatabase(&copy);
+        return -1;
+    }
+
+    EnterCriticalSection(&r->lock);
+    freeDatabase(&r->db);
+    r->db = copy;
+    r->epoch = epoch;
+    r->appliedLsn = lsn;
+    r->primaryLsn = (lsn > r->primaryLsn) ? lsn : r->primaryLsn;
+    r->lastCommitTime = 0;
+    r->lastApplyTime = r->lastContact = wallClockMs();
+    r->snapshotsLoaded++;
+    LeaveCriticalSection(&r->lock);
+    return 0;
+}
+
+
+
+
+/*
+replicaConnect - Connects a replica to its primary and sends the epoch and log position of its copy.
+
+Returns:
+- 0 on success, -1 if the primary cannot be reached or the replica is stopping.
+*/
+static int replicaConnect(Replica *r)
+{
+    unsigned char hello[REPLICATION_HELLO_SIZE];
+    struct addrinfo hints, *addresses, *a;
+    SOCKET s = INVALID_SOCKET;
+    int noDelay = 1;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(r->host, r->port, &hints, &addresses) != 0)
+    {
+        EnterCriticalSection(&r->lock);
+        snprintf(r->error, MAX_LINE_LENGTH, "Unknown Host %s", r->host);
+        LeaveCriticalSection(&r->lock);
+        return -1;
+    }
+    for (a = addresses; a != NULL && s == INVALID_SOCKET; a = a->ai_next)
+    {
+        s = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (s != INVALID_SOCKET && connect(s, a->ai_addr, (int)a->ai_addrlen) != 0)
+        {
+            closesocket(s);
+            s = INVALID_SOCKET;
+        }
+    }
+    freeaddrinfo(addresses);
+
+    EnterCriticalSection(&r->lock);
+    if (s == INVALID_SOCKET || r->stopping)
+    {
+        if (s == INVALID_SOCKET)
+        {
+            snprintf(r->error, MAX_LINE_LENGTH, "Could Not Connect to %s:%s", r->host, r->port);
+        }
+        else
+        {
+            closesocket(s);
+        }
+        LeaveCriticalSection(&r->lock);
+        return -1;
+    }
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char *)&noDelay, sizeof(noDelay));
+    r->socket = s; // From now on stopping the replica shuts the socket down
+    r->connected = 1;
+    r->error[0] = '\0';
+    r->bufferStart = r->bufferEnd = 0;
+    r->lastContact = wallClockMs();
+
+    memcpy(hello, REPLICATION_MAGIC, 8);
+    putInt64(hello + 8, r->epoch);
+    putInt64(hello + 16, r->appliedLsn);
+    hello[24] = RECORD_SIZE & 0xFF;
+    hello[25] = RECORD_SIZE >> 8;
+    hello[26] = NUM_MARK_COLUMNS & 0xFF;
+    hello[27] = NUM_MARK_COLUMNS >> 8;
+    LeaveCriticalSection(&r->lock);
+
+    return sendAll(s, hello, REPLICATION_HELLO_SIZE);
+}
+
+
+
+
+/*
+replicaThread - Receiver thread of a replica : applies the primary's frames to the copy and acknowledges them.
+
+Changes must arrive in log order; after a gap or a lost connection the replica reconnects every REPLICATION_RETRY_MS
+and resumes from its last applied position. An acknowledgement is sent whenever everything received so far is applied.
+*/
+DWORD WINAPI replicaThread(LPVOID param)
+{
+    Replica *r = param;
+    unsigned char header[REPLICATION_FRAME_HEADER];
+    unsigned char record[RECORD_SIZE];
+    unsigned char ack[REPLICATION_FRAME_HEADER];
+    Student s;
+
+    while (!r->stopping)
+    {
+        int failed = (replicaConnect(r) != 0);
+
+        while (!failed && replicaRead(r, header, REPLICATION_FRAME_HEADER) == 0)
+        {
+            long long lsn = getInt64(header + 1);
+            long long time = getInt64(header + 9);
+            unsigned int count = header[17] | header[18] << 8 | header[19] << 16 | (unsigned int)header[20] << 24;
+
+            if (header[0] == FRAME_SNAPSHOT)
+            {
+                failed = (replicaLoadSnapshot(r, lsn, time, count) != 0);
+            }
+            else if (header[0] == FRAME_HEARTBEAT)
+            {
+                EnterCriticalSection(&r->lock);
+                r->primaryLsn = (lsn > r->primaryLsn) ? lsn : r->primaryLsn;
+                r->lastContact = wallClockMs();
+                LeaveCriticalSection(&r->lock);
+            }
+            else if ((header[0] == FRAME_ADD || header[0] == FRAME_UPDATE || header[0] == FRAME_DELETE) && count == 1)
+            {
+                failed = (replicaRead(r, record, RECORD_SIZE) != 0);
+                decodeRecord(record, &s);
+
+                EnterCriticalSection(&r->lock);
+                if (!failed && lsn != r->appliedLsn + 1)
+                {
+                    snprintf(r->error, MAX_LINE_LENGTH, "Change %lld Received After %lld", lsn, r->appliedLsn);
+                    failed = 1;
+                }
+                else if (!failed && header[0] == FRAME_DELETE)
+                {
+                    replicaDelete(&r->db, s.rollNo);
+                }
+                else if (!failed && replicaUpsert(&r->db, &s) != 0)
+                {
+                    snprintf(r->error, MAX_LINE_LENGTH, "Not Enough Memory to Apply Change %lld", lsn);
+                    failed = 1;
+                }
+                if (!failed)
+                {
+                    r->appliedLsn = lsn;
+                    r->primaryLsn = (lsn > r->primaryLsn) ? lsn : r->primaryLsn;
+                    r->lastCommitTime = time;
+                    r->lastApplyTime = r->lastContact = wallClockMs();
+                    r->changesApplied++;
+                }
+                LeaveCriticalSection(&r->lock);
+            }
+            else
+            {
+                EnterCriticalSection(&r->lock);
+                snprintf(r->error, MAX_LINE_LENGTH, "Unexpected Frame From the Primary");
+                LeaveCriticalSection(&r->lock);
+                failed = 1;
+            }
+
+            // Acknowledge once everything received so far is applied
+            if (!failed && r->bufferStart == r->bufferEnd)
+            {
+                EnterCriticalSection(&r->lock);
+                putFrameHeader(ack, FRAME_ACK, r->appliedLsn, r->lastCommitTime, 0);
+                LeaveCriticalSection(&r->lock);
+                failed = (sendAll(r->socket, ack, REPLICATION_FRAME_HEADER) != 0);
+            }
+        }
+
+        EnterCriticalSection(&r->lock);
+        if (r->socket != INVALID_SOCKET)
+        {
+            closesocket(r->socket);
+            r->socket = INVALID_SOCKET;
+        }
+        if (r->connected && r->error[0] == '\0' && !r->stopping)
+        {
+            snprintf(r->error, MAX_LINE_LENGTH, "Connection to the Primary Lost");
+        }
+        r->connected = 0;
+        LeaveCriticalSection(&r->lock);
+
+        for (int waited = 0; waited < REPLICATION_RETRY_MS && !r->stopping; waited += 100)
+        {
+            Sleep(100);
+        }
+    }
+    return 0;
+}
+
+
+
+
+/*
+printReplicaStudent - Prints the marks, grades, SGPA and result of a student of a replica's copy.
+
+Ranks need every student of the primary's database and are not shown.
+*/
+static void printReplicaStudent(const Student *s)
+{
+    StudentGrades grades;
+
+    gradeStudent(s, &grades);
+
+    printf("\n=== Student Results (Read-Only Copy) ===\n\n");
+    printf("Roll No    : %-20s\n", s->rollNo);
+    printf("Name       : %-20s\n", s->name);
+    printf("Branch/Sem : %s/%d\n\n", s->branch, s->semester);
+
+    printf("Subject                              Theory  Practical  Marks     Credits   Grade\n");
+    printf("---------------------------------------------------------------------------------\n");
+    for (int i = 0; i < TOTAL_SUBJECTS; i++)
+    {
+        char marks[16];
+
+        sprintf(marks, "%d/%d", subjectTotalMarks(s, i), subjectMarks[i].maxTheory + subjectMarks[i].maxPractical);
+        printf("%-36s %-7d %-10d %-9s %-9d %s\n", subjectMarks[i].subject,
+               subjectTheoryColumn[i] != -1 ? s->obtainedMarks[subjectTheoryColumn[i]] : 0,
+               subjectPracticalColumn[i] != -1 ? s->obtainedPracticalMarks[subjectPracticalColumn[i]] : 0,
+               marks, subjectMarks[i].credits, gradeScale[grades.gradeIndex[i]].grade);
+    }
+    printf("---------------------------------------------------------------------------------\n\n");
+
+    printf("Total Marks : %d\n", studentTotalMarks(s));
+    printf("SGPA        : %.2f\n", grades.sgpa);
+    printf("Result      : %s\n\n", grades.passed ? "PASS" : "FAIL");
+}
+
+
+
+
+/*
+printReplicaStatus - Prints the connection, log position and lag of a replica.
+
+The lag of the last change compares the primary's commit time with the local time it was applied, so it is exact
+when both programs run on one computer and needs synchronised clocks otherwise.
+*/
+static void printReplicaStatus(Replica *r)
+{
+    EnterCriticalSection(&r->lock);
+    long long now = wallClockMs();
+
+    printf("\n===== Replication Status (Follower) =====\n\n");
+    printf("Primary             : %s:%s (%s)\n", r->host, r->port, r->connected ? "Connected" : "Disconnected");
+    if (r->error[0] != '\0')
+    {
+        printf("Last Error          : %s\n", r->error);
+    }
+    printf("Students in Copy    : %d\n", r->db.count);
+    printf("Applied Position    : %lld of %lld\n", r->appliedLsn, r->primaryLsn);
+    printf("Behind By           : %lld Changes\n", r->primaryLsn - r->appliedLsn);
+    if (r->lastCommitTime > 0)
+    {
+        printf("Lag of Last Change  : %lld ms (Applied %lld ms Ago)\n", r->lastApplyTime - r->lastCommitTime, now - r->lastApplyTime);
+    }
+    printf("Changes Applied     : %ld\n", r->changesApplied);
+    printf("Snapshots Loaded    : %d\n", r->snapshotsLoaded);
+    if (r->lastContact > 0)
+    {
+        printf("Last Heard From     : %lld ms Ago\n", now - r->lastContact);
+    }
+
+    LeaveCriticalSection(&r->lock);
+}
+
+
+
+
+/*
+followPrimary - Keeps a read-only copy of another program's database and serves student lookups from it.
+
+The copy starts from a snapshot of the primary and then applies every change the primary commits. It lives only in
+memory and is never saved; following again later starts from a new snapshot.
+*/
+void followPrimary()
+{
+    char rollNo[MAX_ROLLNO_LENGTH];
+    WSADATA wsaData;
+    Student s;
+    int choice = 0, found;
+
+    Replica *r = calloc(1, sizeof(Replica));
+    if (r == NULL)
+    {
+        printf("Error : Not Enough Memory to Follow a Primary.\n");
+        return;
+    }
+
+    printf("Enter Address of the Primary (e.g. 127.0.0.1) : ");
+    scanf("%255s", r->host);
+    printf("Enter Port (e.g. %s) : ", REPLICATION_PORT);
+    scanf("%15s", r->port);
+
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+    {
+        printf("Error : Could Not Start Windows Sockets.\n");
+        free(r);
+        return;
+    }
+
+    initDatabase(&r->db, r->host);
+    r->socket = INVALID_SOCKET;
+    InitializeCriticalSection(&r->lock);
+    r->thread = CreateThread(NULL, 0, replicaThread, r, 0, NULL);
+    if (r->thread == NULL)
+    {
+        printf("Error : Could Not Start the Replication Thread.\n");
+        choice = 3;
+    }
+    else
+    {
+        printf("Following %s:%s. This Copy Is Read-Only and Kept Up to Date by the Primary.\n", r->host, r->port);
+    }
+
+    while (choice != 3)
+    {
+        printf("\n===== Read-Only Follower of %s:%s =====\n\n", r->host, r->port);
+        printf("1. Look Up Student\n");
+        printf("2. Replication Status and Lag\n");
+        printf("3. Stop Following\n\n");
+        printf("Enter Your Choice : ");
+
+        if (scanf("%d", &choice) != 1)
+        {
+            printf("Invalid Input! Please Enter a Number.\n");
+            clearInputBuffer();
+            continue;
+        }
+
+        if (choice == 1)
+        {
+            printf("Enter Student Roll Number : ");
+            scanf("%19s", rollNo);
+
+            EnterCriticalSection(&r->lock);
+            int row = findDatabaseStudent(&r->db, rollNo);
+            found = (row != -1);
+            if (found)
+            {
+                s = r->db.students[row];
+            }
+            LeaveCriticalSection(&r->lock);
+
+            if (found)
+            {
+                printReplicaStudent(&s);
+            }
+            else
+            {
+                printf("Student with Roll Number %s not found in the Copy.\n", rollNo);
+            }
+        }
+        else if (choice == 2)
+        {
+            printReplicaStatus(r);
+        }
+        else if (choice != 3)
+        {
+            printf("Invalid Choice! Please Select a Valid Option.\n");
+        }
+    }
+
+    if (r->thread != NULL)
+    {
+        InterlockedExchange(&r->stopping, 1);
+        EnterCriticalSection(&r->lock);
+        if (r->socket != INVALID_SOCKET)
+        {
+            shutdown(r->socket, SD_BOTH);
+        }
+        LeaveCriticalSection(&r->lock);
+
+        WaitForSingleObject(r->thread, INFINITE);
+        CloseHandle(r->thread);
+    }
+    DeleteCriticalSection(&r->lock);
+    freeDatabase(&r->db);
+    free(r);
+    WSACleanup();
+    printf("Stopped Following. The Copy Was Discarded.\n");
+}
+
+
+
+
+/*
+replicationMenu - Menu for serving this program's database to read-only followers or following another program.
+*/
+void replicationMenu()
+{
+    char address[256];
+    char port[16];
+    int choice;
+
+    while (1)
+    {
+        printf("\n===== Replication =====\n\n");
+        printf("1. %s\n", replicationLog == NULL ? "Serve Followers (Make This Program the Primary)" : "Stop Serving Followers");
+        printf("2. Primary Status and Follower Lag\n");
+        printf("3. Follow a Primary (Read-Only Copy)\n");
+        printf("4. Return to Admin Menu\n\n");
+        printf("Enter Your Choice : ");
+
+        if (scanf("%d", &choice) != 1)
+        {
+            printf("Invalid Input! Please Enter a Number.\n");
+            clearInputBuffer();
+            continue;
+        }
+
+        if (choice == 1 && replicationLog == NULL)
+        {
+            printf("Enter Address to Listen On (127.0.0.1 for This Computer Only, 0.0.0.0 for Every Network) : ");
+            scanf("%255s", address);
+            printf("Enter Port (e.g. %s) : ", REPLICATION_PORT);
+            scanf("%15s", port);
+
+            loadAllShards(); // Followers get every student, no-op unless the database is sharded
+            if (startReplicationPrimary(address, port) == 0)
+            {
+                printf("Serving Followers on %s:%s. Every Committed Change Is Streamed to Them.\n", address, port);
+            }
+        }
+        else if (choice == 1)
+        {
+            stopReplicationPrimary();
+            printf("Stopped Serving Followers.\n");
+        }
+        else if (choice == 2)
+        {
+            if (replicationLog == NULL)
+            {
+                printf("This Program Is Not Serving Followers.\n");
+            }
+            else
+            {
+                printReplicationStatus();
+            }
+        }
+        else if (choice == 3)
+        {
+            if (replicationLog != NULL)
+            {
+                printf("Stop Serving Followers First. A Primary Cannot Follow Another Program.\n");
+            }
+            else
+            {
+                followPrimary();
+            }
+        }
+        else if (choice == 4)
+        {
+            return;
+        }
+        else
+        {
+            printf("Invalid Choice! Please Select a Valid Option.\n");
+        }
+    }
+}
+
+
+
+
+// TraceEntry - One operation of a session trace loaded for replay
+typedef struct
+{
+    long long time;    // Recording time (ms), see wallClockMs()
+    int sequence;      // Line of the operation in the trace, keeps the order of operations recorded at the same time
+    TraceOp op;
+    char *argument;    // Roll number, CSV row, query text or number, see TraceOp
+    char session[32];  // Session that recorded the operation
+
+} TraceEntry;
+
+
+
+// ReplayInstance - One copy of a trace replayed on its own thread
+typedef struct
+{
+    const TraceEntry *entries;
+    int entryCount;
+    double speed;             // Multiple of the recorded pace, 0 for as fast as possible
+    LARGE_INTEGER start;      // Start of the replay, the same for every instance
+    long long *latencies;     // Latency of every entry, in performance counter ticks
+    unsigned char *failed;    // Set for entries that failed, e.g. the result of a roll number that does not exist
+
+} ReplayInstance;
+
+
+
+// ReplayStats - Throughput and latency of one operation type of a replay (milliseconds)
+typedef struct
+{
+    long count;
+    long failed;
+    double mean;
+    double p50;
+    double p95;
+    double p99;
+    double max;
+
+} ReplayStats;
+
+
+
+// Names of the operations in a trace file, in TraceOp order
+static const char *traceOpNames[TRACE_OP_COUNT] = {"menu", "login", "result", "search", "list", "subject",
+                                                   "merit", "query", "add", "update", "delete"};
+
+// Held by the replay thread that commits an edit, which is then the only thread using students[] (or replayRows)
+CRITICAL_SECTION replayWriteLock;
+
+// In-memory replay : the edits change this copy of the students, published as replaySnapshot, instead of the database
+static int replayInMemory = 0;
+static Student *replayRows = NULL;
+static int replayRowCount = 0;
+static StoreSnapshot *volatile replaySnapshot = NULL;
+
+
+
+
+/*
+tracing - Tells whether this session is being recorded. The first call opens TRACE_FILE if it exists.
+*/
+static int tracing()
+{
+    if (!traceChecked)
+    {
+        FILE *existing = fopen(TRACE_FILE, "r");
+
+        traceChecked = 1;
+        if (existing != NULL)
+        {
+            fclose(existing);
+            traceFile = fopen(TRACE_FILE, "a");
+            snprintf(traceSession, sizeof(traceSession), "%lu.%lld", (unsigned long)GetCurrentProcessId(), wallClockMs() % 1000000);
+        }
+    }
+    return traceFile != NULL && !traceSuspended;
+}
+
+
+
+
+/*
+traceOperation - Appends an operation of this session to TRACE_FILE.
+
+Each operation is one line : recording time (ms), session, operation name and its argument. The line is written and
+flushed at once, so several programs recording at the same time do not mix their lines.
+*/
+void traceOperation(TraceOp op, const char *format, ...)
+{
+    char argument[MAX_LINE_LENGTH];
+    va_list args;
+
+    if (!tracing())
+    {
+        return;
+    }
+
+    va_start(args, format);
+    vsnprintf(argument, MAX_LINE_LENGTH, format, args);
+    va_end(args);
+
+    fprintf(traceFile, "%lld %s %s%s%s\n", wallClockMs(), traceSession, traceOpNames[op], argument[0] != '\0' ? " " : "", argument);
+    fflush(traceFile);
+}
+
+
+
+
+/*
+traceEdit - Appends a committed add, update or delete to TRACE_FILE, with the whole student as a CSV row.
+*/
+void traceEdit(const TransactionOp *op)
+{
+    char row[MAX_CSV_ROW_LENGTH + 1];
+
+    if (!tracing())
+    {
+        return;
+    }
+
+    if (op->type == TXN_DELETE)
+    {
+        traceOperation(TRACE_DELETE, "%s", op->student.rollNo);
+        return;
+    }
+
+    int length = formatCSVRow(row, &op->student);
+    row[length - 1] = '\0'; // Without the line break
+    traceOperation(op->type == TXN_ADD ? TRACE_ADD : TRACE_UPDATE, "%s", row);
+}
+
+
+
+
+/*
+compareTraceEntries - qsort comparison putting trace entries in recording order.
+*/
+static int compareTraceEntries(const void *a, const void *b)
+{
+    const TraceEntry *x = a;
+    const TraceEntry *y = b;
+
+    if (x->time != y->time)
+    {
+        return (x->time < y->time) ? -1 : 1;
+    }
+    return x->sequence - y->sequence;
+}
+
+
+
+
+/*
+compareSessions - qsort comparison of trace entries by session, used to count the sessions of a trace.
+*/
+static int compareSessions(const void *a, const void *b)
+{
+    return strcmp(((const TraceEntry *)a)->session, ((const TraceEntry *)b)->session);
+}
+
+
+
+
+/*
+freeTrace - Frees the entries of a trace loaded by loadTrace().
+*/
+static void freeTrace(TraceEntry *entries, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        free(entries[i].argument);
+    }
+    free(entries);
+}
+
+
+
+
+/*
+loadTrace - Reads the operations of a trace file in recording order. Menu choices and comment lines are skipped.
+
+Returns:
+- The number of operations, -1 if the file could not be opened, -2 if there is not enough memory.
+*/
+static int loadTrace(const char *fileName, TraceEntry **entries, int *sessionCount)
+{
+    char line[MAX_LINE_LENGTH];
+    char opName[16];
+    int count = 0, capacity = 0, sequence = 0;
+    FILE *fp = fopen(fileName, "r");
+
+    *entries = NULL;
+    *sessionCount = 0;
+    if (fp == NULL)
+    {
+        return -1;
+    }
+
+    while (fgets(line, MAX_LINE_LENGTH, fp))
+    {
+        TraceEntry entry;
+        int argumentStart = 0;
+
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '#' || sscanf(line, "%lld %31s %15s %n", &entry.time, entry.session, opName, &argumentStart) != 3)
+        {
+            continue;
+        }
+        entry.op = TRACE_OP_COUNT;
+        for (int op = 0; op < TRACE_OP_COUNT; op++)
+        {
+            if (strcmp(opName, traceOpNames[op]) == 0)
+            {
+                entry.op = (TraceOp)op;
+            }
+        }
+        if (entry.op == TRACE_OP_COUNT || entry.op == TRACE_MENU)
+        {
+            continue;
+        }
+
+        if (count == capacity)
+        {
+            capacity = (capacity > 0) ? capacity * 2 : 256;
+            TraceEntry *grown = realloc(*entries, capacity * sizeof(TraceEntry));
+
+            if (grown == NULL)
+            {
+                fclose(fp);
+                freeTrace(*entries, count);
+                *entries = NULL;
+                return -2;
+            }
+            *entries = grown;
+        }
+        entry.sequence = sequence++;
+        entry.argument = strdup(line + argumentStart);
+        if (entry.argument == NULL)
+        {
+            fclose(fp);
+            freeTrace(*entries, count);
+            *entries = NULL;
+            return -2;
+        }
+        (*entries)[count++] = entry;
+    }
+    fclose(fp);
+
+    if (count > 0)
+    {
+        qsort(*entries, count, sizeof(TraceEntry), compareSessions);
+        for (int i = 0; i < count; i++)
+        {
+            if (i == 0 || strcmp((*entries)[i].session, (*entries)[i - 1].session) != 0)
+            {
+                (*sessionCount)++;
+            }
+        }
+        qsort(*entries, count, sizeof(TraceEntry), compareTraceEntries);
+    }
+    return count;
+}
+
+
+
+
+/*
+snapshotStudentIndex - Finds a student of a snapshot by roll number.
+
+Returns:
+- The index of the student in the snapshot, -1 if no student has this roll number.
+*/
+static int snapshotStudentIndex(const StoreSnapshot *snapshot, const char *rollNo)
+{
+    for (int i = 0; i < snapshot->count; i++)
+    {
+        if (strcmp(snapshotRow(snapshot, i)->rollNo, rollNo) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+
+
+/*
+compareTotalsDescending - qsort comparison of total marks, highest first.
+*/
+static int compareTotalsDescending(const void *a, const void *b)
+{
+    return *(const int *)b - *(const int *)a;
+}
+
+
+
+
+/*
+replayRead - Does the work of a recorded read-only operation on a snapshot, as a session would see it.
+
+This is a model of the menus, not the menus themselves : the same lookups, grading, ranking and query are done on the
+snapshot, without the prompts, the console output and the file reads of the menus (e.g. View Subject Wise Result reads
+students.csv again). The replay report says so.
+
+Returns:
+- 0 on success, -1 if the operation failed (e.g. an unknown roll number or an invalid query).
+*/
+static int replayRead(const StoreSnapshot *snapshot, const TraceEntry *e)
+{
+    char line[MAX_CSV_ROW_LENGTH + 1];
+    StudentGrades grades;
+    CompiledQuery query;
+    int i, index, result = 0;
+
+    switch (e->op)
+    {
+    case TRACE_LOGIN:
+        if (strcmp(e->argument, "admin") != 0 && snapshotStudentIndex(snapshot, e->argument) == -1)
+        {
+            result = -1;
+        }
+        break;
+
+    case TRACE_SEARCH:
+    case TRACE_RESULT:
+        index = snapshotStudentIndex(snapshot, e->argument);
+        if (index == -1)
+        {
+            result = -1;
+        }
+        else if (e->op == TRACE_RESULT)
+        {
+            // Result card : grades, SGPA and the overall rank
+            const Student *s = snapshotRow(snapshot, index);
+            int total = studentTotalMarks(s), rank = 1;
+
+            gradeStudent(s, &grades);
+            for (i = 0; i < snapshot->count; i++)
+            {
+                rank += (studentTotalMarks(snapshotRow(snapshot, i)) > total);
+            }
+            snprintf(line, sizeof(line), "%s %d %.2f %d %s", s->rollNo, total, grades.sgpa, rank, grades.passed ? "PASS" : "FAIL");
+        }
+        break;
+
+    case TRACE_LIST:
+        for (i = 0; i < snapshot->count; i++)
+        {
+            formatCSVRow(line, snapshotRow(snapshot, i));
+        }
+        break;
+
+    case TRACE_SUBJECT:
+        index = atoi(e->argument);
+        if (index < 0 || index >= TOTAL_SUBJECTS)
+        {
+            result = -1;
+            break;
+        }
+        for (i = 0; i < snapshot->count; i++)
+        {
+            const Student *s = snapshotRow(snapshot, i);
+            snprintf(line, sizeof(line), "%-15s %-25s %d", s->rollNo, s->name, subjectTotalMarks(s, index));
+        }
+        break;
+
+    case TRACE_MERIT:
+    {
+        int *totals = malloc((snapshot->count > 0 ? snapshot->count : 1) * sizeof(int));
+        int subject = (atoi(e->argument) == 3) ? 0 : -1; // Subject toppers rank every subject, the merit lists the totals
+
+        if (totals == NULL)
+        {
+            result = -1;
+            break;
+        }
+        do
+        {
+            for (i = 0; i < snapshot->count; i++)
+            {
+                const Student *s = snapshotRow(snapshot, i);
+                totals[i] = (subject == -1) ? studentTotalMarks(s) : subjectTotalMarks(s, subject);
+            }
+            qsort(totals, snapshot->count, sizeof(int), compareTotalsDescending);
+        } while (subject != -1 && ++subject < TOTAL_SUBJECTS);
+        free(totals);
+        break;
+    }
+
+    case TRACE_QUERY:
+    {
+        int n = (snapshot->count > 0) ? snapshot->count : 1;
+        Student *rows = malloc(n * sizeof(Student));
+        StudentGrades *rowGrades = malloc(n * sizeof(StudentGrades));
+        int *matches = malloc(n * sizeof(int));
+
+        if (rows == NULL || rowGrades == NULL || matches == NULL || compileQuery(e->argument, &query) != 0)
+        {
+            result = -1;
+        }
+        else
+        {
+            for (i = 0; i < snapshot->count; i++)
+            {
+                rows[i] = *snapshotRow(snapshot, i);
+                gradeStudent(&rows[i], &rowGrades[i]);
+            }
+            result = (runQuery(&query, rows, rowGrades, snapshot->count, matches) < 0) ? -1 : 0;
+        }
+        free(rows);
+        free(rowGrades);
+        free(matches);
+        break;
+    }
+
+    default:
+        result = -1;
+    }
+    return result;
+}
+
+
+
+
+/*
+acquireReplaySnapshot - Takes a reference on the snapshot of the in-memory replay, with the same grace period as acquireSnapshot().
+*/
+static StoreSnapshot *acquireReplaySnapshot()
+{
+    InterlockedIncrement(&snapshotReaders);
+    StoreSnapshot *snapshot = replaySnapshot;
+    InterlockedIncrement(&snapshot->refCount);
+    InterlockedDecrement(&snapshotReaders);
+
+    return snapshot;
+}
+
+
+
+
+/*
+replayEditInMemory - Applies a replayed add, update or delete to replayRows and publishes it as the new replaySnapshot.
+
+The marks are checked like commitTransaction() does (an update only on the columns it changes), but nothing is journaled,
+saved or sent to followers, so the database is not changed. The caller holds replayWriteLock.
+
+Returns:
+- 0 on success, -1 if the marks are out of range, the copy is full or there is not enough memory.
+*/
+static int replayEditInMemory(TraceOp op, const Student *s)
+{
+    int index = findRowByRoll(replayRows, replayRowCount, s->rollNo);
+    unsigned int invalid, changed = ALL_MARK_COLUMNS;
+
+    if (op == TRACE_DELETE)
+    {
+        if (index == -1)
+        {
+            return 0;
+        }
+        memmove(&replayRows[index], &replayRows[index + 1], (replayRowCount - index - 1) * sizeof(Student));
+        replayRowCount--;
+    }
+    else
+    {
+        if (index != -1)
+        {
+            changed = changedMarkColumns(s, &replayRows[index]);
+        }
+        validateMarkRows(s, 1, &invalid);
+        if ((invalid & changed) != 0 || (index == -1 && replayRowCount >= MAX_STUDENTS))
+        {
+            return -1;
+        }
+        replayRows[index != -1 ? index : replayRowCount++] = *s;
+    }
+
+    StoreSnapshot *snapshot = buildSnapshot(replayRows, replayRowCount);
+    if (snapshot == NULL)
+    {
+        return -1;
+    }
+    StoreSnapshot *old = InterlockedExchangePointer((PVOID volatile *)&replaySnapshot, snapshot);
+
+    while (snapshotReaders != 0)
+    {
+        Sleep(0);
+    }
+    releaseSnapshot(old);
+    return 0;
+}
+
+
+
+
+/*
+replayOperation - Replays one recorded operation against the database, or against its in-memory copy.
+
+Reads run on the current snapshot without locks, like the readers of a live session. Edits are committed as new
+versions under replayWriteLock, so only one replay thread at a time uses students[]. An add of a student that
+already exists is replayed as an update and a delete of a missing student does nothing, so every instance of a
+trace can replay the same edits. In an in-memory replay the edits only change replayRows, see replayEditInMemory().
+
+Returns:
+- 0 on success, -1 if the operation failed.
+*/
+static int replayOperation(const TraceEntry *e)
+{
+    char row[MAX_LINE_LENGTH];
+    Transaction txn;
+    Student s;
+    int result = 0;
+
+    if (e->op == TRACE_ADD || e->op == TRACE_UPDATE || e->op == TRACE_DELETE)
+    {
+        memset(&s, 0, sizeof(Student));
+        snprintf(row, MAX_LINE_LENGTH, "%s", e->argument);
+        if (e->op == TRACE_DELETE)
+        {
+            snprintf(s.rollNo, MAX_ROLLNO_LENGTH, "%s", e->argument);
+        }
+        else if (!parseStudentLine(row, &s))
+        {
+            return -1;
+        }
+
+        EnterCriticalSection(&replayWriteLock);
+        int index = replayInMemory ? -1 : findStudentByRoll(s.rollNo);
+        if (replayInMemory)
+        {
+            result = replayEditInMemory(e->op, &s);
+        }
+        else if (e->op != TRACE_DELETE || index != -1)
+        {
+            beginTransaction(&txn);
+            stageOperation(&txn, e->op == TRACE_DELETE ? TXN_DELETE : (index == -1 ? TXN_ADD : TXN_UPDATE), &s);
+            result = commitTransaction(&txn);
+        }
+        LeaveCriticalSection(&replayWriteLock);
+        return result;
+    }
+
+    StoreSnapshot *snapshot = replayInMemory ? acquireReplaySnapshot() : acquireSnapshot();
+    result = replayRead(snapshot, e);
+    releaseSnapshot(snapshot);
+    return result;
+}
+
+
+
+
+/*
+replayThread - Replays every operation of a trace in recording order and times each one.
+
+At a speed above 0 the operations keep the recorded gaps between them, divided by the speed.
+*/
+DWORD WINAPI replayThread(LPVOID param)
+{
+    ReplayInstance *instance = param;
+    LARGE_INTEGER frequency, before, after;
+
+    QueryPerformanceFrequency(&frequency);
+
+    for (int i = 0; i < instance->entryCount; i++)
+    {
+        const TraceEntry *e = &instance->entries[i];
+
+        if (instance->speed > 0)
+        {
+            long long due = (long long)((e->time - instance->entries[0].time) / instance->speed);
+
+            QueryPerformanceCounter(&before);
+            long long elapsed = (before.QuadPart - instance->start.QuadPart) * 1000 / frequency.QuadPart;
+            if (due > elapsed)
+            {
+                Sleep((DWORD)(due - elapsed));
+            }
+        }
+
+        QueryPerformanceCounter(&before);
+        instance->failed[i] = (replayOperation(e) != 0);
+        QueryPerformanceCounter(&after);
+        instance->latencies[i] = after.QuadPart - before.QuadPart;
+    }
+    return 0;
+}
+
+
+
+
+/*
+compareLatencies - qsort comparison of latencies, shortest first.
+*/
+static int compareLatencies(const void *a, const void *b)
+{
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+
+    return (x > y) - (x < y);
+}
+
+
+
+
+/*
+replayStats - Computes the count, failures, mean, percentiles and maximum latency of one operation type of a replay.
+
+op is a TraceOp, or TRACE_OP_COUNT for every operation. Percentiles use the nearest rank.
+
+Returns:
+- 0 on success, -1 if there is not enough memory.
+*/
+static int replayStats(const ReplayInstance *instances, int instanceCount, int op, double ticksPerMs, ReplayStats *stats)
+{
+    long long *latencies = malloc((size_t)instanceCount * instances[0].entryCount * sizeof(long long));
+    long long sum = 0;
+    long n = 0;
+
+    memset(stats, 0, sizeof(ReplayStats));
+    if (latencies == NULL)
+    {
+        return -1;
+    }
+
+    for (int k = 0; k < instanceCount; k++)
+    {
+        for (int i = 0; i < instances[k].entryCount; i++)
+        {
+            if (op == TRACE_OP_COUNT || instances[k].entries[i].op == (TraceOp)op)
+            {
+                latencies[n++] = instances[k].latencies[i];
+                sum += instances[k].latencies[i];
+                stats->failed += instances[k].failed[i];
+            }
+        }
+    }
+
+    stats->count = n;
+    if (n > 0)
+    {
+        qsort(latencies, n, sizeof(long long), compareLatencies);
+        stats->mean = sum / (double)n / ticksPerMs;
+        stats->p50 = latencies[(long)ceil(0.50 * n) - 1] / ticksPerMs;
+        stats->p95 = latencies[(long)ceil(0.95 * n) - 1] / ticksPerMs;
+        stats->p99 = latencies[(long)ceil(0.99 * n) - 1] / ticksPerMs;
+        stats->max = latencies[n - 1] / ticksPerMs;
+    }
+    free(latencies);
+    return 0;
+}
+
+
+
+
+/*
+writeReplayReport - Writes the throughput and the latency of every operation type of a replay.
+*/
+static void writeReplayReport(FILE *fp, const char *traceName, int sessionCount, int entryCount, int instanceCount, double speed,
+                              int inMemory, double seconds, const ReplayStats *stats)
+{
+    fprintf(fp, "\n===== Replay of %s =====\n\n", traceName);
+    fprintf(fp, "Sessions    : %d (%d Operations)\n", sessionCount, entryCount);
+    fprintf(fp, "Instances   : %d, Replayed at the Same Time\n", instanceCount);
+    if (speed > 0)
+    {
+        fprintf(fp, "Speed       : %.2f x the Recorded Pace\n", speed);
+    }
+    else
+    {
+        fprintf(fp, "Speed       : As Fast As Possible\n");
+    }
+    fprintf(fp, "Edits       : %s\n", inMemory ? "Applied to an In-Memory Copy (Not Journaled or Saved)" : "Committed to the Database");
+    fprintf(fp, "Reads       : Modelled on the Snapshot (No Console Output or File Reads of the Menus)\n");
+    fprintf(fp, "Elapsed     : %.3f s\n", seconds);
+    fprintf(fp, "Throughput  : %.1f Operations/s\n\n", stats[TRACE_OP_COUNT].count / seconds);
+
+    fprintf(fp, "Operation  Count      Failed     Ops/s        Mean (ms)  p50 (ms)   p95 (ms)   p99 (ms)   Max (ms)\n");
+    fprintf(fp, "------------------------------------------------------------------------------------------------------\n");
+    for (int op = 0; op <= TRACE_OP_COUNT; op++)
+    {
+        const ReplayStats *st = &stats[op];
+
+        if (op == TRACE_OP_COUNT)
+        {
+            fprintf(fp, "------------------------------------------------------------------------------------------------------\n");
+        }
+        else if (st->count == 0)
+        {
+            continue;
+        }
+        fprintf(fp, "%-10s %-10ld %-10ld %-12.1f %-10.3f %-10.3f %-10.3f %-10.3f %.3f\n", op == TRACE_OP_COUNT ? "All" : traceOpNames[op],
+                st->count, st->failed, st->count / seconds, st->mean, st->p50, st->p95, st->p99, st->max);
+    }
+    fprintf(fp, "\n");
+}
+
+
+
+
+/*
+replayTrace - Replays a recorded trace against the database in one or more concurrent instances and reports the
+operations per second and the latency percentiles of every operation type.
+
+Every instance replays the whole trace on its own thread, so 10 instances of a trace recorded from one class give
+the load of ten classes. The edits of the trace are either applied to an in-memory copy of the students, leaving the
+database unchanged, or committed to the database like any other edit.
+*/
+void replayTrace()
+{
+    static int lockInitialized = 0;
+    char fileName[MAX_LINE_LENGTH];
+    char answer[8];
+    TraceEntry *entries;
+    ReplayStats stats[TRACE_OP_COUNT + 1];
+    LARGE_INTEGER frequency, end;
+    HANDLE threads[REPLAY_MAX_INSTANCES];
+    int sessionCount, instanceCount, ready, edits = 0, started = 0, inMemory = 1, k;
+    double speed;
+
+    printf("Enter Trace File (e.g. %s) : ", TRACE_FILE);
+    scanf("%1023s", fileName);
+
+    int entryCount = loadTrace(fileName, &entries, &sessionCount);
+    if (entryCount == -1)
+    {
+        printf("Error Opening %s!\n", fileName);
+        return;
+    }
+    if (entryCount == -2)
+    {
+        printf("Error : Not Enough Memory to Load %s.\n", fileName);
+        return;
+    }
+    if (entryCount == 0)
+    {
+        printf("%s Has No Operations to Replay.\n", fileName);
+        free(entries);
+        return;
+    }
+
+    printf("Enter Number of Concurrent Instances (1-%d) : ", REPLAY_MAX_INSTANCES);
+    if (scanf("%d", &instanceCount) != 1 || instanceCount < 1 || instanceCount > REPLAY_MAX_INSTANCES)
+    {
+        printf("Invalid Number of Instances!\n");
+        clearInputBuffer();
+        freeTrace(entries, entryCount);
+        return;
+    }
+    printf("Enter Speed (0 = As Fast As Possible, 1 = Recorded Pace, 2 = Twice as Fast) : ");
+    if (scanf("%lf", &speed) != 1 || speed < 0)
+    {
+        printf("Invalid Speed!\n");
+        clearInputBuffer();
+        freeTrace(entries, entryCount);
+        return;
+    }
+
+    for (int i = 0; i < entryCount; i++)
+    {
+        edits += (entries[i].op == TRACE_ADD || entries[i].op == TRACE_UPDATE || entries[i].op == TRACE_DELETE);
+    }
+    if (edits > 0)
+    {
+        printf("\nThe Trace Has %d Edits. Where Should They Go?\n", edits);
+        printf("1. An In-Memory Copy of the Students (the Database Is Not Changed)\n");
+        printf("2. The Database, Committed and Saved Like Any Other Edit\n");
+        printf("Enter Your Choice : ");
+        if (scanf("%7s", answer) != 1 || (answer[0] != '1' && answer[0] != '2'))
+        {
+            printf("Replay Cancelled.\n");
+            freeTrace(entries, entryCount);
+            return;
+        }
+        inMemory = (answer[0] == '1');
+    }
+
+    ReplayInstance *instances = calloc(instanceCount, sizeof(ReplayInstance));
+    if (instances == NULL)
+    {
+        printf("Error : Not Enough Memory to Replay %s.\n", fileName);
+        freeTrace(entries, entryCount);
+        return;
+    }
+    for (ready = 0; ready < instanceCount; ready++)
+    {
+        instances[ready].entries = entries;
+        instances[ready].entryCount = entryCount;
+        instances[ready].speed = speed;
+        instances[ready].latencies = malloc(entryCount * sizeof(long long));
+        instances[ready].failed = malloc(entryCount);
+        if (instances[ready].latencies == NULL || instances[ready].failed == NULL)
+        {
+            break;
+        }
+    }
+
+    if (!lockInitialized)
+    {
+        InitializeCriticalSection(&replayWriteLock);
+        lockInitialized = 1;
+    }
+    loadAllShards(); // Replayed reads see every student, no-op unless the database is sharded
+
+    if (inMemory)
+    {
+        replayRows = malloc(MAX_STUDENTS * sizeof(Student));
+        if (replayRows == NULL)
+        {
+            printf("Error : Not Enough Memory to Replay %s.\n", fileName);
+            ready = 0;
+        }
+        else
+        {
+            memcpy(replayRows, students, studentCount * sizeof(Student));
+            replayRowCount = studentCount;
+            replaySnapshot = acquireSnapshot(); // The copy starts as the current version
+        }
+    }
+    replayInMemory = inMemory;
+
+    printf("\nReplaying %d Operations of %d Sessions in %d Instances...\n", entryCount, sessionCount, ready);
+
+    // The main thread only waits while the replay threads use the store, and the replayed edits are not recorded again
+    traceSuspended = 1;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&instances[0].start);
+    for (k = 0; k < ready; k++)
+    {
+        instances[k].start = instances[0].start;
+        threads[k] = CreateThread(NULL, 0, replayThread, &instances[k], 0, NULL);
+        if (threads[k] == NULL)
+        {
+            break;
+        }
+        started++;
+    }
+    for (k = 0; k < started; k++)
+    {
+        WaitForSingleObject(threads[k], INFINITE);
+        CloseHandle(threads[k]);
+    }
+    QueryPerformanceCounter(&end);
+    traceSuspended = 0;
+
+    if (replaySnapshot != NULL)
+    {
+        releaseSnapshot(replaySnapshot);
+        replaySnapshot = NULL;
+    }
+    free(replayRows);
+    replayRows = NULL;
+    replayInMemory = 0;
+
+    if (started < instanceCount)
+    {
+        // Out of memory or threads : the instances that ran are reported
+        printf("Warning : Only %d of %d Instances Could Be Started.\n", started, instanceCount);
+    }
+
+    double seconds = (end.QuadPart - instances[0].start.QuadPart) / (double)frequency.QuadPart;
+    int statsReady = (started > 0);
+
+    if (seconds <= 0)
+    {
+        seconds = 1e-9;
+    }
+    for (int op = 0; op <= TRACE_OP_COUNT && statsReady; op++)
+    {
+        statsReady = (replayStats(instances, started, op, frequency.QuadPart / 1000.0, &stats[op]) == 0);
+    }
+
+    if (statsReady)
+    {
+        writeReplayReport(stdout, fileName, sessionCount, entryCount, started, speed, inMemory, seconds, stats);
+
+        FILE *fp = fopen(REPLAY_REPORT_FILE, "w");
+        if (fp != NULL)
+        {
+            writeReplayReport(fp, fileName, sessionCount, entryCount, started, speed, inMemory, seconds, stats);
+            fclose(fp);
+            printf("Report saved to '%s'.\n", REPLAY_REPORT_FILE);
+        }
+    }
+    else if (started > 0)
+    {
+        printf("Error : Not Enough Memory for the Replay Report.\n");
+    }
+
+    for (k = 0; k < instanceCount; k++)
+    {
+        free(instances[k].latencies);
+        free(instances[k].failed);
+    }
+    free(instances);
+    freeTrace(entries, entryCount);
+}
+
+
+
+
+/*
+sessionRecording - Menu for recording sessions to TRACE_FILE and replaying recorded traces.
+
+Recording is on while TRACE_FILE exists : programs started while it exists (admin and student sessions) append their
+operations to it, so a whole result day can be recorded. Stopping renames the file so it can be kept and replayed.
+*/
+void sessionRecording()
+{
+    char fileName[MAX_LINE_LENGTH];
+    int choice;
+
+    while (1)
+    {
+        printf("\n===== Record and Replay Sessions =====\n\n");
+        printf("1. %s\n", tracing() ? "Stop Recording and Save the Trace" : "Start Recording Sessions");
+        printf("2. Replay a Trace (Load Test)\n");
+        printf("3. Return to Admin Menu\n\n");
+        printf("Enter Your Choice : ");
+
+        if (scanf("%d", &choice) != 1)
+        {
+            printf("Invalid Input! Please Enter a Number.\n");
+            clearInputBuffer();
+            continue;
+        }
+
+        if (choice == 1 && traceFile == NULL)
+        {
+            FILE *fp = fopen(TRACE_FILE, "a");
+
+            if (fp == NULL)
+            {
+                printf("Error : Could Not Create %s.\n", TRACE_FILE);
+                continue;
+            }
+            fprintf(fp, "# Session trace : time (ms), session, operation, argument\n");
+            fclose(fp);
+
+            traceChecked = 0; // Opens TRACE_FILE for this session
+            tracing();
+            printf("Recording to %s. Programs Started From Now On Are Recorded Too.\n", TRACE_FILE);
+        }
+        else if (choice == 1)
+        {
+            printf("Save Trace As (e.g. trace_result_day.txt) : ");
+            scanf("%1023s", fileName);
+
+            fclose(traceFile);
+            traceFile = NULL;
+            if (rename(TRACE_FILE, fileName) != 0)
+            {
+                printf("Error : Could Not Rename %s to %s. Another Program May Still Be Recording.\n", TRACE_FILE, fileName);
+            }
+            else
+            {
+                printf("Recording Stopped. Trace saved to '%s'.\n", fileName);
+            }
+        }
+        else if (choice == 2)
+        {
+            replayTrace();
+        }
+        else if (choice == 3)
+        {
+            return;
+        }
+        else
+        {
+            printf("Invalid Choice! Please Select a Valid Option.\n");
+        }
+    }
+}